@@ -0,0 +1,1473 @@
+#include "pch.h"
+#include "Benchmark.h"
+
+// Project includes
+#include "BlockCompressor.h"
+#include "Mesh.h"
+#include "MipChain.h"
+#include "MipGenerator.h"
+#include "PipelineStateTracker.h"
+#include "PngDecoder.h"
+#include "RenderQueue.h"
+#include "Sampler.h"
+#include "SoftwareRenderer.h"
+#include "Texture.h"
+#include "TextureAtlas.h"
+#include "TextureContainer.h"
+#include "TextureResidency.h"
+#include "VirtualTexture.h"
+
+// Standard includes
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <random>
+#include <thread>
+
+namespace dae
+{
+    namespace Benchmark
+    {
+#pragma region Helpers
+        namespace
+        {
+            using Clock = std::chrono::high_resolution_clock;
+
+            double SecondsSince(Clock::time_point start)
+            {
+                return std::chrono::duration<double>(Clock::now() - start).count();
+            }
+
+            std::string ToString(SamplerState samplerState)
+            {
+                switch (samplerState)
+                {
+                case SamplerState::Point:       return "POINT";
+                case SamplerState::Linear:      return "LINEAR";
+                case SamplerState::Anisotropic: return "ANISOTROPIC";
+                default:                        return "UNKNOWN";
+                }
+            }
+
+            std::string ToString(MipFilter mipFilter)
+            {
+                switch (mipFilter)
+                {
+                case MipFilter::Box:     return "BOX";
+                case MipFilter::Kaiser:  return "KAISER";
+                case MipFilter::Lanczos: return "LANCZOS";
+                default:                 return "UNKNOWN";
+                }
+            }
+
+            std::string ToString(BlockFormat blockFormat)
+            {
+                switch (blockFormat)
+                {
+                case BlockFormat::None: return "RGBA8";
+                case BlockFormat::BC1:  return "BC1";
+                case BlockFormat::BC4:  return "BC4";
+                case BlockFormat::BC5:  return "BC5";
+                case BlockFormat::BC7:  return "BC7";
+                default:                return "UNKNOWN";
+                }
+            }
+
+            std::string ToString(CompressionQuality compressionQuality)
+            {
+                switch (compressionQuality)
+                {
+                case CompressionQuality::Fast:   return "FAST";
+                case CompressionQuality::Normal: return "NORMAL";
+                case CompressionQuality::Best:   return "BEST";
+                default:                         return "UNKNOWN";
+                }
+            }
+
+            std::string ToString(AddressMode addressMode)
+            {
+                switch (addressMode)
+                {
+                case AddressMode::Wrap:   return "WRAP";
+                case AddressMode::Clamp:  return "CLAMP";
+                case AddressMode::Mirror: return "MIRROR";
+                default:                  return "UNKNOWN";
+                }
+            }
+
+            std::string ToString(TexelLayout texelLayout)
+            {
+                switch (texelLayout)
+                {
+                case TexelLayout::Linear: return "ROW-MAJOR";
+                case TexelLayout::Tiled:  return "TILED 4x4";
+                default:                  return "UNKNOWN";
+                }
+            }
+
+            std::string ToString(RasterMode rasterMode)
+            {
+                switch (rasterMode)
+                {
+                case RasterMode::Forward:          return "FORWARD";
+                case RasterMode::VisibilityBuffer: return "VISIBILITY BUFFER";
+                default:                           return "UNKNOWN";
+                }
+            }
+
+            std::string ToString(TransparencyMode transparencyMode)
+            {
+                switch (transparencyMode)
+                {
+                case TransparencyMode::Unsorted:        return "UNSORTED";
+                case TransparencyMode::Sorted:          return "SORTED";
+                case TransparencyMode::WeightedBlended: return "WEIGHTED BLENDED";
+                case TransparencyMode::KBuffer:         return "K-BUFFER";
+                default:                                return "UNKNOWN";
+                }
+            }
+
+            // FNV-1a, enough to tell two images apart
+            uint64_t Hash(const std::vector<uint32_t>& image)
+            {
+                uint64_t hash = 14695981039346656037ull;
+                for (const uint32_t texel : image)
+                {
+                    hash = (hash ^ texel) * 1099511628211ull;
+                }
+                return hash;
+            }
+
+            // Root mean square error over the RGB channels of two RGBA8 images, in 8-bit steps
+            double RootMeanSquareError(const std::vector<uint32_t>& image, const std::vector<uint32_t>& reference)
+            {
+                double sumSquares = 0.0;
+                for (size_t i = 0; i < image.size(); ++i)
+                {
+                    for (int shift = 0; shift < 24; shift += 8)
+                    {
+                        const double difference = static_cast<double>(image[i] >> shift & 0xFF) - static_cast<double>(reference[i] >> shift & 0xFF);
+                        sumSquares += difference * difference;
+                    }
+                }
+                return image.empty() ? 0.0 : std::sqrt(sumSquares / static_cast<double>(image.size() * 3));
+            }
+
+            // Footprints ranging from 4x magnification to 16x minification with up to 16:1 anisotropy
+            std::vector<SampleBatch> CreateSampleBatches(const MipChain& mipChain, int count)
+            {
+                std::mt19937                          generator{42};
+                std::uniform_real_distribution<float> uvDistribution{-2.0f, 2.0f};
+                std::uniform_real_distribution<float> scaleDistribution{-2.0f, 4.0f};
+                std::uniform_real_distribution<float> ratioDistribution{0.0f, 4.0f};
+                std::uniform_real_distribution<float> angleDistribution{0.0f, PI_2};
+
+                const float texelSize = 1.0f / static_cast<float>(mipChain.levels[0].width);
+
+                std::vector<SampleBatch> batches(count);
+                for (SampleBatch& batch : batches)
+                {
+                    for (int i = 0; i < Sampler::BATCH_SIZE; ++i)
+                    {
+                        const float major = texelSize * std::exp2(scaleDistribution(generator));
+                        const float minor = major / std::exp2(ratioDistribution(generator));
+                        const float angle = angleDistribution(generator);
+
+                        batch.u[i]    = uvDistribution(generator);
+                        batch.v[i]    = uvDistribution(generator);
+                        batch.dudx[i] =  std::cos(angle) * major;
+                        batch.dvdx[i] =  std::sin(angle) * major;
+                        batch.dudy[i] = -std::sin(angle) * minor;
+                        batch.dvdy[i] =  std::cos(angle) * minor;
+                    }
+                }
+                return batches;
+            }
+        }
+#pragma endregion
+
+        void SamplerThroughput(const Texture* texturePtr, int numBatches)
+        {
+            if (not texturePtr or texturePtr->GetMipChain().IsEmpty())
+            {
+                std::cout << RED_TEXT("**(SOFTWARE) Sampler benchmark needs a texture with CPU texels!") << '\n';
+                return;
+            }
+
+            const MipChain& mipChain = texturePtr->GetMipChain();
+            const std::vector<SampleBatch> batches = CreateSampleBatches(mipChain, 4096);
+
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Sampler benchmark: ") << mipChain.levels[0].width << 'x' << mipChain.levels[0].height
+                      << ", " << mipChain.GetLevelCount() << " mip level(s), " << numBatches * Sampler::BATCH_SIZE << " samples per mode\n";
+
+            for (int state = 0; state < static_cast<int>(SamplerState::COUNT); ++state)
+            {
+                const Sampler sampler{static_cast<SamplerState>(state)};
+
+                ColorBatch colors{};
+                float      checksum = 0.0f;
+
+                const Clock::time_point start = Clock::now();
+                for (int i = 0; i < numBatches; ++i)
+                {
+                    sampler.Sample(mipChain, batches[i % batches.size()], colors);
+                    checksum += colors.r[i % Sampler::BATCH_SIZE];
+                }
+                const double seconds = SecondsSince(start);
+
+                const double samplesPerSecond = static_cast<double>(numBatches) * Sampler::BATCH_SIZE / seconds;
+                const std::string stateString = ToString(sampler.GetState());
+
+                std::cout << GREEN_TEXT("**(SOFTWARE) Sampler ") << MAGENTA_TEXT("" + stateString + "") << " = "
+                          << std::fixed << std::setprecision(2) << samplesPerSecond / 1'000'000.0 << " MSamples/s"
+                          << " (checksum " << checksum << ")\n" << std::defaultfloat;
+            }
+        }
+
+        void TextureSampling(const Texture* texturePtr, int numRuns)
+        {
+            if (not texturePtr or texturePtr->GetMipChain().IsEmpty())
+            {
+                std::cout << RED_TEXT("**(SOFTWARE) Texture sampling benchmark needs a texture with CPU texels!") << '\n';
+                return;
+            }
+
+            const MipChain& mipChain = texturePtr->GetMipChain();
+            const MipLevel& level    = mipChain.levels[0];
+
+            // Small enough for the uvs and colors to stay in cache, so the lookups are timed and not the streaming
+            constexpr int NUM_SAMPLES = 1 << 16;
+            constexpr int SPAN_LENGTH = 64;
+
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Texture sampling benchmark: ") << level.width << 'x' << level.height << ", "
+                      << NUM_SAMPLES << " samples, " << numRuns << " run(s) per path\n";
+
+            // Texel-sized steps like a rasterized span, starting anywhere in [-0.5, 1.5] so every AddressMode has work to do
+            std::mt19937                          generator{42};
+            std::uniform_real_distribution<float> uvDistribution{-0.5f, 1.5f};
+            std::uniform_real_distribution<float> stepDistribution{-1.0f / static_cast<float>(level.width), 1.0f / static_cast<float>(level.width)};
+
+            std::vector<Vector2> uvs(NUM_SAMPLES);
+            Vector2 uv{};
+            Vector2 step{};
+            for (int i = 0; i < NUM_SAMPLES; ++i)
+            {
+                if (i % SPAN_LENGTH == 0)
+                {
+                    uv   = Vector2{uvDistribution(generator), uvDistribution(generator)};
+                    step = Vector2{stepDistribution(generator), stepDistribution(generator) * 0.125f};
+                }
+                uvs[i] = uv;
+                uv    += step;
+            }
+
+            std::vector<ColorRGB> colors(NUM_SAMPLES);
+            std::vector<ColorRGB> referenceColors(NUM_SAMPLES);
+
+            const auto timeRuns = [numRuns](const auto& sampleAll)
+            {
+                const Clock::time_point start = Clock::now();
+                for (int run = 0; run < numRuns; ++run) sampleAll();
+                return SecondsSince(start);
+            };
+
+            // What Texture::Sample used to do: clamp, index the surface and go through SDL_GetRGB for every sample. SDL needs the texels row-major
+            MipChain linearChain = mipChain;
+            linearChain.ConvertLayout(TexelLayout::Linear);
+
+            SDL_Surface* surfacePtr = SDL_CreateRGBSurfaceWithFormatFrom(linearChain.GetLevelTexels(0), level.width, level.height, 32,
+                                                                         level.width * static_cast<int>(sizeof(uint32_t)), SDL_PIXELFORMAT_RGBA32);
+            if (not surfacePtr)
+            {
+                std::cout << RED_TEXT("**(SOFTWARE) Texture sampling benchmark failed: ") << SDL_GetError() << '\n';
+                return;
+            }
+
+            const double sdlSeconds = timeRuns([&]
+            {
+                for (int i = 0; i < NUM_SAMPLES; ++i)
+                {
+                    const int x = std::min(static_cast<int>(std::clamp(uvs[i].x, 0.0f, 1.0f) * static_cast<float>(surfacePtr->w)), surfacePtr->w - 1);
+                    const int y = std::min(static_cast<int>(std::clamp(uvs[i].y, 0.0f, 1.0f) * static_cast<float>(surfacePtr->h)), surfacePtr->h - 1);
+
+                    uint8_t r, g, b;
+                    SDL_GetRGB(static_cast<const uint32_t*>(surfacePtr->pixels)[y * surfacePtr->w + x], surfacePtr->format, &r, &g, &b);
+                    referenceColors[i] = ColorRGB{static_cast<float>(r) / 255.0f, static_cast<float>(g) / 255.0f, static_cast<float>(b) / 255.0f};
+                }
+            });
+            SDL_FreeSurface(surfacePtr);
+
+            const auto printResult = [numRuns, sdlSeconds](const std::string& name, double seconds)
+            {
+                std::cout << GREEN_TEXT("**(SOFTWARE) Texture::Sample ") << MAGENTA_TEXT("" + name + "") << " = "
+                          << std::fixed << std::setprecision(2) << seconds * 1'000'000'000.0 / (static_cast<double>(NUM_SAMPLES) * numRuns) << " ns/sample, speedup "
+                          << sdlSeconds / seconds << "x\n" << std::defaultfloat;
+            };
+            printResult("SDL_GetRGB", sdlSeconds);
+
+            printResult("SINGLE CLAMP", timeRuns([&]
+            {
+                for (int i = 0; i < NUM_SAMPLES; ++i) colors[i] = texturePtr->Sample(uvs[i]);
+            }));
+
+            int numMatching = 0;
+            for (int i = 0; i < NUM_SAMPLES; ++i)
+            {
+                numMatching += colors[i].r == referenceColors[i].r and colors[i].g == referenceColors[i].g and colors[i].b == referenceColors[i].b;
+            }
+
+            for (int mode = 0; mode < static_cast<int>(AddressMode::COUNT); ++mode)
+            {
+                const AddressMode addressMode = static_cast<AddressMode>(mode);
+                printResult("BATCH " + ToString(addressMode), timeRuns([&] { texturePtr->Sample(uvs, colors, addressMode); }));
+            }
+            printResult("BATCH CLAMP sRGB TO LINEAR", timeRuns([&] { texturePtr->Sample(uvs, colors, AddressMode::Clamp, true); }));
+
+            std::cout << GREEN_TEXT("**(SOFTWARE) Texture::Sample ") << MAGENTA_TEXT("CLAMP") << " matches SDL_GetRGB for "
+                      << numMatching << " of " << NUM_SAMPLES << " samples\n";
+        }
+
+        void TexelLayouts(const Texture* texturePtr, int numRuns)
+        {
+            if (not texturePtr or texturePtr->GetMipChain().IsEmpty())
+            {
+                std::cout << RED_TEXT("**(SOFTWARE) Texel layout benchmark needs a texture with CPU texels!") << '\n';
+                return;
+            }
+
+            // Private copies, so the layout the texture is currently rendered with does not matter
+            MipChain mipChains[static_cast<int>(TexelLayout::COUNT)]{texturePtr->GetMipChain(), texturePtr->GetMipChain()};
+            for (int layout = 0; layout < static_cast<int>(TexelLayout::COUNT); ++layout)
+            {
+                mipChains[layout].ConvertLayout(static_cast<TexelLayout>(layout));
+            }
+
+            const MipLevel& level0 = mipChains[0].levels[0];
+
+            // One texel per pixel, so every lookup reads level 0 and the walk direction through memory only depends on the angle
+            constexpr int SCREEN_SIZE = 512;
+            constexpr int NUM_ANGLES  = 7;
+
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Texel layout benchmark: ") << level0.width << 'x' << level0.height << ", "
+                      << SCREEN_SIZE << 'x' << SCREEN_SIZE << " pixels at 1 texel per pixel, " << numRuns << " run(s) per layout\n";
+
+            const float texelU = 1.0f / static_cast<float>(level0.width);
+            const float texelV = 1.0f / static_cast<float>(level0.height);
+
+            std::vector<SampleBatch> batches(SCREEN_SIZE * SCREEN_SIZE / Sampler::BATCH_SIZE);
+            std::vector<ColorBatch>  colors[static_cast<int>(TexelLayout::COUNT)]{};
+
+            for (int angleIdx = 0; angleIdx < NUM_ANGLES; ++angleIdx)
+            {
+                const float angle = PI_DIV_2 * static_cast<float>(angleIdx) / static_cast<float>(NUM_ANGLES - 1);
+                const float cosine = std::cos(angle);
+                const float sine   = std::sin(angle);
+
+                // Screen rows rotated around the center of the texture, at 90 degrees every row walks down a texel column
+                for (int y = 0; y < SCREEN_SIZE; ++y)
+                {
+                    for (int x = 0; x < SCREEN_SIZE; ++x)
+                    {
+                        const float px = static_cast<float>(x - SCREEN_SIZE / 2) + 0.5f;
+                        const float py = static_cast<float>(y - SCREEN_SIZE / 2) + 0.5f;
+
+                        SampleBatch& batch = batches[(y * SCREEN_SIZE + x) / Sampler::BATCH_SIZE];
+                        const int    i     = x % Sampler::BATCH_SIZE;
+
+                        batch.u[i]    = 0.5f + (cosine * px - sine * py) * texelU;
+                        batch.v[i]    = 0.5f + (sine * px + cosine * py) * texelV;
+                        batch.dudx[i] =  cosine * texelU;
+                        batch.dvdx[i] =  sine   * texelV;
+                        batch.dudy[i] = -sine   * texelU;
+                        batch.dvdy[i] =  cosine * texelV;
+                    }
+                }
+
+                for (const SamplerState samplerState : {SamplerState::Point, SamplerState::Linear})
+                {
+                    const Sampler sampler{samplerState};
+
+                    double seconds[static_cast<int>(TexelLayout::COUNT)]{};
+                    for (int layout = 0; layout < static_cast<int>(TexelLayout::COUNT); ++layout)
+                    {
+                        colors[layout].resize(batches.size());
+
+                        const Clock::time_point start = Clock::now();
+                        for (int run = 0; run < numRuns; ++run)
+                        {
+                            for (size_t i = 0; i < batches.size(); ++i) sampler.Sample(mipChains[layout], batches[i], colors[layout][i]);
+                        }
+                        seconds[layout] = SecondsSince(start);
+                    }
+
+                    int numMismatches = 0;
+                    for (size_t i = 0; i < batches.size(); ++i)
+                    {
+                        numMismatches += std::memcmp(&colors[0][i], &colors[1][i], sizeof(ColorBatch)) != 0;
+                    }
+
+                    const double samplesPerRun = static_cast<double>(batches.size()) * Sampler::BATCH_SIZE;
+                    const std::string modeString = ToString(samplerState) + ' ' + std::to_string(static_cast<int>(std::round(angle * TO_DEGREES))) + " DEG";
+
+                    std::cout << GREEN_TEXT("**(SOFTWARE) Texel layout ") << MAGENTA_TEXT("" + modeString + "") << " = " << std::fixed << std::setprecision(2);
+                    for (int layout = 0; layout < static_cast<int>(TexelLayout::COUNT); ++layout)
+                    {
+                        std::cout << ToString(static_cast<TexelLayout>(layout)) << ' ' << seconds[layout] * 1'000'000'000.0 / (samplesPerRun * numRuns) << " ns/sample, ";
+                    }
+                    std::cout << "speedup " << seconds[0] / seconds[1] << "x, " << numMismatches << " batch(es) differ\n" << std::defaultfloat;
+                }
+            }
+
+            const double linearMiB = static_cast<double>(mipChains[0].texels.size() * sizeof(uint32_t)) / (1024.0 * 1024.0);
+            const double tiledMiB  = static_cast<double>(mipChains[1].texels.size() * sizeof(uint32_t)) / (1024.0 * 1024.0);
+            std::cout << GREEN_TEXT("**(SOFTWARE) Texel layout memory ") << MAGENTA_TEXT("TILED 4x4") << " = " << std::fixed << std::setprecision(2)
+                      << tiledMiB << " MiB against " << linearMiB << " MiB row-major, the small mips are padded to whole tiles\n" << std::defaultfloat;
+        }
+
+        void MipGeneration(const std::vector<const Texture*>& texturePtrs, int numRuns)
+        {
+            // Only level 0 of every texture, the generator rebuilds the rest
+            std::vector<MipChain> baseLevels{};
+            for (const Texture* texturePtr : texturePtrs)
+            {
+                if (not texturePtr or texturePtr->GetMipChain().IsEmpty()) continue;
+
+                const MipChain& mipChain = texturePtr->GetMipChain();
+                const MipLevel& level0   = mipChain.levels[0];
+
+                MipChain& baseLevel = baseLevels.emplace_back();
+                baseLevel.layout = mipChain.layout;
+                baseLevel.levels.push_back(level0);
+                baseLevel.texels.assign(mipChain.GetLevelTexels(0), mipChain.GetLevelTexels(0) + MipChain::GetLevelTexelCount(level0.width, level0.height, mipChain.layout));
+            }
+
+            if (baseLevels.empty())
+            {
+                std::cout << RED_TEXT("**(SOFTWARE) Mip generation benchmark needs textures with CPU texels!") << '\n';
+                return;
+            }
+
+            size_t baseBytes    = 0;
+            size_t chainBytes   = 0;
+            size_t scratchBytes = 0;
+            for (const MipChain& baseLevel : baseLevels)
+            {
+                const int width  = baseLevel.levels[0].width;
+                const int height = baseLevel.levels[0].height;
+
+                baseBytes   += static_cast<size_t>(width) * height * sizeof(uint32_t);
+                chainBytes  += MipGenerator::GetTexelCount(width, height) * sizeof(uint32_t);
+
+                // Linear RGBA floats of level 0, plus the horizontal pass and level 1 during the first step
+                const size_t level0Floats = static_cast<size_t>(width) * height * 4;
+                scratchBytes = std::max(scratchBytes, (level0Floats + level0Floats / 2 + level0Floats / 4) * sizeof(float));
+            }
+
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Mip generation benchmark: ") << baseLevels.size() << " texture(s), "
+                      << numRuns << " run(s) per filter, " << std::thread::hardware_concurrency() << " hardware threads\n";
+
+            for (int filter = 0; filter < static_cast<int>(MipFilter::COUNT); ++filter)
+            {
+                double serialSeconds = 0.0;
+                for (const bool isParallel : {false, true})
+                {
+                    const MipGenerator generator{MipSettings{static_cast<MipFilter>(filter), true, isParallel}};
+
+                    double seconds = 0.0;
+                    for (int run = 0; run < numRuns; ++run)
+                    {
+                        for (const MipChain& baseLevel : baseLevels)
+                        {
+                            MipChain mipChain = baseLevel;
+
+                            const Clock::time_point start = Clock::now();
+                            generator.Generate(mipChain);
+                            seconds += SecondsSince(start);
+                        }
+                    }
+                    if (not isParallel) serialSeconds = seconds;
+
+                    const std::string filterString = ToString(generator.GetSettings().filter) + (isParallel ? " (PARALLEL)" : " (SERIAL)");
+
+                    std::cout << GREEN_TEXT("**(SOFTWARE) Mip filter ") << MAGENTA_TEXT("" + filterString + "") << " = "
+                              << std::fixed << std::setprecision(2) << seconds * 1000.0 / numRuns << " ms for all chains";
+                    if (isParallel) std::cout << ", speedup " << serialSeconds / seconds << 'x';
+                    std::cout << '\n' << std::defaultfloat;
+                }
+            }
+
+            std::cout << GREEN_TEXT("**(SOFTWARE) Mip memory ") << MAGENTA_TEXT("RGBA8") << " = "
+                      << std::fixed << std::setprecision(2) << static_cast<double>(baseBytes) / (1024.0 * 1024.0) << " MiB base, "
+                      << static_cast<double>(chainBytes) / (1024.0 * 1024.0) << " MiB with mips (+"
+                      << (static_cast<double>(chainBytes) / static_cast<double>(baseBytes) - 1.0) * 100.0 << "%), "
+                      << static_cast<double>(scratchBytes) / (1024.0 * 1024.0) << " MiB float scratch at peak\n" << std::defaultfloat;
+        }
+
+        void BlockCompression(const std::vector<std::pair<const Texture*, BlockFormat>>& textures)
+        {
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Block compression benchmark: ") << textures.size() << " texture(s), "
+                      << std::thread::hardware_concurrency() << " hardware threads\n";
+
+            for (const auto& [texturePtr, format] : textures)
+            {
+                if (not texturePtr or texturePtr->GetMipChain().IsEmpty() or format == BlockFormat::None)
+                {
+                    std::cout << RED_TEXT("**(SOFTWARE) Block compression benchmark needs a texture with CPU texels and a block format!") << '\n';
+                    continue;
+                }
+
+                const MipChain& mipChain = texturePtr->GetMipChain();
+                const double    rgbaMiB  = static_cast<double>(mipChain.texels.size() * sizeof(uint32_t)) / (1024.0 * 1024.0);
+
+                for (int quality = 0; quality < static_cast<int>(CompressionQuality::COUNT); ++quality)
+                {
+                    CompressedChain compressedChain{};
+                    double          serialSeconds = 0.0;
+                    double          seconds       = 0.0;
+                    for (const bool isParallel : {false, true})
+                    {
+                        const Clock::time_point start = Clock::now();
+                        BlockCompressor{CompressionSettings{format, static_cast<CompressionQuality>(quality), isParallel}}.Compress(mipChain, compressedChain);
+                        (isParallel ? seconds : serialSeconds) = SecondsSince(start);
+                    }
+
+                    const double compressedMiB = static_cast<double>(compressedChain.blocks.size()) / (1024.0 * 1024.0);
+                    const std::string formatString = ToString(format) + ' ' + ToString(static_cast<CompressionQuality>(quality)) + ' '
+                                                   + std::to_string(mipChain.levels[0].width) + 'x' + std::to_string(mipChain.levels[0].height);
+
+                    std::cout << GREEN_TEXT("**(SOFTWARE) Compressed ") << MAGENTA_TEXT("" + formatString + "") << " = "
+                              << std::fixed << std::setprecision(2) << seconds * 1000.0 << " ms (serial " << serialSeconds * 1000.0 << " ms), "
+                              << BlockCompressor::ComputePSNR(mipChain, compressedChain) << " dB PSNR, "
+                              << compressedMiB << " MiB instead of " << rgbaMiB << " MiB (" << rgbaMiB / compressedMiB << "x smaller)\n" << std::defaultfloat;
+                }
+            }
+        }
+
+        void TextureLoading(ID3D11Device* devicePtr, const std::vector<TextureAsset>& assets, int numRuns)
+        {
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Texture loading benchmark: ") << assets.size() << " texture(s), " << numRuns << " run(s) per path\n";
+
+            // Bake whatever is missing first, the benchmark compares the two paths and not the converter
+            for (const TextureAsset& asset : assets)
+            {
+                if (not std::filesystem::exists(TextureContainer::GetContainerPath(asset))) TextureContainer::Convert(asset);
+            }
+
+            const auto timeLoads = [devicePtr, &assets, numRuns](bool isBaked)
+            {
+                const Clock::time_point start = Clock::now();
+                for (int run = 0; run < numRuns; ++run)
+                {
+                    for (const TextureAsset& asset : assets)
+                    {
+                        const Texture* texturePtr = nullptr;
+                        if      (isBaked)                 texturePtr = Texture::LoadFromFile(TextureContainer::GetContainerPath(asset), devicePtr);
+                        else if (asset.alphaPath.empty()) texturePtr = Texture::LoadFromFile(asset.path, devicePtr, asset.mipSettings, asset.compressionSettings);
+                        else                              texturePtr = Texture::LoadPacked(asset.path, asset.alphaPath, devicePtr, asset.mipSettings, asset.compressionSettings);
+                        delete texturePtr;
+                    }
+                }
+                return SecondsSince(start) / numRuns;
+            };
+
+            const double decodeSeconds = timeLoads(false);
+            const double bakedSeconds  = timeLoads(true);
+
+            uintmax_t imageBytes     = 0;
+            uintmax_t containerBytes = 0;
+            for (const TextureAsset& asset : assets)
+            {
+                std::error_code error{};
+                imageBytes     += std::filesystem::file_size(asset.path, error);
+                containerBytes += std::filesystem::file_size(TextureContainer::GetContainerPath(asset), error);
+                if (not asset.alphaPath.empty()) imageBytes += std::filesystem::file_size(asset.alphaPath, error);
+            }
+
+            std::cout << GREEN_TEXT("**(SOFTWARE) Loaded ") << MAGENTA_TEXT("IMAGES") << " = "
+                      << std::fixed << std::setprecision(2) << decodeSeconds * 1000.0 << " ms (decode, mips and compression), "
+                      << static_cast<double>(imageBytes) / (1024.0 * 1024.0) << " MiB on disk\n";
+            std::cout << GREEN_TEXT("**(SOFTWARE) Loaded ") << MAGENTA_TEXT("CONTAINERS") << " = "
+                      << bakedSeconds * 1000.0 << " ms (memory-mapped), " << static_cast<double>(containerBytes) / (1024.0 * 1024.0) << " MiB on disk, speedup "
+                      << decodeSeconds / bakedSeconds << "x\n" << std::defaultfloat;
+        }
+
+        void PngDecoding(const std::string& directory, int numRuns)
+        {
+            std::vector<std::string> paths{};
+            std::error_code          error{};
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{directory, error})
+            {
+                if (entry.path().extension() == ".png") paths.push_back(entry.path().string());
+            }
+            std::sort(paths.begin(), paths.end());
+
+            if (paths.empty())
+            {
+                std::cout << RED_TEXT("**(SOFTWARE) PNG decoding benchmark found no .png files in ") << directory << '\n';
+                return;
+            }
+
+            std::cout << YELLOW_TEXT("**(SOFTWARE) PNG decoding benchmark: ") << paths.size() << " file(s) in " << directory << ", "
+                      << numRuns << " run(s) per path, " << std::thread::hardware_concurrency() << " hardware threads\n";
+
+            // Both decoders against each other, on the RGBA32 layout the textures are built from
+            uintmax_t fileBytes    = 0;
+            size_t    decodedBytes = 0;
+            for (const std::string& path : paths)
+            {
+                fileBytes += std::filesystem::file_size(path, error);
+
+                SDL_Surface* referencePtr = IMG_Load(path.c_str());
+                SDL_Surface* convertedPtr = referencePtr ? SDL_ConvertSurfaceFormat(referencePtr, SDL_PIXELFORMAT_RGBA32, 0) : nullptr;
+                SDL_Surface* decodedPtr   = PngDecoder::Load(path);
+                SDL_FreeSurface(referencePtr);
+
+                std::string result{};
+                if (not convertedPtr)
+                {
+                    result = "SDL_image failed: " + std::string{SDL_GetError()};
+                }
+                else if (not decodedPtr)
+                {
+                    result = "left to SDL_image";
+                }
+                else
+                {
+                    int numDifferent = 0;
+                    for (int y = 0; y < convertedPtr->h; ++y)
+                    {
+                        const uint32_t* referenceRowPtr = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(convertedPtr->pixels) + y * convertedPtr->pitch);
+                        const uint32_t* decodedRowPtr   = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(decodedPtr->pixels)   + y * decodedPtr->pitch);
+                        for (int x = 0; x < convertedPtr->w; ++x) numDifferent += referenceRowPtr[x] != decodedRowPtr[x];
+                    }
+                    result = numDifferent == 0 ? "identical" : std::to_string(numDifferent) + " texel(s) differ";
+                    decodedBytes += static_cast<size_t>(decodedPtr->w) * decodedPtr->h * sizeof(uint32_t);
+                }
+
+                const std::string name = std::filesystem::path{path}.filename().string();
+                std::cout << GREEN_TEXT("**(SOFTWARE) PNG ") << MAGENTA_TEXT("" + name + "") << " = "
+                          << (convertedPtr ? std::to_string(convertedPtr->w) + 'x' + std::to_string(convertedPtr->h) + ", " : "") << result << '\n';
+
+                SDL_FreeSurface(convertedPtr);
+                SDL_FreeSurface(decodedPtr);
+            }
+
+            const auto timeLoads = [numRuns](const auto& loadAll)
+            {
+                const Clock::time_point start = Clock::now();
+                for (int run = 0; run < numRuns; ++run)
+                {
+                    for (SDL_Surface* surfacePtr : loadAll()) SDL_FreeSurface(surfacePtr);
+                }
+                return SecondsSince(start) / numRuns;
+            };
+
+            const double sdlSeconds = timeLoads([&paths]
+            {
+                std::vector<SDL_Surface*> surfacePtrs{};
+                for (const std::string& path : paths) surfacePtrs.push_back(IMG_Load(path.c_str()));
+                return surfacePtrs;
+            });
+            const double serialSeconds = timeLoads([&paths]
+            {
+                std::vector<SDL_Surface*> surfacePtrs{};
+                for (const std::string& path : paths) surfacePtrs.push_back(PngDecoder::Load(path));
+                return surfacePtrs;
+            });
+            const double parallelSeconds = timeLoads([&paths] { return PngDecoder::LoadFiles(paths); });
+
+            // MiB/s of RGBA8 output, the same for both decoders
+            const double decodedMiB = static_cast<double>(decodedBytes) / (1024.0 * 1024.0);
+            const auto printResult = [decodedMiB, sdlSeconds](const std::string& name, double seconds)
+            {
+                std::cout << GREEN_TEXT("**(SOFTWARE) Decoded ") << MAGENTA_TEXT("" + name + "") << " = "
+                          << std::fixed << std::setprecision(2) << seconds * 1000.0 << " ms, " << decodedMiB / seconds << " MiB/s, speedup "
+                          << sdlSeconds / seconds << "x\n" << std::defaultfloat;
+            };
+            printResult("IMG_Load", sdlSeconds);
+            printResult("PngDecoder", serialSeconds);
+            printResult("PngDecoder (PARALLEL)", parallelSeconds);
+
+            std::cout << GREEN_TEXT("**(SOFTWARE) PNG data ") << MAGENTA_TEXT("TOTAL") << " = " << std::fixed << std::setprecision(2)
+                      << static_cast<double>(fileBytes) / (1024.0 * 1024.0) << " MiB on disk, " << decodedMiB << " MiB decoded\n" << std::defaultfloat;
+        }
+
+        void TextureStreaming(ID3D11Device* devicePtr, const std::vector<TextureAsset>& assets, int numTextures, size_t budgetBytes, int numFrames)
+        {
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Texture streaming benchmark: ") << numTextures << " texture(s) from " << assets.size() << " container(s), "
+                      << numFrames << " frame(s)\n";
+
+            std::vector<std::string> containerPaths{};
+            for (const TextureAsset& asset : assets)
+            {
+                const std::string containerPath = TextureContainer::GetContainerPath(asset);
+                if (not std::filesystem::exists(containerPath)) TextureContainer::Convert(asset);
+                containerPaths.push_back(containerPath);
+            }
+
+            // One unit sphere per texture, alternating left and right of a corridor the camera flies down
+            constexpr float SPACING      = 2.0f;
+            constexpr float RADIUS       = 1.0f;
+            constexpr float TAN_HALF_FOV = 0.41421356f; // 45 degrees
+            constexpr float HEIGHT       = 1080.0f;
+
+            const float length = SPACING * static_cast<float>(numTextures);
+
+            const auto flyThrough = [&](size_t budget)
+            {
+                TextureResidency residency{devicePtr, budget};
+
+                std::vector<Texture*> texturePtrs{};
+                size_t                fullBytes = 0;
+                for (int i = 0; i < numTextures; ++i)
+                {
+                    Texture* texturePtr = residency.Load(containerPaths[i % containerPaths.size()]);
+                    if (not texturePtr) continue;
+                    texturePtrs.push_back(texturePtr);
+
+                    TextureContainer container{};
+                    if (not container.Open(containerPaths[i % containerPaths.size()])) continue;
+                    for (int level = 0; level < container.GetLevelCount(); ++level) fullBytes += container.GetSlicePitch(level);
+                }
+
+                double maxUpdateMs   = 0.0;
+                int    pendingFrames = 0;
+                size_t overBudget    = 0;
+
+                const Clock::time_point start = Clock::now();
+                for (int frame = 0; frame < numFrames; ++frame)
+                {
+                    const float cameraZ = length * static_cast<float>(frame) / static_cast<float>(std::max(numFrames - 1, 1)) - 10.0f;
+                    for (size_t i = 0; i < texturePtrs.size(); ++i)
+                    {
+                        const float z = SPACING * static_cast<float>(i);
+                        if (z < cameraZ) continue;
+
+                        const float x        = i % 2 == 0 ? -3.0f : 3.0f;
+                        const float distance = std::sqrt(x * x + (z - cameraZ) * (z - cameraZ));
+                        const float pixels   = RADIUS * HEIGHT / (distance * TAN_HALF_FOV);
+                        const int   size     = texturePtrs[i]->GetMipChain().levels[0].width;
+                        residency.RequestLevel(texturePtrs[i], std::log2(static_cast<float>(size) / pixels) - 1.0f);
+                    }
+
+                    const Clock::time_point updateStart = Clock::now();
+                    residency.Update();
+                    maxUpdateMs = std::max(maxUpdateMs, SecondsSince(updateStart) * 1000.0);
+
+                    const ResidencyStats& stats = residency.GetStats();
+                    if (stats.pendingTextures > 0) ++pendingFrames;
+                    if (stats.residentBytes > budget) overBudget = std::max(overBudget, stats.residentBytes - budget);
+                }
+                const double totalSeconds = SecondsSince(start);
+
+                const ResidencyStats& stats = residency.GetStats();
+                const auto toMiB = [](size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+
+                const std::string name = budget == SIZE_MAX ? "UNLIMITED" : "BUDGET " + std::to_string(budget >> 20) + " MiB";
+                std::cout << GREEN_TEXT("**(SOFTWARE) Streaming ") << MAGENTA_TEXT("" + name + "") << " = " << std::fixed << std::setprecision(2)
+                          << toMiB(stats.peakBytes) << " MiB peak of " << toMiB(fullBytes) << " MiB fully resident, "
+                          << stats.levelsStreamedIn << " level(s) in, " << stats.levelsEvicted << " evicted, " << toMiB(stats.bytesUploaded) << " MiB uploaded\n";
+                std::cout << GREEN_TEXT("**(SOFTWARE) Streaming ") << MAGENTA_TEXT("" + name + "") << " = "
+                          << totalSeconds * 1000.0 / numFrames << " ms per frame (" << maxUpdateMs << " ms max Update()), "
+                          << pendingFrames << " frame(s) with pending requests, " << toMiB(overBudget) << " MiB over budget\n" << std::defaultfloat;
+
+                // Unregistered first, the manager still points at them
+                for (Texture* texturePtr : texturePtrs)
+                {
+                    residency.Unregister(texturePtr);
+                    delete texturePtr;
+                }
+            };
+
+            flyThrough(SIZE_MAX);
+            flyThrough(budgetBytes);
+        }
+
+        void AtlasPacking(int numTextures, int numRuns)
+        {
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Atlas packing benchmark: ") << numTextures << " texture(s) from 32 to 256 texels a side, "
+                      << AtlasSettings{}.maxPageSize << "x" << AtlasSettings{}.maxPageSize << " pages at most, " << numRuns << " run(s)\n";
+
+            // Noise over a color per texture, so a texel that came from a neighbour is always told apart
+            std::mt19937                       generator{42};
+            std::uniform_int_distribution<int> sizeShift{5, 8};
+            std::uniform_int_distribution<int> byte{0, 255};
+
+            std::vector<std::string> names{};
+            std::vector<MipChain>    mipChains(numTextures);
+            for (int i = 0; i < numTextures; ++i)
+            {
+                MipChain& mipChain = mipChains[i];
+                mipChain.AddLevel(1 << sizeShift(generator), 1 << sizeShift(generator));
+
+                const uint32_t color = static_cast<uint32_t>(byte(generator)) | static_cast<uint32_t>(byte(generator)) << 8 | 0xFF000000u;
+                for (uint32_t& texel : mipChain.texels) texel = color ^ static_cast<uint32_t>(byte(generator) & 0x3F) << 16;
+                MipGenerator{MipSettings{MipFilter::Box}}.Generate(mipChain);
+
+                names.push_back("texture_" + std::to_string(i));
+            }
+
+            std::vector<const MipChain*> mipChainPtrs{};
+            for (const MipChain& mipChain : mipChains) mipChainPtrs.push_back(&mipChain);
+
+            // Every level needs a gutter of at least one texel, so fewer levels allow narrower gutters and pack small textures tighter
+            const auto packWith = [&](const AtlasSettings& settings)
+            {
+                const std::string name = "LEVELS " + std::to_string(settings.levelCount) + " GUTTER " + std::to_string(settings.gutter);
+
+                TextureAtlas atlas{};
+                const Clock::time_point start = Clock::now();
+                for (int run = 0; run < numRuns; ++run) atlas.Build(names, mipChainPtrs, settings);
+                const double buildSeconds = SecondsSince(start) / numRuns;
+
+                // Both taps of a bilinear lookup along each axis, at every level, for uvs that reach the edge of the gutter.
+                // Each one has to read the texel the WRAP sampler would have read from the texture on its own
+                size_t numTaps       = 0;
+                size_t numMismatches = 0;
+                for (int i = 0; i < numTextures; ++i)
+                {
+                    const AtlasRect* rectPtr = atlas.Find(names[i]);
+                    if (not rectPtr) continue;
+
+                    const MipChain& page = atlas.GetPage(rectPtr->page);
+                    for (int level = 0; level < page.GetLevelCount(); ++level)
+                    {
+                        const int width  = rectPtr->width  >> level;
+                        const int height = rectPtr->height >> level;
+                        const int gutter = rectPtr->gutter >> level;
+
+                        std::uniform_int_distribution<int> tapX{-gutter, width  + gutter - 2};
+                        std::uniform_int_distribution<int> tapY{-gutter, height + gutter - 2};
+                        for (int sample = 0; sample < 64; ++sample)
+                        {
+                            const int x = tapX(generator);
+                            const int y = tapY(generator);
+                            for (int tap = 0; tap < 4; ++tap)
+                            {
+                                const int tx = x + (tap & 1);
+                                const int ty = y + (tap >> 1);
+                                const uint32_t expected = mipChains[i].GetTexel(level, (tx % width + width) % width, (ty % height + height) % height);
+                                const uint32_t actual   = page.GetTexel(level, (rectPtr->x >> level) + tx, (rectPtr->y >> level) + ty);
+
+                                numMismatches += expected != actual;
+                                ++numTaps;
+                            }
+                        }
+                    }
+                }
+
+                size_t sourceBytes = 0;
+                size_t pageBytes   = 0;
+                for (const MipChain& mipChain : mipChains)               sourceBytes += mipChain.texels.size() * sizeof(uint32_t);
+                for (int page = 0; page < atlas.GetPageCount(); ++page) pageBytes   += atlas.GetPage(page).texels.size() * sizeof(uint32_t);
+
+                std::cout << GREEN_TEXT("**(SOFTWARE) Atlas ") << MAGENTA_TEXT("" + name + "") << " = " << atlas.GetRectCount() << " of " << numTextures
+                          << " texture(s) in " << atlas.GetPageCount() << " page(s), " << std::fixed << std::setprecision(2) << atlas.GetOccupancy() * 100.0f
+                          << "% occupied, " << buildSeconds * 1000.0 << " ms per build\n";
+                std::cout << GREEN_TEXT("**(SOFTWARE) Atlas ") << MAGENTA_TEXT("" + name + "") << " = " << static_cast<double>(pageBytes) / (1024.0 * 1024.0)
+                          << " MiB of pages for " << static_cast<double>(sourceBytes) / (1024.0 * 1024.0) << " MiB of textures, "
+                          << numTextures << " binding(s) down to " << atlas.GetPageCount() << '\n' << std::defaultfloat;
+                std::cout << GREEN_TEXT("**(SOFTWARE) Atlas ") << MAGENTA_TEXT("" + name + "") << " = " << numTaps << " bilinear tap(s) at every level, "
+                          << numMismatches << " read another texel than a wrapped lookup\n";
+            };
+
+            packWith(AtlasSettings{4096, 4, 8});
+            packWith(AtlasSettings{});
+        }
+
+        void RenderQueueSorting(int numPackets, int numGeometries, int numMaterials, int numFrames)
+        {
+            std::cout << YELLOW_TEXT("**(HARDWARE) Render queue benchmark: ") << numPackets << " packet(s) over " << numGeometries << " geometries and "
+                      << numMaterials << " materials, " << numFrames << " frame(s)\n";
+
+            // A quarter of the draws is transparent, every frame moves the camera so the depths change
+            std::mt19937                          generator{42};
+            std::uniform_int_distribution<int>    geometry{0, numGeometries - 1};
+            std::uniform_int_distribution<int>    material{0, numMaterials - 1};
+            std::uniform_int_distribution<int>    pass{0, 2};
+            std::uniform_int_distribution<int>    layer{0, 3};
+            std::uniform_real_distribution<float> depth{0.1f, 500.0f};
+
+            std::vector<DrawPacket> packets(numPackets);
+            for (DrawPacket& packet : packets)
+            {
+                packet.geometryId = static_cast<uint16_t>(geometry(generator));
+                packet.materialId = static_cast<uint16_t>(material(generator));
+                packet.passIdx    = static_cast<uint8_t>(pass(generator));
+                packet.layer      = layer(generator) == 0 ? RenderLayer::Transparent : RenderLayer::Opaque;
+            }
+
+            RenderQueue      queue{};
+            RecordingBackend backend{};
+
+            size_t unsortedStateChanges = 0;
+            size_t sortedStateChanges   = 0;
+            size_t misorderedPackets    = 0;
+            double sortSeconds          = 0.0;
+            for (int frame = 0; frame < numFrames; ++frame)
+            {
+                queue.Clear();
+                for (DrawPacket& packet : packets)
+                {
+                    packet.depth = depth(generator);
+                    queue.Add(packet);
+                }
+
+                backend.Clear();
+                queue.Submit(backend);
+                unsortedStateChanges += backend.GetStateChangeCount();
+
+                const Clock::time_point start = Clock::now();
+                queue.Sort();
+                sortSeconds += SecondsSince(start);
+
+                backend.Clear();
+                queue.Submit(backend);
+                sortedStateChanges += backend.GetStateChangeCount();
+
+                // Depths only have to be ordered across the transparent layer and where the state ties. The keys keep 15 bits of
+                // mantissa, depths closer than that may come in either order
+                constexpr float tolerance = 1.0001f;
+                for (size_t i = 1; i < queue.GetPacketCount(); ++i)
+                {
+                    const DrawPacket& previous = queue.GetPacket(i - 1);
+                    const DrawPacket& current  = queue.GetPacket(i);
+
+                    const bool isSameState = previous.geometryId == current.geometryId and previous.materialId == current.materialId
+                                             and previous.passIdx == current.passIdx;
+                    if (previous.layer != current.layer)                misorderedPackets += previous.layer == RenderLayer::Transparent;
+                    else if (current.layer == RenderLayer::Transparent) misorderedPackets += previous.depth * tolerance < current.depth;
+                    else if (isSameState)                               misorderedPackets += previous.depth > current.depth * tolerance;
+                }
+            }
+
+            const RenderQueueStats& stats = queue.GetStats();
+            std::cout << GREEN_TEXT("**(HARDWARE) Render queue ") << MAGENTA_TEXT("UNSORTED") << " = " << unsortedStateChanges / numFrames << " state change(s) per frame\n";
+            std::cout << GREEN_TEXT("**(HARDWARE) Render queue ") << MAGENTA_TEXT("SORTED") << " = " << sortedStateChanges / numFrames << " state change(s) per frame ("
+                      << stats.geometryBinds << " geometry, " << stats.materialBinds << " material, " << stats.passBinds << " pass), " << std::fixed << std::setprecision(3)
+                      << sortSeconds * 1000.0 / numFrames << " ms per sort in " << stats.sortPasses << " radix pass(es), " << misorderedPackets
+                      << " packet(s) out of order\n" << std::defaultfloat;
+        }
+
+        void HardwareInstancing(ID3D11DeviceContext* deviceContextPtr, Mesh& mesh, PipelineStateTracker& stateTracker, const std::vector<Matrix>& worldMatrices,
+                                const Matrix& viewMatrix, const Matrix& projectionMatrix, int numFrames)
+        {
+            const size_t numInstances = worldMatrices.size();
+            std::cout << YELLOW_TEXT("**(HARDWARE) Instancing benchmark: ") << numInstances << " instance(s), " << numFrames << " frame(s) per path\n";
+
+            // An event query tells when the GPU caught up, so every path is timed until its draws are done rather than only submitted
+            ID3D11Device* devicePtr = nullptr;
+            deviceContextPtr->GetDevice(&devicePtr);
+
+            D3D11_QUERY_DESC queryDesc{};
+            queryDesc.Query = D3D11_QUERY_EVENT;
+
+            ID3D11Query*  queryPtr = nullptr;
+            const HRESULT result   = devicePtr->CreateQuery(&queryDesc, &queryPtr);
+            SAFE_RELEASE(devicePtr)
+            if (FAILED(result))
+            {
+                std::cout << RED_TEXT("**(HARDWARE) Failed to create the event query!") << '\n';
+                return;
+            }
+
+            const auto waitForGPU = [deviceContextPtr, queryPtr]
+            {
+                deviceContextPtr->End(queryPtr);
+                while (deviceContextPtr->GetData(queryPtr, nullptr, 0, 0) == S_FALSE) {}
+            };
+
+            // Every frame starts from a cleared depth buffer, otherwise the second path would mostly be rejected by the depth of the first
+            ID3D11RenderTargetView* renderTargetViewPtr = nullptr;
+            ID3D11DepthStencilView* depthStencilViewPtr = nullptr;
+            deviceContextPtr->OMGetRenderTargets(1, &renderTargetViewPtr, &depthStencilViewPtr);
+
+            struct Result
+            {
+                double   seconds       = 0.0;
+                double   submitSeconds = 0.0;
+                uint64_t draws         = 0;
+            };
+
+            const std::vector<Matrix> noInstances{};
+            const auto renderFrames = [&](bool isInstanced)
+            {
+                Result result{};
+
+                mesh.SetInstances(isInstanced ? worldMatrices : noInstances);
+                stateTracker.Invalidate();
+                waitForGPU();
+
+                const uint64_t          firstDraws = stateTracker.GetStats().draws;
+                const Clock::time_point start      = Clock::now();
+                for (int frame = 0; frame < numFrames; ++frame)
+                {
+                    if (depthStencilViewPtr) deviceContextPtr->ClearDepthStencilView(depthStencilViewPtr, D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+                    // A moving crowd uploads its transforms every frame
+                    const Clock::time_point submitStart = Clock::now();
+                    if (isInstanced)
+                    {
+                        mesh.SetInstances(worldMatrices);
+                        mesh.SetMatrix(viewMatrix, projectionMatrix);
+                        mesh.Render();
+                    }
+                    else
+                    {
+                        for (const Matrix& worldMatrix : worldMatrices)
+                        {
+                            mesh.SetMatrix(worldMatrix, viewMatrix, projectionMatrix);
+                            mesh.Render();
+                        }
+                    }
+                    result.submitSeconds += SecondsSince(submitStart);
+                }
+                waitForGPU();
+
+                result.seconds = SecondsSince(start);
+                result.draws   = stateTracker.GetStats().draws - firstDraws;
+                return result;
+            };
+
+            const Result separate  = renderFrames(false);
+            const Result instanced = renderFrames(true);
+
+            SAFE_RELEASE(depthStencilViewPtr)
+            SAFE_RELEASE(renderTargetViewPtr)
+            SAFE_RELEASE(queryPtr)
+
+            const auto printResult = [numInstances, numFrames](const std::string& name, const Result& result)
+            {
+                const double instancesPerSecond = result.seconds > 0.0 ? static_cast<double>(numInstances) * numFrames / result.seconds : 0.0;
+                std::cout << GREEN_TEXT("**(HARDWARE) Instancing ") << MAGENTA_TEXT("" + name + "") << " = "
+                          << std::fixed << std::setprecision(2) << result.seconds * 1000.0 / numFrames << " ms/frame ("
+                          << result.submitSeconds * 1000.0 / numFrames << " ms submitting), " << result.draws / numFrames << " draw(s)/frame, "
+                          << std::setprecision(0) << instancesPerSecond << " instances/s\n" << std::defaultfloat;
+            };
+            printResult("ONE DRAW PER INSTANCE", separate);
+            printResult("INSTANCED",             instanced);
+
+            std::cout << GREEN_TEXT("**(HARDWARE) Instancing speedup ") << std::fixed << std::setprecision(2)
+                      << (instanced.seconds > 0.0 ? separate.seconds / instanced.seconds : 0.0) << "x\n" << std::defaultfloat;
+        }
+
+        void RasterModes(SoftwareRenderer& renderer, const ColorRGB& clearColor, int numFrames)
+        {
+            const RasterMode originalMode = renderer.GetRasterMode();
+
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Raster mode benchmark: ") << renderer.GetWidth() << 'x' << renderer.GetHeight()
+                      << ", " << numFrames << " frames per mode\n";
+
+            double forwardSeconds = 0.0;
+            for (int mode = 0; mode < static_cast<int>(RasterMode::COUNT); ++mode)
+            {
+                renderer.SetRasterMode(static_cast<RasterMode>(mode));
+
+                // Warm up so the first frame does not pay for allocations
+                renderer.Render(clearColor);
+
+                float geometryMs = 0.0f;
+                float rasterMs   = 0.0f;
+                float shadingMs  = 0.0f;
+
+                const Clock::time_point start = Clock::now();
+                for (int frame = 0; frame < numFrames; ++frame)
+                {
+                    renderer.Render(clearColor);
+
+                    geometryMs += renderer.GetFrameStats().geometryMs;
+                    rasterMs   += renderer.GetFrameStats().rasterMs;
+                    shadingMs  += renderer.GetFrameStats().shadingMs;
+                }
+                const double seconds = SecondsSince(start);
+                if (mode == static_cast<int>(RasterMode::Forward)) forwardSeconds = seconds;
+
+                const SoftwareFrameStats& stats = renderer.GetFrameStats();
+                const double depthComplexity = stats.pixelsVisible > 0 ? static_cast<double>(stats.fragmentsPassed) / static_cast<double>(stats.pixelsVisible) : 0.0;
+                const std::string modeString = ToString(static_cast<RasterMode>(mode));
+
+                std::cout << GREEN_TEXT("**(SOFTWARE) Raster mode ") << MAGENTA_TEXT("" + modeString + "") << " = "
+                          << std::fixed << std::setprecision(2) << seconds * 1000.0 / numFrames << " ms/frame"
+                          << " (geometry " << geometryMs / numFrames << " ms, raster " << rasterMs / numFrames << " ms, shading " << shadingMs / numFrames << " ms)"
+                          << ", shaded " << stats.fragmentsShaded << " of " << stats.fragmentsPassed << " depth-passing fragments"
+                          << ", overdraw " << depthComplexity << "x, speedup " << forwardSeconds / seconds << "x\n" << std::defaultfloat;
+            }
+
+            renderer.SetRasterMode(originalMode);
+        }
+
+        void ClipperFlyThrough(SoftwareRenderer& renderer, int meshIdx, const Matrix& projectionMatrix, const ColorRGB& clearColor, int numFrames)
+        {
+            const float originalGuardBand = renderer.GetGuardBand();
+            const float guardBands[]{1.0f, Clipper::DEFAULT_GUARD_BAND};
+
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Clipper fly-through benchmark: ") << numFrames << " frames along the z axis\n";
+
+            for (const float guardBand : guardBands)
+            {
+                renderer.SetGuardBand(guardBand);
+
+                float    totalMs      = 0.0f;
+                float    worstMs      = 0.0f;
+                uint64_t totalClipped = 0;
+                uint32_t worstClipped = 0;
+
+                for (int frame = 0; frame < numFrames; ++frame)
+                {
+                    // Camera looks down +z and passes through the mesh halfway
+                    const float   t        = static_cast<float>(frame) / static_cast<float>(std::max(numFrames - 1, 1));
+                    const Vector3 position = {0.0f, 2.0f, Lerpf(-60.0f, 60.0f, t)};
+
+                    renderer.BeginFrame(Matrix::Inverse(Matrix::CreateTranslation(position)) * projectionMatrix);
+                    renderer.Submit(meshIdx, Matrix{});
+
+                    const Clock::time_point start = Clock::now();
+                    renderer.Render(clearColor);
+                    const float frameMs = static_cast<float>(SecondsSince(start) * 1000.0);
+
+                    const uint32_t clipped = renderer.GetFrameStats().trianglesClipped;
+                    totalMs      += frameMs;
+                    worstMs       = std::max(worstMs, frameMs);
+                    totalClipped += clipped;
+                    worstClipped  = std::max(worstClipped, clipped);
+                }
+
+                std::ostringstream guardBandString{};
+                guardBandString << guardBand << 'x';
+
+                std::cout << GREEN_TEXT("**(SOFTWARE) Guard band ") << MAGENTA_TEXT("" + guardBandString.str() + "") << " = "
+                          << std::fixed << std::setprecision(2) << totalMs / numFrames << " ms/frame average, " << worstMs << " ms worst"
+                          << ", clipped " << static_cast<double>(totalClipped) / numFrames << " triangles/frame average, " << worstClipped << " worst\n" << std::defaultfloat;
+            }
+
+            renderer.SetGuardBand(originalGuardBand);
+        }
+
+        void TransparencyModes(SoftwareRenderer& renderer, const ColorRGB& clearColor, int numFrames)
+        {
+            const TransparencyMode originalMode = renderer.GetTransparencyMode();
+
+            // Per-triangle sorted blending is the reference every mode is compared against
+            renderer.SetTransparencyMode(TransparencyMode::Sorted);
+            renderer.Render(clearColor);
+            const std::vector<uint32_t> reference = renderer.GetColorBuffer();
+
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Transparency benchmark: ") << renderer.GetWidth() << 'x' << renderer.GetHeight()
+                      << ", " << renderer.GetFrameStats().trianglesTransparent << " transparent triangles, " << numFrames << " frames per mode\n";
+
+            for (int mode = 0; mode < static_cast<int>(TransparencyMode::COUNT); ++mode)
+            {
+                renderer.SetTransparencyMode(static_cast<TransparencyMode>(mode));
+
+                // Warm up so the first frame does not pay for allocations
+                renderer.Render(clearColor);
+
+                float sortMs         = 0.0f;
+                float transparencyMs = 0.0f;
+
+                const Clock::time_point start = Clock::now();
+                for (int frame = 0; frame < numFrames; ++frame)
+                {
+                    renderer.Render(clearColor);
+
+                    sortMs         += renderer.GetFrameStats().sortMs;
+                    transparencyMs += renderer.GetFrameStats().transparencyMs;
+                }
+                const double seconds = SecondsSince(start);
+
+                const SoftwareFrameStats& stats = renderer.GetFrameStats();
+                const double rootMeanSquareError = RootMeanSquareError(renderer.GetColorBuffer(), reference);
+                const std::string modeString = ToString(static_cast<TransparencyMode>(mode));
+
+                std::cout << GREEN_TEXT("**(SOFTWARE) Transparency mode ") << MAGENTA_TEXT("" + modeString + "") << " = "
+                          << std::fixed << std::setprecision(2) << seconds * 1000.0 / numFrames << " ms/frame"
+                          << " (sort " << sortMs / numFrames << " ms, transparency " << transparencyMs / numFrames << " ms)"
+                          << ", " << stats.transparentFragments << " fragments, " << stats.kBufferEvictions << " evicted"
+                          << ", RMSE " << rootMeanSquareError << " vs sorted";
+                if (rootMeanSquareError > 0.0)
+                {
+                    std::cout << " (PSNR " << 20.0 * std::log10(255.0 / rootMeanSquareError) << " dB)";
+                }
+                std::cout << '\n' << std::defaultfloat;
+            }
+
+            renderer.SetTransparencyMode(originalMode);
+        }
+
+        void FramePipelining(SoftwareRenderer& renderer, int meshIdx, const Matrix& viewProjectionMatrix, const ColorRGB& clearColor, int numFrames)
+        {
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Frame pipelining benchmark: ") << renderer.GetWidth() << 'x' << renderer.GetHeight()
+                      << ", " << numFrames << " frames, " << std::thread::hardware_concurrency() << " hardware threads\n";
+
+            const auto submit = [&renderer, meshIdx, &viewProjectionMatrix](int frame)
+            {
+                renderer.BeginFrame(viewProjectionMatrix);
+                renderer.Submit(meshIdx, Matrix::CreateRotationY(static_cast<float>(frame) * 0.05f));
+            };
+
+            std::vector<uint64_t> serialHashes(numFrames);
+            std::vector<uint64_t> pipelinedHashes(numFrames);
+
+            Clock::time_point start = Clock::now();
+            for (int frame = 0; frame < numFrames; ++frame)
+            {
+                submit(frame);
+                renderer.Render(clearColor);
+                serialHashes[frame] = Hash(renderer.GetColorBuffer());
+            }
+            const double serialSeconds = SecondsSince(start);
+
+            // One extra call drains the pipeline, the image of frame N is ready after the call that submitted frame N + 1
+            start = Clock::now();
+            for (int frame = 0; frame <= numFrames; ++frame)
+            {
+                submit(frame);
+                renderer.RenderPipelined(clearColor);
+                if (frame > 0) pipelinedHashes[frame - 1] = Hash(renderer.GetColorBuffer());
+            }
+            const double pipelinedSeconds = SecondsSince(start);
+
+            int numMatching = 0;
+            for (int frame = 0; frame < numFrames; ++frame)
+            {
+                numMatching += serialHashes[frame] == pipelinedHashes[frame];
+            }
+
+            std::cout << GREEN_TEXT("**(SOFTWARE) Serial ") << MAGENTA_TEXT("Render()") << " = "
+                      << std::fixed << std::setprecision(2) << serialSeconds * 1000.0 / numFrames << " ms/frame\n";
+            std::cout << GREEN_TEXT("**(SOFTWARE) Pipelined ") << MAGENTA_TEXT("RenderPipelined()") << " = "
+                      << pipelinedSeconds * 1000.0 / (numFrames + 1) << " ms/frame, speedup " << serialSeconds * (numFrames + 1) / (pipelinedSeconds * numFrames)
+                      << "x, " << numMatching << " of " << numFrames << " images identical to Render()\n" << std::defaultfloat;
+            if (numMatching != numFrames)
+            {
+                std::cout << RED_TEXT("**(SOFTWARE) Pipelined images differ from the serial ones!") << '\n';
+            }
+
+            // Leave a serial frame behind so the renderer is not left with a frame in flight
+            submit(0);
+            renderer.Render(clearColor);
+        }
+
+        void ChannelPacking(SoftwareRenderer& renderer, int meshIdx, int packedMeshIdx, const Matrix& viewProjectionMatrix, const ColorRGB& clearColor, int numFrames)
+        {
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Channel packing benchmark: ") << renderer.GetWidth() << 'x' << renderer.GetHeight()
+                      << ", " << numFrames << " frames per material\n";
+
+            struct Result
+            {
+                double                seconds    = 0.0;
+                double                shadingMs  = 0.0;
+                uint64_t              mapSamples = 0;
+                uint64_t              fragments  = 0;
+                std::vector<uint64_t> hashes     {};
+            };
+
+            const auto renderFrames = [&renderer, &viewProjectionMatrix, &clearColor, numFrames](int renderedMeshIdx)
+            {
+                Result result{};
+                result.hashes.resize(numFrames);
+
+                const Clock::time_point start = Clock::now();
+                for (int frame = 0; frame < numFrames; ++frame)
+                {
+                    renderer.BeginFrame(viewProjectionMatrix);
+                    renderer.Submit(renderedMeshIdx, Matrix::CreateRotationY(static_cast<float>(frame) * 0.05f));
+                    renderer.Render(clearColor);
+
+                    // Forward shading is timed as part of the raster pass
+                    const SoftwareFrameStats& stats = renderer.GetFrameStats();
+                    result.shadingMs  += renderer.GetRasterMode() == RasterMode::Forward ? stats.rasterMs : stats.shadingMs;
+                    result.mapSamples += stats.mapSamples;
+                    result.fragments  += stats.fragmentsShaded;
+                    result.hashes[frame] = Hash(renderer.GetColorBuffer());
+                }
+                result.seconds = SecondsSince(start);
+                return result;
+            };
+
+            const Result separate = renderFrames(meshIdx);
+            const Result packed   = renderFrames(packedMeshIdx);
+
+            int numMatching = 0;
+            for (int frame = 0; frame < numFrames; ++frame)
+            {
+                numMatching += separate.hashes[frame] == packed.hashes[frame];
+            }
+
+            const auto printResult = [numFrames](const std::string& name, const Result& result)
+            {
+                const double samplesPerFragment = result.fragments > 0 ? static_cast<double>(result.mapSamples) / static_cast<double>(result.fragments) : 0.0;
+                std::cout << GREEN_TEXT("**(SOFTWARE) Maps ") << MAGENTA_TEXT("" + name + "") << " = "
+                          << std::fixed << std::setprecision(2) << result.seconds * 1000.0 / numFrames << " ms/frame, "
+                          << result.shadingMs / numFrames << " ms shading, " << result.mapSamples / numFrames << " map samples/frame ("
+                          << samplesPerFragment << " per fragment)\n" << std::defaultfloat;
+            };
+            printResult("SEPARATE", separate);
+            printResult("PACKED",   packed);
+
+            const double savedPercentage = separate.mapSamples > 0
+                ? 100.0 * static_cast<double>(separate.mapSamples - packed.mapSamples) / static_cast<double>(separate.mapSamples)
+                : 0.0;
+            std::cout << GREEN_TEXT("**(SOFTWARE) Packing saved ") << MAGENTA_TEXT("" + std::to_string((separate.mapSamples - packed.mapSamples) / numFrames) + "") << " map samples/frame, "
+                      << std::fixed << std::setprecision(2) << savedPercentage << "% fewer, " << numMatching << " of " << numFrames << " images identical\n"
+                      << std::defaultfloat;
+        }
+
+        void VirtualTexturing(SoftwareRenderer& renderer, VirtualTextureCache& cache, int meshIdx, int virtualMeshIdx, const Matrix& viewProjectionMatrix,
+                              const ColorRGB& clearColor, int numFrames)
+        {
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Virtual texturing benchmark: ") << renderer.GetWidth() << 'x' << renderer.GetHeight()
+                      << ", " << numFrames << " frames, " << cache.GetStats().slotCount << " cache slots of " << VirtualTexture::PAGE_SIZE << 'x'
+                      << VirtualTexture::PAGE_SIZE << " texels\n";
+
+            const auto renderFrame = [&renderer, &viewProjectionMatrix, &clearColor](int renderedMeshIdx, int frame)
+            {
+                renderer.BeginFrame(viewProjectionMatrix);
+                renderer.Submit(renderedMeshIdx, Matrix::CreateRotationY(static_cast<float>(frame) * 0.05f));
+                renderer.Render(clearColor);
+            };
+
+            // 1. Cold start, the pages arrive while the mesh keeps rotating
+            cache.Clear();
+
+            double totalUpdateMs  = 0.0;
+            double totalHitRate   = 0.0;
+            double totalLatencyMs = 0.0;
+            float  maxLatencyMs   = 0.0f;
+            int    maxPagesLoaded = 0;
+            int    settledFrame   = -1;
+
+            const Clock::time_point start        = Clock::now();
+            const uint64_t          loadedBefore = cache.GetStats().totalPagesLoaded;
+            for (int frame = 0; frame < numFrames; ++frame)
+            {
+                renderFrame(virtualMeshIdx, frame);
+
+                const Clock::time_point updateStart = Clock::now();
+                cache.Update();
+                totalUpdateMs += SecondsSince(updateStart) * 1000.0;
+
+                const VirtualTextureStats& stats = cache.GetStats();
+                totalHitRate   += stats.hitRate;
+                totalLatencyMs += stats.averageLatencyMs * stats.pagesLoaded;
+                maxLatencyMs    = std::max(maxLatencyMs, stats.maxLatencyMs);
+                maxPagesLoaded  = std::max(maxPagesLoaded, stats.pagesLoaded);
+                if (stats.hitRate < 1.0f) settledFrame = -1;
+                else if (settledFrame < 0) settledFrame = frame;
+            }
+            const double   seconds     = SecondsSince(start);
+            const uint64_t pagesLoaded = cache.GetStats().totalPagesLoaded - loadedBefore;
+
+            std::cout << GREEN_TEXT("**(SOFTWARE) Cold start ") << std::fixed << std::setprecision(2) << seconds * 1000.0 / numFrames << " ms/frame ("
+                      << totalUpdateMs / numFrames << " ms Update()), " << 100.0 * totalHitRate / numFrames << "% average hit rate, "
+                      << static_cast<double>(pagesLoaded) / numFrames << " pages/frame (" << maxPagesLoaded << " max), "
+                      << (pagesLoaded > 0 ? totalLatencyMs / static_cast<double>(pagesLoaded) : 0.0) << " ms average latency (" << maxLatencyMs << " ms max)\n"
+                      << std::defaultfloat;
+            std::cout << GREEN_TEXT("**(SOFTWARE) Every sampled page resident ")
+                      << MAGENTA_TEXT("" + (settledFrame >= 0 ? "from frame " + std::to_string(settledFrame) : std::string{"never, the cache is too small for the view"}) + "")
+                      << ", " << cache.GetStats().totalPagesEvicted << " pages evicted\n";
+
+            // 2. Every frame again, rendered until all its pages are resident, against the fully resident chain
+            int      numMatching     = 0;
+            int      numSettled      = 0;
+            uint64_t differentPixels = 0;
+            int      maxDifference   = 0;
+
+            std::vector<uint32_t> reference{};
+            for (int frame = 0; frame < numFrames; ++frame)
+            {
+                renderFrame(meshIdx, frame);
+                reference = renderer.GetColorBuffer();
+
+                // The finer pages only get requested once their parents are in, so a few rounds are needed
+                bool isSettled = false;
+                for (int round = 0; round < 16 and not isSettled; ++round)
+                {
+                    renderFrame(virtualMeshIdx, frame);
+                    cache.Flush();
+                    cache.Update();
+                    isSettled = cache.GetStats().hitPages == cache.GetStats().requestedPages;
+                }
+                numSettled += isSettled;
+
+                const std::vector<uint32_t>& image       = renderer.GetColorBuffer();
+                uint64_t                     frameDiffer = 0;
+                for (size_t i = 0; i < image.size(); ++i)
+                {
+                    if (image[i] == reference[i]) continue;
+
+                    ++frameDiffer;
+                    for (int shift = 0; shift < 24; shift += 8)
+                    {
+                        maxDifference = std::max(maxDifference, std::abs(static_cast<int>((image[i] >> shift) & 0xFF) - static_cast<int>((reference[i] >> shift) & 0xFF)));
+                    }
+                }
+                numMatching     += frameDiffer == 0;
+                differentPixels += frameDiffer;
+            }
+
+            std::cout << GREEN_TEXT("**(SOFTWARE) Settled ") << numSettled << " of " << numFrames << " frames, " << numMatching << " images identical to the resident chain, "
+                      << differentPixels << " pixels differ (" << maxDifference << " max per channel)\n";
+        }
+
+        void SoftwareInstancing(SoftwareRenderer& renderer, int meshIdx, const std::vector<Matrix>& worldMatrices, const Matrix& viewProjectionMatrix,
+                                const ColorRGB& clearColor, int numFrames)
+        {
+            std::cout << YELLOW_TEXT("**(SOFTWARE) Instancing benchmark: ") << renderer.GetWidth() << 'x' << renderer.GetHeight()
+                      << ", up to " << worldMatrices.size() << " instance(s), " << numFrames << " frame(s) per count\n";
+            if (worldMatrices.empty()) return;
+
+            // Every instance spins around its own origin, like the crowd of InstancedTechnique
+            const auto meshMatrix = [](int frame) { return Matrix::CreateRotationY(static_cast<float>(frame) * 0.05f); };
+
+            for (size_t numInstances = 1; ; numInstances = std::min(numInstances * 10, worldMatrices.size()))
+            {
+                const std::vector<Matrix> instances(worldMatrices.begin(), worldMatrices.begin() + numInstances);
+
+                double geometryMs = 0.0;
+                const Clock::time_point start = Clock::now();
+                for (int frame = 0; frame < numFrames; ++frame)
+                {
+                    renderer.BeginFrame(viewProjectionMatrix);
+                    renderer.SubmitInstanced(meshIdx, instances, meshMatrix(frame));
+                    renderer.Render(clearColor);
+                    geometryMs += renderer.GetFrameStats().geometryMs;
+                }
+                const double seconds = SecondsSince(start);
+
+                const double instanceFrames = static_cast<double>(numInstances) * numFrames;
+                std::cout << GREEN_TEXT("**(SOFTWARE) Instances ") << MAGENTA_TEXT("" + std::to_string(numInstances) + "") << " = "
+                          << std::fixed << std::setprecision(2) << seconds * 1000.0 / numFrames << " ms/frame (" << geometryMs / numFrames << " ms geometry), "
+                          << std::setprecision(0) << instanceFrames / seconds << " instances/s, " << (geometryMs > 0.0 ? instanceFrames * 1000.0 / geometryMs : 0.0)
+                          << " instances/s of geometry\n" << std::defaultfloat;
+
+                if (numInstances == worldMatrices.size()) break;
+            }
+
+            // Same frame through both submission paths
+            renderer.BeginFrame(viewProjectionMatrix);
+            renderer.SubmitInstanced(meshIdx, worldMatrices, meshMatrix(0));
+            renderer.Render(clearColor);
+            const uint64_t instancedHash = Hash(renderer.GetColorBuffer());
+
+            renderer.BeginFrame(viewProjectionMatrix);
+            for (const Matrix& worldMatrix : worldMatrices)
+            {
+                renderer.Submit(meshIdx, meshMatrix(0) * worldMatrix);
+            }
+            renderer.Render(clearColor);
+            const bool isIdentical = Hash(renderer.GetColorBuffer()) == instancedHash;
+
+            if (isIdentical)
+            {
+                std::cout << GREEN_TEXT("**(SOFTWARE) SubmitInstanced() renders the same image as one Submit() per instance") << '\n';
+            }
+            else
+            {
+                std::cout << RED_TEXT("**(SOFTWARE) SubmitInstanced() renders another image than one Submit() per instance!") << '\n';
+            }
+        }
+    }
+}
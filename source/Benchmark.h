@@ -0,0 +1,89 @@
+#pragma once
+
+// Standard includes
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dae
+{
+    // Forward declarations
+    class Texture;
+    class Mesh;
+    class PipelineStateTracker;
+    class SoftwareRenderer;
+    class VirtualTextureCache;
+    struct ColorRGB;
+    struct Matrix;
+    enum class BlockFormat;
+    struct TextureAsset;
+
+    // Offline measurements of the CPU code paths, results are printed to the console
+    namespace Benchmark
+    {
+        void SamplerThroughput(const Texture* texturePtr, int numBatches = 1 << 18);
+
+        // Texture::Sample one uv at a time and batched in every AddressMode, against the SDL_GetRGB lookup it replaced
+        void TextureSampling(const Texture* texturePtr, int numRuns = 32);
+
+        // Sampler throughput on a row-major and a tiled copy of the chain, for screen-space spans rotated from 0 to 90 degrees across the texture
+        void TexelLayouts(const Texture* texturePtr, int numRuns = 8);
+
+        // Rebuilds the mip chains of the textures with every MipFilter, serial and parallel, and reports the memory of the chains
+        void MipGeneration(const std::vector<const Texture*>& texturePtrs, int numRuns = 4);
+
+        // Compresses the full mip chain of every texture to its format at every CompressionQuality, reports time, PSNR and size against RGBA8
+        void BlockCompression(const std::vector<std::pair<const Texture*, BlockFormat>>& textures);
+
+        // Startup cost of every asset through SDL_image plus mip generation and compression against its memory-mapped container
+        void TextureLoading(ID3D11Device* devicePtr, const std::vector<TextureAsset>& assets, int numRuns = 4);
+
+        // Every .png in directory through IMG_Load and through the built-in PngDecoder, serial and in parallel, and checks both decode the same texels
+        void PngDecoding(const std::string& directory, int numRuns = 4);
+
+        // Flies a camera past numTextures streamed copies of the assets, once without a budget and once within budgetBytes, and reports
+        // the resident memory, the streaming traffic and how often a request had to wait
+        void TextureStreaming(ID3D11Device* devicePtr, const std::vector<TextureAsset>& assets, int numTextures = 256, size_t budgetBytes = size_t{64} << 20,
+                              int numFrames = 240);
+
+        // Packs numTextures random power-of-two textures into atlas pages, reports the occupancy, the build time and the bindings saved,
+        // and checks every bilinear tap that stays within a gutter against a WRAP lookup into the texture on its own
+        void AtlasPacking(int numTextures = 512, int numRuns = 4);
+
+        // Submits numPackets random draws per frame to a RecordingBackend in the order they were added and radix sorted, reports the state
+        // changes of both and the sort time, and checks the sorted order: opaque before transparent, front to back and back to front
+        void RenderQueueSorting(int numPackets = 10000, int numGeometries = 256, int numMaterials = 64, int numFrames = 64);
+
+        // Draws the mesh once per world matrix into the bound render target, one draw per instance and then one DrawIndexedInstanced, waits for
+        // the GPU after each path and reports the submission time, the draws and the instances/s of both. Leaves the instances set on the mesh
+        void HardwareInstancing(ID3D11DeviceContext* deviceContextPtr, Mesh& mesh, PipelineStateTracker& stateTracker, const std::vector<Matrix>& worldMatrices,
+                                const Matrix& viewMatrix, const Matrix& projectionMatrix, int numFrames = 16);
+
+        // Renders the scene that is currently submitted to the software renderer in every RasterMode
+        void RasterModes(SoftwareRenderer& renderer, const ColorRGB& clearColor, int numFrames = 32);
+
+        // Flies the camera straight through the mesh, once clipping at the frustum and once with the default guard band
+        void ClipperFlyThrough(SoftwareRenderer& renderer, int meshIdx, const Matrix& projectionMatrix, const ColorRGB& clearColor, int numFrames = 64);
+
+        // Renders the submitted scene in every TransparencyMode and compares each image against sorted blending
+        void TransparencyModes(SoftwareRenderer& renderer, const ColorRGB& clearColor, int numFrames = 16);
+
+        // Renders the same rotating mesh with Render() and RenderPipelined() and checks that both produce the same images
+        void FramePipelining(SoftwareRenderer& renderer, int meshIdx, const Matrix& viewProjectionMatrix, const ColorRGB& clearColor, int numFrames = 64);
+
+        // Renders the same rotating geometry with separate specular and glossiness maps and with them packed into one, counts the map samples and compares the images
+        void ChannelPacking(SoftwareRenderer& renderer, int meshIdx, int packedMeshIdx, const Matrix& viewProjectionMatrix, const ColorRGB& clearColor,
+                            int numFrames = 32);
+
+        // Renders the rotating mesh with its diffuse map paged through the cache from a cold start and reports the hit rate, the pages loaded per frame
+        // and their latency, then lets the pages of every frame settle and compares the image against the same mesh with the whole chain resident
+        void VirtualTexturing(SoftwareRenderer& renderer, VirtualTextureCache& cache, int meshIdx, int virtualMeshIdx, const Matrix& viewProjectionMatrix,
+                              const ColorRGB& clearColor, int numFrames = 64);
+
+        // Renders growing prefixes of the world matrices through SubmitInstanced() and reports the instances/s of the geometry stage and of whole frames,
+        // then checks that the full set renders the same image as one Submit() per instance
+        void SoftwareInstancing(SoftwareRenderer& renderer, int meshIdx, const std::vector<Matrix>& worldMatrices, const Matrix& viewProjectionMatrix,
+                                const ColorRGB& clearColor, int numFrames = 8);
+    }
+}
@@ -0,0 +1,923 @@
+#include "pch.h"
+#include "BlockCompressor.h"
+
+// Project includes
+#include "MipChain.h"
+
+// Standard includes
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <execution>
+#include <limits>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr int BLOCK_TEXELS = 16;
+
+        // Palette positions between the two endpoints, in the order of the indices
+        constexpr float BC1_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+        constexpr float BC4_WEIGHTS[8] = {0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f};
+        constexpr int   BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64}; // Out of 64
+
+        // One 4x4 block channel-major in 0..255, so the index search covers 8 texels per AVX2 vector
+        struct BlockTexels
+        {
+            alignas(32) float channels[4][BLOCK_TEXELS] {};
+        };
+
+        struct Palette
+        {
+            float entries[16][4] {};
+            int   size           = 0;
+        };
+
+        // Bits are packed LSB first, like every BC format stores them
+        class BitWriter final
+        {
+        public:
+            explicit BitWriter(uint8_t* outputPtr, int numBytes) : m_OutputPtr{outputPtr} { std::fill(outputPtr, outputPtr + numBytes, uint8_t{0}); }
+
+            void Write(uint32_t value, int numBits)
+            {
+                for (int i = 0; i < numBits; ++i, ++m_Position)
+                {
+                    m_OutputPtr[m_Position >> 3] |= static_cast<uint8_t>((value >> i & 1) << (m_Position & 7));
+                }
+            }
+
+        private:
+            uint8_t* m_OutputPtr = nullptr;
+            int      m_Position  = 0;
+        };
+
+        class BitReader final
+        {
+        public:
+            explicit BitReader(const uint8_t* inputPtr) : m_InputPtr{inputPtr} {}
+
+            uint32_t Read(int numBits)
+            {
+                uint32_t value = 0;
+                for (int i = 0; i < numBits; ++i, ++m_Position)
+                {
+                    value |= static_cast<uint32_t>(m_InputPtr[m_Position >> 3] >> (m_Position & 7) & 1) << i;
+                }
+                return value;
+            }
+
+        private:
+            const uint8_t* m_InputPtr = nullptr;
+            int            m_Position = 0;
+        };
+
+        int GetRefinementCount(CompressionQuality quality)
+        {
+            switch (quality)
+            {
+            case CompressionQuality::Fast:   return 0;
+            case CompressionQuality::Normal: return 1;
+            default:                         return 8;
+            }
+        }
+
+        // Edge texels are repeated for levels smaller than a block
+        void LoadBlock(const MipChain& mipChain, int level, int blockX, int blockY, BlockTexels& block)
+        {
+            const MipLevel& mipLevel = mipChain.levels[level];
+            const uint32_t* texels   = mipChain.GetLevelTexels(level);
+            const int       rowPitch = MipChain::GetRowPitch(mipLevel.width, mipChain.layout);
+            for (int y = 0; y < 4; ++y)
+            {
+                const int sourceY = std::min(blockY * 4 + y, mipLevel.height - 1);
+                for (int x = 0; x < 4; ++x)
+                {
+                    const int      sourceX = std::min(blockX * 4 + x, mipLevel.width - 1);
+                    const uint32_t texel   = texels[MipChain::GetTexelIndex(sourceX, sourceY, rowPitch, mipChain.layout)];
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        block.channels[c][y * 4 + x] = static_cast<float>(texel >> (c * 8) & 0xFF);
+                    }
+                }
+            }
+        }
+
+        // Nearest palette entry of every texel over the first numChannels channels, returns the summed squared error
+        float SelectIndices(const BlockTexels& block, int numChannels, const Palette& palette, uint8_t (&indices)[BLOCK_TEXELS])
+        {
+            float error = 0.0f;
+#if defined(__AVX2__)
+            for (int first = 0; first < BLOCK_TEXELS; first += 8)
+            {
+                __m256 texels[4];
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    texels[c] = _mm256_load_ps(&block.channels[c][first]);
+                }
+
+                __m256 bestError = _mm256_set1_ps(std::numeric_limits<float>::max());
+                __m256 bestIndex = _mm256_setzero_ps();
+                for (int i = 0; i < palette.size; ++i)
+                {
+                    __m256 distance = _mm256_setzero_ps();
+                    for (int c = 0; c < numChannels; ++c)
+                    {
+                        const __m256 delta = _mm256_sub_ps(texels[c], _mm256_set1_ps(palette.entries[i][c]));
+                        distance = _mm256_fmadd_ps(delta, delta, distance);
+                    }
+
+                    const __m256 isCloser = _mm256_cmp_ps(distance, bestError, _CMP_LT_OQ);
+                    bestError = _mm256_blendv_ps(bestError, distance, isCloser);
+                    bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps(static_cast<float>(i)), isCloser);
+                }
+
+                alignas(32) float   errors[8];
+                alignas(32) int32_t closest[8];
+                _mm256_store_ps(errors, bestError);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(closest), _mm256_cvttps_epi32(bestIndex));
+                for (int i = 0; i < 8; ++i)
+                {
+                    indices[first + i] = static_cast<uint8_t>(closest[i]);
+                    error += errors[i];
+                }
+            }
+#else
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                float bestError = std::numeric_limits<float>::max();
+                for (int i = 0; i < palette.size; ++i)
+                {
+                    float distance = 0.0f;
+                    for (int c = 0; c < numChannels; ++c)
+                    {
+                        const float delta = block.channels[c][t] - palette.entries[i][c];
+                        distance += delta * delta;
+                    }
+
+                    if (distance < bestError)
+                    {
+                        bestError  = distance;
+                        indices[t] = static_cast<uint8_t>(i);
+                    }
+                }
+                error += bestError;
+            }
+#endif
+            return error;
+        }
+
+        // Line through the block that the palette is spread over: the bounding box diagonal in Fast mode, the principal axis otherwise
+        void FindEndpoints(const BlockTexels& block, int numChannels, CompressionQuality quality, float (&endpoint0)[4], float (&endpoint1)[4])
+        {
+            float minimum[4]{};
+            float maximum[4]{};
+            float mean[4]   {};
+            for (int c = 0; c < numChannels; ++c)
+            {
+                minimum[c] = *std::min_element(block.channels[c], block.channels[c] + BLOCK_TEXELS);
+                maximum[c] = *std::max_element(block.channels[c], block.channels[c] + BLOCK_TEXELS);
+                for (int t = 0; t < BLOCK_TEXELS; ++t)
+                {
+                    mean[c] += block.channels[c][t] / BLOCK_TEXELS;
+                }
+            }
+
+            if (quality == CompressionQuality::Fast)
+            {
+                // Inset by 1/16 of the range, the extremes alone waste palette entries on outliers
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    const float inset = (maximum[c] - minimum[c]) / 16.0f;
+                    endpoint0[c] = minimum[c] + inset;
+                    endpoint1[c] = maximum[c] - inset;
+                }
+                return;
+            }
+
+            float covariance[4][4]{};
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                for (int a = 0; a < numChannels; ++a)
+                {
+                    for (int b = 0; b < numChannels; ++b)
+                    {
+                        covariance[a][b] += (block.channels[a][t] - mean[a]) * (block.channels[b][t] - mean[b]);
+                    }
+                }
+            }
+
+            // Power iteration, starting from the column of the channel that varies most so it cannot start orthogonal to the axis
+            int widestChannel = 0;
+            for (int c = 1; c < numChannels; ++c)
+            {
+                if (covariance[c][c] > covariance[widestChannel][widestChannel]) widestChannel = c;
+            }
+
+            float axis[4]{};
+            for (int c = 0; c < numChannels; ++c)
+            {
+                axis[c] = covariance[c][widestChannel];
+            }
+
+            for (int iteration = 0; iteration < 8; ++iteration)
+            {
+                float next[4]{};
+                float lengthSquared = 0.0f;
+                for (int a = 0; a < numChannels; ++a)
+                {
+                    for (int b = 0; b < numChannels; ++b)
+                    {
+                        next[a] += covariance[a][b] * axis[b];
+                    }
+                    lengthSquared += next[a] * next[a];
+                }
+
+                // Every texel has the same value
+                if (lengthSquared < 1e-12f)
+                {
+                    std::copy(mean, mean + 4, endpoint0);
+                    std::copy(mean, mean + 4, endpoint1);
+                    return;
+                }
+
+                const float invLength = 1.0f / std::sqrt(lengthSquared);
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    axis[c] = next[c] * invLength;
+                }
+            }
+
+            float minProjection = std::numeric_limits<float>::max();
+            float maxProjection = std::numeric_limits<float>::lowest();
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                float projection = 0.0f;
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    projection += (block.channels[c][t] - mean[c]) * axis[c];
+                }
+                minProjection = std::min(minProjection, projection);
+                maxProjection = std::max(maxProjection, projection);
+            }
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                endpoint0[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+                endpoint1[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+            }
+        }
+
+        // Least-squares endpoints for the current indices, weights[i] is how far palette entry i lies from endpoint0 towards endpoint1
+        bool RefineEndpoints(const BlockTexels& block, int numChannels, const uint8_t (&indices)[BLOCK_TEXELS], const float* weights,
+                             float (&endpoint0)[4], float (&endpoint1)[4])
+        {
+            float aa = 0.0f;
+            float ab = 0.0f;
+            float bb = 0.0f;
+            float ax[4]{};
+            float bx[4]{};
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                const float b = weights[indices[t]];
+                const float a = 1.0f - b;
+
+                aa += a * a;
+                ab += a * b;
+                bb += b * b;
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    ax[c] += a * block.channels[c][t];
+                    bx[c] += b * block.channels[c][t];
+                }
+            }
+
+            // All texels on one endpoint, nothing to solve
+            const float determinant = aa * bb - ab * ab;
+            if (std::abs(determinant) < 1e-6f) return false;
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                endpoint0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+                endpoint1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+            }
+            return true;
+        }
+
+        // Quantizes the endpoints, picks the indices and reports the error, refining the endpoints while the error keeps dropping
+        template <typename EncodedBlock, typename TryFunction>
+        EncodedBlock EncodeRefined(const BlockTexels& block, int numChannels, CompressionQuality quality, const float* weights, TryFunction&& tryFunction)
+        {
+            float endpoint0[4]{};
+            float endpoint1[4]{};
+            FindEndpoints(block, numChannels, quality, endpoint0, endpoint1);
+
+            EncodedBlock best = tryFunction(endpoint0, endpoint1);
+            for (int iteration = 0; iteration < GetRefinementCount(quality); ++iteration)
+            {
+                if (not RefineEndpoints(block, numChannels, best.indices, weights, endpoint0, endpoint1)) break;
+
+                const EncodedBlock candidate = tryFunction(endpoint0, endpoint1);
+                if (candidate.error >= best.error) break;
+
+                best = candidate;
+            }
+            return best;
+        }
+    }
+#pragma endregion
+
+#pragma region BC1
+    namespace
+    {
+        struct BC1Block
+        {
+            uint16_t color0  = 0;
+            uint16_t color1  = 0;
+            uint8_t  indices[BLOCK_TEXELS] {};
+            float    error   = 0.0f;
+        };
+
+        uint16_t QuantizeRGB565(const float (&color)[4])
+        {
+            const int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+            const int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+            const int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+            return static_cast<uint16_t>(r << 11 | g << 5 | b);
+        }
+
+        // 4 colors when color0 > color1, otherwise 3 colors and transparent black
+        void BuildPaletteBC1(uint16_t color0, uint16_t color1, int (&palette)[4][3])
+        {
+            const uint16_t colors[2] = {color0, color1};
+            for (int e = 0; e < 2; ++e)
+            {
+                const int r = colors[e] >> 11 & 0x1F;
+                const int g = colors[e] >> 5  & 0x3F;
+                const int b = colors[e]       & 0x1F;
+
+                // Bit replication, like the hardware expands them
+                palette[e][0] = r << 3 | r >> 2;
+                palette[e][1] = g << 2 | g >> 4;
+                palette[e][2] = b << 3 | b >> 2;
+            }
+
+            for (int c = 0; c < 3; ++c)
+            {
+                if (color0 > color1)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+                }
+                else
+                {
+                    palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+                    palette[3][c] = 0;
+                }
+            }
+        }
+
+        BC1Block TryBC1(const BlockTexels& block, const float (&endpoint0)[4], const float (&endpoint1)[4])
+        {
+            BC1Block result{QuantizeRGB565(endpoint0), QuantizeRGB565(endpoint1)};
+
+            // The 4-color mode needs color0 > color1, when both are equal index 0 is exact for every texel anyway
+            if (result.color0 < result.color1) std::swap(result.color0, result.color1);
+
+            int colors[4][3];
+            BuildPaletteBC1(result.color0, result.color1, colors);
+
+            Palette palette{};
+            palette.size = result.color0 == result.color1 ? 1 : 4;
+            for (int i = 0; i < 4; ++i)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    palette.entries[i][c] = static_cast<float>(colors[i][c]);
+                }
+            }
+
+            result.error = SelectIndices(block, 3, palette, result.indices);
+            return result;
+        }
+
+        void EncodeBC1(const BlockTexels& block, CompressionQuality quality, uint8_t* outputPtr)
+        {
+            const BC1Block encoded = EncodeRefined<BC1Block>(block, 3, quality, BC1_WEIGHTS, [&block](const float (&endpoint0)[4], const float (&endpoint1)[4])
+            {
+                return TryBC1(block, endpoint0, endpoint1);
+            });
+
+            BitWriter writer{outputPtr, 8};
+            writer.Write(encoded.color0, 16);
+            writer.Write(encoded.color1, 16);
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                writer.Write(encoded.indices[t], 2);
+            }
+        }
+
+        void DecodeBC1(const uint8_t* inputPtr, uint32_t (&texels)[BLOCK_TEXELS])
+        {
+            BitReader reader{inputPtr};
+            const uint16_t color0 = static_cast<uint16_t>(reader.Read(16));
+            const uint16_t color1 = static_cast<uint16_t>(reader.Read(16));
+
+            int palette[4][3];
+            BuildPaletteBC1(color0, color1, palette);
+
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                const uint32_t index = reader.Read(2);
+                const uint32_t alpha = color0 <= color1 and index == 3 ? 0 : 255;
+                texels[t] = palette[index][0] | palette[index][1] << 8 | palette[index][2] << 16 | alpha << 24;
+            }
+        }
+    }
+#pragma endregion
+
+#pragma region BC4
+    namespace
+    {
+        struct BC4Block
+        {
+            uint8_t value0  = 0;
+            uint8_t value1  = 0;
+            uint8_t indices[BLOCK_TEXELS] {};
+            float   error   = 0.0f;
+        };
+
+        // 8 values when value0 > value1, otherwise 6 values plus exact 0 and 255
+        void BuildPaletteBC4(int value0, int value1, int (&palette)[8])
+        {
+            palette[0] = value0;
+            palette[1] = value1;
+            if (value0 > value1)
+            {
+                for (int i = 2; i < 8; ++i)
+                {
+                    palette[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+                }
+            }
+            else
+            {
+                for (int i = 2; i < 6; ++i)
+                {
+                    palette[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+                }
+                palette[6] = 0;
+                palette[7] = 255;
+            }
+        }
+
+        // Channel 0 of the block only
+        BC4Block TryBC4(const BlockTexels& block, float endpoint0, float endpoint1, bool isSixValueMode)
+        {
+            BC4Block result{static_cast<uint8_t>(std::clamp(static_cast<int>(endpoint0 + 0.5f), 0, 255)),
+                            static_cast<uint8_t>(std::clamp(static_cast<int>(endpoint1 + 0.5f), 0, 255))};
+
+            // The order of the endpoints selects the mode
+            if ((result.value0 < result.value1) != isSixValueMode) std::swap(result.value0, result.value1);
+
+            int values[8];
+            BuildPaletteBC4(result.value0, result.value1, values);
+
+            Palette palette{};
+            palette.size = 8;
+            for (int i = 0; i < 8; ++i)
+            {
+                palette.entries[i][0] = static_cast<float>(values[i]);
+            }
+
+            result.error = SelectIndices(block, 1, palette, result.indices);
+            return result;
+        }
+
+        void EncodeBC4(const BlockTexels& block, int channel, CompressionQuality quality, uint8_t* outputPtr)
+        {
+            BlockTexels single{};
+            std::copy(block.channels[channel], block.channels[channel] + BLOCK_TEXELS, single.channels[0]);
+
+            BC4Block encoded = EncodeRefined<BC4Block>(single, 1, quality, BC4_WEIGHTS, [&single](const float (&endpoint0)[4], const float (&endpoint1)[4])
+            {
+                return TryBC4(single, endpoint0[0], endpoint1[0], false);
+            });
+
+            // Blocks that touch 0 or 255 can keep those exact and spread the 6 interpolated values over the rest
+            if (quality == CompressionQuality::Best)
+            {
+                float minimum = 255.0f;
+                float maximum = 0.0f;
+                for (const float value : single.channels[0])
+                {
+                    if (value <= 0.0f or value >= 255.0f) continue;
+
+                    minimum = std::min(minimum, value);
+                    maximum = std::max(maximum, value);
+                }
+
+                if (minimum <= maximum)
+                {
+                    const BC4Block candidate = TryBC4(single, minimum, maximum, true);
+                    if (candidate.error < encoded.error) encoded = candidate;
+                }
+            }
+
+            BitWriter writer{outputPtr, 8};
+            writer.Write(encoded.value0, 8);
+            writer.Write(encoded.value1, 8);
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                writer.Write(encoded.indices[t], 3);
+            }
+        }
+
+        void DecodeBC4(const uint8_t* inputPtr, uint8_t (&values)[BLOCK_TEXELS])
+        {
+            BitReader reader{inputPtr};
+            const int value0 = static_cast<int>(reader.Read(8));
+            const int value1 = static_cast<int>(reader.Read(8));
+
+            int palette[8];
+            BuildPaletteBC4(value0, value1, palette);
+
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                values[t] = static_cast<uint8_t>(palette[reader.Read(3)]);
+            }
+        }
+    }
+#pragma endregion
+
+#pragma region BC7
+    namespace
+    {
+        // Mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit each, 4-bit indices
+        struct BC7Block
+        {
+            uint8_t endpoints[2][4]       {};
+            uint8_t pBits[2]              {};
+            uint8_t indices[BLOCK_TEXELS] {};
+            float   error                 = 0.0f;
+        };
+
+        int InterpolateBC7(int value0, int value1, int weight)
+        {
+            return ((64 - weight) * value0 + weight * value1 + 32) >> 6;
+        }
+
+        // The p-bit is shared by all channels of an endpoint, the one that lands closest wins
+        void QuantizeBC7Endpoint(const float (&endpoint)[4], uint8_t (&quantized)[4], uint8_t& pBit)
+        {
+            float bestError = std::numeric_limits<float>::max();
+            for (int p = 0; p < 2; ++p)
+            {
+                uint8_t candidate[4];
+                float   error = 0.0f;
+                for (int c = 0; c < 4; ++c)
+                {
+                    candidate[c] = static_cast<uint8_t>(std::clamp(static_cast<int>((endpoint[c] - static_cast<float>(p)) / 2.0f + 0.5f), 0, 127));
+
+                    const float delta = static_cast<float>(candidate[c] << 1 | p) - endpoint[c];
+                    error += delta * delta;
+                }
+
+                if (error < bestError)
+                {
+                    bestError = error;
+                    pBit      = static_cast<uint8_t>(p);
+                    std::copy(candidate, candidate + 4, quantized);
+                }
+            }
+        }
+
+        BC7Block TryBC7(const BlockTexels& block, const float (&endpoint0)[4], const float (&endpoint1)[4])
+        {
+            BC7Block result{};
+            QuantizeBC7Endpoint(endpoint0, result.endpoints[0], result.pBits[0]);
+            QuantizeBC7Endpoint(endpoint1, result.endpoints[1], result.pBits[1]);
+
+            Palette palette{};
+            palette.size = 16;
+            for (int i = 0; i < 16; ++i)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    const int value0 = result.endpoints[0][c] << 1 | result.pBits[0];
+                    const int value1 = result.endpoints[1][c] << 1 | result.pBits[1];
+                    palette.entries[i][c] = static_cast<float>(InterpolateBC7(value0, value1, BC7_WEIGHTS[i]));
+                }
+            }
+
+            result.error = SelectIndices(block, 4, palette, result.indices);
+            return result;
+        }
+
+        void EncodeBC7(const BlockTexels& block, CompressionQuality quality, uint8_t* outputPtr)
+        {
+            static const float weights[16] =
+            {
+                 0.0f / 64.0f,  4.0f / 64.0f,  9.0f / 64.0f, 13.0f / 64.0f, 17.0f / 64.0f, 21.0f / 64.0f, 26.0f / 64.0f, 30.0f / 64.0f,
+                34.0f / 64.0f, 38.0f / 64.0f, 43.0f / 64.0f, 47.0f / 64.0f, 51.0f / 64.0f, 55.0f / 64.0f, 60.0f / 64.0f, 64.0f / 64.0f
+            };
+
+            BC7Block encoded = EncodeRefined<BC7Block>(block, 4, quality, weights, [&block](const float (&endpoint0)[4], const float (&endpoint1)[4])
+            {
+                return TryBC7(block, endpoint0, endpoint1);
+            });
+
+            // The most significant bit of the first index is implied 0, swapping the endpoints mirrors every index
+            if (encoded.indices[0] >= 8)
+            {
+                std::swap(encoded.endpoints[0], encoded.endpoints[1]);
+                std::swap(encoded.pBits[0],     encoded.pBits[1]);
+                for (uint8_t& index : encoded.indices)
+                {
+                    index = static_cast<uint8_t>(15 - index);
+                }
+            }
+
+            BitWriter writer{outputPtr, 16};
+            writer.Write(1 << 6, 7);
+            for (int c = 0; c < 4; ++c)
+            {
+                writer.Write(encoded.endpoints[0][c], 7);
+                writer.Write(encoded.endpoints[1][c], 7);
+            }
+            writer.Write(encoded.pBits[0], 1);
+            writer.Write(encoded.pBits[1], 1);
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                writer.Write(encoded.indices[t], t == 0 ? 3 : 4);
+            }
+        }
+
+        // Only mode 6 is ever written by EncodeBC7, blocks in any other mode decode to magenta
+        void DecodeBC7(const uint8_t* inputPtr, uint32_t (&texels)[BLOCK_TEXELS])
+        {
+            BitReader reader{inputPtr};
+            if (reader.Read(7) != 1 << 6)
+            {
+                std::fill(texels, texels + BLOCK_TEXELS, 0xFFFF00FFu);
+                return;
+            }
+
+            int endpoints[2][4];
+            for (int c = 0; c < 4; ++c)
+            {
+                endpoints[0][c] = static_cast<int>(reader.Read(7));
+                endpoints[1][c] = static_cast<int>(reader.Read(7));
+            }
+
+            const uint32_t pBit0 = reader.Read(1);
+            const uint32_t pBit1 = reader.Read(1);
+            for (int c = 0; c < 4; ++c)
+            {
+                endpoints[0][c] = endpoints[0][c] << 1 | pBit0;
+                endpoints[1][c] = endpoints[1][c] << 1 | pBit1;
+            }
+
+            for (int t = 0; t < BLOCK_TEXELS; ++t)
+            {
+                const uint32_t index = reader.Read(t == 0 ? 3 : 4);
+
+                uint32_t texel = 0;
+                for (int c = 0; c < 4; ++c)
+                {
+                    texel |= static_cast<uint32_t>(InterpolateBC7(endpoints[0][c], endpoints[1][c], BC7_WEIGHTS[index])) << (c * 8);
+                }
+                texels[t] = texel;
+            }
+        }
+    }
+#pragma endregion
+
+#pragma region Dispatch
+    namespace
+    {
+        void EncodeBlock(BlockFormat format, const BlockTexels& block, CompressionQuality quality, uint8_t* outputPtr)
+        {
+            switch (format)
+            {
+            case BlockFormat::BC1:
+                EncodeBC1(block, quality, outputPtr);
+                break;
+
+            case BlockFormat::BC4:
+                EncodeBC4(block, 0, quality, outputPtr);
+                break;
+
+            case BlockFormat::BC5:
+                EncodeBC4(block, 0, quality, outputPtr);
+                EncodeBC4(block, 1, quality, outputPtr + 8);
+                break;
+
+            case BlockFormat::BC7:
+                EncodeBC7(block, quality, outputPtr);
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        void DecodeBlock(BlockFormat format, const uint8_t* inputPtr, uint32_t (&texels)[BLOCK_TEXELS])
+        {
+            switch (format)
+            {
+            case BlockFormat::BC1:
+                DecodeBC1(inputPtr, texels);
+                break;
+
+            case BlockFormat::BC4:
+            {
+                uint8_t red[BLOCK_TEXELS];
+                DecodeBC4(inputPtr, red);
+                for (int t = 0; t < BLOCK_TEXELS; ++t)
+                {
+                    texels[t] = red[t] | 0xFF000000u;
+                }
+                break;
+            }
+
+            case BlockFormat::BC5:
+            {
+                uint8_t red[BLOCK_TEXELS];
+                uint8_t green[BLOCK_TEXELS];
+                DecodeBC4(inputPtr,     red);
+                DecodeBC4(inputPtr + 8, green);
+                for (int t = 0; t < BLOCK_TEXELS; ++t)
+                {
+                    texels[t] = red[t] | green[t] << 8 | 0xFF000000u;
+                }
+                break;
+            }
+
+            case BlockFormat::BC7:
+                DecodeBC7(inputPtr, texels);
+                break;
+
+            default:
+                std::fill(texels, texels + BLOCK_TEXELS, 0xFFFF00FFu);
+                break;
+            }
+        }
+    }
+#pragma endregion
+
+#pragma region Public
+    BlockCompressor::BlockCompressor(const CompressionSettings& settings)
+        : m_Settings{settings}
+    {
+    }
+
+    void BlockCompressor::Compress(const MipChain& mipChain, CompressedChain& compressedChain) const
+    {
+        assert(m_Settings.format != BlockFormat::None and "BlockCompressor::Compress needs a block format");
+
+        const int blockBytes = GetBlockBytes(m_Settings.format);
+
+        compressedChain.format = m_Settings.format;
+        compressedChain.levels.clear();
+
+        // Every block row of every level is one work item, the small levels ride along with the big ones
+        std::vector<std::pair<int, int>> blockRows{};
+
+        size_t numBytes = 0;
+        for (int level = 0; level < mipChain.GetLevelCount(); ++level)
+        {
+            const MipLevel& mipLevel = mipChain.levels[level];
+
+            CompressedLevel compressedLevel{mipLevel.width, mipLevel.height, std::max((mipLevel.width + 3) / 4, 1), std::max((mipLevel.height + 3) / 4, 1), numBytes};
+            numBytes += static_cast<size_t>(compressedLevel.blocksX) * compressedLevel.blocksY * blockBytes;
+            compressedChain.levels.push_back(compressedLevel);
+
+            for (int blockY = 0; blockY < compressedLevel.blocksY; ++blockY)
+            {
+                blockRows.emplace_back(level, blockY);
+            }
+        }
+        compressedChain.blocks.assign(numBytes, 0);
+
+        const auto compressRow = [this, &mipChain, &compressedChain, blockBytes](const std::pair<int, int>& blockRow)
+        {
+            const auto [level, blockY] = blockRow;
+            const CompressedLevel& compressedLevel = compressedChain.levels[level];
+
+            uint8_t* outputPtr = compressedChain.GetLevelBlocks(level) + static_cast<size_t>(blockY) * compressedLevel.blocksX * blockBytes;
+
+            BlockTexels block{};
+            for (int blockX = 0; blockX < compressedLevel.blocksX; ++blockX)
+            {
+                LoadBlock(mipChain, level, blockX, blockY, block);
+                EncodeBlock(m_Settings.format, block, m_Settings.quality, outputPtr + blockX * blockBytes);
+            }
+        };
+
+        if (m_Settings.isParallel) std::for_each(std::execution::par, blockRows.begin(), blockRows.end(), compressRow);
+        else                       std::for_each(blockRows.begin(), blockRows.end(), compressRow);
+    }
+
+    void BlockCompressor::Decompress(const CompressedChain& compressedChain, MipChain& mipChain)
+    {
+        const int blockBytes = GetBlockBytes(compressedChain.format);
+
+        mipChain.levels.clear();
+
+        uint32_t numTexels = 0;
+        for (const CompressedLevel& compressedLevel : compressedChain.levels)
+        {
+            mipChain.levels.push_back({compressedLevel.width, compressedLevel.height, numTexels});
+            numTexels += static_cast<uint32_t>(compressedLevel.width * compressedLevel.height);
+        }
+        mipChain.texels.resize(numTexels);
+
+        for (int level = 0; level < compressedChain.GetLevelCount(); ++level)
+        {
+            const CompressedLevel& compressedLevel = compressedChain.levels[level];
+            const uint8_t*         inputPtr        = compressedChain.GetLevelBlocks(level);
+            uint32_t*              texelsPtr       = mipChain.GetLevelTexels(level);
+
+            uint32_t texels[BLOCK_TEXELS];
+            for (int blockY = 0; blockY < compressedLevel.blocksY; ++blockY)
+            {
+                for (int blockX = 0; blockX < compressedLevel.blocksX; ++blockX, inputPtr += blockBytes)
+                {
+                    DecodeBlock(compressedChain.format, inputPtr, texels);
+
+                    // Drop the padding of levels smaller than a block
+                    for (int y = 0; y < 4 and blockY * 4 + y < compressedLevel.height; ++y)
+                    {
+                        for (int x = 0; x < 4 and blockX * 4 + x < compressedLevel.width; ++x)
+                        {
+                            texelsPtr[(blockY * 4 + y) * compressedLevel.width + blockX * 4 + x] = texels[y * 4 + x];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    double BlockCompressor::ComputePSNR(const MipChain& reference, const CompressedChain& compressedChain)
+    {
+        // Decompress writes row-major, and the padding of tiled levels must not count
+        if (reference.layout != TexelLayout::Linear)
+        {
+            MipChain linearReference = reference;
+            linearReference.ConvertLayout(TexelLayout::Linear);
+            return ComputePSNR(linearReference, compressedChain);
+        }
+
+        MipChain decoded{};
+        Decompress(compressedChain, decoded);
+        assert(decoded.texels.size() == reference.texels.size() and "BlockCompressor::ComputePSNR needs the chain that was compressed");
+
+        const int numChannels = GetChannelCount(compressedChain.format);
+
+        double sumSquares = 0.0;
+        for (size_t i = 0; i < reference.texels.size(); ++i)
+        {
+            for (int c = 0; c < numChannels; ++c)
+            {
+                const double difference = static_cast<double>(reference.texels[i] >> (c * 8) & 0xFF) - static_cast<double>(decoded.texels[i] >> (c * 8) & 0xFF);
+                sumSquares += difference * difference;
+            }
+        }
+
+        const double meanSquaredError = sumSquares / static_cast<double>(reference.texels.size() * numChannels);
+        if (meanSquaredError <= 0.0) return std::numeric_limits<double>::infinity();
+
+        return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+    }
+
+    int BlockCompressor::GetBlockBytes(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+        case BlockFormat::BC4: return 8;
+        case BlockFormat::BC5:
+        case BlockFormat::BC7: return 16;
+        default:               return 64; // 16 RGBA8 texels
+        }
+    }
+
+    int BlockCompressor::GetChannelCount(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC4: return 1;
+        case BlockFormat::BC5: return 2;
+        case BlockFormat::BC1: return 3;
+        default:               return 4;
+        }
+    }
+#pragma endregion
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+// Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+    // Forward declarations
+    struct MipChain;
+
+    enum class BlockFormat
+    {
+        None,  // Uncompressed RGBA8, 4 bytes per texel
+        BC1,   // RGB, 0.5 bytes per texel
+        BC4,   // R only, 0.5 bytes per texel, for single-channel data
+        BC5,   // RG, 1 byte per texel, normal maps with Z reconstructed in the shader
+        BC7,   // RGBA, 1 byte per texel, mode 6 only
+
+        COUNT
+    };
+
+    enum class CompressionQuality
+    {
+        Fast,   // Bounding box endpoints
+        Normal, // Principal axis endpoints, refined once
+        Best,   // Principal axis endpoints, refined until they stop improving, BC4 also tries its 6-value mode
+
+        COUNT
+    };
+
+    struct CompressionSettings
+    {
+        BlockFormat        format     = BlockFormat::None;
+        CompressionQuality quality    = CompressionQuality::Normal;
+        bool               isParallel = true;
+    };
+
+    struct CompressedLevel
+    {
+        int    width   = 0;
+        int    height  = 0;
+        int    blocksX = 0;
+        int    blocksY = 0;
+        size_t offset  = 0; // First byte of this level inside CompressedChain::blocks
+    };
+
+    // Every mip level of a texture as 4x4 blocks, back to back in one allocation and ready for D3D11_SUBRESOURCE_DATA
+    struct CompressedChain
+    {
+        BlockFormat                  format = BlockFormat::None;
+        std::vector<CompressedLevel> levels {};
+        std::vector<uint8_t>         blocks {};
+
+        int  GetLevelCount() const { return static_cast<int>(levels.size()); }
+        bool IsEmpty()       const { return levels.empty(); }
+
+        const uint8_t* GetLevelBlocks(int level) const { return blocks.data() + levels[level].offset; }
+        uint8_t*       GetLevelBlocks(int level)       { return blocks.data() + levels[level].offset; }
+    };
+
+    /**
+     * \brief CPU encoder for the D3D11 block-compressed formats, every mip level of a MipChain is compressed independently.
+     * Index selection tests 8 texels against the whole palette at once with AVX2, block rows are spread over the cores.
+     */
+    class BlockCompressor final
+    {
+    public:
+        explicit BlockCompressor(const CompressionSettings& settings = CompressionSettings{});
+        ~BlockCompressor() = default;
+
+        BlockCompressor(const BlockCompressor& other)                = default;
+        BlockCompressor(BlockCompressor&& other) noexcept            = default;
+        BlockCompressor& operator=(const BlockCompressor& other)     = default;
+        BlockCompressor& operator=(BlockCompressor&& other) noexcept = default;
+
+        // Levels smaller than a block are padded by repeating their edge texels
+        void Compress(const MipChain& mipChain, CompressedChain& compressedChain) const;
+
+        // Channels the format does not store decode like the GPU does: 0 for G and B, 255 for alpha
+        static void Decompress(const CompressedChain& compressedChain, MipChain& mipChain);
+
+        // Over every texel of every level, but only over the channels the format stores
+        static double ComputePSNR(const MipChain& reference, const CompressedChain& compressedChain);
+
+        static int GetBlockBytes(BlockFormat format);
+        static int GetChannelCount(BlockFormat format);
+
+        const CompressionSettings& GetSettings() const { return m_Settings; }
+
+    private:
+        CompressionSettings m_Settings {};
+    };
+}
@@ -0,0 +1,217 @@
+#include "pch.h"
+#include "Clipper.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        enum Outcode : int
+        {
+            OUT_NEAR         = 1 << 0,
+            OUT_FAR          = 1 << 1,
+            OUT_LEFT         = 1 << 2,
+            OUT_RIGHT        = 1 << 3,
+            OUT_BOTTOM       = 1 << 4,
+            OUT_TOP          = 1 << 5,
+            OUT_GUARD_LEFT   = 1 << 6,
+            OUT_GUARD_RIGHT  = 1 << 7,
+            OUT_GUARD_BOTTOM = 1 << 8,
+            OUT_GUARD_TOP    = 1 << 9,
+
+            FRUSTUM_PLANES = OUT_NEAR | OUT_FAR | OUT_LEFT | OUT_RIGHT | OUT_BOTTOM | OUT_TOP,
+            CLIP_PLANES    = OUT_NEAR | OUT_GUARD_LEFT | OUT_GUARD_RIGHT | OUT_GUARD_BOTTOM | OUT_GUARD_TOP
+        };
+
+        constexpr int NUM_CLIP_PLANES = 5;
+
+#if !defined(__AVX2__)
+        // Scalar fallback of ComputeOutcodes()
+        int ComputeOutcode(float x, float y, float z, float w, float guardBand)
+        {
+            const float guardBandW = guardBand * w;
+
+            int outcode = 0;
+            if (z < 0.0f)         outcode |= OUT_NEAR;
+            if (z > w)            outcode |= OUT_FAR;
+            if (x < -w)           outcode |= OUT_LEFT;
+            if (x >  w)           outcode |= OUT_RIGHT;
+            if (y < -w)           outcode |= OUT_BOTTOM;
+            if (y >  w)           outcode |= OUT_TOP;
+            if (x < -guardBandW)  outcode |= OUT_GUARD_LEFT;
+            if (x >  guardBandW)  outcode |= OUT_GUARD_RIGHT;
+            if (y < -guardBandW)  outcode |= OUT_GUARD_BOTTOM;
+            if (y >  guardBandW)  outcode |= OUT_GUARD_TOP;
+            return outcode;
+        }
+#endif
+
+        ClipResult ToClipResult(int andOutcode, int orOutcode)
+        {
+            if (andOutcode & FRUSTUM_PLANES) return ClipResult::Outside;
+            if (orOutcode  & CLIP_PLANES)    return ClipResult::Clip;
+            return ClipResult::Inside;
+        }
+
+        // Signed distance to clip plane i, the inside is >= 0
+        float PlaneDistance(const Vector4& position, int plane, float guardBand)
+        {
+            switch (plane)
+            {
+            case 0:  return position.z;
+            case 1:  return guardBand * position.w + position.x;
+            case 2:  return guardBand * position.w - position.x;
+            case 3:  return guardBand * position.w + position.y;
+            default: return guardBand * position.w - position.y;
+            }
+        }
+
+        ClippedVertex Lerp(const ClippedVertex& from, const ClippedVertex& to, float t)
+        {
+            ClippedVertex result{};
+            result.position = from.position + (to.position - from.position) * t;
+            for (int i = 0; i < 3; ++i)
+            {
+                result.weights[i] = Lerpf(from.weights[i], to.weights[i], t);
+            }
+            return result;
+        }
+
+#if defined(__AVX2__)
+        __m256i Bit(__m256 mask, int bit)
+        {
+            return _mm256_and_si256(_mm256_castps_si256(mask), _mm256_set1_epi32(bit));
+        }
+
+        __m256i ComputeOutcodes(__m256 x, __m256 y, __m256 z, __m256 w, __m256 guardBand)
+        {
+            const __m256 zero          = _mm256_setzero_ps();
+            const __m256 negW          = _mm256_sub_ps(zero, w);
+            const __m256 guardBandW    = _mm256_mul_ps(guardBand, w);
+            const __m256 negGuardBandW = _mm256_sub_ps(zero, guardBandW);
+
+            __m256i outcode = Bit(_mm256_cmp_ps(z, zero, _CMP_LT_OQ), OUT_NEAR);
+            outcode = _mm256_or_si256(outcode, Bit(_mm256_cmp_ps(z, w,             _CMP_GT_OQ), OUT_FAR));
+            outcode = _mm256_or_si256(outcode, Bit(_mm256_cmp_ps(x, negW,          _CMP_LT_OQ), OUT_LEFT));
+            outcode = _mm256_or_si256(outcode, Bit(_mm256_cmp_ps(x, w,             _CMP_GT_OQ), OUT_RIGHT));
+            outcode = _mm256_or_si256(outcode, Bit(_mm256_cmp_ps(y, negW,          _CMP_LT_OQ), OUT_BOTTOM));
+            outcode = _mm256_or_si256(outcode, Bit(_mm256_cmp_ps(y, w,             _CMP_GT_OQ), OUT_TOP));
+            outcode = _mm256_or_si256(outcode, Bit(_mm256_cmp_ps(x, negGuardBandW, _CMP_LT_OQ), OUT_GUARD_LEFT));
+            outcode = _mm256_or_si256(outcode, Bit(_mm256_cmp_ps(x, guardBandW,    _CMP_GT_OQ), OUT_GUARD_RIGHT));
+            outcode = _mm256_or_si256(outcode, Bit(_mm256_cmp_ps(y, negGuardBandW, _CMP_LT_OQ), OUT_GUARD_BOTTOM));
+            outcode = _mm256_or_si256(outcode, Bit(_mm256_cmp_ps(y, guardBandW,    _CMP_GT_OQ), OUT_GUARD_TOP));
+            return outcode;
+        }
+#endif
+    }
+#pragma endregion
+
+#pragma region Initialization
+    Clipper::Clipper(float guardBand)
+    {
+        SetGuardBand(guardBand);
+    }
+
+    void Clipper::SetGuardBand(float guardBand)
+    {
+        m_GuardBand = std::max(guardBand, 1.0f);
+    }
+#pragma endregion
+
+#pragma region Clipping
+    void Clipper::Classify(const ClipTriangleBatch& batch, int count, ClipResult (&results)[BATCH_SIZE]) const
+    {
+#if defined(__AVX2__)
+        const __m256 guardBand = _mm256_set1_ps(m_GuardBand);
+
+        __m256i andOutcode = _mm256_set1_epi32(-1);
+        __m256i orOutcode  = _mm256_setzero_si256();
+        for (int v = 0; v < 3; ++v)
+        {
+            const __m256i outcode = ComputeOutcodes(_mm256_load_ps(batch.x[v]), _mm256_load_ps(batch.y[v]),
+                                                    _mm256_load_ps(batch.z[v]), _mm256_load_ps(batch.w[v]), guardBand);
+            andOutcode = _mm256_and_si256(andOutcode, outcode);
+            orOutcode  = _mm256_or_si256(orOutcode, outcode);
+        }
+
+        alignas(32) int andOutcodes[BATCH_SIZE];
+        alignas(32) int orOutcodes[BATCH_SIZE];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(andOutcodes), andOutcode);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(orOutcodes),  orOutcode);
+
+        for (int i = 0; i < count; ++i)
+        {
+            results[i] = ToClipResult(andOutcodes[i], orOutcodes[i]);
+        }
+#else
+        for (int i = 0; i < count; ++i)
+        {
+            int andOutcode = ~0;
+            int orOutcode  = 0;
+            for (int v = 0; v < 3; ++v)
+            {
+                const int outcode = ComputeOutcode(batch.x[v][i], batch.y[v][i], batch.z[v][i], batch.w[v][i], m_GuardBand);
+                andOutcode &= outcode;
+                orOutcode  |= outcode;
+            }
+            results[i] = ToClipResult(andOutcode, orOutcode);
+        }
+#endif
+    }
+
+    // Sutherland-Hodgman against the near plane and the four guard band planes
+    int Clipper::ClipTriangle(const Vector4 (&positions)[3], ClippedVertex (&polygon)[MAX_POLYGON_VERTICES]) const
+    {
+        ClippedVertex buffers[2][MAX_POLYGON_VERTICES];
+        for (int i = 0; i < 3; ++i)
+        {
+            buffers[0][i] = ClippedVertex{positions[i], {i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f}};
+        }
+
+        int input = 0;
+        int count = 3;
+        for (int plane = 0; plane < NUM_CLIP_PLANES and count > 0; ++plane)
+        {
+            float distances[MAX_POLYGON_VERTICES];
+            bool  isAnyOutside = false;
+            for (int i = 0; i < count; ++i)
+            {
+                distances[i]  = PlaneDistance(buffers[input][i].position, plane, m_GuardBand);
+                isAnyOutside |= distances[i] < 0.0f;
+            }
+            if (not isAnyOutside) continue;
+
+            const ClippedVertex* source      = buffers[input];
+            ClippedVertex*       destination = buffers[1 - input];
+
+            int newCount = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                const int  next         = (i + 1) % count;
+                const bool isInside     = distances[i]    >= 0.0f;
+                const bool isNextInside = distances[next] >= 0.0f;
+
+                if (isInside) destination[newCount++] = source[i];
+                if (isInside != isNextInside)
+                {
+                    const float t = distances[i] / (distances[i] - distances[next]);
+                    destination[newCount++] = Lerp(source[i], source[next], t);
+                }
+            }
+
+            input = 1 - input;
+            count = newCount;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            polygon[i] = buffers[input][i];
+        }
+        return count;
+    }
+#pragma endregion
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// Project includes
+#include "Vector4.h"
+
+// Standard includes
+#include <cstdint>
+
+namespace dae
+{
+    enum class ClipResult : uint8_t
+    {
+        Inside,  // Inside the near plane and the guard band, rasterize directly and let scissoring do the rest
+        Outside, // Completely outside one of the frustum planes
+        Clip     // Crosses the near plane or leaves the guard band
+    };
+
+    // Clip-space positions of eight triangles in SoA layout
+    struct ClipTriangleBatch
+    {
+        alignas(32) float x[3][8] {};
+        alignas(32) float y[3][8] {};
+        alignas(32) float z[3][8] {};
+        alignas(32) float w[3][8] {};
+    };
+
+    // Vertex of a clipped polygon, weights are barycentrics relative to the input triangle
+    struct ClippedVertex
+    {
+        Vector4 position   {};
+        float   weights[3] {};
+    };
+
+    /**
+     * \brief Homogeneous clipper with a guard band for the software rasterizer (D3D clip space, 0 <= z <= w).
+     * Only triangles that cross the near plane or exceed the guard band are clipped, everything else is rasterized directly.
+     * There is no far plane clipping, the depth test against the cleared depth of 1.0 already discards those fragments.
+     */
+    class Clipper final
+    {
+    public:
+        static constexpr int   BATCH_SIZE           = 8;
+        static constexpr int   MAX_POLYGON_VERTICES = 8; // 3 + one per clip plane
+        static constexpr float DEFAULT_GUARD_BAND   = 8.0f;
+
+        explicit Clipper(float guardBand = DEFAULT_GUARD_BAND);
+        ~Clipper() = default;
+
+        Clipper(const Clipper& other)                = default;
+        Clipper(Clipper&& other) noexcept            = default;
+        Clipper& operator=(const Clipper& other)     = default;
+        Clipper& operator=(Clipper&& other) noexcept = default;
+
+        // Classifies the first count triangles of the batch, unused lanes are left untouched
+        void Classify(const ClipTriangleBatch& batch, int count, ClipResult (&results)[BATCH_SIZE]) const;
+
+        // Returns the number of vertices of the clipped convex polygon, 0 when nothing is left
+        int ClipTriangle(const Vector4 (&positions)[3], ClippedVertex (&polygon)[MAX_POLYGON_VERTICES]) const;
+
+        // Guard band extent in multiples of the viewport, 1 means clipping at the frustum
+        void  SetGuardBand(float guardBand);
+        float GetGuardBand() const { return m_GuardBand; }
+
+    private:
+        float m_GuardBand = DEFAULT_GUARD_BAND;
+    };
+}
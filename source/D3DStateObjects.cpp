@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "D3DStateObjects.h"
+
+// Project includes
+#include "StateDescriptors.h"
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        const char* GetTypeName(StateObjectType type)
+        {
+            switch (type)
+            {
+                case StateObjectType::Rasterizer:   return "rasterizer";
+                case StateObjectType::Blend:        return "blend";
+                case StateObjectType::DepthStencil: return "depth-stencil";
+                case StateObjectType::Sampler:      return "sampler";
+                default:                            return "unknown";
+            }
+        }
+    }
+#pragma endregion
+
+#pragma region D3DStateObjectFactory
+    D3DStateObjects::D3DStateObjectFactory::D3DStateObjectFactory(ID3D11Device* devicePtr)
+        : m_DevicePtr{devicePtr}
+    {
+        if (m_DevicePtr) m_DevicePtr->AddRef();
+    }
+
+    D3DStateObjects::D3DStateObjectFactory::~D3DStateObjectFactory()
+    {
+        SAFE_RELEASE(m_DevicePtr)
+    }
+
+    void* D3DStateObjects::D3DStateObjectFactory::Create(StateObjectType type, const void* descPtr, size_t descSize)
+    {
+        HRESULT result    = E_INVALIDARG;
+        void*   objectPtr = nullptr;
+
+        switch (type)
+        {
+            case StateObjectType::Rasterizer:
+            {
+                if (descSize != sizeof(D3D11_RASTERIZER_DESC)) break;
+                ID3D11RasterizerState* statePtr = nullptr;
+                result    = m_DevicePtr->CreateRasterizerState(static_cast<const D3D11_RASTERIZER_DESC*>(descPtr), &statePtr);
+                objectPtr = statePtr;
+                break;
+            }
+            case StateObjectType::Blend:
+            {
+                if (descSize != sizeof(D3D11_BLEND_DESC)) break;
+                ID3D11BlendState* statePtr = nullptr;
+                result    = m_DevicePtr->CreateBlendState(static_cast<const D3D11_BLEND_DESC*>(descPtr), &statePtr);
+                objectPtr = statePtr;
+                break;
+            }
+            case StateObjectType::DepthStencil:
+            {
+                if (descSize != sizeof(D3D11_DEPTH_STENCIL_DESC)) break;
+                ID3D11DepthStencilState* statePtr = nullptr;
+                result    = m_DevicePtr->CreateDepthStencilState(static_cast<const D3D11_DEPTH_STENCIL_DESC*>(descPtr), &statePtr);
+                objectPtr = statePtr;
+                break;
+            }
+            case StateObjectType::Sampler:
+            {
+                if (descSize != sizeof(D3D11_SAMPLER_DESC)) break;
+                ID3D11SamplerState* statePtr = nullptr;
+                result    = m_DevicePtr->CreateSamplerState(static_cast<const D3D11_SAMPLER_DESC*>(descPtr), &statePtr);
+                objectPtr = statePtr;
+                break;
+            }
+            default:
+                break;
+        }
+
+        return SUCCEEDED(result) ? objectPtr : nullptr;
+    }
+
+    void D3DStateObjects::D3DStateObjectFactory::Destroy(StateObjectType type, void* objectPtr)
+    {
+        // Released through their own type, the pointers were stored as void*
+        switch (type)
+        {
+            case StateObjectType::Rasterizer:   static_cast<ID3D11RasterizerState*>(objectPtr)->Release();   break;
+            case StateObjectType::Blend:        static_cast<ID3D11BlendState*>(objectPtr)->Release();        break;
+            case StateObjectType::DepthStencil: static_cast<ID3D11DepthStencilState*>(objectPtr)->Release(); break;
+            case StateObjectType::Sampler:      static_cast<ID3D11SamplerState*>(objectPtr)->Release();      break;
+            default:                                                                                         break;
+        }
+    }
+#pragma endregion
+
+#pragma region Initialization & Cleanup
+    D3DStateObjects::D3DStateObjects(ID3D11Device* devicePtr)
+        : m_Factory{devicePtr}
+        , m_CachePtr{new StateObjectCache{m_Factory}}
+    {
+    }
+
+    D3DStateObjects::~D3DStateObjects()
+    {
+        // Releases every state through the factory, before the factory releases the device
+        delete m_CachePtr;
+    }
+#pragma endregion
+
+#pragma region Public
+    ID3D11RasterizerState* D3DStateObjects::GetRasterizerState(const D3D11_RASTERIZER_DESC& desc)
+    {
+        const D3D11_RASTERIZER_DESC normalized = StateDescriptors::NormalizeRasterizerDesc(desc);
+        return static_cast<ID3D11RasterizerState*>(Acquire(StateObjectType::Rasterizer, &normalized, sizeof(normalized)));
+    }
+
+    ID3D11BlendState* D3DStateObjects::GetBlendState(const D3D11_BLEND_DESC& desc)
+    {
+        const D3D11_BLEND_DESC normalized = StateDescriptors::NormalizeBlendDesc(desc);
+        return static_cast<ID3D11BlendState*>(Acquire(StateObjectType::Blend, &normalized, sizeof(normalized)));
+    }
+
+    ID3D11DepthStencilState* D3DStateObjects::GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc)
+    {
+        const D3D11_DEPTH_STENCIL_DESC normalized = StateDescriptors::NormalizeDepthStencilDesc(desc);
+        return static_cast<ID3D11DepthStencilState*>(Acquire(StateObjectType::DepthStencil, &normalized, sizeof(normalized)));
+    }
+
+    ID3D11SamplerState* D3DStateObjects::GetSamplerState(const D3D11_SAMPLER_DESC& desc)
+    {
+        const D3D11_SAMPLER_DESC normalized = StateDescriptors::NormalizeSamplerDesc(desc);
+        return static_cast<ID3D11SamplerState*>(Acquire(StateObjectType::Sampler, &normalized, sizeof(normalized)));
+    }
+#pragma endregion
+
+#pragma region Private
+    void* D3DStateObjects::Acquire(StateObjectType type, const void* descPtr, size_t descSize)
+    {
+        const StateCacheStats previousStats = m_CachePtr->GetStats();
+        void*                 objectPtr     = m_CachePtr->Acquire(type, descPtr, descSize);
+        const StateCacheStats& stats        = m_CachePtr->GetStats();
+
+        if (stats.failures != previousStats.failures)
+        {
+            std::cout << RED_TEXT("**(HARDWARE) Failed to create ") << MAGENTA_TEXT("" + std::string{GetTypeName(type)} + "")
+                      << RED_TEXT(" state!\n");
+        }
+        else if (stats.lateCreations != previousStats.lateCreations)
+        {
+            std::cout << YELLOW_TEXT("**(HARDWARE) Created ") << MAGENTA_TEXT("" + std::string{GetTypeName(type)} + "")
+                      << YELLOW_TEXT(" state after the prewarm, add it to the prewarmed states\n");
+        }
+        return objectPtr;
+    }
+#pragma endregion
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Project includes
+#include "StateObjectCache.h"
+
+namespace dae
+{
+    /**
+     * \brief The D3D11 side of a StateObjectCache: typed getters that return shared rasterizer, blend, depth-stencil and sampler states.
+     * Every getter normalizes its descriptor into a zeroed copy first, so padding never makes equal states look different. The returned
+     * states are borrowed, they stay alive until this object is deleted and must not be released by the caller.
+     */
+    class D3DStateObjects final
+    {
+    public:
+        explicit D3DStateObjects(ID3D11Device* devicePtr);
+        ~D3DStateObjects();
+
+        D3DStateObjects(const D3DStateObjects&)                = delete;
+        D3DStateObjects(D3DStateObjects&&) noexcept            = delete;
+        D3DStateObjects& operator=(const D3DStateObjects&)     = delete;
+        D3DStateObjects& operator=(D3DStateObjects&&) noexcept = delete;
+
+        ID3D11RasterizerState*   GetRasterizerState(const D3D11_RASTERIZER_DESC& desc);
+        ID3D11BlendState*        GetBlendState(const D3D11_BLEND_DESC& desc);
+        ID3D11DepthStencilState* GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc);
+        ID3D11SamplerState*      GetSamplerState(const D3D11_SAMPLER_DESC& desc);
+
+        // Every state the application switches between was requested, see StateObjectCache::Seal()
+        void Seal() { m_CachePtr->Seal(); }
+
+        const StateCacheStats& GetStats() const { return m_CachePtr->GetStats(); }
+
+    private:
+        // Creates the objects the cache keeps, the device is released with it
+        class D3DStateObjectFactory final : public IStateObjectFactory
+        {
+        public:
+            explicit D3DStateObjectFactory(ID3D11Device* devicePtr);
+            ~D3DStateObjectFactory() override;
+
+            D3DStateObjectFactory(const D3DStateObjectFactory&)                = delete;
+            D3DStateObjectFactory(D3DStateObjectFactory&&) noexcept            = delete;
+            D3DStateObjectFactory& operator=(const D3DStateObjectFactory&)     = delete;
+            D3DStateObjectFactory& operator=(D3DStateObjectFactory&&) noexcept = delete;
+
+            void* Create(StateObjectType type, const void* descPtr, size_t descSize) override;
+            void  Destroy(StateObjectType type, void* objectPtr) override;
+
+        private:
+            ID3D11Device* m_DevicePtr = nullptr;
+        };
+
+        // Warns about every refused and every late creation
+        void* Acquire(StateObjectType type, const void* descPtr, size_t descSize);
+
+        D3DStateObjectFactory m_Factory;
+        StateObjectCache*     m_CachePtr = nullptr;
+    };
+}
@@ -1,18 +1,273 @@
 #include "pch.h"
 #include "Effect.h"
 
+// Project includes
+#include "EffectCache.h"
+
+// Standard includes
+#include <map>
+#include <tuple>
+
 namespace dae
 {
+#pragma region Helpers
+    namespace
+    {
+        // The effect framework compiles through D3DCompile with the fx_5_0 profile as well, this only keeps the binary it produces
+        class D3DEffectCompiler final : public IEffectCompiler
+        {
+        public:
+            bool Compile(const EffectSource& source, std::vector<uint8_t>& binary, std::string& errors) const override
+            {
+                std::vector<D3D_SHADER_MACRO> macros{};
+                for (const EffectDefine& define : source.defines)
+                {
+                    macros.push_back({define.name.c_str(), define.value.c_str()});
+                }
+                macros.push_back({nullptr, nullptr});
+
+                ID3DBlob* binaryBlobPtr = nullptr;
+                ID3DBlob* errorBlobPtr  = nullptr;
+
+                const HRESULT result = D3DCompileFromFile(source.path.wstring().c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, nullptr, "fx_5_0",
+                                                          source.shaderFlags, source.effectFlags, &binaryBlobPtr, &errorBlobPtr);
+                if (errorBlobPtr != nullptr)
+                {
+                    errors.assign(static_cast<const char*>(errorBlobPtr->GetBufferPointer()), errorBlobPtr->GetBufferSize());
+                    SAFE_RELEASE(errorBlobPtr)
+                }
+                if (FAILED(result) or binaryBlobPtr == nullptr)
+                {
+                    SAFE_RELEASE(binaryBlobPtr)
+                    return false;
+                }
+
+                const uint8_t* binaryPtr = static_cast<const uint8_t*>(binaryBlobPtr->GetBufferPointer());
+                binary.assign(binaryPtr, binaryPtr + binaryBlobPtr->GetBufferSize());
+                SAFE_RELEASE(binaryBlobPtr)
+                return true;
+            }
+
+            std::string GetVersion() const override
+            {
+                return "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION) + " fx_5_0";
+            }
+        };
+
+        // Entries live in an EffectCache folder next to every .fx file
+        EffectCache& GetEffectCache()
+        {
+            static const D3DEffectCompiler s_Compiler{};
+            static EffectCache             s_EffectCache{s_Compiler};
+            return s_EffectCache;
+        }
+
+        // Uploads into the constant buffer of one tier. Resolved again whenever the layout of the blocks changes
+        class EffectParameterSink final : public IParameterSink
+        {
+        public:
+            EffectParameterSink(const Effect& effect, ID3DX11EffectConstantBuffer* bufferPtr)
+                : m_Effect{effect},
+                  m_BufferPtr{bufferPtr}
+            {
+            }
+
+            void Upload(const ParameterBlock& block, uint64_t fieldMask) override
+            {
+                if (block.GetLayoutId() != m_LayoutId) Resolve(block);
+
+                if (m_IsPacked)
+                {
+                    uint32_t offset{};
+                    uint32_t size{};
+                    block.GetRange(fieldMask, offset, size);
+                    m_BufferPtr->SetRawValue(block.GetData() + offset, offset, size);
+                    return;
+                }
+
+                const std::vector<ParameterField>& fields = block.GetFields();
+                for (size_t i = 0; i < fields.size(); ++i)
+                {
+                    const FieldTarget& target = m_Targets[i];
+                    if (not (fieldMask & (uint64_t{1} << i)) or not target.variablePtr) continue;
+
+                    // The matrix setter transposes into column_major, the raw bytes are row major like Matrix
+                    const uint8_t* dataPtr = block.GetData() + fields[i].offset;
+                    if (target.isColumnMajor) target.variablePtr->AsMatrix()->SetMatrix(reinterpret_cast<const float*>(dataPtr));
+                    else                      target.variablePtr->SetRawValue(dataPtr, 0, fields[i].size);
+                }
+            }
+
+        private:
+            struct FieldTarget
+            {
+                ID3DX11EffectVariable* variablePtr   = nullptr;
+                bool                   isColumnMajor = false;
+            };
+
+            // Packed when every field lives in the buffer at the offset the block gave it, and no matrix needs transposing
+            void Resolve(const ParameterBlock& block)
+            {
+                m_LayoutId = block.GetLayoutId();
+                m_IsPacked = m_BufferPtr and m_BufferPtr->IsValid();
+                m_Targets.clear();
+
+                for (const ParameterField& field : block.GetFields())
+                {
+                    FieldTarget& target = m_Targets.emplace_back();
+
+                    ID3DX11EffectVariable* variablePtr = m_Effect.GetVariableByName(field.name);
+                    if (not variablePtr or not variablePtr->IsValid())
+                    {
+                        m_IsPacked = false;
+                        continue;
+                    }
+
+                    D3DX11_EFFECT_VARIABLE_DESC variableDesc{};
+                    D3DX11_EFFECT_TYPE_DESC     typeDesc{};
+                    variablePtr->GetDesc(&variableDesc);
+                    variablePtr->GetType()->GetDesc(&typeDesc);
+
+                    target.variablePtr   = variablePtr;
+                    target.isColumnMajor = typeDesc.Class == D3D_SVC_MATRIX_COLUMNS;
+
+                    m_IsPacked = m_IsPacked and variablePtr->GetParentConstantBuffer() == m_BufferPtr and variableDesc.BufferOffset == field.offset
+                                 and not target.isColumnMajor;
+                }
+            }
+
+            const Effect&                m_Effect;
+            ID3DX11EffectConstantBuffer* m_BufferPtr = nullptr;
+            uint64_t                     m_LayoutId  = 0;
+            bool                         m_IsPacked  = false;
+            std::vector<FieldTarget>     m_Targets   {};
+        };
+
+        // By ParameterFrequency
+        constexpr const char* PARAMETER_BUFFER_NAMES[] = {"cbFrame", "cbObject", "cbMaterial"};
+
+        std::string JoinDefines(const std::vector<EffectDefine>& defines)
+        {
+            std::string permutation{};
+            for (const EffectDefine& define : defines)
+            {
+                if (not permutation.empty()) permutation += ' ';
+                permutation += define.name + '=' + define.value;
+            }
+            return permutation;
+        }
+
+        void AddParameterStats(ParameterUploadStats& total, const ParameterUploadStats& stats)
+        {
+            total.applies        += stats.applies;
+            total.uploads        += stats.uploads;
+            total.uploadedFields += stats.uploadedFields;
+            total.uploadedBytes  += stats.uploadedBytes;
+        }
+
+        EffectSource MakeSource(const std::wstring& assetFile, const std::vector<EffectDefine>& defines)
+        {
+            EffectSource source{};
+            source.path    = assetFile;
+            source.defines = defines;
+#if defined( DEBUG ) || defined( _DEBUG )
+            source.shaderFlags |= D3DCOMPILE_DEBUG;
+            source.shaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+            return source;
+        }
+
+        // Every effect that is alive, by device, file and define set
+        using EffectKey = std::tuple<ID3D11Device*, std::wstring, std::string>;
+
+        std::map<EffectKey, Effect*> g_Effects{};
+        EffectRegistryStats          g_RegistryStats{};
+    }
+#pragma endregion
+
 #pragma region Initialization & Cleanup
-    Effect::Effect(ID3D11Device* devicePtr, const std::wstring& assetFile)
+    struct Effect::ParameterSlot
+    {
+        ParameterSlot(const Effect& effect, ID3DX11EffectConstantBuffer* bufferPtr)
+            : sink{effect, bufferPtr},
+              binding{sink}
+        {
+        }
+
+        EffectParameterSink sink;
+        ParameterBinding    binding;
+    };
+
+    Effect::Effect(ID3D11Device* devicePtr, const std::wstring& assetFile, const std::vector<EffectDefine>& defines, std::string permutation)
+        : m_DevicePtr{devicePtr},
+          m_AssetFile{assetFile},
+          m_Permutation{std::move(permutation)},
+          m_Source{MakeSource(assetFile, defines)}
     {
-        m_EffectPtr = LoadEffect(devicePtr, assetFile);
+        // Hashed before the load, an edit that lands in between is picked up by the next reload rather than missed
+        m_SourceKey = GetSourceKey(m_Source);
+        m_EffectPtr = LoadEffect(devicePtr, assetFile, defines);
     }
 
     Effect::~Effect()
     {
+        for (const ParameterSlot* slotPtr : m_ParameterSlots)
+        {
+            delete slotPtr;
+        }
+
+        for (ID3DX11Effect*& effectPtr : m_RetiredEffects)
+        {
+            SAFE_RELEASE(effectPtr)
+        }
         SAFE_RELEASE(m_EffectPtr)
     }
+
+    Effect* Effect::Acquire(ID3D11Device* devicePtr, const std::wstring& assetFile)
+    {
+        return Acquire(devicePtr, assetFile, {});
+    }
+
+    Effect* Effect::Acquire(ID3D11Device* devicePtr, const std::wstring& assetFile, const std::vector<EffectDefine>& defines)
+    {
+        ++g_RegistryStats.acquisitions;
+
+        const EffectKey key{devicePtr, assetFile, JoinDefines(defines)};
+
+        Effect*& effectPtr = g_Effects[key];
+        if (not effectPtr)
+        {
+            ++g_RegistryStats.loads;
+
+            effectPtr = new Effect(devicePtr, assetFile, defines, std::get<2>(key));
+            if (not effectPtr->m_EffectPtr)
+            {
+                delete effectPtr;
+                g_Effects.erase(key);
+                return nullptr;
+            }
+            ++g_RegistryStats.effectCount;
+        }
+
+        effectPtr->AddRef();
+        return effectPtr;
+    }
+
+    void Effect::AddRef()
+    {
+        ++m_RefCount;
+        ++g_RegistryStats.referenceCount;
+    }
+
+    void Effect::Release()
+    {
+        --g_RegistryStats.referenceCount;
+        if (--m_RefCount > 0) return;
+
+        --g_RegistryStats.effectCount;
+        g_Effects.erase({m_DevicePtr, m_AssetFile, m_Permutation});
+        delete this;
+    }
 #pragma endregion
 
 #pragma region Getters
@@ -23,67 +278,194 @@ namespace dae
 
     ID3DX11EffectTechnique* Effect::GetTechniqueByName(const std::string& name) const
     {
-        return m_EffectPtr->GetTechniqueByName(name.c_str());
+        const auto [it, isNew] = m_Techniques.try_emplace(name, nullptr);
+        if (not isNew)
+        {
+            ++g_RegistryStats.cachedLookups;
+            return it->second;
+        }
+
+        ++g_RegistryStats.reflectionLookups;
+        it->second = m_EffectPtr->GetTechniqueByName(name.c_str());
+        return it->second;
     }
 
     ID3DX11EffectVariable* Effect::GetVariableByName(const std::string& name) const
     {
-        return m_EffectPtr->GetVariableByName(name.c_str());
+        const auto [it, isNew] = m_Variables.try_emplace(name, nullptr);
+        if (not isNew)
+        {
+            ++g_RegistryStats.cachedLookups;
+            return it->second;
+        }
+
+        ++g_RegistryStats.reflectionLookups;
+        it->second = m_EffectPtr->GetVariableByName(name.c_str());
+        return it->second;
+    }
+#pragma endregion
+
+#pragma region Public
+    bool Effect::ApplyParameters(const ParameterBlock& block) const
+    {
+        const size_t slotIdx = static_cast<size_t>(block.GetFrequency());
+        if (m_ParameterSlots.size() <= slotIdx) m_ParameterSlots.resize(slotIdx + 1, nullptr);
+
+        ParameterSlot*& slotPtr = m_ParameterSlots[slotIdx];
+        if (not slotPtr) slotPtr = new ParameterSlot{*this, m_EffectPtr->GetConstantBufferByName(PARAMETER_BUFFER_NAMES[slotIdx])};
+
+        return slotPtr->binding.Apply(block);
+    }
+
+    bool Effect::SetResource(ID3DX11EffectShaderResourceVariable* variablePtr, ID3D11ShaderResourceView* SRVPtr) const
+    {
+        const auto [it, isNew] = m_BoundResources.try_emplace(variablePtr, SRVPtr);
+        if (not isNew and it->second == SRVPtr) return false;
+
+        it->second = SRVPtr;
+        variablePtr->SetResource(SRVPtr);
+        return true;
+    }
+#pragma endregion
+
+#pragma region Private
+    void Effect::Swap(ID3DX11Effect* effectPtr, uint64_t key)
+    {
+        m_RetiredEffects.push_back(m_EffectPtr);
+        m_EffectPtr = effectPtr;
+        m_SourceKey = key;
+        ++m_Generation;
+
+        m_Techniques.clear();
+        m_Variables.clear();
+        m_BoundResources.clear();
+
+        // The new slots upload every block in full, the buffers of the new effect start out empty
+        for (const ParameterSlot* slotPtr : m_ParameterSlots)
+        {
+            if (slotPtr) AddParameterStats(m_RetiredParameterStats, slotPtr->binding.GetStats());
+            delete slotPtr;
+        }
+        m_ParameterSlots.clear();
     }
 #pragma endregion
 
 #pragma region Static Functions
     ID3DX11Effect* Effect::LoadEffect(ID3D11Device* devicePtr, const std::wstring& assetFile)
     {
-        HRESULT result;
-        ID3D10Blob* errorBlobPtr = nullptr;
-        ID3DX11Effect* effectPtr = nullptr;
+        return LoadEffect(devicePtr, assetFile, {});
+    }
 
-        DWORD shaderFlags = 0;
-#if defined( DEBUG ) || defined( _DEBUG )
-        shaderFlags |= D3DCOMPILE_DEBUG;
-        shaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
+    ID3DX11Effect* Effect::LoadEffect(ID3D11Device* devicePtr, const std::wstring& assetFile, const std::vector<EffectDefine>& defines)
+    {
+        std::string          errors{};
+        ID3DX11Effect* const effectPtr = CreateEffect(devicePtr, MakeSource(assetFile, defines), errors);
+        if (not effectPtr)
+        {
+            std::wstringstream ss;
+            for (const char c : errors)
+                ss << c;
 
-        result = D3DX11CompileEffectFromFile(
-            assetFile.c_str(),
-            nullptr,
-            nullptr,
-            shaderFlags,
-            0,
-            devicePtr,
-            &effectPtr,
-            &errorBlobPtr);
+            OutputDebugStringW(ss.str().c_str());
+            ss << "\nPath: " << assetFile;
 
-        if (FAILED(result))
+            auto wstr = ss.str();
+            std::wcout << RED_TEXT(L"" + wstr + L"") << '\n';
+        }
+        return effectPtr;
+    }
+
+    ID3DX11Effect* Effect::CreateEffect(ID3D11Device* devicePtr, const EffectSource& source, std::string& errors)
+    {
+        ID3DX11Effect* effectPtr = nullptr;
+
+        // A cached binary the runtime refuses is dropped and compiled once more
+        EffectCache& effectCache = GetEffectCache();
+        for (int attempt = 0; attempt < 2 and not effectPtr; ++attempt)
         {
-            if (errorBlobPtr != nullptr)
+            std::vector<uint8_t> binary{};
+            if (not effectCache.Load(source, binary, errors))
             {
-                const char* errorsPtr = static_cast<const char*>(errorBlobPtr->GetBufferPointer());
+                if (errors.empty()) errors = "EffectLoader: Failed to CreateEffectFromFile!";
+                return nullptr;
+            }
+
+            const HRESULT result = D3DX11CreateEffectFromMemory(binary.data(), binary.size(), 0, devicePtr, &effectPtr);
+            if (FAILED(result))
+            {
+                effectPtr = nullptr;
+                effectCache.Invalidate(source);
+            }
+        }
 
-                std::wstringstream ss;
-                for (unsigned int i = 0; i < errorBlobPtr->GetBufferSize(); ++i)
-                    ss << errorsPtr[i];
+        if (not effectPtr) errors = "EffectLoader: Failed to CreateEffectFromMemory!";
+        return effectPtr;
+    }
+
+    EffectCacheStats Effect::GetCacheStats()
+    {
+        return GetEffectCache().GetStats();
+    }
 
-                OutputDebugStringW(ss.str().c_str());
-                SAFE_RELEASE(errorBlobPtr)
+    EffectRegistryStats Effect::GetRegistryStats()
+    {
+        return g_RegistryStats;
+    }
 
-                auto wstr = ss.str();
-                std::wcout << RED_TEXT(L"" + wstr + L"") << '\n';
+    ParameterUploadStats Effect::GetParameterStats()
+    {
+        ParameterUploadStats parameterStats{};
+        for (const auto& [key, effectPtr] : g_Effects)
+        {
+            AddParameterStats(parameterStats, effectPtr->m_RetiredParameterStats);
+            for (const ParameterSlot* slotPtr : effectPtr->m_ParameterSlots)
+            {
+                if (slotPtr) AddParameterStats(parameterStats, slotPtr->binding.GetStats());
             }
-            else
+        }
+        return parameterStats;
+    }
+
+    std::vector<EffectOrigin> Effect::GetOrigins()
+    {
+        std::vector<EffectOrigin> origins{};
+        origins.reserve(g_Effects.size());
+        for (const auto& [key, effectPtr] : g_Effects)
+        {
+            origins.push_back({effectPtr->m_DevicePtr, effectPtr->m_AssetFile, effectPtr->m_Permutation, effectPtr->m_Source, effectPtr->m_SourceKey});
+        }
+        return origins;
+    }
+
+    bool Effect::Reload(const EffectOrigin& origin, ID3DX11Effect* effectPtr, uint64_t key)
+    {
+        const auto it = g_Effects.find({origin.devicePtr, origin.assetFile, origin.permutation});
+        if (it == g_Effects.end())
+        {
+            SAFE_RELEASE(effectPtr)
+            return false;
+        }
+
+        ++g_RegistryStats.reloads;
+        it->second->Swap(effectPtr, key);
+        return true;
+    }
+
+    void Effect::ReleaseRetired()
+    {
+        for (const auto& [key, effectPtr] : g_Effects)
+        {
+            for (ID3DX11Effect*& retiredEffectPtr : effectPtr->m_RetiredEffects)
             {
-                std::wstringstream ss;
-                ss << "EffectLoader: Failed to CreateEffectFromFile!\nPath: " << assetFile;
-                auto wstr = ss.str();
-                std::wcout << RED_TEXT(L"" + wstr + L"") << '\n';
+                SAFE_RELEASE(retiredEffectPtr)
             }
-            return nullptr;
+            effectPtr->m_RetiredEffects.clear();
         }
-        
-        SAFE_RELEASE(errorBlobPtr)
+    }
 
-        return effectPtr;
+    uint64_t Effect::GetSourceKey(const EffectSource& source)
+    {
+        return GetEffectCache().GetKey(source);
     }
 #pragma endregion
 }
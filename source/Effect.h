@@ -1,25 +1,122 @@
 #pragma once
+#include "EffectCache.h"
+#include "ParameterBlock.h"
+
+// Standard includes
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace dae
 {
+    struct EffectRegistryStats
+    {
+        int      effectCount       = 0; // Alive, one per device and file
+        int      referenceCount    = 0; // Meshes holding them
+        uint64_t loads             = 0;
+        uint64_t acquisitions      = 0;
+        uint64_t reflectionLookups = 0; // Names that went through Effects11 reflection
+        uint64_t cachedLookups     = 0; // Names an earlier mesh had already resolved
+        uint64_t reloads           = 0; // Effects swapped for a recompiled version of their file
+    };
+
+    // What an effect that is alive was built from, for whoever watches its files
+    struct EffectOrigin
+    {
+        ID3D11Device* devicePtr   = nullptr;
+        std::wstring  assetFile   {};
+        std::string   permutation {};
+        EffectSource  source      {};
+        uint64_t      key         = 0; // EffectCache::GetKey() of source when the effect was loaded
+    };
+
+    /**
+     * \brief One compiled effect file, shared by every mesh that draws with it. Acquire() loads each file once per device and counts the
+     * references, Release() deletes the effect with the last one. Techniques and variables are resolved through reflection once and
+     * remembered, so the next mesh gets the same pointers; the values they hold are shared as well, so every mesh sets its own before it draws.
+     * A reload swaps the compiled effect underneath the meshes, they resolve their pointers again when GetGeneration() changes.
+     */
     class Effect final
     {
     public:
-        Effect(ID3D11Device* devicePtr, const std::wstring& assetFile);
-        ~Effect();
-
         Effect(const Effect& other)                = delete;
         Effect(Effect&& other) noexcept            = delete;
         Effect& operator=(const Effect& other)     = delete;
         Effect& operator=(Effect&& other) noexcept = delete;
 
+        // nullptr when the file cannot be compiled. Every define set is a variant of its own
+        static Effect* Acquire(ID3D11Device* devicePtr, const std::wstring& assetFile);
+        static Effect* Acquire(ID3D11Device* devicePtr, const std::wstring& assetFile, const std::vector<EffectDefine>& defines);
+        void           AddRef();
+        void           Release();
+
+        const std::wstring& GetAssetFile()   const { return m_AssetFile; }
+        // "NAME=value" pairs separated by spaces, empty without defines
+        const std::string&  GetPermutation() const { return m_Permutation; }
+        // Changes whenever a reload swaps the compiled effect, whatever was resolved from it has to be resolved again
+        uint32_t            GetGeneration()  const { return m_Generation; }
+
         ID3DX11EffectTechnique* GetTechniqueByIndex(int index)              const;
         ID3DX11EffectTechnique* GetTechniqueByName(const std::string& name) const;
         ID3DX11EffectVariable*  GetVariableByName(const std::string& name)  const;
 
-        static ID3DX11Effect* LoadEffect(ID3D11Device* devicePtr, const std::wstring& assetFile);
+        // Uploads what changed in block since this effect last received it, to cbFrame, cbObject or cbMaterial by its frequency.
+        // One SetRawValue() when the cbuffer matches the layout of the block, field by field otherwise. Fields the effect lacks are skipped.
+        // False when nothing had to be uploaded
+        bool ApplyParameters(const ParameterBlock& block) const;
+        // Binds SRVPtr to a texture variable of this effect unless it already holds it. False when nothing changed, so the pass does not
+        // have to be applied again for it
+        bool SetResource(ID3DX11EffectShaderResourceVariable* variablePtr, ID3D11ShaderResourceView* SRVPtr) const;
+
+        // Reads the compiled binary from the effect cache, the compiler only runs when the .fx file, one of its includes, the defines or the flags changed
+        static ID3DX11Effect*      LoadEffect(ID3D11Device* devicePtr, const std::wstring& assetFile);
+        static ID3DX11Effect*      LoadEffect(ID3D11Device* devicePtr, const std::wstring& assetFile, const std::vector<EffectDefine>& defines);
+        // Reads or compiles the binary and creates the effect from it, nullptr with the reason in errors when either fails. Thread-safe
+        static ID3DX11Effect*      CreateEffect(ID3D11Device* devicePtr, const EffectSource& source, std::string& errors);
+        static EffectCacheStats    GetCacheStats();
+        static EffectRegistryStats GetRegistryStats();
+        // Summed over every effect that is alive
+        static ParameterUploadStats GetParameterStats();
+
+        // Reloading, on the render thread between frames. Reload() takes ownership of effectPtr and swaps it in for the effect origin describes,
+        // it releases effectPtr and returns false when that effect is gone. The compiled effects it replaced stay alive until ReleaseRetired(),
+        // so the techniques and variables resolved from them can still be released
+        static std::vector<EffectOrigin> GetOrigins();
+        static bool                      Reload(const EffectOrigin& origin, ID3DX11Effect* effectPtr, uint64_t key);
+        static void                      ReleaseRetired();
+        // Reads the source and everything it includes. Thread-safe
+        static uint64_t                  GetSourceKey(const EffectSource& source);
 
     private:
-        ID3DX11Effect* m_EffectPtr = nullptr;
+        Effect(ID3D11Device* devicePtr, const std::wstring& assetFile, const std::vector<EffectDefine>& defines, std::string permutation);
+        ~Effect();
+
+        struct ParameterSlot;
+
+        // Forgets everything resolved from the old effect, the upload statistics of its parameter slots are kept
+        void Swap(ID3DX11Effect* effectPtr, uint64_t key);
+
+        ID3DX11Effect* m_EffectPtr   = nullptr;
+        ID3D11Device*  m_DevicePtr   = nullptr;
+        std::wstring   m_AssetFile   {};
+        std::string    m_Permutation {};
+        EffectSource   m_Source      {};
+        uint64_t       m_SourceKey   = 0;
+        uint32_t       m_Generation  = 0;
+        int            m_RefCount    = 0;
+
+        std::vector<ID3DX11Effect*> m_RetiredEffects {};
+
+        mutable std::unordered_map<std::string, ID3DX11EffectTechnique*> m_Techniques {};
+        mutable std::unordered_map<std::string, ID3DX11EffectVariable*>  m_Variables  {};
+
+        // One per frequency, created by the first block applied to it
+        mutable std::vector<ParameterSlot*> m_ParameterSlots        {};
+        // What the slots of the effects swapped out had uploaded, so a reload does not restart the statistics
+        ParameterUploadStats                m_RetiredParameterStats {};
+
+        // What every texture variable holds. The effect keeps a reference to each view, so an address is never reused while it is bound
+        mutable std::unordered_map<ID3DX11EffectShaderResourceVariable*, ID3D11ShaderResourceView*> m_BoundResources {};
     };
 }
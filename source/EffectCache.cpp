@@ -0,0 +1,270 @@
+// Built without the precompiled header, the cache knows nothing about D3D and its tests run on any platform
+#include "EffectCache.h"
+
+// Standard includes
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr uint32_t MAGIC   = 0x43584644; // "DFXC"
+        constexpr uint32_t VERSION = 1;
+
+        // On-disk layout, little endian. The compiled binary follows the header
+        struct EntryHeader
+        {
+            uint32_t magic      = MAGIC;
+            uint32_t version    = VERSION;
+            uint64_t key        = 0;
+            uint64_t binarySize = 0;
+            uint64_t checksum   = 0; // Of the binary
+        };
+        static_assert(sizeof(EntryHeader) == 32);
+
+        // FNV-1a, every field is hashed with its size so neighbouring fields never run into each other
+        constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+        constexpr uint64_t FNV_PRIME  = 0x00000100000001B3ull;
+
+        uint64_t HashBytes(uint64_t hash, const void* dataPtr, size_t size)
+        {
+            const uint8_t* bytePtr = static_cast<const uint8_t*>(dataPtr);
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash = (hash ^ bytePtr[i]) * FNV_PRIME;
+            }
+            return hash;
+        }
+
+        uint64_t HashString(uint64_t hash, const std::string& text)
+        {
+            const uint64_t size = text.size();
+            hash = HashBytes(hash, &size, sizeof(size));
+            return HashBytes(hash, text.data(), text.size());
+        }
+
+        bool ReadFile(const std::filesystem::path& path, std::string& contents)
+        {
+            std::ifstream file{path, std::ios::binary};
+            if (not file) return false;
+
+            contents.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+            return not file.bad();
+        }
+
+        // The files named by the #include lines of contents, in order. Commented-out lines are included as well, which only costs a rebuild
+        std::vector<std::string> FindIncludes(const std::string& contents)
+        {
+            std::vector<std::string> includes{};
+            std::istringstream       lines{contents};
+            std::string              line{};
+            while (std::getline(lines, line))
+            {
+                const size_t hashPos = line.find_first_not_of(" \t");
+                if (hashPos == std::string::npos or line[hashPos] != '#') continue;
+
+                const size_t directivePos = line.find_first_not_of(" \t", hashPos + 1);
+                if (directivePos == std::string::npos or line.compare(directivePos, 7, "include") != 0) continue;
+
+                const size_t openPos = line.find_first_of("\"<", directivePos + 7);
+                if (openPos == std::string::npos) continue;
+
+                const size_t closePos = line.find_first_of(line[openPos] == '"' ? "\"" : ">", openPos + 1);
+                if (closePos != std::string::npos) includes.push_back(line.substr(openPos + 1, closePos - openPos - 1));
+            }
+            return includes;
+        }
+
+        // Depth first like the preprocessor, relative to the including file like D3D_COMPILE_STANDARD_FILE_INCLUDE.
+        // A missing include is hashed by name, the compiler reports it
+        uint64_t HashWithIncludes(uint64_t hash, const std::filesystem::path& path, std::set<std::filesystem::path>& visitedPaths)
+        {
+            const std::filesystem::path normalPath = path.lexically_normal();
+            hash = HashString(hash, normalPath.generic_string());
+            if (not visitedPaths.insert(normalPath).second) return hash;
+
+            std::string contents{};
+            if (not ReadFile(normalPath, contents)) return HashString(hash, "<missing>");
+
+            hash = HashString(hash, contents);
+            for (const std::string& include : FindIncludes(contents))
+            {
+                hash = HashWithIncludes(hash, normalPath.parent_path() / include, visitedPaths);
+            }
+            return hash;
+        }
+
+        // Which entry a source is stored in: the file, the defines and the flags, not the contents
+        uint64_t GetIdentity(const EffectSource& source)
+        {
+            uint64_t hash = HashString(FNV_OFFSET, source.path.lexically_normal().generic_string());
+            for (const EffectDefine& define : source.defines)
+            {
+                hash = HashString(hash, define.name);
+                hash = HashString(hash, define.value);
+            }
+            hash = HashBytes(hash, &source.shaderFlags, sizeof(source.shaderFlags));
+            return HashBytes(hash, &source.effectFlags, sizeof(source.effectFlags));
+        }
+
+        enum class EntryState
+        {
+            Valid,
+            Missing,
+            Outdated,
+            Corrupt
+        };
+
+        EntryState ReadEntry(const std::filesystem::path& entryPath, uint64_t key, std::vector<uint8_t>& binary)
+        {
+            std::ifstream file{entryPath, std::ios::binary};
+            if (not file) return EntryState::Missing;
+
+            EntryHeader header{};
+            if (not file.read(reinterpret_cast<char*>(&header), sizeof(header)) or header.magic != MAGIC) return EntryState::Corrupt;
+            if (header.version != VERSION or header.key != key) return EntryState::Outdated;
+
+            // The size is checked against the file before anything is allocated for it
+            std::error_code error{};
+            const uintmax_t fileSize = std::filesystem::file_size(entryPath, error);
+            if (error or header.binarySize == 0 or header.binarySize != fileSize - sizeof(header)) return EntryState::Corrupt;
+
+            binary.resize(header.binarySize);
+            if (not file.read(reinterpret_cast<char*>(binary.data()), static_cast<std::streamsize>(binary.size()))
+                or HashBytes(FNV_OFFSET, binary.data(), binary.size()) != header.checksum)
+            {
+                binary.clear();
+                return EntryState::Corrupt;
+            }
+            return EntryState::Valid;
+        }
+
+        // A temporary file per writer, renamed over the entry once it is complete. When another process holds the entry open
+        // the rename fails on Windows, the binary is then only compiled again by the next load
+        bool WriteEntry(const std::filesystem::path& entryPath, uint64_t key, const std::vector<uint8_t>& binary)
+        {
+            // Thread ids repeat across processes, the random part does not
+            static const uint32_t        s_WriterId = std::random_device{}();
+            static std::atomic<uint32_t> s_WriteIdx{0};
+
+            std::error_code error{};
+            std::filesystem::create_directories(entryPath.parent_path(), error);
+            if (error) return false;
+
+            EntryHeader header{};
+            header.key        = key;
+            header.binarySize = binary.size();
+            header.checksum   = HashBytes(FNV_OFFSET, binary.data(), binary.size());
+
+            std::ostringstream suffix{};
+            suffix << '.' << std::hex << s_WriterId << '_' << std::hash<std::thread::id>{}(std::this_thread::get_id()) << '_' << s_WriteIdx.fetch_add(1) << ".tmp";
+            std::filesystem::path temporaryPath = entryPath;
+            temporaryPath += suffix.str();
+
+            {
+                std::ofstream file{temporaryPath, std::ios::binary};
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(reinterpret_cast<const char*>(binary.data()), static_cast<std::streamsize>(binary.size()));
+                if (not file.good())
+                {
+                    file.close();
+                    std::filesystem::remove(temporaryPath, error);
+                    return false;
+                }
+            }
+
+            std::filesystem::rename(temporaryPath, entryPath, error);
+            if (error)
+            {
+                std::filesystem::remove(temporaryPath, error);
+                return false;
+            }
+            return true;
+        }
+    }
+#pragma endregion
+
+#pragma region Public
+    EffectCache::EffectCache(const IEffectCompiler& compiler, std::filesystem::path directory) :
+        m_Compiler{compiler},
+        m_Directory{std::move(directory)}
+    {
+    }
+
+    bool EffectCache::Load(const EffectSource& source, std::vector<uint8_t>& binary, std::string& errors)
+    {
+        const uint64_t              key       = GetKey(source);
+        const std::filesystem::path entryPath = GetEntryPath(source);
+
+        const EntryState state = ReadEntry(entryPath, key, binary);
+        {
+            const std::lock_guard lock{m_StatsMutex};
+            if (state == EntryState::Valid)
+            {
+                ++m_Stats.hits;
+                return true;
+            }
+
+            ++m_Stats.misses;
+            if (state == EntryState::Outdated) ++m_Stats.invalidations;
+            if (state == EntryState::Corrupt)  ++m_Stats.corruptEntries;
+        }
+
+        binary.clear();
+        if (not m_Compiler.Compile(source, binary, errors) or binary.empty())
+        {
+            const std::lock_guard lock{m_StatsMutex};
+            ++m_Stats.compileFailures;
+            return false;
+        }
+
+        if (not WriteEntry(entryPath, key, binary))
+        {
+            const std::lock_guard lock{m_StatsMutex};
+            ++m_Stats.writeFailures;
+        }
+        return true;
+    }
+
+    void EffectCache::Invalidate(const EffectSource& source)
+    {
+        std::error_code error{};
+        if (std::filesystem::remove(GetEntryPath(source), error))
+        {
+            const std::lock_guard lock{m_StatsMutex};
+            ++m_Stats.invalidations;
+        }
+    }
+
+    std::filesystem::path EffectCache::GetEntryPath(const EffectSource& source) const
+    {
+        std::ostringstream name{};
+        name << source.path.stem().string() << '_' << std::hex << std::setw(16) << std::setfill('0') << GetIdentity(source) << EXTENSION;
+
+        const std::filesystem::path directory = m_Directory.empty() ? source.path.parent_path() / "EffectCache" : m_Directory;
+        return directory / name.str();
+    }
+
+    uint64_t EffectCache::GetKey(const EffectSource& source) const
+    {
+        std::set<std::filesystem::path> visitedPaths{};
+
+        uint64_t key = HashString(GetIdentity(source), m_Compiler.GetVersion());
+        return HashWithIncludes(key, source.path, visitedPaths);
+    }
+
+    EffectCacheStats EffectCache::GetStats() const
+    {
+        const std::lock_guard lock{m_StatsMutex};
+        return m_Stats;
+    }
+#pragma endregion
+}
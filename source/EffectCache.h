@@ -0,0 +1,88 @@
+#pragma once
+
+// Standard includes
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+    struct EffectDefine
+    {
+        std::string name  {};
+        std::string value {};
+    };
+
+    // Everything that decides what the compiler produces for one .fx file
+    struct EffectSource
+    {
+        std::filesystem::path     path        {};
+        std::vector<EffectDefine> defines     {};
+        uint32_t                  shaderFlags = 0; // D3DCOMPILE_*
+        uint32_t                  effectFlags = 0; // D3DCOMPILE_EFFECT_*
+    };
+
+    // Turns an .fx file into the binary D3DX11CreateEffectFromMemory() reads. Behind an interface so the cache runs without D3D
+    class IEffectCompiler
+    {
+    public:
+        virtual ~IEffectCompiler() = default;
+
+        // errors holds the compiler output when it fails
+        virtual bool        Compile(const EffectSource& source, std::vector<uint8_t>& binary, std::string& errors) const = 0;
+        // Part of every key, so a different compiler never reads the binaries of another
+        virtual std::string GetVersion() const = 0;
+    };
+
+    struct EffectCacheStats
+    {
+        uint64_t hits            = 0;
+        uint64_t misses          = 0; // Compiled, the entry was missing, outdated or corrupt
+        uint64_t invalidations   = 0; // Entries whose source, includes, defines or flags had changed
+        uint64_t corruptEntries  = 0;
+        uint64_t compileFailures = 0;
+        uint64_t writeFailures   = 0; // Compiled fine, but the entry could not be stored, the next load compiles again
+    };
+
+    /**
+     * \brief Compiled effects on disk, one .fxo entry per source file, define set and flags. Every entry carries a key hashed from the
+     * contents of the .fx file and every file it #includes, the defines, the flags and the compiler version, so an entry whose key no longer
+     * matches is recompiled without anyone deleting it. Entries are written to a temporary file and renamed into place, so
+     * processes that compile the same effect at once never see each other's partial writes, and a checksum rejects anything that is torn anyway.
+     */
+    class EffectCache final
+    {
+    public:
+        static constexpr const char* EXTENSION = ".fxo";
+
+        // An empty directory keeps the entries in an EffectCache folder next to every source
+        explicit EffectCache(const IEffectCompiler& compiler, std::filesystem::path directory = {});
+        ~EffectCache() = default;
+
+        EffectCache(const EffectCache&)                = delete;
+        EffectCache(EffectCache&&) noexcept            = delete;
+        EffectCache& operator=(const EffectCache&)     = delete;
+        EffectCache& operator=(EffectCache&&) noexcept = delete;
+
+        // The stored binary when its key still matches, otherwise compiles and stores it. Thread-safe
+        bool Load(const EffectSource& source, std::vector<uint8_t>& binary, std::string& errors);
+
+        // Drops the entry, e.g. when the runtime refused a binary that was read back intact
+        void Invalidate(const EffectSource& source);
+
+        std::filesystem::path GetEntryPath(const EffectSource& source) const;
+        // Reads the source and everything it includes
+        uint64_t              GetKey(const EffectSource& source)       const;
+
+        EffectCacheStats GetStats() const;
+
+    private:
+        const IEffectCompiler& m_Compiler;
+        std::filesystem::path  m_Directory {};
+
+        mutable std::mutex m_StatsMutex {};
+        EffectCacheStats   m_Stats      {};
+    };
+}
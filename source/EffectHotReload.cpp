@@ -0,0 +1,258 @@
+#include "pch.h"
+#include "EffectHotReload.h"
+
+// Standard includes
+#include <filesystem>
+#include <set>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        // Editors write in more than one go, the first notification usually arrives before the file is complete
+        constexpr std::chrono::milliseconds SETTLE_TIME{50};
+
+        std::string GetName(const EffectOrigin& origin)
+        {
+            const std::string file = std::filesystem::path{origin.assetFile}.filename().string();
+            return origin.permutation.empty() ? file : file + " (" + origin.permutation + ")";
+        }
+
+        // Only the folders of the .fx files, an include elsewhere is picked up by the poll
+        std::set<std::filesystem::path> GetDirectories(const std::vector<EffectOrigin>& origins)
+        {
+            std::set<std::filesystem::path> directories{};
+            for (const EffectOrigin& origin : origins)
+            {
+                std::error_code error{};
+                const std::filesystem::path directory = std::filesystem::absolute(origin.source.path, error).parent_path();
+                if (not error) directories.insert(directory.lexically_normal());
+            }
+            return directories;
+        }
+
+        // A change notification per folder, signalled when a file in it is written, created, renamed or deleted
+        class DirectoryWatch final
+        {
+        public:
+            DirectoryWatch() = default;
+            ~DirectoryWatch() { Close(); }
+
+            DirectoryWatch(const DirectoryWatch&)                = delete;
+            DirectoryWatch(DirectoryWatch&&) noexcept            = delete;
+            DirectoryWatch& operator=(const DirectoryWatch&)     = delete;
+            DirectoryWatch& operator=(DirectoryWatch&&) noexcept = delete;
+
+            void Watch(const std::set<std::filesystem::path>& directories)
+            {
+                if (directories == m_Directories) return;
+
+                Close();
+                m_Directories = directories;
+                for (const std::filesystem::path& directory : directories)
+                {
+                    // The wake event takes one of the slots
+                    if (m_Handles.size() + 1 == MAXIMUM_WAIT_OBJECTS) break;
+
+                    const HANDLE handle = FindFirstChangeNotificationW(directory.wstring().c_str(), FALSE,
+                                                                       FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+                    if (handle != INVALID_HANDLE_VALUE) m_Handles.push_back(handle);
+                }
+            }
+
+            // True when a folder changed, false when woken or timed out. Without any handle to wait on it only sleeps
+            bool Wait(HANDLE wakeEvent, std::chrono::milliseconds timeout)
+            {
+                std::vector<HANDLE> handles{};
+                if (wakeEvent) handles.push_back(wakeEvent);
+                handles.insert(handles.end(), m_Handles.begin(), m_Handles.end());
+
+                const DWORD result = handles.empty() ? WAIT_FAILED
+                                                     : WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, static_cast<DWORD>(timeout.count()));
+                if (result == WAIT_FAILED)
+                {
+                    std::this_thread::sleep_for(timeout);
+                    return false;
+                }
+                // WAIT_TIMEOUT lies past the handles as well
+                const DWORD handleIdx = result - WAIT_OBJECT_0;
+                if (handleIdx >= handles.size()) return false;
+
+                const HANDLE handle = handles[handleIdx];
+                if (handle == wakeEvent) return false;
+
+                FindNextChangeNotification(handle);
+                return true;
+            }
+
+        private:
+            void Close()
+            {
+                for (const HANDLE handle : m_Handles)
+                {
+                    FindCloseChangeNotification(handle);
+                }
+                m_Handles.clear();
+                m_Directories.clear();
+            }
+
+            std::set<std::filesystem::path> m_Directories {};
+            std::vector<HANDLE>             m_Handles     {};
+        };
+    }
+#pragma endregion
+
+#pragma region Initialization & Cleanup
+    EffectHotReload::EffectHotReload(std::chrono::milliseconds pollInterval)
+        : m_PollInterval{pollInterval}
+    {
+        // Auto-reset, one wake per signal. Without it the worker still polls, it only takes longer to stop
+        m_WakeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        m_Worker    = std::thread{&EffectHotReload::RunWorker, this};
+    }
+
+    EffectHotReload::~EffectHotReload()
+    {
+        {
+            const std::lock_guard lock{m_Mutex};
+            m_IsStopping = true;
+        }
+        if (m_WakeEvent) SetEvent(m_WakeEvent);
+
+        if (m_Worker.joinable()) m_Worker.join();
+        if (m_WakeEvent) CloseHandle(m_WakeEvent);
+
+        for (CompiledEffect& compiled : m_Compiled)
+        {
+            SAFE_RELEASE(compiled.effectPtr)
+        }
+    }
+#pragma endregion
+
+#pragma region Public
+    int EffectHotReload::Update()
+    {
+        // The meshes resolved their pointers again after the last swaps, nothing uses the old effects anymore
+        Effect::ReleaseRetired();
+
+        std::vector<CompiledEffect> compiledEffects{};
+        {
+            const std::lock_guard lock{m_Mutex};
+            compiledEffects.swap(m_Compiled);
+        }
+
+        int         reloadCount = 0;
+        std::string lastErrors{};
+        for (CompiledEffect& compiled : compiledEffects)
+        {
+            const std::string name = GetName(compiled.origin);
+            if (not compiled.effectPtr)
+            {
+                // Every variant of a file usually fails the same way, the errors are only printed for the first one
+                std::cout << RED_TEXT("**(HARDWARE) Effect reload failed, kept the old one = ") << MAGENTA_TEXT("" + name + "") << '\n';
+                if (compiled.errors != lastErrors) std::cout << RED_TEXT("" + compiled.errors + "") << '\n';
+                lastErrors = compiled.errors;
+
+                const std::lock_guard lock{m_Mutex};
+                ++m_Stats.failures;
+                m_Stats.lastError = compiled.errors;
+                continue;
+            }
+
+            // Released by Reload() when the effect is gone
+            if (not Effect::Reload(compiled.origin, compiled.effectPtr, compiled.key)) continue;
+
+            ++reloadCount;
+            std::cout << GREEN_TEXT("**(HARDWARE) Reloaded Effect = ") << MAGENTA_TEXT("" + name + "") << '\n';
+        }
+        if (reloadCount > 0)
+        {
+            const std::lock_guard lock{m_Mutex};
+            m_Stats.reloads += reloadCount;
+        }
+
+        // Every acquire of a new variant counts a load, every release of the last reference lowers the count and every swap counts a reload
+        const EffectRegistryStats registryStats = Effect::GetRegistryStats();
+        if (registryStats.loads != m_RegistryStats.loads or registryStats.effectCount != m_RegistryStats.effectCount or registryStats.reloads != m_RegistryStats.reloads)
+        {
+            m_RegistryStats = registryStats;
+
+            std::vector<EffectOrigin> origins = Effect::GetOrigins();
+            {
+                const std::lock_guard lock{m_Mutex};
+                m_Origins = std::move(origins);
+                ++m_OriginsVersion;
+                m_Stats.watchedCount = static_cast<int>(m_Origins.size());
+            }
+            if (m_WakeEvent) SetEvent(m_WakeEvent);
+        }
+
+        return reloadCount;
+    }
+
+    EffectReloadStats EffectHotReload::GetStats() const
+    {
+        const std::lock_guard lock{m_Mutex};
+        return m_Stats;
+    }
+#pragma endregion
+
+#pragma region Private
+    void EffectHotReload::RunWorker()
+    {
+        // Worker only: the key each origin was last compiled from, so a failing source is not compiled again until it changes
+        std::map<OriginId, uint64_t> compiledKeys{};
+        std::vector<EffectOrigin>    origins{};
+        uint64_t                     originsVersion = 0;
+        DirectoryWatch               directoryWatch{};
+
+        while (true)
+        {
+            {
+                const std::lock_guard lock{m_Mutex};
+                if (m_IsStopping) return;
+
+                if (m_OriginsVersion != originsVersion)
+                {
+                    origins        = m_Origins;
+                    originsVersion = m_OriginsVersion;
+                }
+            }
+
+            directoryWatch.Watch(GetDirectories(origins));
+            Scan(origins, compiledKeys);
+
+            if (directoryWatch.Wait(m_WakeEvent, m_PollInterval)) std::this_thread::sleep_for(SETTLE_TIME);
+        }
+    }
+
+    void EffectHotReload::Scan(const std::vector<EffectOrigin>& origins, std::map<OriginId, uint64_t>& compiledKeys)
+    {
+        {
+            const std::lock_guard lock{m_Mutex};
+            ++m_Stats.scans;
+        }
+
+        for (const EffectOrigin& origin : origins)
+        {
+            const uint64_t key = Effect::GetSourceKey(origin.source);
+
+            // Until the swap the origin still carries the key of the old effect
+            uint64_t& compiledKey = compiledKeys[{origin.devicePtr, origin.assetFile, origin.permutation}];
+            if (key == origin.key or key == compiledKey) continue;
+            compiledKey = key;
+
+            CompiledEffect compiled{origin, nullptr, key, {}};
+            compiled.effectPtr = Effect::CreateEffect(origin.devicePtr, origin.source, compiled.errors);
+
+            const std::lock_guard lock{m_Mutex};
+            ++m_Stats.compiles;
+            m_Compiled.push_back(std::move(compiled));
+
+            // Whatever is left is compiled again by the next instance, from the effect cache when it is still current
+            if (m_IsStopping) return;
+        }
+    }
+#pragma endregion
+}
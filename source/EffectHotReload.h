@@ -0,0 +1,81 @@
+#pragma once
+#include "Effect.h"
+
+// Standard includes
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace dae
+{
+    struct EffectReloadStats
+    {
+        int         watchedCount = 0; // Effects alive at the last Update()
+        uint64_t    scans        = 0; // Times the worker hashed every watched source
+        uint64_t    compiles     = 0;
+        uint64_t    reloads      = 0; // Compiled effects swapped in
+        uint64_t    failures     = 0; // Compiles that kept the old effect
+        std::string lastError    {};
+    };
+
+    /**
+     * \brief Recompiles the .fx files of the effects that are alive when they change on disk, without ever blocking a frame. A worker thread
+     * sleeps on a change notification for the folders of the sources and hashes them when it fires; the notification only wakes it early,
+     * every poll interval it hashes them anyway, so a missed or unsupported notification costs latency and nothing else. The hash is the
+     * key of the effect cache, so includes count and touching a file without changing it does not recompile. The worker also creates the
+     * new effect, which the device allows from any thread; Update() only swaps it in. A source that fails to compile keeps the effect it
+     * had, its errors are reported once, and it is not tried again until it changes once more.
+     */
+    class EffectHotReload final
+    {
+    public:
+        explicit EffectHotReload(std::chrono::milliseconds pollInterval = std::chrono::milliseconds{500});
+        ~EffectHotReload();
+
+        EffectHotReload(const EffectHotReload&)                = delete;
+        EffectHotReload(EffectHotReload&&) noexcept            = delete;
+        EffectHotReload& operator=(const EffectHotReload&)     = delete;
+        EffectHotReload& operator=(EffectHotReload&&) noexcept = delete;
+
+        // Between frames on the render thread: releases what the last swaps retired, swaps in what the worker finished and hands it the
+        // effects that are alive now. Returns how many were swapped, meshes resolve their techniques and variables again when it is not 0
+        int Update();
+
+        EffectReloadStats GetStats() const;
+
+    private:
+        struct CompiledEffect
+        {
+            EffectOrigin   origin    {};
+            ID3DX11Effect* effectPtr = nullptr; // nullptr when it failed
+            uint64_t       key       = 0;
+            std::string    errors    {};
+        };
+
+        // Device, file and define set, like the registry of Effect
+        using OriginId = std::tuple<ID3D11Device*, std::wstring, std::string>;
+
+        void RunWorker();
+        // Hashes every origin, compiles the ones whose key neither matches the effect nor the last compile of the worker
+        void Scan(const std::vector<EffectOrigin>& origins, std::map<OriginId, uint64_t>& compiledKeys);
+
+        const std::chrono::milliseconds m_PollInterval;
+
+        // Render thread only, the registry changed when these did
+        EffectRegistryStats m_RegistryStats {};
+
+        mutable std::mutex          m_Mutex          {};
+        HANDLE                      m_WakeEvent      = nullptr; // Signals new origins and stopping to the worker
+        std::vector<EffectOrigin>   m_Origins        {};
+        uint64_t                    m_OriginsVersion = 0;
+        std::vector<CompiledEffect> m_Compiled       {};
+        EffectReloadStats           m_Stats          {};
+        bool                        m_IsStopping     = false;
+        std::thread                 m_Worker         {};
+    };
+}
@@ -2,8 +2,12 @@
 #include "Mesh.h"
 
 // Project includes
+#include "D3DStateObjects.h"
 #include "Effect.h"
+#include "ParameterBlock.h"
+#include "PipelineStateTracker.h"
 #include "SceneSelector.h"
+#include "ShaderPermutation.h"
 #include "Texture.h"
 
 // Standard includes
@@ -22,108 +26,15 @@ namespace dae
         if (not m_EffectPtr)
             assert(false and "Failed to create effect!");
         
-        m_TechniquePtr = m_EffectPtr->GetTechniqueByName("DefaultTechnique");
-        
-        if (not m_TechniquePtr->IsValid())
-            assert(false and "Failed to create technique!");
+        m_EffectGeneration = m_EffectPtr->GetGeneration();
 
-        InitializeMatrix();
+        InitializeTechniques();
         InitializeTextures();
-        InitializeScalars();
+        InitializeParameters();
 
         m_DevicePtr->GetImmediateContext(&m_DeviceContextPtr);
 
-        // Create Vertex Layout
-        //=======================================================================================================
-        
-        // --- WEEK 1 ---
-#if W1
-        static constexpr uint32_t numElements{2};
-#elif W2
-        
-        // --- WEEK 2 ---
-#if TODO_0
-        static constexpr uint32_t numElements{2};
-#elif TODO_1
-        static constexpr uint32_t numElements{3};
-#elif TODO_2
-        static constexpr uint32_t numElements{3};
-#elif TODO_3
-        static constexpr uint32_t numElements{3};
-#endif
-        
-        // --- WEEK 3 ---
-#elif W3
-#if TODO_0
-        static constexpr uint32_t numElements{5};
-#endif
-#endif
-        
-        D3D11_INPUT_ELEMENT_DESC vertexDesc[numElements]{};
-
-        vertexDesc[0].SemanticName      = "POSITION";
-        vertexDesc[0].Format            = DXGI_FORMAT_R32G32B32_FLOAT;
-        vertexDesc[0].AlignedByteOffset = 0;
-        vertexDesc[0].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
-
-        vertexDesc[1].SemanticName      = "COLOR";
-        vertexDesc[1].Format            = DXGI_FORMAT_R32G32B32_FLOAT;
-        vertexDesc[1].AlignedByteOffset = 12;
-        vertexDesc[1].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
-        
-        // --- WEEK 2 ---
-#if W2
-#if TODO_1
-        vertexDesc[2].SemanticName      = "TEXCOORD";
-        vertexDesc[2].Format            = DXGI_FORMAT_R32G32_FLOAT;
-        vertexDesc[2].AlignedByteOffset = 24;
-        vertexDesc[2].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
-#elif TODO_2
-        vertexDesc[2].SemanticName      = "TEXCOORD";
-        vertexDesc[2].Format            = DXGI_FORMAT_R32G32_FLOAT;
-        vertexDesc[2].AlignedByteOffset = 24;
-        vertexDesc[2].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
-#elif TODO_3
-        vertexDesc[2].SemanticName      = "TEXCOORD";
-        vertexDesc[2].Format            = DXGI_FORMAT_R32G32_FLOAT;
-        vertexDesc[2].AlignedByteOffset = 24;
-        vertexDesc[2].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
-#endif
-        
-        // --- WEEK 3 ---
-#elif W3
-#if TODO_0
-        vertexDesc[2].SemanticName      = "TEXCOORD";
-        vertexDesc[2].Format            = DXGI_FORMAT_R32G32_FLOAT;
-        vertexDesc[2].AlignedByteOffset = 24;
-        vertexDesc[2].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
-
-        vertexDesc[3].SemanticName      = "NORMAL";
-        vertexDesc[3].Format            = DXGI_FORMAT_R32G32B32_FLOAT;
-        vertexDesc[3].AlignedByteOffset = 32;
-        vertexDesc[3].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
-
-        vertexDesc[4].SemanticName      = "TANGENT";
-        vertexDesc[4].Format            = DXGI_FORMAT_R32G32B32_FLOAT;
-        vertexDesc[4].AlignedByteOffset = 44;
-        vertexDesc[4].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
-#endif
-#endif
-        
-        // Create Input Layout
-        //=======================================================================================================
-        D3DX11_PASS_DESC passDesc{};
-        m_TechniquePtr->GetPassByIndex(0)->GetDesc(&passDesc);
-
-        HRESULT result = m_DevicePtr->CreateInputLayout(
-            vertexDesc,
-            numElements,
-            passDesc.pIAInputSignature,
-            passDesc.IAInputSignatureSize,
-            &m_InputLayoutPtr);
-
-        if (FAILED(result))
-            assert(false and "Failed to create input layout!");
+        InitializeInputLayout();
 
         // Create Vertex Buffer
         //=======================================================================================================
@@ -137,7 +48,7 @@ namespace dae
         D3D11_SUBRESOURCE_DATA initData{};
         initData.pSysMem = m_Vertices.data();
 
-        result = m_DevicePtr->CreateBuffer(&bd, &initData, &m_VertexBufferPtr);
+        HRESULT result = m_DevicePtr->CreateBuffer(&bd, &initData, &m_VertexBufferPtr);
 
         if (FAILED(result))
             assert(false and "Failed to create vertex buffer!");
@@ -165,57 +76,61 @@ namespace dae
         // --- WEEK 1 ---
 #if W1
 #if TODO_1
-        m_EffectPtr = new Effect(m_DevicePtr, L"Resources/PosCol3D_W1_TODO_0.fx");
+        m_EffectPtr = Effect::Acquire(m_DevicePtr, L"Resources/PosCol3D_W1_TODO_0.fx");
 #endif
         
         // --- WEEK 2 ---
 #elif W2
 #if TODO_0
-        m_EffectPtr = new Effect(m_DevicePtr, L"Resources/PosCol3D_W2_TODO_0.fx");
+        m_EffectPtr = Effect::Acquire(m_DevicePtr, L"Resources/PosCol3D_W2_TODO_0.fx");
 #elif TODO_1
-        m_EffectPtr = new Effect(m_DevicePtr, L"Resources/PosCol3D_W2_TODO_1.fx");
+        m_EffectPtr = Effect::Acquire(m_DevicePtr, L"Resources/PosCol3D_W2_TODO_1.fx");
 #elif TODO_2
-        m_EffectPtr = new Effect(m_DevicePtr, L"Resources/PosCol3D_W2_TODO_2.fx");
+        m_EffectPtr = Effect::Acquire(m_DevicePtr, L"Resources/PosCol3D_W2_TODO_2.fx");
 #elif TODO_3
-        m_EffectPtr = new Effect(m_DevicePtr, L"Resources/PosCol3D_W2_TODO_3.fx");
+        m_EffectPtr = Effect::Acquire(m_DevicePtr, L"Resources/PosCol3D_W2_TODO_3.fx");
 #endif
         
         // --- WEEK 3 ---
 #elif W3
 #if TODO_0
-        m_EffectPtr = new Effect(m_DevicePtr, L"Resources/PosCol3D_W3_TODO_0.fx");
+        // The default variant, the renderer selects the others through SetEffect()
+        m_EffectPtr = Effect::Acquire(m_DevicePtr, L"Resources/PosCol3D_W3_TODO_0.fx", ShaderPermutation{}.GetDefines());
 #endif
 #endif
     }
 
-    void Mesh::InitializeMatrix()
+    void Mesh::InitializeTechniques()
     {
-        // --- WEEK 2 ---
-#if W2
-#if TODO_0
-        m_WorldViewProjectionMatrixPtr = m_EffectPtr->GetVariableByName("gWorldViewProj")->AsMatrix();
-        if (not m_WorldViewProjectionMatrixPtr->IsValid())
-            assert(false and "Failed to create matrix variable!");
-#elif TODO_1
-        m_WorldViewProjectionMatrixPtr = m_EffectPtr->GetVariableByName("gWorldViewProj")->AsMatrix();
-        if (not m_WorldViewProjectionMatrixPtr->IsValid())
-            assert(false and "Failed to create matrix variable: gWorldViewProj!");
-#elif TODO_2
-        m_WorldViewProjectionMatrixPtr = m_EffectPtr->GetVariableByName("gWorldViewProj")->AsMatrix();
-        if (not m_WorldViewProjectionMatrixPtr->IsValid())
-            assert(false and "Failed to create matrix variable: gWorldViewProj!");
-#elif TODO_3
-        m_WorldViewProjectionMatrixPtr = m_EffectPtr->GetVariableByName("gWorldViewProj")->AsMatrix();
-        if (not m_WorldViewProjectionMatrixPtr->IsValid())
-            assert(false and "Failed to create matrix variable: gWorldViewProj!");
-#endif
+        m_TechniquePtr = m_EffectPtr->GetTechniqueByName("DefaultTechnique");
+        
+        if (not m_TechniquePtr->IsValid())
+            assert(false and "Failed to create technique!");
 
-        // --- WEEK 3 ---
-#elif W3
+        CachePasses(m_TechniquePtr, m_Passes);
+
+#if W3
 #if TODO_0
-        m_WorldViewProjectionMatrixPtr = m_EffectPtr->GetVariableByName("gWorldViewProj")->AsMatrix();
-        if (not m_WorldViewProjectionMatrixPtr->IsValid())
-            assert(false and "Failed to create matrix variable: gWorldViewProj!");
+        m_PackedTechniquePtr = m_EffectPtr->GetTechniqueByName("PackedTechnique");
+
+        if (not m_PackedTechniquePtr->IsValid())
+            assert(false and "Failed to create technique: PackedTechnique!");
+
+        CachePasses(m_PackedTechniquePtr, m_PackedPasses);
+
+        m_InstancedTechniquePtr = m_EffectPtr->GetTechniqueByName("InstancedTechnique");
+
+        if (not m_InstancedTechniquePtr->IsValid())
+            assert(false and "Failed to create technique: InstancedTechnique!");
+
+        CachePasses(m_InstancedTechniquePtr, m_InstancedPasses);
+
+        m_PackedInstancedTechniquePtr = m_EffectPtr->GetTechniqueByName("PackedInstancedTechnique");
+
+        if (not m_PackedInstancedTechniquePtr->IsValid())
+            assert(false and "Failed to create technique: PackedInstancedTechnique!");
+
+        CachePasses(m_PackedInstancedTechniquePtr, m_PackedInstancedPasses);
 #endif
 #endif
     }
@@ -256,59 +171,167 @@ namespace dae
         m_GlossinessMapVariablePtr = m_EffectPtr->GetVariableByName("gGlossMap")->AsShaderResource();
         if (not m_GlossinessMapVariablePtr->IsValid())
             assert(false and "Failed to create texture variable: gGlossMap!");
+
+        m_SpecularGlossMapVariablePtr = m_EffectPtr->GetVariableByName("gSpecularGlossMap")->AsShaderResource();
+        if (not m_SpecularGlossMapVariablePtr->IsValid())
+            assert(false and "Failed to create texture variable: gSpecularGlossMap!");
 #endif
 #endif
     }
 
-    void Mesh::InitializeScalars()
+    void Mesh::InitializeInputLayout()
     {
+        // Create Vertex Layout
+        //=======================================================================================================
+        
+        // --- WEEK 1 ---
+#if W1
+        static constexpr uint32_t numElements{2};
+#elif W2
+        
+        // --- WEEK 2 ---
+#if TODO_0
+        static constexpr uint32_t numElements{2};
+#elif TODO_1
+        static constexpr uint32_t numElements{3};
+#elif TODO_2
+        static constexpr uint32_t numElements{3};
+#elif TODO_3
+        static constexpr uint32_t numElements{3};
+#endif
+        
+        // --- WEEK 3 ---
+#elif W3
+#if TODO_0
+        static constexpr uint32_t numElements{5};
+#endif
+#endif
+        
+        D3D11_INPUT_ELEMENT_DESC vertexDesc[numElements]{};
+
+        vertexDesc[0].SemanticName      = "POSITION";
+        vertexDesc[0].Format            = DXGI_FORMAT_R32G32B32_FLOAT;
+        vertexDesc[0].AlignedByteOffset = 0;
+        vertexDesc[0].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
+
+        vertexDesc[1].SemanticName      = "COLOR";
+        vertexDesc[1].Format            = DXGI_FORMAT_R32G32B32_FLOAT;
+        vertexDesc[1].AlignedByteOffset = 12;
+        vertexDesc[1].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
+        
         // --- WEEK 2 ---
 #if W2
-#if TODO_3
-        m_TimeVariablePtr = m_EffectPtr->GetVariableByName("gTime")->AsScalar();
-        if (not m_TimeVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gTime!");
+#if TODO_1
+        vertexDesc[2].SemanticName      = "TEXCOORD";
+        vertexDesc[2].Format            = DXGI_FORMAT_R32G32_FLOAT;
+        vertexDesc[2].AlignedByteOffset = 24;
+        vertexDesc[2].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
+#elif TODO_2
+        vertexDesc[2].SemanticName      = "TEXCOORD";
+        vertexDesc[2].Format            = DXGI_FORMAT_R32G32_FLOAT;
+        vertexDesc[2].AlignedByteOffset = 24;
+        vertexDesc[2].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
+#elif TODO_3
+        vertexDesc[2].SemanticName      = "TEXCOORD";
+        vertexDesc[2].Format            = DXGI_FORMAT_R32G32_FLOAT;
+        vertexDesc[2].AlignedByteOffset = 24;
+        vertexDesc[2].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
 #endif
         
         // --- WEEK 3 ---
 #elif W3
 #if TODO_0
-        m_TimeVariablePtr = m_EffectPtr->GetVariableByName("gTime")->AsScalar();
-        if (not m_TimeVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gTime!");
+        vertexDesc[2].SemanticName      = "TEXCOORD";
+        vertexDesc[2].Format            = DXGI_FORMAT_R32G32_FLOAT;
+        vertexDesc[2].AlignedByteOffset = 24;
+        vertexDesc[2].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
+
+        vertexDesc[3].SemanticName      = "NORMAL";
+        vertexDesc[3].Format            = DXGI_FORMAT_R32G32B32_FLOAT;
+        vertexDesc[3].AlignedByteOffset = 32;
+        vertexDesc[3].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
+
+        vertexDesc[4].SemanticName      = "TANGENT";
+        vertexDesc[4].Format            = DXGI_FORMAT_R32G32B32_FLOAT;
+        vertexDesc[4].AlignedByteOffset = 44;
+        vertexDesc[4].InputSlotClass    = D3D11_INPUT_PER_VERTEX_DATA;
+#endif
+#endif
+        
+        // Create Input Layout
+        //=======================================================================================================
+        D3DX11_PASS_DESC passDesc{};
+        m_TechniquePtr->GetPassByIndex(0)->GetDesc(&passDesc);
 
-        m_CameraPositionVariablePtr = m_EffectPtr->GetVariableByName("gCameraPos")->AsVector();
-        if (not m_CameraPositionVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gCameraPos!");
+        const HRESULT result = m_DevicePtr->CreateInputLayout(
+            vertexDesc,
+            numElements,
+            passDesc.pIAInputSignature,
+            passDesc.IAInputSignatureSize,
+            &m_InputLayoutPtr);
 
-        m_UseNormalMapVariablePtr = m_EffectPtr->GetVariableByName("gUseNormalMap")->AsScalar();
-        if (not m_UseNormalMapVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gUseNormalMap!");
+        if (FAILED(result))
+            assert(false and "Failed to create input layout!");
 
-        m_ShadingModeVariablePtr = m_EffectPtr->GetVariableByName("gShadingMode")->AsScalar();
-        if (not m_ShadingModeVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gShadingMode!");
+        // --- WEEK 3 ---
+#if W3
+#if TODO_0
+        // Create Instanced Input Layout: the same vertex in slot 0, the InstanceTransform in slot 1 advancing once per instance
+        //=======================================================================================================
+        static constexpr uint32_t numInstanceElements{4};
+        static_assert(sizeof(InstanceTransform) == numInstanceElements * sizeof(Vector3), "VS_INSTANCE_INPUT expects four packed float3 rows");
 
-        m_AmbientVariablePtr = m_EffectPtr->GetVariableByName("gAmbientColor")->AsVector();
-        if (not m_AmbientVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gAmbientColor!");
+        D3D11_INPUT_ELEMENT_DESC instancedDesc[numElements + numInstanceElements]{};
+        std::copy(std::begin(vertexDesc), std::end(vertexDesc), std::begin(instancedDesc));
 
-        m_LightDirectionVariablePtr = m_EffectPtr->GetVariableByName("gLightDir")->AsVector();
-        if (not m_LightDirectionVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gLightDir!");
+        for (uint32_t i = 0; i < numInstanceElements; ++i)
+        {
+            D3D11_INPUT_ELEMENT_DESC& instanceDesc = instancedDesc[numElements + i];
+            instanceDesc.SemanticName         = "WORLD";
+            instanceDesc.SemanticIndex        = i;
+            instanceDesc.Format               = DXGI_FORMAT_R32G32B32_FLOAT;
+            instanceDesc.InputSlot            = 1;
+            instanceDesc.AlignedByteOffset    = i * sizeof(Vector3);
+            instanceDesc.InputSlotClass       = D3D11_INPUT_PER_INSTANCE_DATA;
+            instanceDesc.InstanceDataStepRate = 1;
+        }
 
-        m_LightIntensityVariablePtr = m_EffectPtr->GetVariableByName("gLightIntensity")->AsScalar();
-        if (not m_LightIntensityVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gLightIntensity!");
+        D3DX11_PASS_DESC instancedPassDesc{};
+        m_InstancedTechniquePtr->GetPassByIndex(0)->GetDesc(&instancedPassDesc);
 
-        m_KDVariablePtr = m_EffectPtr->GetVariableByName("gKD")->AsScalar();
-        if (not m_KDVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gKD!");
+        const HRESULT instancedResult = m_DevicePtr->CreateInputLayout(
+            instancedDesc,
+            numElements + numInstanceElements,
+            instancedPassDesc.pIAInputSignature,
+            instancedPassDesc.IAInputSignatureSize,
+            &m_InstancedInputLayoutPtr);
 
-        m_ShininessVariablePtr = m_EffectPtr->GetVariableByName("gShininess")->AsScalar();
-        if (not m_ShininessVariablePtr->IsValid())
-            assert(false and "Failed to create scalar variable: gShininess!");
+        if (FAILED(instancedResult))
+            assert(false and "Failed to create instanced input layout!");
 #endif
+#endif
+    }
+
+    void Mesh::InitializeParameters()
+    {
+        // Sizes as HLSL stores them
+        m_ObjectParametersPtr = new ParameterBlock{ParameterFrequency::Object};
+        m_ObjectParametersPtr->AddField("gWorldViewProj", sizeof(Matrix));
+        m_ObjectParametersPtr->AddField("gWorld",         sizeof(Matrix));
+
+        m_MaterialParametersPtr = new ParameterBlock{ParameterFrequency::Material};
+        m_MaterialParametersPtr->AddField("gKD",        sizeof(float));
+        m_MaterialParametersPtr->AddField("gShininess", sizeof(float));
+    }
+
+    void Mesh::DeclareFrameParameters(ParameterBlock& frameParameters)
+    {
+        frameParameters.AddField("gCameraPos",      sizeof(Vector3));
+        frameParameters.AddField("gAmbientColor",   sizeof(float) * 3);
+        frameParameters.AddField("gLightDir",       sizeof(float) * 3);
+        frameParameters.AddField("gLightIntensity", sizeof(float));
+#if W2 and TODO_3
+        frameParameters.AddField("gTime",           sizeof(float));
 #endif
     }
 #pragma endregion
@@ -316,98 +339,118 @@ namespace dae
 #pragma region Cleanup
     Mesh::~Mesh()
     {
-        // Matrix variables
-        SAFE_RELEASE(m_WorldViewProjectionMatrixPtr)
-
         // Texture variables
         SAFE_RELEASE(m_DiffuseMapVariablePtr)
         SAFE_RELEASE(m_NormalMapVariablePtr)
         SAFE_RELEASE(m_SpecularMapVariablePtr) 
         SAFE_RELEASE(m_GlossinessMapVariablePtr)
+        SAFE_RELEASE(m_SpecularGlossMapVariablePtr)
 
-        // Scalar variables
-        SAFE_RELEASE(m_TimeVariablePtr)
-        SAFE_RELEASE(m_CameraPositionVariablePtr)
-        SAFE_RELEASE(m_UseNormalMapVariablePtr)
-        SAFE_RELEASE(m_ShadingModeVariablePtr)
-        SAFE_RELEASE(m_AmbientVariablePtr)
-        SAFE_RELEASE(m_LightDirectionVariablePtr)
-        SAFE_RELEASE(m_LightIntensityVariablePtr)
-        SAFE_RELEASE(m_KDVariablePtr)
-        SAFE_RELEASE(m_ShininessVariablePtr)
+        // Parameter blocks
+        delete m_ObjectParametersPtr;
+        delete m_MaterialParametersPtr;
 
         // Shader variables
         SAFE_RELEASE(m_IndexBufferPtr)
         SAFE_RELEASE(m_VertexBufferPtr)
         SAFE_RELEASE(m_InputLayoutPtr)
+        SAFE_RELEASE(m_InstanceBufferPtr)
+        SAFE_RELEASE(m_InstancedInputLayoutPtr)
+
+        // Shader resources
+        SAFE_RELEASE(m_Resources.diffuseMapPtr)
+        SAFE_RELEASE(m_Resources.normalMapPtr)
+        SAFE_RELEASE(m_Resources.specularMapPtr)
+        SAFE_RELEASE(m_Resources.glossinessMapPtr)
+        SAFE_RELEASE(m_Resources.specularGlossMapPtr)
 
         SAFE_RELEASE(m_DeviceContextPtr)
+        SAFE_RELEASE(m_PackedInstancedTechniquePtr)
+        SAFE_RELEASE(m_InstancedTechniquePtr)
+        SAFE_RELEASE(m_PackedTechniquePtr)
         SAFE_RELEASE(m_TechniquePtr)
         
-        delete m_EffectPtr;
+        SAFE_RELEASE(m_EffectPtr)
     }
 #pragma endregion
 
 #pragma region Render & Draw
     void Mesh::Render() const
     {
+        BindGeometry();
+        BindMaterial();
+        Draw();
+    }
+
+    void Mesh::BindGeometry() const
+    {
+        // Only what differs from the mesh drawn before reaches the context
+        //=======================================================================================================
+        
         // 1. Set Primitive Topology
         //=======================================================================================================
-        m_DeviceContextPtr->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        m_StateTrackerPtr->SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        // 2. Set Input Layout
+        // 2. Set Input Layout, the instanced one also reads slot 1
         //=======================================================================================================
-        m_DeviceContextPtr->IASetInputLayout(m_InputLayoutPtr);
+        const bool isInstanced = IsInstanced();
+        m_StateTrackerPtr->SetInputLayout(isInstanced ? m_InstancedInputLayoutPtr : m_InputLayoutPtr);
 
-        // 3. Set VertexBuffer
+        // 3. Set VertexBuffer, and the InstanceTransforms
         //=======================================================================================================
-        constexpr UINT stride = sizeof(Vertex);
-        constexpr UINT offset = 0;
-        m_DeviceContextPtr->IASetVertexBuffers(0, 1, &m_VertexBufferPtr, &stride, &offset);
+        m_StateTrackerPtr->SetVertexBuffer(0, m_VertexBufferPtr, sizeof(Vertex), 0);
+        if (isInstanced) m_StateTrackerPtr->SetVertexBuffer(1, m_InstanceBufferPtr, sizeof(InstanceTransform), 0);
 
         // 4. Set IndexBuffer
         //=======================================================================================================
-        m_DeviceContextPtr->IASetIndexBuffer(m_IndexBufferPtr, DXGI_FORMAT_R32_UINT, 0);
+        m_StateTrackerPtr->SetIndexBuffer(m_IndexBufferPtr, DXGI_FORMAT_R32_UINT, 0);
+    }
 
-        // 5. Draw
-        //=======================================================================================================
-        Draw();
+    void Mesh::BindMaterial() const
+    {
+        ApplyMaterialParameters();
     }
 
     void Mesh::Draw() const
+    {
+        // 5. Set RasterizerState, the passes do not set one
+        //=======================================================================================================
+        if (m_RasterizerStatePtr) m_StateTrackerPtr->SetRasterizerState(m_RasterizerStatePtr);
+
+        // 6. Upload what changed since the effect last received this mesh, the effect is shared
+        //=======================================================================================================
+        ApplyObjectParameters();
+
+        // 7. Draw
+        //=======================================================================================================
+        DrawPasses();
+    }
+
+    void Mesh::DrawPasses() const
     {
         // --- WEEK 1 ---
 #if W1
 #if TODO_1
-        D3DX11_TECHNIQUE_DESC techDesc{};
-        m_TechniquePtr->GetDesc(&techDesc);
-        
-        for (UINT p = 0; p < techDesc.Passes; ++p)
+        for (ID3DX11EffectPass* passPtr : m_Passes)
         {
-            m_TechniquePtr->GetPassByIndex(p)->Apply(0, m_DeviceContextPtr);
-            m_DeviceContextPtr->DrawIndexed(m_NumIndices, 0, 0);
+            m_StateTrackerPtr->ApplyPass(passPtr);
+            m_StateTrackerPtr->DrawIndexed(m_NumIndices, 0, 0);
         }
 #endif
         
         // --- WEEK 2 ---
 #elif W2
 #if TODO_0
-        D3DX11_TECHNIQUE_DESC techDesc{};
-        m_TechniquePtr->GetDesc(&techDesc);
-        
-        for (UINT p = 0; p < techDesc.Passes; ++p)
+        for (ID3DX11EffectPass* passPtr : m_Passes)
         {
-            m_TechniquePtr->GetPassByIndex(p)->Apply(0, m_DeviceContextPtr);
-            m_DeviceContextPtr->DrawIndexed(m_NumIndices, 0, 0);
+            m_StateTrackerPtr->ApplyPass(passPtr);
+            m_StateTrackerPtr->DrawIndexed(m_NumIndices, 0, 0);
         }
 #elif TODO_1
-        D3DX11_TECHNIQUE_DESC techDesc{};
-        m_TechniquePtr->GetDesc(&techDesc);
-        
-        for (UINT p = 0; p < techDesc.Passes; ++p)
+        for (ID3DX11EffectPass* passPtr : m_Passes)
         {
-            m_TechniquePtr->GetPassByIndex(p)->Apply(0, m_DeviceContextPtr);
-            m_DeviceContextPtr->DrawIndexed(m_NumIndices, 0, 0);
+            m_StateTrackerPtr->ApplyPass(passPtr);
+            m_StateTrackerPtr->DrawIndexed(m_NumIndices, 0, 0);
         }
 #elif TODO_2
         LoadPass();
@@ -427,102 +470,229 @@ namespace dae
 #pragma region Pass
     void Mesh::LoadPass() const
     {
-        D3DX11_TECHNIQUE_DESC techDesc;
-        m_TechniquePtr->GetDesc(&techDesc);
-        if (m_PassIdx < techDesc.Passes)
+        const std::vector<ID3DX11EffectPass*>& passes = GetActivePasses();
+        if (m_PassIdx < passes.size())
         {
-            m_TechniquePtr->GetPassByIndex(m_PassIdx)->Apply(0, m_DeviceContextPtr);
-            m_DeviceContextPtr->DrawIndexed(m_NumIndices, 0, 0);
+            m_StateTrackerPtr->ApplyPass(passes[m_PassIdx]);
+            if (IsInstanced()) m_StateTrackerPtr->DrawIndexedInstanced(m_NumIndices, m_NumInstances, 0, 0, 0);
+            else               m_StateTrackerPtr->DrawIndexed(m_NumIndices, 0, 0);
+        }
+    }
+
+    const std::vector<ID3DX11EffectPass*>& Mesh::GetActivePasses() const
+    {
+        // The input layouts come from P0 of DefaultTechnique and InstancedTechnique, the packed techniques run the same vertex shaders
+        if (IsInstanced()) return m_UsePackedMaps and not m_PackedInstancedPasses.empty() ? m_PackedInstancedPasses : m_InstancedPasses;
+        return m_UsePackedMaps and not m_PackedPasses.empty() ? m_PackedPasses : m_Passes;
+    }
+
+    void Mesh::CachePasses(ID3DX11EffectTechnique* techniquePtr, std::vector<ID3DX11EffectPass*>& passes)
+    {
+        D3DX11_TECHNIQUE_DESC techDesc{};
+        techniquePtr->GetDesc(&techDesc);
+
+        passes.clear();
+        for (UINT p = 0; p < techDesc.Passes; ++p)
+        {
+            passes.push_back(techniquePtr->GetPassByIndex(p));
         }
     }
 #pragma endregion
 
-#pragma region Setters
-    void Mesh::SetMatrix(const Matrix& viewMatrix, const Matrix& projectionMatrix) const
+#pragma region Parameters
+    void Mesh::ApplyObjectParameters() const
     {
-        const Matrix worldViewProjectionMatrix = viewMatrix * projectionMatrix;
-        m_WorldViewProjectionMatrixPtr->SetMatrix(reinterpret_cast<const float*>(&worldViewProjectionMatrix));
+        bool isUploaded = false;
+        if (m_FrameParametersPtr) isUploaded |= m_EffectPtr->ApplyParameters(*m_FrameParametersPtr);
+        isUploaded |= m_EffectPtr->ApplyParameters(*m_ObjectParametersPtr);
+
+        if (isUploaded) m_StateTrackerPtr->MarkEffectDirty();
     }
 
-    void Mesh::SetMatrix(const Matrix& worldMatrix, const Matrix& viewMatrix, const Matrix& projectionMatrix) const
+    void Mesh::ApplyMaterialParameters() const
     {
-        const Matrix worldViewProjectionMatrix = worldMatrix * viewMatrix * projectionMatrix;
-        m_WorldViewProjectionMatrixPtr->SetMatrix(reinterpret_cast<const float*>(&worldViewProjectionMatrix));
+        bool isChanged = m_EffectPtr->ApplyParameters(*m_MaterialParametersPtr);
+
+        const ShaderResources& resources = m_Resources;
+        const uint32_t         setBits   = resources.setBits;
+
+        // The effect is shared, only a view another mesh replaced in the meantime has to be bound again
+        if (setBits & DiffuseMapBit)       isChanged |= m_EffectPtr->SetResource(m_DiffuseMapVariablePtr,       resources.diffuseMapPtr);
+        if (setBits & NormalMapBit)        isChanged |= m_EffectPtr->SetResource(m_NormalMapVariablePtr,        resources.normalMapPtr);
+        if (setBits & SpecularMapBit)      isChanged |= m_EffectPtr->SetResource(m_SpecularMapVariablePtr,      resources.specularMapPtr);
+        if (setBits & GlossinessMapBit)    isChanged |= m_EffectPtr->SetResource(m_GlossinessMapVariablePtr,    resources.glossinessMapPtr);
+        if (setBits & SpecularGlossMapBit) isChanged |= m_EffectPtr->SetResource(m_SpecularGlossMapVariablePtr, resources.specularGlossMapPtr);
+
+        if (isChanged) m_StateTrackerPtr->MarkEffectDirty();
     }
 
-    void Mesh::SetDiffuseMap(const Texture* diffuseTexturePtr) const
+    void Mesh::SetShaderResource(ID3D11ShaderResourceView*& slotPtr, const Texture* texturePtr, ResourceBits bit)
     {
-        if (diffuseTexturePtr)
-            m_DiffuseMapVariablePtr->SetResource(diffuseTexturePtr->GetSRV());
+        if (not texturePtr) return;
+
+        ID3D11ShaderResourceView* SRVPtr = texturePtr->GetSRV();
+        if (SRVPtr) SRVPtr->AddRef();
+        SAFE_RELEASE(slotPtr)
+
+        slotPtr = SRVPtr;
+        m_Resources.setBits |= bit;
     }
+#pragma endregion
 
-    void Mesh::SetNormalMap(const Texture* normalMapTexturePtr) const
+#pragma region Setters
+    void Mesh::SetMatrix(const Matrix& viewMatrix, const Matrix& projectionMatrix)
     {
-        if (normalMapTexturePtr)
-            m_NormalMapVariablePtr->SetResource(normalMapTexturePtr->GetSRV());
+        SetMatrix(Matrix{}, viewMatrix, projectionMatrix);
+    }
+
+    void Mesh::SetMatrix(const Matrix& worldMatrix, const Matrix& viewMatrix, const Matrix& projectionMatrix)
+    {
+        const Matrix viewProjectionMatrix = viewMatrix * projectionMatrix;
+
+        m_ObjectParametersPtr->Set(ObjectWorldViewProjection, IsInstanced() ? viewProjectionMatrix : worldMatrix * viewProjectionMatrix);
+        m_ObjectParametersPtr->Set(ObjectWorld,               worldMatrix);
     }
 
-    void Mesh::SetSpecularMap(const Texture* specularTexturePtr) const
+    void Mesh::SetDiffuseMap(const Texture* diffuseTexturePtr)
     {
-        if (specularTexturePtr)
-            m_SpecularMapVariablePtr->SetResource(specularTexturePtr->GetSRV());
+        SetShaderResource(m_Resources.diffuseMapPtr, diffuseTexturePtr, DiffuseMapBit);
     }
 
-    void Mesh::SetGlossinessMap(const Texture* glossinessTexturePtr) const
+    void Mesh::SetNormalMap(const Texture* normalMapTexturePtr)
     {
-        if (glossinessTexturePtr)
-            m_GlossinessMapVariablePtr->SetResource(glossinessTexturePtr->GetSRV());
+        SetShaderResource(m_Resources.normalMapPtr, normalMapTexturePtr, NormalMapBit);
     }
 
-    void Mesh::SetTime(float time) const
+    void Mesh::SetSpecularMap(const Texture* specularTexturePtr)
     {
-        m_TimeVariablePtr->SetFloat(time);
+        SetShaderResource(m_Resources.specularMapPtr, specularTexturePtr, SpecularMapBit);
     }
 
-    void Mesh::SetCameraPosition(const Vector3& viewDirection) const
+    void Mesh::SetGlossinessMap(const Texture* glossinessTexturePtr)
     {
-        m_CameraPositionVariablePtr->SetFloatVector(reinterpret_cast<const float*>(&viewDirection));
+        SetShaderResource(m_Resources.glossinessMapPtr, glossinessTexturePtr, GlossinessMapBit);
     }
 
-    void Mesh::SetUseNormalMap(bool useNormalMap) const
+    void Mesh::SetSpecularGlossinessMap(const Texture* specularGlossinessTexturePtr)
     {
-        m_UseNormalMapVariablePtr->SetBool(useNormalMap);
+        SetShaderResource(m_Resources.specularGlossMapPtr, specularGlossinessTexturePtr, SpecularGlossMapBit);
+    }
+
+    void Mesh::SetInstances(const std::vector<Matrix>& worldMatrices)
+    {
+        m_NumInstances = static_cast<UINT>(worldMatrices.size());
+        if (m_NumInstances == 0) return;
+
+        // Grows by doubling, so a crowd that keeps changing size does not recreate the buffer every time
+        if (m_NumInstances > m_InstanceCapacity)
+        {
+            SAFE_RELEASE(m_InstanceBufferPtr)
+            m_InstanceCapacity = std::max(m_NumInstances, m_InstanceCapacity * 2);
+
+            D3D11_BUFFER_DESC bd{};
+            bd.Usage          = D3D11_USAGE_DYNAMIC;
+            bd.ByteWidth      = sizeof(InstanceTransform) * m_InstanceCapacity;
+            bd.BindFlags      = D3D11_BIND_VERTEX_BUFFER;
+            bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            bd.MiscFlags      = 0;
+
+            const HRESULT result = m_DevicePtr->CreateBuffer(&bd, nullptr, &m_InstanceBufferPtr);
+            if (FAILED(result))
+            {
+                assert(false and "Failed to create instance buffer!");
+                m_InstanceCapacity = 0;
+                m_NumInstances     = 0;
+                return;
+            }
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mappedResource{};
+        if (FAILED(m_DeviceContextPtr->Map(m_InstanceBufferPtr, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+        {
+            assert(false and "Failed to map instance buffer!");
+            m_NumInstances = 0;
+            return;
+        }
+
+        InstanceTransform* instancePtr = static_cast<InstanceTransform*>(mappedResource.pData);
+        for (const Matrix& worldMatrix : worldMatrices)
+        {
+            *instancePtr++ = InstanceTransform{worldMatrix.GetAxisX(), worldMatrix.GetAxisY(), worldMatrix.GetAxisZ(), worldMatrix.GetTranslation()};
+        }
+        m_DeviceContextPtr->Unmap(m_InstanceBufferPtr, 0);
     }
 
-    void Mesh::SetShadingMode(int shadingMode) const
+    void Mesh::SetKD(float kd)
     {
-        m_ShadingModeVariablePtr->SetInt(shadingMode);
+        m_MaterialParametersPtr->Set(MaterialKD, kd);
     }
 
-    void Mesh::SetAmbient(float* ambient) const
+    void Mesh::SetShininess(float shininess)
     {
-        m_AmbientVariablePtr->SetFloatVector(ambient);
+        m_MaterialParametersPtr->Set(MaterialShininess, shininess);
     }
 
-    void Mesh::SetLightDirection(float* lightDirection) const
+    bool Mesh::SetEffect(Effect* effectPtr)
     {
-        m_LightDirectionVariablePtr->SetFloatVector(lightDirection);
+        if (not effectPtr) return false;
+        if (effectPtr == m_EffectPtr) return true;
+
+        ReleaseEffectVariables();
+
+        effectPtr->AddRef();
+        SAFE_RELEASE(m_EffectPtr)
+        m_EffectPtr        = effectPtr;
+        m_EffectGeneration = effectPtr->GetGeneration();
+
+        // Every variant runs the same vertex shader, so the input layout still matches its signature
+        InitializeTechniques();
+        InitializeTextures();
+        return true;
     }
 
-    void Mesh::SetLightIntensity(float lightIntensity) const
+    bool Mesh::RefreshEffect()
     {
-        m_LightIntensityVariablePtr->SetFloat(lightIntensity);
+        if (m_EffectGeneration == m_EffectPtr->GetGeneration()) return false;
+        m_EffectGeneration = m_EffectPtr->GetGeneration();
+
+        // The effect still keeps the old compiled effect alive, so its techniques and variables can be released
+        ReleaseEffectVariables();
+        InitializeTechniques();
+        InitializeTextures();
+
+        // The edit may have changed the input signature of the vertex shaders
+        SAFE_RELEASE(m_InputLayoutPtr)
+        SAFE_RELEASE(m_InstancedInputLayoutPtr)
+        InitializeInputLayout();
+        return true;
     }
 
-    void Mesh::SetKD(float kd) const
+    void Mesh::ReleaseEffectVariables()
     {
-        m_KDVariablePtr->SetFloat(kd);
+        SAFE_RELEASE(m_DiffuseMapVariablePtr)
+        SAFE_RELEASE(m_NormalMapVariablePtr)
+        SAFE_RELEASE(m_SpecularMapVariablePtr)
+        SAFE_RELEASE(m_GlossinessMapVariablePtr)
+        SAFE_RELEASE(m_SpecularGlossMapVariablePtr)
+        SAFE_RELEASE(m_PackedInstancedTechniquePtr)
+        SAFE_RELEASE(m_InstancedTechniquePtr)
+        SAFE_RELEASE(m_PackedTechniquePtr)
+        SAFE_RELEASE(m_TechniquePtr)
+
+        // Borrowed from the techniques, like the variables
+        m_Passes.clear();
+        m_PackedPasses.clear();
+        m_InstancedPasses.clear();
+        m_PackedInstancedPasses.clear();
     }
 
-    void Mesh::SetShininess(float shininess) const
+    const std::wstring& Mesh::GetEffectFile() const
     {
-        m_ShininessVariablePtr->SetFloat(shininess);
+        return m_EffectPtr->GetAssetFile();
     }
 
-    void Mesh::SetRasterizerState(FillMode fillMode, CullMode cullingMode, bool frontCounterClockwise) const
+    D3D11_RASTERIZER_DESC Mesh::CreateRasterizerDesc(FillMode fillMode, CullMode cullingMode, bool frontCounterClockwise)
     {
-        ID3D11RasterizerState* rasterizerStatePtr = nullptr;
-        
         D3D11_RASTERIZER_DESC rasterizerDesc{};
         rasterizerDesc.FrontCounterClockwise = frontCounterClockwise ? TRUE : FALSE;
         rasterizerDesc.DepthBias             = 0;
@@ -561,14 +731,14 @@ namespace dae
                 rasterizerDesc.CullMode = D3D11_CULL_BACK;
                 break;
         }
+        return rasterizerDesc;
+    }
 
-        const HRESULT result = m_DevicePtr->CreateRasterizerState(&rasterizerDesc, &rasterizerStatePtr);
-        if (FAILED(result))
-            assert(false and "Failed to create rasterizer state!");
-        
-        m_DeviceContextPtr->RSSetState(rasterizerStatePtr);
-        
-        SAFE_RELEASE(rasterizerStatePtr)
+    void Mesh::SetRasterizerState(FillMode fillMode, CullMode cullingMode, bool frontCounterClockwise)
+    {
+        // Shared with every mesh and prewarmed by the renderer, nothing to create or release here
+        m_RasterizerStatePtr = m_StateObjectsPtr->GetRasterizerState(CreateRasterizerDesc(fillMode, cullingMode, frontCounterClockwise));
+        assert(m_RasterizerStatePtr and "Failed to create rasterizer state!");
     }
 #pragma endregion
 }
@@ -1,10 +1,14 @@
 #pragma once
 #include "Renderer.h"
+#include "RenderQueue.h"
 
 namespace dae
 {
     // Forward declarations
+    class D3DStateObjects;
     class Effect;
+    class ParameterBlock;
+    class PipelineStateTracker;
     class Texture;
     
     struct Vertex
@@ -16,6 +20,15 @@ namespace dae
         Vector3  tangent  = {0.0f, 0.0f, 1.0f};
     };
 
+    // Slot 1 of InstancedTechnique, the rows of an affine world matrix without its constant last column
+    struct InstanceTransform
+    {
+        Vector3 axisX       = {1.0f, 0.0f, 0.0f};
+        Vector3 axisY       = {0.0f, 1.0f, 0.0f};
+        Vector3 axisZ       = {0.0f, 0.0f, 1.0f};
+        Vector3 translation = {0.0f, 0.0f, 0.0f};
+    };
+
     class Mesh final
     {
     public:
@@ -27,39 +40,129 @@ namespace dae
         Mesh& operator=(const Mesh& other)     = delete;
         Mesh& operator=(Mesh&& other) noexcept = delete;
 
+        // Fields of the parameter tiers, in the order of cbFrame, cbObject and cbMaterial in the effect
+        enum FrameParameter : int
+        {
+            FrameCameraPosition,
+            FrameAmbientColor,
+            FrameLightDirection,
+            FrameLightIntensity,
+#if W2 and TODO_3
+            FrameTime // Not in a cbFrame, the W2 effect spins the vehicle itself and finds gTime by name
+#endif
+        };
+        enum ObjectParameter : int
+        {
+            ObjectWorldViewProjection,
+            ObjectWorld
+        };
+        enum MaterialParameter : int
+        {
+            MaterialKD,
+            MaterialShininess
+        };
+
+        // The frame tier belongs to the renderer, every mesh uploads the same block
+        static void DeclareFrameParameters(ParameterBlock& frameParameters);
+        // What SetRasterizerState() binds, for the renderer to prewarm every combination with
+        static D3D11_RASTERIZER_DESC CreateRasterizerDesc(FillMode fillMode, CullMode cullingMode, bool frontCounterClockwise);
+
         void Render() const;
-        void SetMatrix(const Matrix& viewMatrix, const Matrix& projectionMatrix)                            const;
-        void SetMatrix(const Matrix& worldMatrix, const Matrix& viewMatrix, const Matrix& projectionMatrix) const;
+
+        // The steps of Render(), for a RenderQueue that skips the binds the mesh before already made: the input assembler, then the
+        // material constants and shader resources, then the rasterizer state, the frame and object constants, the pass and the draw itself
+        void BindGeometry() const;
+        void BindMaterial() const;
+        void Draw()         const;
+
+        // The setters only fill the parameter blocks of this mesh, Render() uploads what changed into the shared effect
+        void SetFrameParameters(const ParameterBlock* frameParametersPtr) { m_FrameParametersPtr = frameParametersPtr; }
+        // Every bind and draw goes through it, set before the first one
+        void SetStateTracker(PipelineStateTracker* stateTrackerPtr)       { m_StateTrackerPtr = stateTrackerPtr; }
+        // Rasterizer states come from it, set before the first SetRasterizerState()
+        void SetStateObjects(D3DStateObjects* stateObjectsPtr)            { m_StateObjectsPtr = stateObjectsPtr; }
+
+        // The world matrix goes up on its own next to the product, the normals and tangents are transformed by it. Instanced, it is applied
+        // before the transform of every instance and the product leaves it out, see SetInstances()
+        void SetMatrix(const Matrix& viewMatrix, const Matrix& projectionMatrix);
+        void SetMatrix(const Matrix& worldMatrix, const Matrix& viewMatrix, const Matrix& projectionMatrix);
 
         // Texture variables
-        void SetDiffuseMap(const Texture* diffuseTexturePtr)       const;
-        void SetNormalMap(const Texture* normalMapTexturePtr)      const;
-        void SetSpecularMap(const Texture* specularTexturePtr)     const;
-        void SetGlossinessMap(const Texture* glossinessTexturePtr) const;
-
-        // Scalar variables
-        void SetTime(float time)                             const;
-        void SetCameraPosition(const Vector3& viewDirection) const;
-        void SetUseNormalMap(bool useNormalMap)              const;
-        void SetShadingMode(int shadingMode)                 const;
-        void SetAmbient(float* ambient)                      const;
-        void SetLightDirection(float* lightDirection)        const;
-        void SetLightIntensity(float lightIntensity)         const;
-        void SetKD(float kd)                                 const;
-        void SetShininess(float shininess)                   const;
-
-        void SetRasterizerState(FillMode fillMode, CullMode cullingMode, bool frontCounterClockwise) const;
+        void SetDiffuseMap(const Texture* diffuseTexturePtr);
+        void SetNormalMap(const Texture* normalMapTexturePtr);
+        void SetSpecularMap(const Texture* specularTexturePtr);
+        void SetGlossinessMap(const Texture* glossinessTexturePtr);
+        // Specular RGB with glossiness in alpha, only sampled while packed maps are used
+        void SetSpecularGlossinessMap(const Texture* specularGlossinessTexturePtr);
+
+        // Material variables
+        void SetKD(float kd);
+        void SetShininess(float shininess);
+
+        // Draws with another variant of the same effect file from now on, e.g. one from a ShaderPermutationCache. Takes its own reference
+        bool SetEffect(Effect* effectPtr);
+        // Resolves techniques, variables and the input layout again after a reload swapped the compiled effect. False when it had not
+        bool RefreshEffect();
+        const std::wstring& GetEffectFile() const;
+
+        // Bound through the state tracker with every draw. A mesh that never set one draws with whatever the mesh before it bound
+        void SetRasterizerState(FillMode fillMode, CullMode cullingMode, bool frontCounterClockwise);
+
+        // Draws once per world matrix in a single DrawIndexedInstanced from now on, call SetMatrix() again afterwards. Only P0, the vehicle
+        // pass, has an instanced version. An empty vector goes back to one draw of one copy
+        void SetInstances(const std::vector<Matrix>& worldMatrices);
+        UINT GetNumInstances() const { return m_NumInstances; }
         
         void SetPassIdx(UINT passIdx) { m_PassIdx = passIdx; }
+        UINT GetPassIdx()       const { return m_PassIdx; }
+
+        // Switches to PackedTechnique, same pass indices with one map less to sample
+        void SetUsePackedMaps(bool usePackedMaps) { m_UsePackedMaps = usePackedMaps; }
 
     private:
         void InitializeEffect();
-        void InitializeMatrix();
+        void InitializeTechniques();
         void InitializeTextures();
-        void InitializeScalars();
-
-        void Draw()     const;
-        void LoadPass() const;
+        void InitializeInputLayout();
+        void InitializeParameters();
+
+        void ReleaseEffectVariables();
+
+        void DrawPasses()              const;
+        void LoadPass()                const;
+        void ApplyObjectParameters()   const;
+        void ApplyMaterialParameters() const;
+
+        const std::vector<ID3DX11EffectPass*>& GetActivePasses() const;
+
+        bool IsInstanced() const { return m_NumInstances > 0 and m_InstancedInputLayoutPtr; }
+
+        // Looked up once, GetDesc() and GetPassByIndex() no longer run for every draw
+        static void CachePasses(ID3DX11EffectTechnique* techniquePtr, std::vector<ID3DX11EffectPass*>& passes);
+
+        // Which shader resources the mesh has set, only those are bound before it draws.
+        // The others keep whatever the last mesh drawn with the effect left in it, e.g. the fire only sets a diffuse map
+        enum ResourceBits : uint32_t
+        {
+            DiffuseMapBit       = 1 << 0,
+            NormalMapBit        = 1 << 1,
+            SpecularMapBit      = 1 << 2,
+            GlossinessMapBit    = 1 << 3,
+            SpecularGlossMapBit = 1 << 4
+        };
+
+        // The SRVs hold a reference, like an effect variable would
+        struct ShaderResources
+        {
+            ID3D11ShaderResourceView* diffuseMapPtr       = nullptr;
+            ID3D11ShaderResourceView* normalMapPtr        = nullptr;
+            ID3D11ShaderResourceView* specularMapPtr      = nullptr;
+            ID3D11ShaderResourceView* glossinessMapPtr    = nullptr;
+            ID3D11ShaderResourceView* specularGlossMapPtr = nullptr;
+            uint32_t                  setBits             = 0;
+        };
+
+        void SetShaderResource(ID3D11ShaderResourceView*& slotPtr, const Texture* texturePtr, ResourceBits bit);
 
     private:
         //-------------------------------------------------------------------------------------------
@@ -68,21 +171,39 @@ namespace dae
         
         // From Renderer
         ID3D11Device*                        m_DevicePtr                    = nullptr;
+        const ParameterBlock*                m_FrameParametersPtr           = nullptr;
+        PipelineStateTracker*                m_StateTrackerPtr              = nullptr;
+        D3DStateObjects*                     m_StateObjectsPtr              = nullptr;
+        ID3D11RasterizerState*               m_RasterizerStatePtr           = nullptr; // Borrowed from m_StateObjectsPtr
 
         //-------------------------------------------------------------------------------------------
         // POINTERS MANAGED BY THIS CLASS
         //-------------------------------------------------------------------------------------------
         
-        // Effect
+        // Effect, shared with every mesh that draws with the same file
         Effect*                              m_EffectPtr                    = nullptr;
+        uint32_t                             m_EffectGeneration             = 0; // Effect::GetGeneration() the pointers below were resolved at
 
         // Shader variables
         ID3D11Buffer*                        m_VertexBufferPtr              = nullptr;
         ID3D11InputLayout*                   m_InputLayoutPtr               = nullptr;
         ID3D11Buffer*                        m_IndexBufferPtr               = nullptr;
 
+        // Instancing, the buffer grows to the most instances set so far and is rewritten whole by SetInstances()
+        ID3D11InputLayout*                   m_InstancedInputLayoutPtr      = nullptr;
+        ID3D11Buffer*                        m_InstanceBufferPtr            = nullptr;
+        UINT                                 m_InstanceCapacity             = 0;
+        UINT                                 m_NumInstances                 = 0;
+
         // Technique 
         ID3DX11EffectTechnique*              m_TechniquePtr                 = nullptr;
+        ID3DX11EffectTechnique*              m_PackedTechniquePtr           = nullptr;
+        std::vector<ID3DX11EffectPass*>      m_Passes                       {};
+        std::vector<ID3DX11EffectPass*>      m_PackedPasses                 {};
+        ID3DX11EffectTechnique*              m_InstancedTechniquePtr        = nullptr;
+        ID3DX11EffectTechnique*              m_PackedInstancedTechniquePtr  = nullptr;
+        std::vector<ID3DX11EffectPass*>      m_InstancedPasses              {};
+        std::vector<ID3DX11EffectPass*>      m_PackedInstancedPasses        {};
         // Device context created by m_DevicePtr->DetImmediateContext(&m_DeviceContextPtr);
         ID3D11DeviceContext*                 m_DeviceContextPtr             = nullptr;
 
@@ -91,25 +212,33 @@ namespace dae
         ID3DX11EffectShaderResourceVariable* m_NormalMapVariablePtr         = nullptr;
         ID3DX11EffectShaderResourceVariable* m_SpecularMapVariablePtr       = nullptr;
         ID3DX11EffectShaderResourceVariable* m_GlossinessMapVariablePtr     = nullptr;
+        ID3DX11EffectShaderResourceVariable* m_SpecularGlossMapVariablePtr  = nullptr;
 
-        // Matrix variables
-        ID3DX11EffectMatrixVariable*         m_WorldViewProjectionMatrixPtr = nullptr;
-        
-        // Scalar variables
-        ID3DX11EffectScalarVariable*         m_TimeVariablePtr              = nullptr;
-        ID3DX11EffectVectorVariable*         m_CameraPositionVariablePtr    = nullptr;
-        ID3DX11EffectScalarVariable*         m_UseNormalMapVariablePtr      = nullptr;
-        ID3DX11EffectScalarVariable*         m_ShadingModeVariablePtr       = nullptr;
-        ID3DX11EffectVectorVariable*         m_AmbientVariablePtr           = nullptr;
-        ID3DX11EffectVectorVariable*         m_LightDirectionVariablePtr    = nullptr;
-        ID3DX11EffectScalarVariable*         m_LightIntensityVariablePtr    = nullptr;
-        ID3DX11EffectScalarVariable*         m_KDVariablePtr                = nullptr;
-        ID3DX11EffectScalarVariable*         m_ShininessVariablePtr         = nullptr;
+        // Parameter blocks of the object and material tiers
+        ParameterBlock*                      m_ObjectParametersPtr          = nullptr;
+        ParameterBlock*                      m_MaterialParametersPtr        = nullptr;
         
         std::vector<Vertex> m_Vertices  {};
         std::vector<uint32_t> m_Indices {};
         uint32_t m_NumIndices = 0;
 
-        UINT m_PassIdx = 0;
+        UINT m_PassIdx       = 0;
+        bool m_UsePackedMaps = false;
+
+        ShaderResources m_Resources {};
+    };
+
+    // Draws queued meshes on the device they were created with, objectPtr of every packet is a Mesh.
+    // The pass goes to the state tracker with every draw, Effects11 only commits the constant buffers when a pass is applied
+    class MeshRenderBackend final : public IRenderBackend
+    {
+    public:
+        void BindGeometry(const DrawPacket& packet) override { GetMesh(packet).BindGeometry(); }
+        void BindMaterial(const DrawPacket& packet) override { GetMesh(packet).BindMaterial(); }
+        void BindPass(const DrawPacket&)            override {}
+        void Draw(const DrawPacket& packet)         override { GetMesh(packet).Draw(); }
+
+    private:
+        static const Mesh& GetMesh(const DrawPacket& packet) { return *static_cast<const Mesh*>(packet.objectPtr); }
     };
 }
@@ -0,0 +1,89 @@
+#include "pch.h"
+#include "MipChain.h"
+
+// Standard includes
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace dae
+{
+    size_t MipChain::GetLevelTexelCount(int width, int height, TexelLayout layout)
+    {
+        if (layout == TexelLayout::Linear) return static_cast<size_t>(width) * height;
+
+        const size_t tilesY = static_cast<size_t>((height + TILE_SIZE - 1) >> TILE_SHIFT);
+        return tilesY * GetRowPitch(width, layout);
+    }
+
+    void MipChain::AddLevel(int width, int height)
+    {
+        const uint32_t offset = levels.empty() ? 0 : levels.back().offset + static_cast<uint32_t>(GetLevelTexelCount(levels.back().width, levels.back().height, layout));
+
+        levels.push_back({width, height, offset});
+        texels.resize(offset + GetLevelTexelCount(width, height, layout));
+    }
+
+    void MipChain::ReadRow(int level, int y, uint32_t* rowPtr) const
+    {
+        const MipLevel& mipLevel = levels[level];
+        const int       rowPitch = GetRowPitch(mipLevel.width, layout);
+        const uint32_t* levelPtr = GetLevelTexels(level);
+
+        if (layout == TexelLayout::Linear)
+        {
+            std::memcpy(rowPtr, levelPtr + static_cast<size_t>(y) * rowPitch, mipLevel.width * sizeof(uint32_t));
+            return;
+        }
+
+        // Four contiguous texels per tile
+        const uint32_t* tileRowPtr = levelPtr + GetTexelIndex(0, y, rowPitch, layout);
+        for (int x = 0; x < mipLevel.width; x += TILE_SIZE)
+        {
+            std::memcpy(rowPtr + x, tileRowPtr + (x << TILE_SHIFT), std::min(TILE_SIZE, mipLevel.width - x) * sizeof(uint32_t));
+        }
+    }
+
+    void MipChain::WriteRow(int level, int y, const uint32_t* rowPtr)
+    {
+        const MipLevel& mipLevel = levels[level];
+        const int       rowPitch = GetRowPitch(mipLevel.width, layout);
+        uint32_t*       levelPtr = GetLevelTexels(level);
+
+        if (layout == TexelLayout::Linear)
+        {
+            std::memcpy(levelPtr + static_cast<size_t>(y) * rowPitch, rowPtr, mipLevel.width * sizeof(uint32_t));
+            return;
+        }
+
+        uint32_t* tileRowPtr = levelPtr + GetTexelIndex(0, y, rowPitch, layout);
+        for (int x = 0; x < mipLevel.width; x += TILE_SIZE)
+        {
+            std::memcpy(tileRowPtr + (x << TILE_SHIFT), rowPtr + x, std::min(TILE_SIZE, mipLevel.width - x) * sizeof(uint32_t));
+        }
+    }
+
+    void MipChain::ConvertLayout(TexelLayout newLayout)
+    {
+        if (newLayout == layout) return;
+
+        MipChain converted{};
+        converted.layout = newLayout;
+
+        std::vector<uint32_t> row{};
+        for (int level = 0; level < GetLevelCount(); ++level)
+        {
+            const MipLevel& mipLevel = levels[level];
+            converted.AddLevel(mipLevel.width, mipLevel.height);
+
+            row.resize(mipLevel.width);
+            for (int y = 0; y < mipLevel.height; ++y)
+            {
+                ReadRow(level, y, row.data());
+                converted.WriteRow(level, y, row.data());
+            }
+        }
+
+        *this = std::move(converted);
+    }
+}
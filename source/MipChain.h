@@ -0,0 +1,81 @@
+#pragma once
+
+// Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+    // How the texels of every level are ordered inside MipChain::texels
+    enum class TexelLayout
+    {
+        Linear, // Row-major, what D3D11, the block compressor and the .dtex container read
+        Tiled,  // 4x4 tiles of one cache line each, tiles row-major, levels padded to whole tiles
+
+        COUNT
+    };
+
+    struct MipLevel
+    {
+        int      width  = 0;
+        int      height = 0;
+        uint32_t offset = 0; // First texel of this level inside MipChain::texels
+    };
+
+    /**
+     * \brief CPU copy of a texture: every mip level packed back to back in one allocation (RGBA8, R in the lowest byte).
+     * Keeping the whole chain contiguous lets the SIMD sampler gather from any level with a single base pointer.
+     * Tiled chains keep every 2x2 bilinear footprint and every rotated span within a few cache lines, whatever direction it walks in.
+     */
+    struct MipChain
+    {
+        static constexpr int TILE_SHIFT  = 2;
+        static constexpr int TILE_SIZE   = 1 << TILE_SHIFT;
+        static constexpr int TILE_TEXELS = TILE_SIZE * TILE_SIZE;
+
+        std::vector<MipLevel> levels {};
+        std::vector<uint32_t> texels {};
+        TexelLayout           layout = TexelLayout::Linear;
+
+        int  GetLevelCount() const { return static_cast<int>(levels.size()); }
+        bool IsEmpty()       const { return levels.empty(); }
+
+        const uint32_t* GetLevelTexels(int level) const { return texels.data() + levels[level].offset; }
+        uint32_t*       GetLevelTexels(int level)       { return texels.data() + levels[level].offset; }
+
+        // Texels from one row to the next for Linear, from one row of tiles to the next for Tiled
+        static int GetRowPitch(int width, TexelLayout layout)
+        {
+            return layout == TexelLayout::Tiled ? ((width + TILE_SIZE - 1) >> TILE_SHIFT) * TILE_TEXELS : width;
+        }
+
+        // Relative to the first texel of the level
+        static uint32_t GetTexelIndex(int x, int y, int rowPitch, TexelLayout layout)
+        {
+            if (layout == TexelLayout::Linear) return static_cast<uint32_t>(y * rowPitch + x);
+
+            return static_cast<uint32_t>((y >> TILE_SHIFT) * rowPitch + ((x >> TILE_SHIFT) << (2 * TILE_SHIFT))
+                                         + ((y & (TILE_SIZE - 1)) << TILE_SHIFT) + (x & (TILE_SIZE - 1)));
+        }
+
+        uint32_t GetTexel(int level, int x, int y) const
+        {
+            const MipLevel& mipLevel = levels[level];
+            return texels[mipLevel.offset + GetTexelIndex(x, y, GetRowPitch(mipLevel.width, layout), layout)];
+        }
+
+        // Including the padding of partial tiles
+        static size_t GetLevelTexelCount(int width, int height, TexelLayout layout);
+
+        // Appends a level behind the last one and grows texels to fit it
+        void AddLevel(int width, int height);
+
+        // One row of a level in row-major order, whatever the layout of the chain is
+        void ReadRow(int level, int y, uint32_t* rowPtr) const;
+        void WriteRow(int level, int y, const uint32_t* rowPtr);
+
+        // Reorders every level in place, the padding of partial tiles is never read by any lookup
+        void ConvertLayout(TexelLayout newLayout);
+    };
+}
@@ -0,0 +1,392 @@
+#include "pch.h"
+#include "MipGenerator.h"
+
+// Project includes
+#include "MipChain.h"
+
+// Standard includes
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <execution>
+#include <numeric>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr float KAISER_BETA       = 4.0f;
+        constexpr float FILTER_RADIUS     = 3.0f; // Of the windowed sincs, in destination texels
+        constexpr int   BAND_SIZE         = 16;   // Rows per parallel work item
+        constexpr int   MIN_PARALLEL_ROWS = 64;   // Below this the scheduling costs more than the filtering
+
+        // Weights of every output texel along one axis, padded so all outputs have the same number of taps
+        struct FilterTaps
+        {
+            int                numTaps = 0;
+            std::vector<int>   indices {}; // Source texels, already wrapped
+            std::vector<float> weights {}; // Normalized per output texel
+        };
+
+        float Sinc(float x)
+        {
+            if (std::abs(x) < 1e-5f) return 1.0f;
+
+            const float piX = PI * x;
+            return std::sin(piX) / piX;
+        }
+
+        // Modified Bessel function of the first kind and order 0
+        float BesselI0(float x)
+        {
+            const float quarterX2 = x * x * 0.25f;
+
+            float sum  = 1.0f;
+            float term = 1.0f;
+            for (int k = 1; k < 32 and term > sum * 1e-8f; ++k)
+            {
+                term *= quarterX2 / static_cast<float>(k * k);
+                sum  += term;
+            }
+            return sum;
+        }
+
+        float FilterRadius(MipFilter filter)
+        {
+            return filter == MipFilter::Box ? 0.5f : FILTER_RADIUS;
+        }
+
+        // x is the distance to the center of the output texel, in output texels
+        float FilterWeight(MipFilter filter, float x)
+        {
+            const float distance = std::abs(x);
+            switch (filter)
+            {
+            case MipFilter::Box:
+                return distance < 0.5f ? 1.0f : 0.0f;
+
+            case MipFilter::Kaiser:
+            {
+                if (distance >= FILTER_RADIUS) return 0.0f;
+
+                const float t = distance / FILTER_RADIUS;
+                return Sinc(x) * BesselI0(KAISER_BETA * std::sqrt(1.0f - t * t)) / BesselI0(KAISER_BETA);
+            }
+
+            case MipFilter::Lanczos:
+                return distance < FILTER_RADIUS ? Sinc(x) * Sinc(x / FILTER_RADIUS) : 0.0f;
+
+            default:
+                return 0.0f;
+            }
+        }
+
+        FilterTaps BuildTaps(MipFilter filter, int sourceSize, int destinationSize)
+        {
+            const float scale         = static_cast<float>(sourceSize) / static_cast<float>(destinationSize);
+            const float support       = FilterRadius(filter) * scale;
+            const int   maxCandidates = static_cast<int>(std::floor(support * 2.0f)) + 1;
+
+            std::vector<std::vector<std::pair<int, float>>> outputs(destinationSize);
+
+            FilterTaps taps{};
+            for (int i = 0; i < destinationSize; ++i)
+            {
+                // Texel j is centered at j + 0.5, both in source texels
+                const float center = (static_cast<float>(i) + 0.5f) * scale;
+                const int   first  = static_cast<int>(std::ceil(center - support - 0.5f));
+
+                float sumWeights = 0.0f;
+                for (int j = first; j < first + maxCandidates; ++j)
+                {
+                    const float weight = FilterWeight(filter, (static_cast<float>(j) + 0.5f - center) / scale);
+                    if (weight == 0.0f) continue;
+
+                    // WRAP addressing, the same as the samplers
+                    outputs[i].emplace_back((j % sourceSize + sourceSize) % sourceSize, weight);
+                    sumWeights += weight;
+                }
+
+                for (std::pair<int, float>& tap : outputs[i])
+                {
+                    tap.second /= sumWeights;
+                }
+                taps.numTaps = std::max(taps.numTaps, static_cast<int>(outputs[i].size()));
+            }
+
+            taps.indices.resize(static_cast<size_t>(destinationSize) * taps.numTaps);
+            taps.weights.resize(static_cast<size_t>(destinationSize) * taps.numTaps, 0.0f);
+            for (int i = 0; i < destinationSize; ++i)
+            {
+                for (int k = 0; k < taps.numTaps; ++k)
+                {
+                    const bool isPadding = k >= static_cast<int>(outputs[i].size());
+                    taps.indices[i * taps.numTaps + k] = isPadding ? outputs[i].back().first : outputs[i][k].first;
+                    taps.weights[i * taps.numTaps + k] = isPadding ? 0.0f                    : outputs[i][k].second;
+                }
+            }
+            return taps;
+        }
+
+        const std::array<float, 256>& GetSRGBToLinearTable()
+        {
+            static const std::array<float, 256> table = []
+            {
+                std::array<float, 256> result{};
+                for (int i = 0; i < 256; ++i)
+                {
+                    const float value = static_cast<float>(i) / 255.0f;
+                    result[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+                }
+                return result;
+            }();
+            return table;
+        }
+
+        // Indexed by the linear value in 16 bits, fine enough to round every 8-bit sRGB step correctly
+        const std::vector<uint8_t>& GetLinearToSRGBTable()
+        {
+            static const std::vector<uint8_t> table = []
+            {
+                std::vector<uint8_t> result(65536);
+                for (int i = 0; i < 65536; ++i)
+                {
+                    const float value = static_cast<float>(i) / 65535.0f;
+                    const float srgb  = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                    result[i] = static_cast<uint8_t>(srgb * 255.0f + 0.5f);
+                }
+                return result;
+            }();
+            return table;
+        }
+
+        void DecodeRow(const uint32_t* texels, int count, bool isSRGB, float* output)
+        {
+            const std::array<float, 256>& toLinear = GetSRGBToLinearTable();
+            for (int x = 0; x < count; ++x)
+            {
+                const uint32_t texel = texels[x];
+                for (int c = 0; c < 3; ++c)
+                {
+                    const uint32_t value = texel >> (c * 8) & 0xFF;
+                    output[x * 4 + c] = isSRGB ? toLinear[value] : static_cast<float>(value) / 255.0f;
+                }
+                output[x * 4 + 3] = static_cast<float>(texel >> 24) / 255.0f;
+            }
+        }
+
+        void EncodeRow(const float* input, int count, bool isSRGB, uint32_t* texels)
+        {
+            const std::vector<uint8_t>& toSRGB = GetLinearToSRGBTable();
+            for (int x = 0; x < count; ++x)
+            {
+                uint32_t texel = 0;
+                for (int c = 0; c < 4; ++c)
+                {
+                    // The sincs have negative lobes
+                    const float value = Saturate(input[x * 4 + c]);
+                    const uint32_t encoded = isSRGB and c < 3
+                        ? toSRGB[static_cast<int>(value * 65535.0f + 0.5f)]
+                        : static_cast<uint32_t>(value * 255.0f + 0.5f);
+                    texel |= encoded << (c * 8);
+                }
+                texels[x] = texel;
+            }
+        }
+
+        template <typename RowFunction>
+        void ForEachRow(int numRows, bool isParallel, RowFunction&& rowFunction)
+        {
+            if (not isParallel or numRows < MIN_PARALLEL_ROWS)
+            {
+                for (int y = 0; y < numRows; ++y)
+                {
+                    rowFunction(y);
+                }
+                return;
+            }
+
+            std::vector<int> bands((numRows + BAND_SIZE - 1) / BAND_SIZE);
+            std::iota(bands.begin(), bands.end(), 0);
+            std::for_each(std::execution::par, bands.begin(), bands.end(), [numRows, &rowFunction](int band)
+            {
+                const int lastRow = std::min((band + 1) * BAND_SIZE, numRows);
+                for (int y = band * BAND_SIZE; y < lastRow; ++y)
+                {
+                    rowFunction(y);
+                }
+            });
+        }
+
+        // One RGBA texel per output, the four channels form a single SSE vector
+        void FilterRowHorizontal(const float* source, const FilterTaps& taps, int destinationWidth, float* output)
+        {
+            for (int x = 0; x < destinationWidth; ++x)
+            {
+                const int*   indices = &taps.indices[static_cast<size_t>(x) * taps.numTaps];
+                const float* weights = &taps.weights[static_cast<size_t>(x) * taps.numTaps];
+#if defined(__AVX2__)
+                __m128 accum = _mm_setzero_ps();
+                for (int k = 0; k < taps.numTaps; ++k)
+                {
+                    accum = _mm_fmadd_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(source + indices[k] * 4), accum);
+                }
+                _mm_storeu_ps(output + x * 4, accum);
+#else
+                float accum[4]{};
+                for (int k = 0; k < taps.numTaps; ++k)
+                {
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        accum[c] += weights[k] * source[indices[k] * 4 + c];
+                    }
+                }
+                std::copy(std::begin(accum), std::end(accum), output + x * 4);
+#endif
+            }
+        }
+
+        // Blends whole rows, so the SIMD runs across the row 8 floats at a time
+        void FilterRowVertical(const float* source, size_t rowFloats, const int* indices, const float* weights, int numTaps, float* output)
+        {
+            size_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 8 <= rowFloats; i += 8)
+            {
+                __m256 accum = _mm256_setzero_ps();
+                for (int k = 0; k < numTaps; ++k)
+                {
+                    accum = _mm256_fmadd_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(source + indices[k] * rowFloats + i), accum);
+                }
+                _mm256_storeu_ps(output + i, accum);
+            }
+#endif
+            for (; i < rowFloats; ++i)
+            {
+                float accum = 0.0f;
+                for (int k = 0; k < numTaps; ++k)
+                {
+                    accum += weights[k] * source[indices[k] * rowFloats + i];
+                }
+                output[i] = accum;
+            }
+        }
+    }
+#pragma endregion
+
+#pragma region Public
+    MipGenerator::MipGenerator(const MipSettings& settings)
+        : m_Settings{settings}
+    {
+    }
+
+    void MipGenerator::Generate(MipChain& mipChain) const
+    {
+        assert(mipChain.GetLevelCount() == 1 and "MipGenerator::Generate expects a chain with only level 0");
+
+        int width  = mipChain.levels[0].width;
+        int height = mipChain.levels[0].height;
+
+        // Lay out every level up front in the layout of level 0, which stays where it is
+        const int numLevels = GetLevelCount(width, height);
+        for (int level = 1; level < numLevels; ++level)
+        {
+            const MipLevel& previous = mipChain.levels[level - 1];
+            mipChain.AddLevel(std::max(previous.width / 2, 1), std::max(previous.height / 2, 1));
+        }
+
+        const bool isLinear = mipChain.layout == TexelLayout::Linear;
+
+        const bool isSRGB     = m_Settings.isSRGB;
+        const bool isParallel = m_Settings.isParallel;
+
+        // Linear RGBA floats, the previous level is never requantized before it is filtered again
+        std::vector<float> source(static_cast<size_t>(width) * height * 4);
+        std::vector<float> horizontal{};
+        std::vector<float> destination{};
+
+        ForEachRow(height, isParallel, [&](int y)
+        {
+            float* row = source.data() + static_cast<size_t>(y) * width * 4;
+            if (isLinear)
+            {
+                DecodeRow(mipChain.GetLevelTexels(0) + static_cast<size_t>(y) * width, width, isSRGB, row);
+                return;
+            }
+
+            // Tiled rows are not contiguous, gather them first
+            std::vector<uint32_t> texels(width);
+            mipChain.ReadRow(0, y, texels.data());
+            DecodeRow(texels.data(), width, isSRGB, row);
+        });
+
+        for (int level = 1; level < numLevels; ++level)
+        {
+            const int destinationWidth  = mipChain.levels[level].width;
+            const int destinationHeight = mipChain.levels[level].height;
+
+            const FilterTaps tapsX = BuildTaps(m_Settings.filter, width,  destinationWidth);
+            const FilterTaps tapsY = BuildTaps(m_Settings.filter, height, destinationHeight);
+
+            const size_t rowFloats = static_cast<size_t>(destinationWidth) * 4;
+            horizontal.resize(rowFloats * height);
+            destination.resize(rowFloats * destinationHeight);
+
+            ForEachRow(height, isParallel, [&](int y)
+            {
+                FilterRowHorizontal(source.data() + static_cast<size_t>(y) * width * 4, tapsX, destinationWidth, horizontal.data() + y * rowFloats);
+            });
+
+            uint32_t* levelTexels = mipChain.GetLevelTexels(level);
+            ForEachRow(destinationHeight, isParallel, [&](int y)
+            {
+                float* row = destination.data() + y * rowFloats;
+                FilterRowVertical(horizontal.data(), rowFloats, &tapsY.indices[static_cast<size_t>(y) * tapsY.numTaps],
+                                  &tapsY.weights[static_cast<size_t>(y) * tapsY.numTaps], tapsY.numTaps, row);
+                if (isLinear)
+                {
+                    EncodeRow(row, destinationWidth, isSRGB, levelTexels + static_cast<size_t>(y) * destinationWidth);
+                    return;
+                }
+
+                std::vector<uint32_t> texels(destinationWidth);
+                EncodeRow(row, destinationWidth, isSRGB, texels.data());
+                mipChain.WriteRow(level, y, texels.data());
+            });
+
+            std::swap(source, destination);
+            width  = destinationWidth;
+            height = destinationHeight;
+        }
+    }
+
+    int MipGenerator::GetLevelCount(int width, int height)
+    {
+        int numLevels = 1;
+        while (width > 1 or height > 1)
+        {
+            width  = std::max(width  / 2, 1);
+            height = std::max(height / 2, 1);
+            ++numLevels;
+        }
+        return numLevels;
+    }
+
+    size_t MipGenerator::GetTexelCount(int width, int height)
+    {
+        size_t numTexels = static_cast<size_t>(width) * height;
+        while (width > 1 or height > 1)
+        {
+            width      = std::max(width  / 2, 1);
+            height     = std::max(height / 2, 1);
+            numTexels += static_cast<size_t>(width) * height;
+        }
+        return numTexels;
+    }
+#pragma endregion
+}
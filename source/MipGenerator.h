@@ -0,0 +1,55 @@
+#pragma once
+
+// Standard includes
+#include <cstddef>
+
+namespace dae
+{
+    // Forward declarations
+    struct MipChain;
+
+    enum class MipFilter
+    {
+        Box,     // 2x2 average, what GenerateMips() does on most drivers
+        Kaiser,  // Kaiser-windowed sinc, sharper without visible ringing
+        Lanczos, // Lanczos-3, sharpest, can ring on hard edges
+
+        COUNT
+    };
+
+    struct MipSettings
+    {
+        MipFilter filter     = MipFilter::Kaiser;
+        bool      isSRGB     = true; // Color maps are filtered in linear light, data maps (normals, gloss) as stored
+        bool      isParallel = true;
+    };
+
+    /**
+     * \brief Builds the full mip chain of a texture on the CPU, every level is filtered from the previous one in float precision.
+     * The filters are separable: a horizontal pass per source row, then a vertical pass that blends whole rows 8 floats at a time.
+     * Levels depend on each other, so the parallelism is across row bands within a level; tiny levels run serially.
+     */
+    class MipGenerator final
+    {
+    public:
+        explicit MipGenerator(const MipSettings& settings = MipSettings{});
+        ~MipGenerator() = default;
+
+        MipGenerator(const MipGenerator& other)                = default;
+        MipGenerator(MipGenerator&& other) noexcept            = default;
+        MipGenerator& operator=(const MipGenerator& other)     = default;
+        MipGenerator& operator=(MipGenerator&& other) noexcept = default;
+
+        // Level 0 has to be the only level on entry, the chain is filled down to 1x1 in the layout of level 0
+        void Generate(MipChain& mipChain) const;
+
+        // D3D11 rules, every level halves and rounds down until both sides are 1
+        static int    GetLevelCount(int width, int height);
+        static size_t GetTexelCount(int width, int height); // Linear layout
+
+        const MipSettings& GetSettings() const { return m_Settings; }
+
+    private:
+        MipSettings m_Settings {};
+    };
+}
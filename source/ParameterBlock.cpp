@@ -0,0 +1,147 @@
+// Built without the precompiled header, the blocks know nothing about D3D and their tests run on any platform
+#include "ParameterBlock.h"
+
+// Standard includes
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr uint32_t REGISTER_SIZE = 16;
+
+        constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+        constexpr uint64_t FNV_PRIME  = 0x00000100000001B3ull;
+
+        uint64_t HashBytes(uint64_t hash, const void* dataPtr, size_t size)
+        {
+            const uint8_t* bytePtr = static_cast<const uint8_t*>(dataPtr);
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash = (hash ^ bytePtr[i]) * FNV_PRIME;
+            }
+            return hash;
+        }
+
+        uint64_t GetFieldBit(size_t fieldIdx)
+        {
+            return uint64_t{1} << fieldIdx;
+        }
+    }
+#pragma endregion
+
+#pragma region ParameterBlock
+    ParameterBlock::ParameterBlock(ParameterFrequency frequency)
+        : m_Frequency{frequency}
+    {
+        static std::atomic<uint64_t> s_NextId{1};
+        m_Id       = s_NextId.fetch_add(1);
+        m_LayoutId = HashBytes(FNV_OFFSET, &m_Frequency, sizeof(m_Frequency));
+    }
+
+    int ParameterBlock::AddField(const std::string& name, uint32_t size)
+    {
+        assert(m_Fields.size() < MAX_FIELDS and "Too many fields in a parameter block!");
+        assert(size > 0);
+
+        // Anything that would cross into the next register starts on it instead
+        uint32_t offset = GetSize();
+        if (offset % REGISTER_SIZE != 0 and offset % REGISTER_SIZE + size > REGISTER_SIZE)
+        {
+            offset += REGISTER_SIZE - offset % REGISTER_SIZE;
+        }
+
+        m_Fields.push_back({name, offset, size});
+        m_FieldVersions.push_back(0);
+        m_Data.resize(offset + size, 0);
+
+        m_LayoutId = HashBytes(m_LayoutId, name.data(), name.size());
+        m_LayoutId = HashBytes(m_LayoutId, &offset, sizeof(offset));
+        m_LayoutId = HashBytes(m_LayoutId, &size, sizeof(size));
+
+        return static_cast<int>(m_Fields.size()) - 1;
+    }
+
+    bool ParameterBlock::Set(int fieldIdx, const void* dataPtr, uint32_t size)
+    {
+        const ParameterField& field = m_Fields[fieldIdx];
+        assert(size == field.size and "Value does not match the size of the field!");
+
+        uint8_t* fieldPtr = m_Data.data() + field.offset;
+        if (m_FieldVersions[fieldIdx] != 0 and std::memcmp(fieldPtr, dataPtr, size) == 0) return false;
+
+        std::memcpy(fieldPtr, dataPtr, size);
+        m_FieldVersions[fieldIdx] = ++m_Version;
+        return true;
+    }
+
+    uint64_t ParameterBlock::GetDirtyMask(uint64_t version) const
+    {
+        uint64_t dirtyMask = 0;
+        for (size_t i = 0; i < m_FieldVersions.size(); ++i)
+        {
+            if (m_FieldVersions[i] > version) dirtyMask |= GetFieldBit(i);
+        }
+        return dirtyMask;
+    }
+
+    void ParameterBlock::GetRange(uint64_t fieldMask, uint32_t& offset, uint32_t& size) const
+    {
+        uint32_t begin = GetSize();
+        uint32_t end   = 0;
+        for (size_t i = 0; i < m_Fields.size(); ++i)
+        {
+            if (not (fieldMask & GetFieldBit(i))) continue;
+
+            begin = std::min(begin, m_Fields[i].offset);
+            end   = std::max(end, m_Fields[i].offset + m_Fields[i].size);
+        }
+
+        offset = begin < end ? begin : 0;
+        size   = begin < end ? end - begin : 0;
+    }
+#pragma endregion
+
+#pragma region ParameterBinding
+    ParameterBinding::ParameterBinding(IParameterSink& sink)
+        : m_Sink{sink}
+    {
+    }
+
+    bool ParameterBinding::Apply(const ParameterBlock& block)
+    {
+        ++m_Stats.applies;
+
+        const bool     isSameBlock = block.GetId() == m_BlockId and block.GetLayoutId() == m_LayoutId;
+        const uint64_t fieldMask   = block.GetDirtyMask(isSameBlock ? m_Version : 0);
+
+        m_BlockId  = block.GetId();
+        m_LayoutId = block.GetLayoutId();
+        m_Version  = block.GetVersion();
+        if (not fieldMask) return false;
+
+        m_Sink.Upload(block, fieldMask);
+
+        uint32_t offset{};
+        uint32_t size{};
+        block.GetRange(fieldMask, offset, size);
+
+        ++m_Stats.uploads;
+        m_Stats.uploadedFields += std::popcount(fieldMask);
+        m_Stats.uploadedBytes  += size;
+        return true;
+    }
+
+    void ParameterBinding::Reset()
+    {
+        m_BlockId  = 0;
+        m_LayoutId = 0;
+        m_Version  = 0;
+    }
+#pragma endregion
+}
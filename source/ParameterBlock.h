@@ -0,0 +1,125 @@
+#pragma once
+
+// Standard includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+    // How often the values of a block change, every tier is uploaded to its own constant buffer
+    enum class ParameterFrequency
+    {
+        Frame,    // Camera and lights, shared by every mesh
+        Object,   // Transforms
+        Material  // Surface constants
+    };
+
+    struct ParameterField
+    {
+        std::string name   {};
+        uint32_t    offset = 0; // In bytes, packed like HLSL packs a cbuffer
+        uint32_t    size   = 0;
+    };
+
+    /**
+     * \brief CPU copy of one constant buffer. Fields are laid out the way HLSL packs them, so the whole block can be uploaded as is.
+     * Set() only counts as a change when the bytes differ; every field remembers the version it last changed in, so any number of
+     * consumers can each ask what changed since they last looked without clearing it for the others. A field that was never set is never
+     * uploaded, the buffer keeps its own value for it.
+     * Knows nothing about D3D, the uploads go through an IParameterSink.
+     */
+    class ParameterBlock final
+    {
+    public:
+        static constexpr int MAX_FIELDS = 64; // One bit each in a dirty mask
+
+        explicit ParameterBlock(ParameterFrequency frequency);
+        ~ParameterBlock() = default;
+
+        ParameterBlock(const ParameterBlock&)                = delete;
+        ParameterBlock(ParameterBlock&&) noexcept            = delete;
+        ParameterBlock& operator=(const ParameterBlock&)     = delete;
+        ParameterBlock& operator=(ParameterBlock&&) noexcept = delete;
+
+        // Appends a field and returns its index. A field never straddles a 16 byte register, like in HLSL. bool is 4 bytes there
+        int AddField(const std::string& name, uint32_t size);
+
+        // False when the value was already there. size has to match the field
+        bool Set(int fieldIdx, const void* dataPtr, uint32_t size);
+        template <typename T>
+        bool Set(int fieldIdx, const T& value) { return Set(fieldIdx, &value, sizeof(T)); }
+
+        // Fields changed after version, every field that was set when version is 0
+        uint64_t GetDirtyMask(uint64_t version) const;
+        // Smallest byte range that holds every field in fieldMask
+        void     GetRange(uint64_t fieldMask, uint32_t& offset, uint32_t& size) const;
+
+        ParameterFrequency                 GetFrequency() const { return m_Frequency; }
+        // Unique for the lifetime of the process, unlike the address
+        uint64_t                           GetId()        const { return m_Id; }
+        uint64_t                           GetVersion()   const { return m_Version; }
+        // Changes whenever a field is added, consumers resolve their fields again when it does
+        uint64_t                           GetLayoutId()  const { return m_LayoutId; }
+        uint32_t                           GetSize()      const { return static_cast<uint32_t>(m_Data.size()); }
+        const uint8_t*                     GetData()      const { return m_Data.data(); }
+        const std::vector<ParameterField>& GetFields()    const { return m_Fields; }
+
+    private:
+        ParameterFrequency          m_Frequency;
+        uint64_t                    m_Id            = 0;
+        uint64_t                    m_Version       = 0;
+        uint64_t                    m_LayoutId      = 0;
+        std::vector<ParameterField> m_Fields        {};
+        std::vector<uint64_t>       m_FieldVersions {};
+        std::vector<uint8_t>        m_Data          {};
+    };
+
+    // Where a flushed block goes, e.g. a constant buffer of an effect. Behind an interface so the blocks run without D3D
+    class IParameterSink
+    {
+    public:
+        virtual ~IParameterSink() = default;
+
+        // One call per upload, fieldMask has a bit for every field of block that changed
+        virtual void Upload(const ParameterBlock& block, uint64_t fieldMask) = 0;
+    };
+
+    struct ParameterUploadStats
+    {
+        uint64_t applies        = 0;
+        uint64_t uploads        = 0; // Applies that found something to upload
+        uint64_t uploadedFields = 0;
+        uint64_t uploadedBytes  = 0; // Of the ranges GetRange() returns for the uploaded fields
+    };
+
+    /**
+     * \brief One buffer a block is uploaded to. Remembers which block it received last and at which version, so applying the
+     * same block again only uploads what changed, and switching to another block uploads all of it.
+     */
+    class ParameterBinding final
+    {
+    public:
+        explicit ParameterBinding(IParameterSink& sink);
+        ~ParameterBinding() = default;
+
+        ParameterBinding(const ParameterBinding&)                = delete;
+        ParameterBinding(ParameterBinding&&) noexcept            = delete;
+        ParameterBinding& operator=(const ParameterBinding&)     = delete;
+        ParameterBinding& operator=(ParameterBinding&&) noexcept = delete;
+
+        // False when nothing had to be uploaded
+        bool Apply(const ParameterBlock& block);
+        // The buffer no longer holds what was uploaded, the next Apply() uploads everything
+        void Reset();
+
+        const ParameterUploadStats& GetStats() const { return m_Stats; }
+
+    private:
+        IParameterSink&      m_Sink;
+        uint64_t             m_BlockId  = 0;
+        uint64_t             m_LayoutId = 0;
+        uint64_t             m_Version  = 0;
+        ParameterUploadStats m_Stats    {};
+    };
+}
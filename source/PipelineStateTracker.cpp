@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "PipelineStateTracker.h"
+
+namespace dae
+{
+#pragma region PipelineStateStats
+    PipelineSlotStats PipelineStateStats::GetTotal() const
+    {
+        PipelineSlotStats total{};
+        for (const PipelineSlotStats& slotStats : slots)
+        {
+            total.issued   += slotStats.issued;
+            total.filtered += slotStats.filtered;
+        }
+        return total;
+    }
+#pragma endregion
+
+#pragma region Initialization & Cleanup
+    PipelineStateTracker::PipelineStateTracker(ID3D11DeviceContext* deviceContextPtr)
+        : m_DeviceContextPtr{deviceContextPtr}
+    {
+        if (m_DeviceContextPtr) m_DeviceContextPtr->AddRef();
+    }
+
+    PipelineStateTracker::~PipelineStateTracker()
+    {
+        SAFE_RELEASE(m_DeviceContextPtr)
+    }
+#pragma endregion
+
+#pragma region Public
+    void PipelineStateTracker::Invalidate()
+    {
+        m_HasTopology        = false;
+        m_HasInputLayout     = false;
+        m_HasIndexBuffer     = false;
+        m_HasRasterizerState = false;
+        m_PassPtr            = nullptr;
+        m_IsEffectDirty      = true;
+        m_HasVertexBuffers.fill(false);
+    }
+
+    void PipelineStateTracker::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+    {
+        if (not Track(PipelineSlot::PrimitiveTopology, m_HasTopology and m_Topology == topology)) return;
+
+        m_HasTopology = true;
+        m_Topology    = topology;
+        m_DeviceContextPtr->IASetPrimitiveTopology(topology);
+    }
+
+    void PipelineStateTracker::SetInputLayout(ID3D11InputLayout* inputLayoutPtr)
+    {
+        if (not Track(PipelineSlot::InputLayout, m_HasInputLayout and m_InputLayoutPtr == inputLayoutPtr)) return;
+
+        m_HasInputLayout = true;
+        m_InputLayoutPtr = inputLayoutPtr;
+        m_DeviceContextPtr->IASetInputLayout(inputLayoutPtr);
+    }
+
+    void PipelineStateTracker::SetVertexBuffer(UINT slot, ID3D11Buffer* bufferPtr, UINT stride, UINT offset)
+    {
+        // Slots past the tracked ones are always issued
+        if (slot >= VERTEX_BUFFER_SLOTS)
+        {
+            Track(PipelineSlot::VertexBuffer, false);
+            m_DeviceContextPtr->IASetVertexBuffers(slot, 1, &bufferPtr, &stride, &offset);
+            return;
+        }
+
+        VertexBufferBinding& binding = m_VertexBuffers[slot];
+        const bool isBound = m_HasVertexBuffers[slot] and binding.bufferPtr == bufferPtr and binding.stride == stride and binding.offset == offset;
+        if (not Track(PipelineSlot::VertexBuffer, isBound)) return;
+
+        m_HasVertexBuffers[slot] = true;
+        binding                  = {bufferPtr, stride, offset};
+        m_DeviceContextPtr->IASetVertexBuffers(slot, 1, &bufferPtr, &stride, &offset);
+    }
+
+    void PipelineStateTracker::SetIndexBuffer(ID3D11Buffer* bufferPtr, DXGI_FORMAT format, UINT offset)
+    {
+        const bool isBound = m_HasIndexBuffer and m_IndexBufferPtr == bufferPtr and m_IndexFormat == format and m_IndexOffset == offset;
+        if (not Track(PipelineSlot::IndexBuffer, isBound)) return;
+
+        m_HasIndexBuffer = true;
+        m_IndexBufferPtr = bufferPtr;
+        m_IndexFormat    = format;
+        m_IndexOffset    = offset;
+        m_DeviceContextPtr->IASetIndexBuffer(bufferPtr, format, offset);
+    }
+
+    void PipelineStateTracker::SetRasterizerState(ID3D11RasterizerState* rasterizerStatePtr)
+    {
+        if (not Track(PipelineSlot::RasterizerState, m_HasRasterizerState and m_RasterizerStatePtr == rasterizerStatePtr)) return;
+
+        m_HasRasterizerState = true;
+        m_RasterizerStatePtr = rasterizerStatePtr;
+        m_DeviceContextPtr->RSSetState(rasterizerStatePtr);
+    }
+
+    void PipelineStateTracker::ApplyPass(ID3DX11EffectPass* passPtr)
+    {
+        if (not Track(PipelineSlot::EffectPass, m_PassPtr == passPtr and not m_IsEffectDirty)) return;
+
+        m_PassPtr       = passPtr;
+        m_IsEffectDirty = false;
+        passPtr->Apply(0, m_DeviceContextPtr);
+    }
+
+    void PipelineStateTracker::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+    {
+        ++m_Stats.draws;
+        ++m_Stats.instances;
+        m_DeviceContextPtr->DrawIndexed(indexCount, startIndex, baseVertex);
+    }
+
+    void PipelineStateTracker::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+    {
+        ++m_Stats.draws;
+        m_Stats.instances += instanceCount;
+        m_DeviceContextPtr->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+    }
+#pragma endregion
+
+#pragma region Private
+    bool PipelineStateTracker::Track(PipelineSlot slot, bool isBound)
+    {
+        PipelineSlotStats& slotStats = m_Stats.slots[static_cast<size_t>(slot)];
+        if (isBound)
+        {
+            ++slotStats.filtered;
+            return false;
+        }
+
+        ++slotStats.issued;
+        return true;
+    }
+#pragma endregion
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+// Standard includes
+#include <array>
+#include <cstdint>
+
+namespace dae
+{
+    // What a bind sets, every kind is counted on its own
+    enum class PipelineSlot
+    {
+        PrimitiveTopology,
+        InputLayout,
+        VertexBuffer,
+        IndexBuffer,
+        RasterizerState,
+        EffectPass,
+
+        COUNT
+    };
+
+    struct PipelineSlotStats
+    {
+        uint64_t issued   = 0; // Reached the device context
+        uint64_t filtered = 0; // Already bound, dropped
+    };
+
+    struct PipelineStateStats
+    {
+        std::array<PipelineSlotStats, static_cast<size_t>(PipelineSlot::COUNT)> slots     {};
+        uint64_t                                                                 draws     = 0;
+        uint64_t                                                                 instances = 0; // Drawn by the draws above, one per DrawIndexed()
+
+        const PipelineSlotStats& operator[](PipelineSlot slot) const { return slots[static_cast<size_t>(slot)]; }
+        PipelineSlotStats        GetTotal()                    const;
+    };
+
+    /**
+     * \brief Sits between the meshes and the immediate context and remembers what was bound last to every slot, so a bind of the same state
+     * never reaches the driver. An effect pass is only applied again when another pass was applied in between, or when effect variables changed
+     * since, because Apply() is what commits them. Anything that binds through the context directly, e.g. the UI, leaves the tracker out of date;
+     * Invalidate() before the next draw makes it issue every slot again.
+     */
+    class PipelineStateTracker final
+    {
+    public:
+        explicit PipelineStateTracker(ID3D11DeviceContext* deviceContextPtr);
+        ~PipelineStateTracker();
+
+        PipelineStateTracker(const PipelineStateTracker&)                = delete;
+        PipelineStateTracker(PipelineStateTracker&&) noexcept            = delete;
+        PipelineStateTracker& operator=(const PipelineStateTracker&)     = delete;
+        PipelineStateTracker& operator=(PipelineStateTracker&&) noexcept = delete;
+
+        // Forgets everything bound, e.g. at the start of a frame
+        void Invalidate();
+
+        // Input assembler, one vertex buffer per slot
+        void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+        void SetInputLayout(ID3D11InputLayout* inputLayoutPtr);
+        void SetVertexBuffer(UINT slot, ID3D11Buffer* bufferPtr, UINT stride, UINT offset);
+        void SetIndexBuffer(ID3D11Buffer* bufferPtr, DXGI_FORMAT format, UINT offset);
+
+        // The effect passes leave the rasterizer state alone, the meshes bind their own through here
+        void SetRasterizerState(ID3D11RasterizerState* rasterizerStatePtr);
+
+        // An effect variable was set, the next ApplyPass() has to reach the context to commit it
+        void MarkEffectDirty() { m_IsEffectDirty = true; }
+        void ApplyPass(ID3DX11EffectPass* passPtr);
+
+        void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+        void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+
+        const PipelineStateStats& GetStats() const { return m_Stats; }
+
+    private:
+        static constexpr UINT VERTEX_BUFFER_SLOTS = 4; // More than any input layout uses
+
+        struct VertexBufferBinding
+        {
+            ID3D11Buffer* bufferPtr = nullptr;
+            UINT          stride    = 0;
+            UINT          offset    = 0;
+        };
+
+        // True when the bind has to be issued, counts it either way
+        bool Track(PipelineSlot slot, bool isBound);
+
+        ID3D11DeviceContext* m_DeviceContextPtr = nullptr;
+
+        // Valid flags rather than sentinel values, nullptr is a state of its own
+        bool                     m_HasTopology        = false;
+        D3D11_PRIMITIVE_TOPOLOGY m_Topology           {};
+        bool                     m_HasInputLayout     = false;
+        ID3D11InputLayout*       m_InputLayoutPtr     = nullptr;
+        bool                     m_HasIndexBuffer     = false;
+        ID3D11Buffer*            m_IndexBufferPtr     = nullptr;
+        DXGI_FORMAT              m_IndexFormat        {};
+        UINT                     m_IndexOffset        = 0;
+        bool                     m_HasRasterizerState = false;
+        ID3D11RasterizerState*   m_RasterizerStatePtr = nullptr;
+        ID3DX11EffectPass*       m_PassPtr            = nullptr;
+        bool                     m_IsEffectDirty      = true;
+
+        std::array<bool, VERTEX_BUFFER_SLOTS>                m_HasVertexBuffers {};
+        std::array<VertexBufferBinding, VERTEX_BUFFER_SLOTS> m_VertexBuffers    {};
+
+        PipelineStateStats m_Stats {};
+    };
+}
@@ -0,0 +1,754 @@
+#include "pch.h"
+#include "PngDecoder.h"
+
+// Standard includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <execution>
+#include <fstream>
+#include <numeric>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dae
+{
+    namespace PngDecoder
+    {
+#pragma region Helpers
+        namespace
+        {
+            constexpr uint8_t SIGNATURE[8] {137, 80, 78, 71, 13, 10, 26, 10};
+            constexpr int     MAX_SIZE     = 1 << 14; // D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+
+            struct ImageHeader
+            {
+                int width    = 0;
+                int height   = 0;
+                int channels = 0; // 3 for RGB, 4 for RGBA
+            };
+
+            uint32_t ReadBigEndian(const uint8_t* bytesPtr)
+            {
+                return static_cast<uint32_t>(bytesPtr[0]) << 24 | static_cast<uint32_t>(bytesPtr[1]) << 16 | static_cast<uint32_t>(bytesPtr[2]) << 8 | bytesPtr[3];
+            }
+
+            bool ReadHeader(std::span<const uint8_t> file, ImageHeader& header)
+            {
+                // Signature, then IHDR always comes first: length, type, 13 bytes of data and the CRC
+                if (file.size() < 8 + 25 or std::memcmp(file.data(), SIGNATURE, sizeof(SIGNATURE)) != 0) return false;
+
+                const uint8_t* chunkPtr = file.data() + 8;
+                if (ReadBigEndian(chunkPtr) != 13 or std::memcmp(chunkPtr + 4, "IHDR", 4) != 0) return false;
+
+                const uint32_t width       = ReadBigEndian(chunkPtr + 8);
+                const uint32_t height      = ReadBigEndian(chunkPtr + 12);
+                const uint8_t  bitDepth    = chunkPtr[16];
+                const uint8_t  colorType   = chunkPtr[17];
+                const uint8_t  compression = chunkPtr[18];
+                const uint8_t  filter      = chunkPtr[19];
+                const uint8_t  interlace   = chunkPtr[20];
+
+                if (width == 0 or height == 0 or width > MAX_SIZE or height > MAX_SIZE) return false;
+                if (bitDepth != 8 or compression != 0 or filter != 0 or interlace != 0) return false;
+                if (colorType != 2 and colorType != 6) return false;
+
+                header.width    = static_cast<int>(width);
+                header.height   = static_cast<int>(height);
+                header.channels = colorType == 6 ? 4 : 3;
+                return true;
+            }
+
+#pragma region Inflate
+            constexpr int      LITERAL_BITS     = 10; // Primary table bits, longer codes continue in a subtable
+            constexpr int      DISTANCE_BITS    = 8;
+            constexpr int      CODE_LENGTH_BITS = 7;
+            constexpr int      MAX_CODE_LENGTH  = 15;
+            constexpr int      MAX_PRIMARY_BITS = 10;
+            constexpr uint32_t SUBTABLE         = 0x10;
+
+            constexpr uint16_t LENGTH_BASE[29]    {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+            constexpr uint8_t  LENGTH_EXTRA[29]   {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+            constexpr uint16_t DISTANCE_BASE[30]  {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+                                                   4097, 6145, 8193, 12289, 16385, 24577};
+            constexpr uint8_t  DISTANCE_EXTRA[30] {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+            constexpr uint8_t  CODE_LENGTH_ORDER[19] {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+            // LSB-first reader that keeps at least 56 bits buffered after every Refill(), enough for a whole length/distance pair
+            struct BitReader
+            {
+                const uint8_t* bytesPtr = nullptr;
+                const uint8_t* endPtr   = nullptr;
+                uint64_t       bits     = 0;
+                int            count    = 0;
+                int            overrun  = 0; // Zero bytes appended past the end of the input
+
+                void Refill()
+                {
+                    if (endPtr - bytesPtr >= 8)
+                    {
+                        // Bytes that only partially fit are loaded again by the next refill, at the same position
+                        uint64_t word;
+                        std::memcpy(&word, bytesPtr, sizeof(word));
+                        bits     |= word << count;
+                        bytesPtr += (63 - count) >> 3;
+                        count    |= 56;
+                        return;
+                    }
+
+                    while (count <= 56)
+                    {
+                        if (bytesPtr < endPtr) bits |= static_cast<uint64_t>(*bytesPtr++) << count;
+                        else                   ++overrun;
+                        count += 8;
+                    }
+                }
+
+                uint32_t Read(int numBits)
+                {
+                    const uint32_t value = static_cast<uint32_t>(bits & ((uint64_t{1} << numBits) - 1));
+                    Consume(numBits);
+                    return value;
+                }
+
+                void Consume(int numBits)
+                {
+                    bits  >>= numBits;
+                    count  -= numBits;
+                }
+
+                // Drops the rest of the current byte and hands the buffered whole bytes back to the input
+                bool AlignToByte()
+                {
+                    Consume(count & 7);
+                    if ((count >> 3) < overrun) return false;
+
+                    bytesPtr -= (count >> 3) - overrun;
+                    bits      = 0;
+                    count     = 0;
+                    overrun   = 0;
+                    return true;
+                }
+
+                // Only the padding may be left over once the stream ended, consuming it means the input was truncated
+                bool IsOverrun() const { return overrun * 8 > count; }
+            };
+
+            /**
+             * \brief Canonical Huffman decoding table. An entry holds the symbol in bits 16-31 and the bits to consume in bits 0-3,
+             * or the start of a subtable in bits 16-31, the SUBTABLE flag and the subtable index bits in bits 8-11. Empty entries are invalid codes.
+             */
+            struct HuffmanTable
+            {
+                std::vector<uint32_t> entries     {};
+                int                   primaryBits = 0;
+
+                bool Build(const uint8_t* lengths, int numSymbols, int tableBits)
+                {
+                    int count[MAX_CODE_LENGTH + 1] {};
+                    for (int symbol = 0; symbol < numSymbols; ++symbol) ++count[lengths[symbol]];
+                    count[0] = 0;
+
+                    // Over-subscribed sets are invalid, incomplete ones are allowed and leave invalid entries
+                    int left = 1;
+                    for (int length = 1; length <= MAX_CODE_LENGTH; ++length)
+                    {
+                        left = (left << 1) - count[length];
+                        if (left < 0) return false;
+                    }
+
+                    int nextCode[MAX_CODE_LENGTH + 1] {};
+                    for (int length = 1, code = 0; length <= MAX_CODE_LENGTH; ++length)
+                    {
+                        code             = (code + count[length - 1]) << 1;
+                        nextCode[length] = code;
+                    }
+
+                    // Deflate sends codes MSB first into an LSB-first stream, so the table is indexed by the reversed code
+                    uint16_t codes[288] {};
+                    for (int symbol = 0; symbol < numSymbols; ++symbol)
+                    {
+                        const int length = lengths[symbol];
+                        if (length == 0) continue;
+
+                        const int code     = nextCode[length]++;
+                        int       reversed = 0;
+                        for (int bit = 0; bit < length; ++bit) reversed |= (code >> bit & 1) << (length - 1 - bit);
+                        codes[symbol] = static_cast<uint16_t>(reversed);
+                    }
+
+                    primaryBits = tableBits;
+                    const uint32_t primaryMask = (1u << tableBits) - 1;
+
+                    // The longest code behind every primary index decides the size of its subtable
+                    uint8_t subtableLengths[1 << MAX_PRIMARY_BITS] {};
+                    for (int symbol = 0; symbol < numSymbols; ++symbol)
+                    {
+                        if (lengths[symbol] <= tableBits) continue;
+
+                        uint8_t& subtableLength = subtableLengths[codes[symbol] & primaryMask];
+                        subtableLength = std::max(subtableLength, lengths[symbol]);
+                    }
+
+                    entries.assign(size_t{1} << tableBits, 0);
+                    for (uint32_t index = 0; index <= primaryMask; ++index)
+                    {
+                        if (subtableLengths[index] == 0) continue;
+
+                        const uint32_t subtableBits = subtableLengths[index] - tableBits;
+                        entries[index] = static_cast<uint32_t>(entries.size()) << 16 | subtableBits << 8 | SUBTABLE | static_cast<uint32_t>(tableBits);
+                        entries.resize(entries.size() + (size_t{1} << subtableBits), 0);
+                    }
+
+                    for (int symbol = 0; symbol < numSymbols; ++symbol)
+                    {
+                        const int length = lengths[symbol];
+                        if (length == 0) continue;
+
+                        const uint32_t code = codes[symbol];
+                        if (length <= tableBits)
+                        {
+                            for (uint32_t index = code; index <= primaryMask; index += 1u << length)
+                            {
+                                entries[index] = static_cast<uint32_t>(symbol) << 16 | static_cast<uint32_t>(length);
+                            }
+                            continue;
+                        }
+
+                        const uint32_t subtable     = entries[code & primaryMask];
+                        const uint32_t subtableBits = subtable >> 8 & 0xF;
+                        for (uint32_t index = code >> tableBits; index < (1u << subtableBits); index += 1u << (length - tableBits))
+                        {
+                            entries[(subtable >> 16) + index] = static_cast<uint32_t>(symbol) << 16 | static_cast<uint32_t>(length - tableBits);
+                        }
+                    }
+                    return true;
+                }
+
+                // Needs MAX_CODE_LENGTH buffered bits, -1 for an invalid code
+                int Decode(BitReader& reader) const
+                {
+                    uint32_t entry = entries[reader.bits & ((1u << primaryBits) - 1)];
+                    if (entry & SUBTABLE)
+                    {
+                        reader.Consume(primaryBits);
+                        entry = entries[(entry >> 16) + (reader.bits & ((1u << (entry >> 8 & 0xF)) - 1))];
+                    }
+
+                    const int length = static_cast<int>(entry & 0xF);
+                    if (length == 0) return -1;
+
+                    reader.Consume(length);
+                    return static_cast<int>(entry >> 16);
+                }
+            };
+
+            struct FixedTables
+            {
+                HuffmanTable literals  {};
+                HuffmanTable distances {};
+            };
+
+            const FixedTables& GetFixedTables()
+            {
+                static const FixedTables fixedTables = []
+                {
+                    uint8_t lengths[288 + 30];
+                    std::fill(lengths,       lengths + 144, uint8_t{8});
+                    std::fill(lengths + 144, lengths + 256, uint8_t{9});
+                    std::fill(lengths + 256, lengths + 280, uint8_t{7});
+                    std::fill(lengths + 280, lengths + 288, uint8_t{8});
+                    std::fill(lengths + 288, lengths + 318, uint8_t{5});
+
+                    FixedTables result{};
+                    result.literals.Build(lengths, 288, LITERAL_BITS);
+                    result.distances.Build(lengths + 288, 30, DISTANCE_BITS);
+                    return result;
+                }();
+                return fixedTables;
+            }
+
+            bool ReadDynamicTables(BitReader& reader, HuffmanTable& literals, HuffmanTable& distances)
+            {
+                reader.Refill();
+                const int numLiterals    = static_cast<int>(reader.Read(5)) + 257;
+                const int numDistances   = static_cast<int>(reader.Read(5)) + 1;
+                const int numCodeLengths = static_cast<int>(reader.Read(4)) + 4;
+                if (numLiterals > 286 or numDistances > 30) return false;
+
+                uint8_t codeLengthLengths[19] {};
+                for (int i = 0; i < numCodeLengths; ++i)
+                {
+                    reader.Refill();
+                    codeLengthLengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(reader.Read(3));
+                }
+
+                HuffmanTable codeLengths{};
+                if (not codeLengths.Build(codeLengthLengths, 19, CODE_LENGTH_BITS)) return false;
+
+                // Literal and distance lengths form one sequence, a repeat may run from one into the other
+                uint8_t lengths[286 + 30] {};
+                const int numLengths = numLiterals + numDistances;
+                for (int i = 0; i < numLengths;)
+                {
+                    reader.Refill();
+                    const int symbol = codeLengths.Decode(reader);
+                    if (symbol < 0) return false;
+
+                    if (symbol < 16)
+                    {
+                        lengths[i++] = static_cast<uint8_t>(symbol);
+                        continue;
+                    }
+
+                    uint8_t value  = 0;
+                    int     repeat = 0;
+                    if (symbol == 16)
+                    {
+                        if (i == 0) return false;
+                        value  = lengths[i - 1];
+                        repeat = 3 + static_cast<int>(reader.Read(2));
+                    }
+                    else if (symbol == 17) repeat = 3  + static_cast<int>(reader.Read(3));
+                    else                   repeat = 11 + static_cast<int>(reader.Read(7));
+
+                    if (i + repeat > numLengths) return false;
+                    std::fill_n(lengths + i, repeat, value);
+                    i += repeat;
+                }
+
+                // Without an end-of-block code the block could never end
+                if (lengths[256] == 0) return false;
+
+                return literals.Build(lengths, numLiterals, LITERAL_BITS) and distances.Build(lengths + numLiterals, numDistances, DISTANCE_BITS);
+            }
+
+            bool InflateBlock(BitReader& reader, const HuffmanTable& literals, const HuffmanTable& distances, uint8_t* outputPtr, uint8_t*& currentPtr, uint8_t* outputEndPtr)
+            {
+                uint8_t* out = currentPtr;
+                for (;;)
+                {
+                    reader.Refill();
+
+                    const int symbol = literals.Decode(reader);
+                    if (symbol < 256)
+                    {
+                        if (symbol < 0 or out == outputEndPtr) return false;
+                        *out++ = static_cast<uint8_t>(symbol);
+                        continue;
+                    }
+                    if (symbol == 256) break;
+
+                    const int lengthSymbol = symbol - 257;
+                    if (lengthSymbol >= 29) return false;
+                    const int length = LENGTH_BASE[lengthSymbol] + static_cast<int>(reader.Read(LENGTH_EXTRA[lengthSymbol]));
+
+                    const int distanceSymbol = distances.Decode(reader);
+                    if (distanceSymbol < 0 or distanceSymbol >= 30) return false;
+                    const int distance = DISTANCE_BASE[distanceSymbol] + static_cast<int>(reader.Read(DISTANCE_EXTRA[distanceSymbol]));
+
+                    if (distance > out - outputPtr or length > outputEndPtr - out) return false;
+
+                    const uint8_t* source = out - distance;
+                    if (distance >= 8 and outputEndPtr - out >= length + 8)
+                    {
+                        // 8 bytes at a time, the source never overlaps the bytes of the same step and the overshoot is rewritten later
+                        uint8_t* const end = out + length;
+                        do
+                        {
+                            uint64_t word;
+                            std::memcpy(&word, source, sizeof(word));
+                            std::memcpy(out, &word, sizeof(word));
+                            source += 8;
+                            out    += 8;
+                        }
+                        while (out < end);
+                        out = end;
+                    }
+                    else if (distance == 1)
+                    {
+                        std::memset(out, *source, length);
+                        out += length;
+                    }
+                    else
+                    {
+                        for (int i = 0; i < length; ++i) *out++ = source[i];
+                    }
+                }
+
+                currentPtr = out;
+                return true;
+            }
+
+            // zlib stream into exactly outputSize bytes
+            bool Inflate(std::span<const uint8_t> input, uint8_t* outputPtr, size_t outputSize)
+            {
+                if (input.size() < 2) return false;
+
+                const uint8_t method = input[0];
+                const uint8_t flags  = input[1];
+                if ((method & 0x0F) != 8 or (method >> 4) > 7 or (method << 8 | flags) % 31 != 0 or (flags & 0x20)) return false;
+
+                BitReader reader{input.data() + 2, input.data() + input.size()};
+
+                uint8_t* const outputEndPtr = outputPtr + outputSize;
+                uint8_t*       currentPtr   = outputPtr;
+
+                HuffmanTable literals{};
+                HuffmanTable distances{};
+
+                bool isFinal = false;
+                while (not isFinal)
+                {
+                    reader.Refill();
+                    isFinal = reader.Read(1) != 0;
+
+                    switch (reader.Read(2))
+                    {
+                    case 0:
+                    {
+                        if (not reader.AlignToByte() or reader.endPtr - reader.bytesPtr < 4) return false;
+
+                        const uint16_t length     = static_cast<uint16_t>(reader.bytesPtr[0] | reader.bytesPtr[1] << 8);
+                        const uint16_t complement = static_cast<uint16_t>(reader.bytesPtr[2] | reader.bytesPtr[3] << 8);
+                        reader.bytesPtr += 4;
+
+                        if (length != static_cast<uint16_t>(~complement) or reader.endPtr - reader.bytesPtr < length or outputEndPtr - currentPtr < length) return false;
+
+                        std::memcpy(currentPtr, reader.bytesPtr, length);
+                        currentPtr      += length;
+                        reader.bytesPtr += length;
+                        break;
+                    }
+                    case 1:
+                    {
+                        const FixedTables& fixedTables = GetFixedTables();
+                        if (not InflateBlock(reader, fixedTables.literals, fixedTables.distances, outputPtr, currentPtr, outputEndPtr)) return false;
+                        break;
+                    }
+                    case 2:
+                        if (not ReadDynamicTables(reader, literals, distances)) return false;
+                        if (not InflateBlock(reader, literals, distances, outputPtr, currentPtr, outputEndPtr)) return false;
+                        break;
+                    default:
+                        return false;
+                    }
+                }
+
+                return not reader.IsOverrun() and currentPtr == outputEndPtr;
+            }
+#pragma endregion
+
+#pragma region Unfiltering
+            enum class RowFilter : uint8_t
+            {
+                None,
+                Sub,
+                Up,
+                Average,
+                Paeth,
+
+                COUNT
+            };
+
+#if defined(__AVX2__)
+            // One pixel of 3 or 4 bytes in the low bytes of a vector, without reading or writing past it
+            inline __m128i LoadPixel(const uint8_t* pixelPtr, int bytesPerPixel)
+            {
+                uint32_t pixel = 0;
+                std::memcpy(&pixel, pixelPtr, bytesPerPixel);
+                return _mm_cvtsi32_si128(static_cast<int>(pixel));
+            }
+
+            inline void StorePixel(uint8_t* pixelPtr, __m128i pixel, int bytesPerPixel)
+            {
+                const uint32_t value = static_cast<uint32_t>(_mm_cvtsi128_si32(pixel));
+                std::memcpy(pixelPtr, &value, bytesPerPixel);
+            }
+
+            // Prefix sum over the pixels of 16 bytes, 4 pixels of 4 bytes or 4 pixels of 3 bytes in the low 12
+            void UnfilterSub(uint8_t* rowPtr, int rowBytes, int bytesPerPixel)
+            {
+                const int step = bytesPerPixel * 4;
+                const __m128i broadcastLast = bytesPerPixel == 4 ? _mm_setr_epi8(12, 13, 14, 15, 12, 13, 14, 15, 12, 13, 14, 15, 12, 13, 14, 15)
+                                                                 : _mm_setr_epi8(9, 10, 11, 9, 10, 11, 9, 10, 11, 9, 10, 11, -1, -1, -1, -1);
+
+                __m128i carry = _mm_setzero_si128();
+                int     x     = 0;
+                for (; x + 16 <= rowBytes; x += step)
+                {
+                    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowPtr + x));
+                    if (bytesPerPixel == 4)
+                    {
+                        pixels = _mm_add_epi8(pixels, _mm_slli_si128(pixels, 4));
+                        pixels = _mm_add_epi8(pixels, _mm_slli_si128(pixels, 8));
+                        pixels = _mm_add_epi8(pixels, carry);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(rowPtr + x), pixels);
+                    }
+                    else
+                    {
+                        pixels = _mm_add_epi8(pixels, _mm_slli_si128(pixels, 3));
+                        pixels = _mm_add_epi8(pixels, _mm_slli_si128(pixels, 6));
+                        pixels = _mm_add_epi8(pixels, carry);
+                        _mm_storel_epi64(reinterpret_cast<__m128i*>(rowPtr + x), pixels);
+                        StorePixel(rowPtr + x + 8, _mm_srli_si128(pixels, 8), 4);
+                    }
+                    carry = _mm_shuffle_epi8(pixels, broadcastLast);
+                }
+
+                for (x = std::max(x, bytesPerPixel); x < rowBytes; ++x) rowPtr[x] = static_cast<uint8_t>(rowPtr[x] + rowPtr[x - bytesPerPixel]);
+            }
+
+            void UnfilterUp(uint8_t* rowPtr, const uint8_t* previousRowPtr, int rowBytes)
+            {
+                int x = 0;
+                for (; x + 16 <= rowBytes; x += 16)
+                {
+                    const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowPtr + x));
+                    const __m128i above  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previousRowPtr + x));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(rowPtr + x), _mm_add_epi8(pixels, above));
+                }
+                for (; x < rowBytes; ++x) rowPtr[x] = static_cast<uint8_t>(rowPtr[x] + previousRowPtr[x]);
+            }
+
+            // Every pixel depends on the one before it, so the vectors hold one pixel and work on all of its channels at once
+            void UnfilterAverage(uint8_t* rowPtr, const uint8_t* previousRowPtr, int rowBytes, int bytesPerPixel)
+            {
+                const __m128i one  = _mm_set1_epi8(1);
+                __m128i       left = _mm_setzero_si128();
+                for (int x = 0; x < rowBytes; x += bytesPerPixel)
+                {
+                    const __m128i above = LoadPixel(previousRowPtr + x, bytesPerPixel);
+
+                    // _mm_avg_epu8 rounds up, the filter rounds down
+                    const __m128i average = _mm_sub_epi8(_mm_avg_epu8(left, above), _mm_and_si128(_mm_xor_si128(left, above), one));
+                    left = _mm_add_epi8(LoadPixel(rowPtr + x, bytesPerPixel), average);
+                    StorePixel(rowPtr + x, left, bytesPerPixel);
+                }
+            }
+
+            void UnfilterPaeth(uint8_t* rowPtr, const uint8_t* previousRowPtr, int rowBytes, int bytesPerPixel)
+            {
+                const __m128i zero   = _mm_setzero_si128();
+                __m128i       left   = zero;
+                __m128i       upLeft = zero;
+                for (int x = 0; x < rowBytes; x += bytesPerPixel)
+                {
+                    const __m128i up = _mm_unpacklo_epi8(LoadPixel(previousRowPtr + x, bytesPerPixel), zero);
+
+                    // Distances in 16 bits, the sum in the third one does not fit a byte
+                    const __m128i toUp           = _mm_sub_epi16(up, upLeft);
+                    const __m128i toLeft         = _mm_sub_epi16(left, upLeft);
+                    const __m128i leftDistance   = _mm_abs_epi16(toUp);
+                    const __m128i upDistance     = _mm_abs_epi16(toLeft);
+                    const __m128i upLeftDistance = _mm_abs_epi16(_mm_add_epi16(toUp, toLeft));
+                    const __m128i smallest       = _mm_min_epi16(upLeftDistance, _mm_min_epi16(leftDistance, upDistance));
+
+                    // Ties go to left, then up, then up-left
+                    __m128i predictor = upLeft;
+                    predictor = _mm_blendv_epi8(predictor, up,   _mm_cmpeq_epi16(smallest, upDistance));
+                    predictor = _mm_blendv_epi8(predictor, left, _mm_cmpeq_epi16(smallest, leftDistance));
+
+                    const __m128i pixel = _mm_add_epi8(LoadPixel(rowPtr + x, bytesPerPixel), _mm_packus_epi16(predictor, zero));
+                    StorePixel(rowPtr + x, pixel, bytesPerPixel);
+
+                    left   = _mm_unpacklo_epi8(pixel, zero);
+                    upLeft = up;
+                }
+            }
+#else
+            uint8_t PaethPredictor(int left, int up, int upLeft)
+            {
+                const int leftDistance   = std::abs(up - upLeft);
+                const int upDistance     = std::abs(left - upLeft);
+                const int upLeftDistance = std::abs(left + up - 2 * upLeft);
+
+                if (leftDistance <= upDistance and leftDistance <= upLeftDistance) return static_cast<uint8_t>(left);
+                return static_cast<uint8_t>(upDistance <= upLeftDistance ? up : upLeft);
+            }
+
+            void UnfilterSub(uint8_t* rowPtr, int rowBytes, int bytesPerPixel)
+            {
+                for (int x = bytesPerPixel; x < rowBytes; ++x) rowPtr[x] = static_cast<uint8_t>(rowPtr[x] + rowPtr[x - bytesPerPixel]);
+            }
+
+            void UnfilterUp(uint8_t* rowPtr, const uint8_t* previousRowPtr, int rowBytes)
+            {
+                for (int x = 0; x < rowBytes; ++x) rowPtr[x] = static_cast<uint8_t>(rowPtr[x] + previousRowPtr[x]);
+            }
+
+            void UnfilterAverage(uint8_t* rowPtr, const uint8_t* previousRowPtr, int rowBytes, int bytesPerPixel)
+            {
+                for (int x = 0; x < rowBytes; ++x)
+                {
+                    const int left = x >= bytesPerPixel ? rowPtr[x - bytesPerPixel] : 0;
+                    rowPtr[x] = static_cast<uint8_t>(rowPtr[x] + ((left + previousRowPtr[x]) >> 1));
+                }
+            }
+
+            void UnfilterPaeth(uint8_t* rowPtr, const uint8_t* previousRowPtr, int rowBytes, int bytesPerPixel)
+            {
+                for (int x = 0; x < rowBytes; ++x)
+                {
+                    const int left   = x >= bytesPerPixel ? rowPtr[x - bytesPerPixel]         : 0;
+                    const int upLeft = x >= bytesPerPixel ? previousRowPtr[x - bytesPerPixel] : 0;
+                    rowPtr[x] = static_cast<uint8_t>(rowPtr[x] + PaethPredictor(left, previousRowPtr[x], upLeft));
+                }
+            }
+#endif
+
+            bool UnfilterRow(RowFilter filter, uint8_t* rowPtr, const uint8_t* previousRowPtr, int rowBytes, int bytesPerPixel)
+            {
+                switch (filter)
+                {
+                case RowFilter::None:    return true;
+                case RowFilter::Sub:     UnfilterSub(rowPtr, rowBytes, bytesPerPixel);                     return true;
+                case RowFilter::Up:      UnfilterUp(rowPtr, previousRowPtr, rowBytes);                     return true;
+                case RowFilter::Average: UnfilterAverage(rowPtr, previousRowPtr, rowBytes, bytesPerPixel); return true;
+                case RowFilter::Paeth:   UnfilterPaeth(rowPtr, previousRowPtr, rowBytes, bytesPerPixel);   return true;
+                default:                 return false;
+                }
+            }
+
+            // RGB rows get an opaque alpha, RGBA rows are already in the final layout
+            void ExpandRow(const uint8_t* rowPtr, int width, int channels, uint8_t* outputPtr)
+            {
+                if (channels == 4)
+                {
+                    std::memcpy(outputPtr, rowPtr, static_cast<size_t>(width) * 4);
+                    return;
+                }
+
+                int x = 0;
+#if defined(__AVX2__)
+                // 4 pixels per step, the 16-byte load needs 4 bytes of the row after them
+                const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+                const __m128i alpha  = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+                for (; x * 3 + 16 <= width * 3; x += 4)
+                {
+                    const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowPtr + x * 3));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(outputPtr + x * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, expand), alpha));
+                }
+#endif
+                for (; x < width; ++x)
+                {
+                    outputPtr[x * 4 + 0] = rowPtr[x * 3 + 0];
+                    outputPtr[x * 4 + 1] = rowPtr[x * 3 + 1];
+                    outputPtr[x * 4 + 2] = rowPtr[x * 3 + 2];
+                    outputPtr[x * 4 + 3] = 0xFF;
+                }
+            }
+#pragma endregion
+        }
+#pragma endregion
+
+        SDL_Surface* Load(const std::string& path)
+        {
+            std::ifstream stream{path, std::ios::binary | std::ios::ate};
+            if (not stream) return nullptr;
+
+            std::vector<uint8_t> file(static_cast<size_t>(stream.tellg()));
+            stream.seekg(0);
+            if (not stream.read(reinterpret_cast<char*>(file.data()), static_cast<std::streamsize>(file.size()))) return nullptr;
+
+            int width  = 0;
+            int height = 0;
+            if (not ReadSize(file, width, height)) return nullptr;
+
+            SDL_Surface* surfacePtr = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+            if (not surfacePtr) return nullptr;
+
+            if (not Decode(file, static_cast<uint8_t*>(surfacePtr->pixels), surfacePtr->pitch))
+            {
+                SDL_FreeSurface(surfacePtr);
+                return nullptr;
+            }
+            return surfacePtr;
+        }
+
+        std::vector<SDL_Surface*> LoadFiles(const std::vector<std::string>& paths)
+        {
+            // Inflate is serial within a file, so the files are the unit of parallelism
+            std::vector<SDL_Surface*> surfacePtrs(paths.size(), nullptr);
+            std::vector<size_t>       indices(paths.size());
+            std::iota(indices.begin(), indices.end(), size_t{0});
+
+            std::for_each(std::execution::par, indices.begin(), indices.end(), [&](size_t i)
+            {
+                surfacePtrs[i] = Load(paths[i]);
+            });
+            return surfacePtrs;
+        }
+
+        bool ReadSize(std::span<const uint8_t> file, int& width, int& height)
+        {
+            ImageHeader header{};
+            if (not ReadHeader(file, header)) return false;
+
+            width  = header.width;
+            height = header.height;
+            return true;
+        }
+
+        bool Decode(std::span<const uint8_t> file, uint8_t* pixelsPtr, int pitch)
+        {
+            ImageHeader header{};
+            if (not ReadHeader(file, header)) return false;
+
+            // Gather the IDAT chunks, a single one is inflated straight out of the file
+            std::vector<std::span<const uint8_t>> dataChunks{};
+            size_t offset = sizeof(SIGNATURE);
+            for (;;)
+            {
+                if (file.size() - offset < 12) return false;
+
+                const uint32_t length = ReadBigEndian(file.data() + offset);
+                const uint8_t* type   = file.data() + offset + 4;
+                if (length > file.size() - offset - 12) return false;
+
+                const std::span<const uint8_t> data = file.subspan(offset + 8, length);
+                offset += 12 + static_cast<size_t>(length);
+
+                if      (std::memcmp(type, "IDAT", 4) == 0) dataChunks.push_back(data);
+                else if (std::memcmp(type, "IEND", 4) == 0) break;
+                // Color keying is SDL_image's job, so are critical chunks we do not know. A PLTE next to RGB is only a suggestion
+                else if (std::memcmp(type, "tRNS", 4) == 0) return false;
+                else if (not (type[0] & 0x20) and std::memcmp(type, "IHDR", 4) != 0 and std::memcmp(type, "PLTE", 4) != 0) return false;
+            }
+            if (dataChunks.empty()) return false;
+
+            std::vector<uint8_t> joinedChunks{};
+            std::span<const uint8_t> compressed = dataChunks[0];
+            if (dataChunks.size() > 1)
+            {
+                for (const std::span<const uint8_t>& chunk : dataChunks) joinedChunks.insert(joinedChunks.end(), chunk.begin(), chunk.end());
+                compressed = joinedChunks;
+            }
+
+            // Every row starts with its filter type
+            const int    bytesPerPixel = header.channels;
+            const int    rowBytes      = header.width * bytesPerPixel;
+            const size_t rowStride     = static_cast<size_t>(rowBytes) + 1;
+
+            std::vector<uint8_t> filtered(rowStride * header.height);
+            if (not Inflate(compressed, filtered.data(), filtered.size())) return false;
+
+            // The row above the first one is all zeros
+            const std::vector<uint8_t> zeroRow(rowBytes, 0);
+            const uint8_t*             previousRowPtr = zeroRow.data();
+            for (int y = 0; y < header.height; ++y)
+            {
+                uint8_t*        rowPtr = filtered.data() + y * rowStride + 1;
+                const RowFilter filter = static_cast<RowFilter>(rowPtr[-1]);
+
+                if (not UnfilterRow(filter, rowPtr, previousRowPtr, rowBytes, bytesPerPixel)) return false;
+                ExpandRow(rowPtr, header.width, header.channels, pixelsPtr + static_cast<size_t>(y) * pitch);
+
+                previousRowPtr = rowPtr;
+            }
+            return true;
+        }
+    }
+}
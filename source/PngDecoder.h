@@ -0,0 +1,33 @@
+#pragma once
+
+// Standard includes
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Forward declarations
+struct SDL_Surface;
+
+namespace dae
+{
+    /**
+     * \brief Built-in decoder for the 8-bit RGB and RGBA, non-interlaced PNGs our assets use, straight into SDL_PIXELFORMAT_RGBA32.
+     * Inflate refills 64 bits at a time and decodes through two-level Huffman tables, the row filters are undone with SSE on whole pixels.
+     * Anything else (palettes, grayscale, 16 bits, interlacing, tRNS) is left to SDL_image. Chunk CRCs and the zlib Adler-32 are not verified.
+     */
+    namespace PngDecoder
+    {
+        // nullptr when the file is missing, damaged or in a format this decoder leaves to SDL_image
+        SDL_Surface* Load(const std::string& path);
+
+        // One surface per path in the same order, the files are decoded concurrently. Every entry follows the rules of Load()
+        std::vector<SDL_Surface*> LoadFiles(const std::vector<std::string>& paths);
+
+        // Only checks the signature and the IHDR chunk
+        bool ReadSize(std::span<const uint8_t> file, int& width, int& height);
+
+        // pixelsPtr has room for height rows of pitch bytes, every row receives width RGBA8 texels. RGB images get an alpha of 255
+        bool Decode(std::span<const uint8_t> file, uint8_t* pixelsPtr, int pitch);
+    }
+}
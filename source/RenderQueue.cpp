@@ -0,0 +1,155 @@
+// Built without the precompiled header, the queue knows nothing about D3D and its tests run on any platform
+#include "RenderQueue.h"
+
+// Standard includes
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr uint64_t PASS_MASK  = 0x7F;
+        constexpr uint32_t DEPTH_MASK = 0xFFFFFF;
+
+        constexpr int RADIX_BITS   = 8;
+        constexpr int RADIX_SIZE   = 1 << RADIX_BITS;
+        constexpr int RADIX_PASSES = 64 / RADIX_BITS;
+
+        // Positive floats order like their bits. The upper 24 below the sign keep the exponent and 16 bits of mantissa
+        uint32_t EncodeDepth(float depth)
+        {
+            if (not (depth > 0.0f)) return 0;
+            return std::bit_cast<uint32_t>(depth) >> 7 & DEPTH_MASK;
+        }
+    }
+#pragma endregion
+
+#pragma region RenderQueue
+    uint64_t RenderQueue::EncodeSortKey(const DrawPacket& packet)
+    {
+        assert(packet.passIdx <= PASS_MASK and "Pass index does not fit in a sort key!");
+
+        const uint64_t pass     = packet.passIdx & PASS_MASK;
+        const uint64_t material = packet.materialId;
+        const uint64_t geometry = packet.geometryId;
+        const uint64_t depth    = EncodeDepth(packet.depth);
+
+        if (packet.layer == RenderLayer::Opaque)
+        {
+            return pass << 56 | material << 40 | geometry << 24 | depth;
+        }
+        return uint64_t{1} << 63 | (DEPTH_MASK - depth) << 39 | pass << 32 | material << 16 | geometry;
+    }
+
+    void RenderQueue::Clear()
+    {
+        m_Packets.clear();
+        m_Order.clear();
+    }
+
+    void RenderQueue::Add(const DrawPacket& packet)
+    {
+        m_Order.push_back({EncodeSortKey(packet), static_cast<uint32_t>(m_Packets.size())});
+        m_Packets.push_back(packet);
+    }
+
+    void RenderQueue::Sort()
+    {
+        const size_t count = m_Order.size();
+        m_Stats.sortPasses = 0;
+        if (count < 2) return;
+
+        // Every histogram in one read, a byte every key shares lands in a single bucket and needs no pass
+        std::array<std::array<uint32_t, RADIX_SIZE>, RADIX_PASSES> histograms{};
+        for (const SortEntry& entry : m_Order)
+        {
+            for (int pass = 0; pass < RADIX_PASSES; ++pass)
+            {
+                ++histograms[pass][entry.key >> pass * RADIX_BITS & (RADIX_SIZE - 1)];
+            }
+        }
+
+        m_Scratch.resize(count);
+        for (int pass = 0; pass < RADIX_PASSES; ++pass)
+        {
+            std::array<uint32_t, RADIX_SIZE>& histogram = histograms[pass];
+            if (std::ranges::find(histogram, static_cast<uint32_t>(count)) != histogram.end()) continue;
+
+            // Offsets where every bucket starts, the scatter keeps the order within a bucket
+            uint32_t offset = 0;
+            for (uint32_t& bucket : histogram)
+            {
+                const uint32_t bucketSize = bucket;
+                bucket = offset;
+                offset += bucketSize;
+            }
+
+            for (const SortEntry& entry : m_Order)
+            {
+                m_Scratch[histogram[entry.key >> pass * RADIX_BITS & (RADIX_SIZE - 1)]++] = entry;
+            }
+            m_Order.swap(m_Scratch);
+            ++m_Stats.sortPasses;
+        }
+    }
+
+    const RenderQueueStats& RenderQueue::Submit(IRenderBackend& backend)
+    {
+        const uint64_t sortPasses = m_Stats.sortPasses;
+        m_Stats            = {};
+        m_Stats.sortPasses = sortPasses;
+
+        const DrawPacket* previousPtr = nullptr;
+        for (const SortEntry& entry : m_Order)
+        {
+            const DrawPacket& packet = m_Packets[entry.packetIdx];
+            ++m_Stats.packets;
+
+            // A pass belongs to the effect of its material, another material always binds its pass again
+            const bool isSameGeometry = previousPtr and previousPtr->geometryId == packet.geometryId;
+            const bool isSameMaterial = previousPtr and previousPtr->materialId == packet.materialId;
+            const bool isSamePass     = isSameMaterial and previousPtr->passIdx == packet.passIdx;
+
+            if (not isSameGeometry)
+            {
+                backend.BindGeometry(packet);
+                ++m_Stats.geometryBinds;
+            }
+
+            if (not isSameMaterial)
+            {
+                backend.BindMaterial(packet);
+                ++m_Stats.materialBinds;
+            }
+
+            if (not isSamePass)
+            {
+                backend.BindPass(packet);
+                ++m_Stats.passBinds;
+            }
+
+            m_Stats.skippedBinds += isSameGeometry + isSameMaterial + isSamePass;
+
+            backend.Draw(packet);
+            previousPtr = &packet;
+        }
+        return m_Stats;
+    }
+#pragma endregion
+
+#pragma region RecordingBackend
+    size_t RecordingBackend::GetStateChangeCount() const
+    {
+        return static_cast<size_t>(std::ranges::count_if(m_Commands, [](const RenderCommand& command) { return command.type != RenderCommandType::Draw; }));
+    }
+
+    void RecordingBackend::Record(RenderCommandType type, const DrawPacket& packet)
+    {
+        m_Commands.push_back({type, packet.geometryId, packet.materialId, packet.passIdx, packet.depth});
+    }
+#pragma endregion
+}
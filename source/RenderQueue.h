@@ -0,0 +1,136 @@
+#pragma once
+
+// Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+    enum class RenderLayer : uint8_t
+    {
+        Opaque,      // Drawn first, front to back within the same state
+        Transparent  // Drawn last, back to front regardless of state
+    };
+
+    // One draw of the frame. Ids name the state a draw needs, packets that share one share the bind
+    struct DrawPacket
+    {
+        const void* objectPtr  = nullptr; // What the backend draws, e.g. a Mesh
+        uint16_t    geometryId = 0;       // Input layout, vertex and index buffer
+        uint16_t    materialId = 0;       // Effect variant, material constants and shader resources
+        uint8_t     passIdx    = 0;
+        RenderLayer layer      = RenderLayer::Opaque;
+        float       depth      = 0.0f;    // View-space distance, negative is treated as 0
+    };
+
+    // Where a queue is submitted to. Behind an interface so the queue runs without D3D
+    class IRenderBackend
+    {
+    public:
+        virtual ~IRenderBackend() = default;
+
+        // Only called when the packet needs another geometry, material or pass than the one drawn before it
+        virtual void BindGeometry(const DrawPacket& packet) = 0;
+        virtual void BindMaterial(const DrawPacket& packet) = 0;
+        virtual void BindPass(const DrawPacket& packet)     = 0;
+        // Once per packet, with the per-object constants
+        virtual void Draw(const DrawPacket& packet)         = 0;
+    };
+
+    struct RenderQueueStats
+    {
+        uint64_t packets       = 0;
+        uint64_t geometryBinds = 0;
+        uint64_t materialBinds = 0;
+        uint64_t passBinds     = 0;
+        uint64_t skippedBinds  = 0; // Binds the packet before had already made
+        uint64_t sortPasses    = 0; // Radix passes that had to move anything
+    };
+
+    /**
+     * \brief The draws of one frame, sorted by a 64-bit key before they are submitted. Opaque packets come first and are ordered by pass,
+     * material and geometry, then front to back, so state changes as rarely as possible and early depth rejection still works within a state.
+     * Transparent packets follow back to front, their state only breaks ties. The keys are sorted with an LSD radix sort that skips every
+     * byte all keys share; the scratch memory is kept between frames. Submit() only binds what differs from the packet before.
+     */
+    class RenderQueue final
+    {
+    public:
+        RenderQueue() = default;
+        ~RenderQueue() = default;
+
+        RenderQueue(const RenderQueue&)                = delete;
+        RenderQueue(RenderQueue&&) noexcept            = delete;
+        RenderQueue& operator=(const RenderQueue&)     = delete;
+        RenderQueue& operator=(RenderQueue&&) noexcept = delete;
+
+        // Layer in bit 63. Opaque:      pass 7 | material 16 | geometry 16 | depth 24
+        //                  Transparent: inverted depth 24 | pass 7 | material 16 | geometry 16
+        static uint64_t EncodeSortKey(const DrawPacket& packet);
+
+        // Starts a frame, keeps the memory
+        void Clear();
+        void Add(const DrawPacket& packet);
+        // Stable, packets with the same key keep the order they were added in
+        void Sort();
+        // In the current order, Sort() first unless the order they were added in is wanted. Stats count this submission only
+        const RenderQueueStats& Submit(IRenderBackend& backend);
+
+        size_t                  GetPacketCount()       const { return m_Order.size(); }
+        // In submission order
+        const DrawPacket&       GetPacket(size_t idx)  const { return m_Packets[m_Order[idx].packetIdx]; }
+        uint64_t                GetSortKey(size_t idx) const { return m_Order[idx].key; }
+        const RenderQueueStats& GetStats()             const { return m_Stats; }
+
+    private:
+        struct SortEntry
+        {
+            uint64_t key       = 0;
+            uint32_t packetIdx = 0;
+        };
+
+        std::vector<DrawPacket> m_Packets {};
+        std::vector<SortEntry>  m_Order   {};
+        std::vector<SortEntry>  m_Scratch {};
+        RenderQueueStats        m_Stats   {};
+    };
+
+    enum class RenderCommandType : uint8_t
+    {
+        BindGeometry,
+        BindMaterial,
+        BindPass,
+        Draw
+    };
+
+    struct RenderCommand
+    {
+        RenderCommandType type       = RenderCommandType::Draw;
+        uint16_t          geometryId = 0;
+        uint16_t          materialId = 0;
+        uint8_t           passIdx    = 0;
+        float             depth      = 0.0f;
+    };
+
+    // Null backend, draws nothing and records what it was asked to do, e.g. to count the state changes of a frame without a device
+    class RecordingBackend final : public IRenderBackend
+    {
+    public:
+        void BindGeometry(const DrawPacket& packet) override { Record(RenderCommandType::BindGeometry, packet); }
+        void BindMaterial(const DrawPacket& packet) override { Record(RenderCommandType::BindMaterial, packet); }
+        void BindPass(const DrawPacket& packet)     override { Record(RenderCommandType::BindPass,     packet); }
+        void Draw(const DrawPacket& packet)         override { Record(RenderCommandType::Draw,         packet); }
+
+        void Clear() { m_Commands.clear(); }
+        // Binds only, draws are not state changes
+        size_t GetStateChangeCount() const;
+
+        const std::vector<RenderCommand>& GetCommands() const { return m_Commands; }
+
+    private:
+        void Record(RenderCommandType type, const DrawPacket& packet);
+
+        std::vector<RenderCommand> m_Commands {};
+    };
+}
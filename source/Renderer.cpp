@@ -3,9 +3,22 @@
 // Project includes
 #include "Renderer.h"
 #include "SceneSelector.h"
+#include "D3DStateObjects.h"
+#include "Effect.h"
+#include "EffectCache.h"
+#include "EffectHotReload.h"
 #include "Mesh.h"
+#include "ParameterBlock.h"
+#include "PipelineStateTracker.h"
+#include "RenderQueue.h"
+#include "ShaderPermutation.h"
+#include "SoftwareRenderer.h"
 #include "Texture.h"
+#include "TextureAtlas.h"
+#include "TextureResidency.h"
 #include "Utils.h"
+#include "VirtualTexture.h"
+#include "Benchmark.h"
 
 // DirectX headers
 #include <dxgi.h>
@@ -18,7 +31,10 @@
 #include "imgui_impl_dx11.h"
 
 // Standard includes
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <filesystem>
 
 namespace dae
 {
@@ -52,6 +68,9 @@ namespace dae
     std::vector<uint32_t> vehicle_indices  {};
     std::vector<Vertex>   fireFx_vertices  {};
     std::vector<uint32_t> fireFx_indices   {};
+
+    std::vector<Vertex>   fireStress_vertices {};
+    std::vector<uint32_t> fireStress_indices  {};
 #pragma endregion
     
 #pragma region Initialization
@@ -83,6 +102,7 @@ namespace dae
         InitializeMesh();
         InitializeCamera();
         InitializeTextures();
+        InitializeSoftwareRenderer();
 
         // Debug
         //=======================================================================================================
@@ -272,6 +292,27 @@ namespace dae
 
     void Renderer::InitializeMesh()
     {
+        m_FrameParametersPtr = new ParameterBlock{ParameterFrequency::Frame};
+        Mesh::DeclareFrameParameters(*m_FrameParametersPtr);
+
+        m_RenderQueuePtr  = new RenderQueue{};
+        m_StateTrackerPtr = new PipelineStateTracker{m_DeviceContextPtr};
+        m_StateObjectsPtr = new D3DStateObjects{m_DevicePtr};
+
+        // Cycling the fill or cull mode only looks up one of these, the cache is sealed so a state missing here gets reported
+        for (int fillMode = 0; fillMode < static_cast<int>(FillMode::COUNT); ++fillMode)
+        {
+            for (int cullMode = 0; cullMode < static_cast<int>(CullMode::COUNT); ++cullMode)
+            {
+                for (const bool frontCounterClockwise : {false, true})
+                {
+                    m_StateObjectsPtr->GetRasterizerState(Mesh::CreateRasterizerDesc(static_cast<FillMode>(fillMode), static_cast<CullMode>(cullMode),
+                                                                                     frontCounterClockwise));
+                }
+            }
+        }
+        m_StateObjectsPtr->Seal();
+
         // --- WEEK 1 ---
 #if W1
 #if TODO_1
@@ -294,12 +335,39 @@ namespace dae
 #elif W3
 #if TODO_0
         m_MeshPtr       = new Mesh(m_DevicePtr, vehicle_vertices, vehicle_indices);
-        m_MeshPtr->SetRasterizerState(m_FillMode, m_CullMode, m_UseFrontCounterClockwise);
-        
         m_FireFXMeshPtr = new Mesh(m_DevicePtr, fireFx_vertices,  fireFx_indices);
         m_FireFXMeshPtr->SetPassIdx(m_WithAlphaBlendingPassIdx);
+
+        // Without a manifest every variant is compiled up front, the effect cache keeps that to one run
+        PermutationManifest manifest{};
+        if (not manifest.Read(m_PermutationsPath))
+        {
+            manifest = PermutationManifest::CreateComplete();
+            manifest.Write(m_PermutationsPath);
+        }
+
+        m_ShaderPermutationsPtr = new ShaderPermutationCache{m_DevicePtr, m_MeshPtr->GetEffectFile(), std::move(manifest)};
+        m_ShaderPermutationsPtr->Prewarm();
+        SelectVehiclePermutation();
+#endif
+#endif
+
+        if (m_MeshPtr)       m_MeshPtr->SetFrameParameters(m_FrameParametersPtr);
+        if (m_FireFXMeshPtr) m_FireFXMeshPtr->SetFrameParameters(m_FrameParametersPtr);
+        if (m_MeshPtr)       m_MeshPtr->SetStateTracker(m_StateTrackerPtr);
+        if (m_FireFXMeshPtr) m_FireFXMeshPtr->SetStateTracker(m_StateTrackerPtr);
+        if (m_MeshPtr)       m_MeshPtr->SetStateObjects(m_StateObjectsPtr);
+        if (m_FireFXMeshPtr) m_FireFXMeshPtr->SetStateObjects(m_StateObjectsPtr);
+
+#if W3
+#if TODO_0
+        // Looked up in the state objects set above
+        m_MeshPtr->SetRasterizerState(m_FillMode, m_CullMode, m_UseFrontCounterClockwise);
 #endif
 #endif
+
+        // Watches every effect that is alive from now on, including variants selected later
+        m_EffectHotReloadPtr = new EffectHotReload{};
     }
 
     void Renderer::InitializeTextures()
@@ -320,17 +388,23 @@ namespace dae
         // --- WEEK 3 ---
 #elif W3
 #if TODO_0
-        m_DiffuseTexturePtr    = Texture::LoadFromFile(m_DiffuseTexturePath,    m_DevicePtr);
-        m_NormalTexturePtr     = Texture::LoadFromFile(m_NormalTexturePath,     m_DevicePtr);
-        m_SpecularTexturePtr   = Texture::LoadFromFile(m_SpecularTexturePath,   m_DevicePtr);
-        m_GlossinessTexturePtr = Texture::LoadFromFile(m_GlossinessTexturePath, m_DevicePtr);
+        m_TextureResidencyPtr = new TextureResidency(m_DevicePtr, static_cast<size_t>(m_TextureBudgetMiB) << 20);
+
+        m_DiffuseTexturePtr    = LoadTexture(m_DiffuseTextureAsset);
+        m_NormalTexturePtr     = LoadTexture(m_NormalTextureAsset);
+        m_SpecularTexturePtr   = LoadTexture(m_SpecularTextureAsset);
+        m_GlossinessTexturePtr = LoadTexture(m_GlossinessTextureAsset);
+
+        m_SpecularGlossinessTexturePtr = LoadTexture(m_SpecularGlossinessTextureAsset);
         
         m_MeshPtr->SetDiffuseMap(m_DiffuseTexturePtr);
         m_MeshPtr->SetNormalMap(m_NormalTexturePtr);
         m_MeshPtr->SetSpecularMap(m_SpecularTexturePtr);
         m_MeshPtr->SetGlossinessMap(m_GlossinessTexturePtr);
+        m_MeshPtr->SetSpecularGlossinessMap(m_SpecularGlossinessTexturePtr);
 
-        m_FireFXTexturePtr = Texture::LoadFromFile(m_FireFXTexturePath, m_DevicePtr);
+        // The atlas page replaces the fire texture when InitializeObjects() moved the fire UVs into it
+        m_FireFXTexturePtr = m_FireFXAtlasPagePath.empty() ? LoadTexture(m_FireFXTextureAsset) : LoadTexture(TextureAsset{m_FireFXAtlasPagePath});
         m_FireFXMeshPtr->SetDiffuseMap(m_FireFXTexturePtr);
 #endif
 #endif
@@ -346,6 +420,99 @@ namespace dae
 #if TODO_0
         Utils::ParseOBJ(m_VehiclePath, vehicle_vertices, vehicle_indices);
         Utils::ParseOBJ(m_FireFXPath, fireFx_vertices, fireFx_indices);
+        Utils::CreateQuadCloud(m_NumFireStressQuads, Vector3{20.0f, 10.0f, 20.0f}, fireStress_vertices, fireStress_indices);
+
+        // A baked atlas that is newer than the fire texture moves the UVs of both fire meshes into its page, before the vertex buffers are created
+        TextureAtlas     atlas{};
+        std::error_code  error{};
+        const AtlasRect* fireRectPtr = atlas.Read(m_AtlasTablePath) ? atlas.Find(m_FireFXTexturePath) : nullptr;
+        if (fireRectPtr and std::filesystem::last_write_time(m_AtlasTablePath, error) >= std::filesystem::last_write_time(m_FireFXTexturePath, error) and not error
+            and std::filesystem::exists(TextureAtlas::GetPagePath(m_AtlasTablePath, fireRectPtr->page), error))
+        {
+            const int numOutside = TextureAtlas::RemapUVs(fireFx_vertices, *fireRectPtr) + TextureAtlas::RemapUVs(fireStress_vertices, *fireRectPtr);
+            if (numOutside > 0)
+            {
+                std::cout << RED_TEXT("Renderer::InitializeObjects() ") << numOutside << " FireFX vertices lie beyond the atlas gutter\n";
+            }
+            m_FireFXAtlasPagePath = TextureAtlas::GetPagePath(m_AtlasTablePath, fireRectPtr->page);
+        }
+
+        const auto getRadius = [](const std::vector<Vertex>& vertices)
+        {
+            float radius = 0.0f;
+            for (const Vertex& vertex : vertices) radius = std::max(radius, vertex.position.Magnitude());
+            return radius;
+        };
+        m_VehicleRadius = getRadius(vehicle_vertices);
+        m_FireFXRadius  = getRadius(fireFx_vertices);
+
+        // Spaced so neighbours never touch, whatever yaw they were given
+        Utils::CreateInstanceGrid(m_NumVehicleInstances,         m_VehicleRadius * 2.5f, m_VehicleInstances);
+        Utils::CreateInstanceGrid(m_NumSoftwareVehicleInstances, m_VehicleRadius * 2.5f, m_SoftwareVehicleInstances);
+#endif
+#endif
+    }
+
+    void Renderer::InitializeSoftwareRenderer()
+    {
+#if W3
+#if TODO_0
+        m_SoftwareRendererPtr = new SoftwareRenderer(m_Width, m_Height);
+
+        // A map that failed to load is left unbound, the shading falls back to a constant for it
+        const auto getMipChain = [](const Texture* texturePtr, const std::string& mapName) -> const MipChain*
+        {
+            if (texturePtr) return &texturePtr->GetMipChain();
+
+            std::cout << RED_TEXT("**(SOFTWARE) Missing ") << MAGENTA_TEXT("" + mapName + "") << RED_TEXT(" map, rendering without it\n");
+            return nullptr;
+        };
+
+        SoftwareMaterial vehicleMaterial{};
+        vehicleMaterial.diffusePtr    = getMipChain(m_DiffuseTexturePtr,    "diffuse");
+        vehicleMaterial.normalPtr     = getMipChain(m_NormalTexturePtr,     "normal");
+        vehicleMaterial.specularPtr   = getMipChain(m_SpecularTexturePtr,   "specular");
+        vehicleMaterial.glossinessPtr = getMipChain(m_GlossinessTexturePtr, "glossiness");
+
+        m_VehicleSoftwareMeshIdx = m_SoftwareRendererPtr->AddMesh(&vehicle_vertices, &vehicle_indices, vehicleMaterial);
+
+        if (m_SpecularGlossinessTexturePtr)
+        {
+            SoftwareMaterial packedVehicleMaterial = vehicleMaterial;
+            packedVehicleMaterial.specularGlossinessPtr = &m_SpecularGlossinessTexturePtr->GetMipChain();
+
+            m_PackedVehicleSoftwareMeshIdx = m_SoftwareRendererPtr->AddMesh(&vehicle_vertices, &vehicle_indices, packedVehicleMaterial);
+        }
+
+        // The backing file is cut from the same chain, and cut again whenever the image is newer
+        m_VirtualTextureCachePtr = new VirtualTextureCache(m_NumVirtualTextureSlots);
+
+        std::error_code error{};
+        const bool isPaged = std::filesystem::exists(m_VirtualDiffusePath, error)
+                         and std::filesystem::last_write_time(m_VirtualDiffusePath, error) >= std::filesystem::last_write_time(m_DiffuseTexturePath, error) and not error;
+        if (m_DiffuseTexturePtr and (isPaged or VirtualTexture::Write(m_VirtualDiffusePath, m_DiffuseTexturePtr->GetMipChain())))
+        {
+            m_VirtualDiffuseTexturePtr = m_VirtualTextureCachePtr->Open(m_VirtualDiffusePath);
+        }
+
+        if (m_VirtualDiffuseTexturePtr)
+        {
+            SoftwareMaterial virtualVehicleMaterial = vehicleMaterial;
+            virtualVehicleMaterial.virtualDiffusePtr = m_VirtualDiffuseTexturePtr;
+
+            m_VirtualVehicleSoftwareMeshIdx = m_SoftwareRendererPtr->AddMesh(&vehicle_vertices, &vehicle_indices, virtualVehicleMaterial);
+        }
+
+        // The fire is nothing but its texture, without it there is nothing to blend
+        SoftwareMaterial fireMaterial{};
+        fireMaterial.diffusePtr    = getMipChain(m_FireFXTexturePtr, "fire");
+        fireMaterial.isTransparent = true;
+
+        if (fireMaterial.diffusePtr)
+        {
+            m_FireFXSoftwareMeshIdx     = m_SoftwareRendererPtr->AddMesh(&fireFx_vertices,     &fireFx_indices,     fireMaterial);
+            m_FireStressSoftwareMeshIdx = m_SoftwareRendererPtr->AddMesh(&fireStress_vertices, &fireStress_indices, fireMaterial);
+        }
 #endif
 #endif
     }
@@ -358,15 +525,27 @@ namespace dae
         // General
         //=======================================================================================================
         // Textures
+        delete m_TextureResidencyPtr;
         delete m_TexturePtr;
         delete m_DiffuseTexturePtr;
         delete m_GlossinessTexturePtr;
         delete m_NormalTexturePtr;
         delete m_SpecularTexturePtr;
+        delete m_SpecularGlossinessTexturePtr;
         delete m_FireFXTexturePtr;
 
+        // Stops the worker before the effects and the device it compiles for go
+        delete m_EffectHotReloadPtr;
         delete m_MeshPtr;
         delete m_FireFXMeshPtr;
+        delete m_FrameParametersPtr;
+        delete m_ShaderPermutationsPtr;
+        delete m_RenderQueuePtr;
+        delete m_StateTrackerPtr;
+        delete m_StateObjectsPtr;
+
+        delete m_SoftwareRendererPtr;
+        delete m_VirtualTextureCachePtr;
         
         // DirectX
         //=======================================================================================================
@@ -407,6 +586,13 @@ namespace dae
 #pragma region Update & Render
     void Renderer::Update(const Timer* timerPtr)
     {
+        // Effects recompiled since the last frame are swapped in before anything is set on them
+        if (m_EffectHotReloadPtr and m_EffectHotReloadPtr->Update() > 0)
+        {
+            if (m_MeshPtr)       m_MeshPtr->RefreshEffect();
+            if (m_FireFXMeshPtr) m_FireFXMeshPtr->RefreshEffect();
+        }
+
         // --- WEEK 2 ---
 #if W2
 #if TODO_0
@@ -422,32 +608,44 @@ namespace dae
         m_Camera.Update(timerPtr);
         
         m_MeshPtr->SetMatrix(m_Camera.GetInverseViewMatrix(), m_Camera.GetProjectionMatrix());
-        m_MeshPtr->SetTime(m_AccTime);
+        m_FrameParametersPtr->Set(Mesh::FrameTime, m_AccTime);
         
         Rotate(timerPtr->GetElapsed());
 #endif
 #elif W3
 #if TODO_0
         m_Camera.Update(timerPtr);
+        UpdateTextureResidency();
 
-        // Vehicle
-        m_MeshPtr->SetMatrix(m_Camera.GetInverseViewMatrix(), m_Camera.GetProjectionMatrix());
-        m_MeshPtr->SetCameraPosition(m_Camera.GetPosition());
-        
-        m_MeshPtr->SetUseNormalMap(m_UseNormalMap);
-        m_MeshPtr->SetTime(m_AccTime);
-        m_MeshPtr->SetShadingMode(static_cast<int>(m_ShadingMode));
+        // Frame, only what changed since the last frame is uploaded
+        m_FrameParametersPtr->Set(Mesh::FrameCameraPosition, m_Camera.GetPosition());
+        m_FrameParametersPtr->Set(Mesh::FrameAmbientColor,   m_Ambient);
+        m_FrameParametersPtr->Set(Mesh::FrameLightDirection, m_LightDirection);
+        m_FrameParametersPtr->Set(Mesh::FrameLightIntensity, m_LightIntensity);
+
+        // Object, once per frame instead of a rotation per vertex in the vertex shaders
+        m_WorldMatrix = Matrix::CreateRotationY(45.0f * TO_RADIANS * m_AccTime);
+
+        // Vehicle, the UI changes the shading mode, normal map and sampler without going through the Cycle/Toggle functions
+        SelectVehiclePermutation();
+
+        // The grid never moves, the transforms are only uploaded when the crowd is toggled. Every vehicle spins with the world matrix
+        if ((m_MeshPtr->GetNumInstances() > 0) != m_UseVehicleCrowd)
+        {
+            m_MeshPtr->SetInstances(m_UseVehicleCrowd ? m_VehicleInstances : std::vector<Matrix>{});
+        }
+        m_MeshPtr->SetMatrix(m_WorldMatrix, m_Camera.GetInverseViewMatrix(), m_Camera.GetProjectionMatrix());
         
-        m_MeshPtr->SetAmbient(m_Ambient);
-        m_MeshPtr->SetLightDirection(m_LightDirection);
-        m_MeshPtr->SetLightIntensity(m_LightIntensity);
+        m_MeshPtr->SetUsePackedMaps(m_UsePackedMaps and m_SpecularGlossinessTexturePtr);
         m_MeshPtr->SetKD(m_KD);
         m_MeshPtr->SetShininess(m_Shininess);
 
         // FireFX
-        m_FireFXMeshPtr->SetMatrix(m_Camera.GetInverseViewMatrix(), m_Camera.GetProjectionMatrix());
-        m_FireFXMeshPtr->SetTime(m_AccTime);
+        m_FireFXMeshPtr->SetMatrix(m_WorldMatrix, m_Camera.GetInverseViewMatrix(), m_Camera.GetProjectionMatrix());
         m_FireFXMeshPtr->SetPassIdx(m_UseAlphaBlending ? m_WithAlphaBlendingPassIdx : m_WithoutAlphaBlendingPassIdx);
+
+        // Software
+        UpdateSoftwareRenderer();
         
         Rotate(timerPtr->GetElapsed());
 #endif
@@ -487,6 +685,7 @@ namespace dae
 
         // 2. Set pipeline + invoke draw calls (= render)
         //=======================================================================================================
+        m_StateTrackerPtr->Invalidate();
         
         // --- WEEK 1 ---
 #if W1
@@ -509,7 +708,14 @@ namespace dae
         // --- WEEK 3 ---
 #elif W3
 #if TODO_0
-        Render_W3_TODO_0();
+        if (m_UseSoftwareRenderer)
+        {
+            Render_Software(clearColor);
+        }
+        else
+        {
+            Render_W3_TODO_0();
+        }
 #endif
 #endif
 
@@ -529,13 +735,15 @@ namespace dae
         m_SamplerState = static_cast<SamplerState>((static_cast<int>(m_SamplerState) + 1) % static_cast<int>(SamplerState::COUNT));
         UpdateSamplerStateString();
         
-        m_MeshPtr->SetPassIdx(static_cast<UINT>(m_SamplerState));
+        SelectVehiclePermutation();
     }
 
     void Renderer::CycleShadingMode()
     {
         m_ShadingMode = static_cast<ShadingMode>((static_cast<int>(m_ShadingMode) + 1) % static_cast<int>(ShadingMode::COUNT));
         UpdateShadingModeString();
+
+        SelectVehiclePermutation();
     }
 
     void Renderer::CycleCullMode()
@@ -566,6 +774,8 @@ namespace dae
         m_UseNormalMap = not m_UseNormalMap;
         std::string onOff = m_UseNormalMap ? "ON" : "OFF";
         std::cout << GREEN_TEXT("**(HARDWARE) NormalMap ") << MAGENTA_TEXT("" + onOff + "") << '\n';
+
+        SelectVehiclePermutation();
     }
 
     void Renderer::ToggleAlphaBlending()
@@ -709,6 +919,9 @@ namespace dae
             ImGui::Checkbox("F7: FireFX", &m_UseFireFX);
             ImGui::Checkbox("F8: Uniform ClearColor", &m_UseClearColor);
             ImGui::Checkbox("F9: FPS", &m_UseFPSCounter);
+            ImGui::Checkbox("Packed specular + glossiness map", &m_UsePackedMaps);
+            ImGui::Checkbox(("Vehicle crowd (" + std::to_string(m_UseSoftwareRenderer ? m_NumSoftwareVehicleInstances : m_NumVehicleInstances) + " instances)").c_str(),
+                            &m_UseVehicleCrowd);
         
             ImGui::Spacing();
             ImGui::Separator();
@@ -724,6 +937,140 @@ namespace dae
             ImGui::Separator();
             ImGui::Spacing();
 
+            if (m_TextureResidencyPtr)
+            {
+                if (ImGui::SliderInt("Texture budget (MiB)", &m_TextureBudgetMiB, 1, 64))
+                {
+                    m_TextureResidencyPtr->SetBudget(static_cast<size_t>(m_TextureBudgetMiB) << 20);
+                }
+
+                const ResidencyStats& stats = m_TextureResidencyPtr->GetStats();
+                const auto toMiB = [](size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+                ImGui::Text("Resident   : %.2f / %.2f MiB (peak %.2f), %.2f MiB requested", toMiB(stats.residentBytes), toMiB(stats.budgetBytes),
+                            toMiB(stats.peakBytes), toMiB(stats.requestedBytes));
+                ImGui::Text("Levels     : %d / %d in %d texture(s), %d pending", stats.residentLevels, stats.totalLevels, stats.textureCount, stats.pendingTextures);
+                ImGui::Text("Streaming  : %llu in, %llu evicted, %.2f MiB uploaded", static_cast<unsigned long long>(stats.levelsStreamedIn),
+                            static_cast<unsigned long long>(stats.levelsEvicted), toMiB(stats.bytesUploaded));
+
+                ImGui::Spacing();
+                ImGui::Separator();
+                ImGui::Spacing();
+            }
+
+            ImGui::Checkbox("Software rasterizer", &m_UseSoftwareRenderer);
+            if (m_SoftwareRendererPtr)
+            {
+                int rasterMode = static_cast<int>(m_SoftwareRendererPtr->GetRasterMode());
+                ImGui::RadioButton("Forward", &rasterMode, static_cast<int>(RasterMode::Forward));
+                ImGui::SameLine();
+                ImGui::RadioButton("Visibility buffer", &rasterMode, static_cast<int>(RasterMode::VisibilityBuffer));
+                m_SoftwareRendererPtr->SetRasterMode(static_cast<RasterMode>(rasterMode));
+
+                int transparencyMode = static_cast<int>(m_SoftwareRendererPtr->GetTransparencyMode());
+                ImGui::RadioButton("Unsorted", &transparencyMode, static_cast<int>(TransparencyMode::Unsorted));
+                ImGui::SameLine();
+                ImGui::RadioButton("Sorted", &transparencyMode, static_cast<int>(TransparencyMode::Sorted));
+                ImGui::SameLine();
+                ImGui::RadioButton("Weighted blended", &transparencyMode, static_cast<int>(TransparencyMode::WeightedBlended));
+                ImGui::SameLine();
+                ImGui::RadioButton("K-buffer", &transparencyMode, static_cast<int>(TransparencyMode::KBuffer));
+                m_SoftwareRendererPtr->SetTransparencyMode(static_cast<TransparencyMode>(transparencyMode));
+
+                ImGui::Checkbox("Fire stress scene", &m_UseFireStressScene);
+                ImGui::Checkbox("Pipelined frames (one frame latency)", &m_UseFramePipelining);
+                if (ImGui::Checkbox("Tiled texel layout", &m_UseTiledTexels))
+                {
+                    // Between frames, so no lookup is in flight while the chains are reordered
+                    const TexelLayout texelLayout = m_UseTiledTexels ? TexelLayout::Tiled : TexelLayout::Linear;
+                    for (Texture* texturePtr : {m_DiffuseTexturePtr, m_GlossinessTexturePtr, m_NormalTexturePtr, m_SpecularTexturePtr,
+                                                m_SpecularGlossinessTexturePtr, m_FireFXTexturePtr})
+                    {
+                        if (texturePtr) texturePtr->SetTexelLayout(texelLayout);
+                    }
+                }
+
+                if (m_VirtualVehicleSoftwareMeshIdx >= 0)
+                {
+                    ImGui::Checkbox("Virtual diffuse map", &m_UseVirtualDiffuseMap);
+                }
+
+                float guardBand = m_SoftwareRendererPtr->GetGuardBand();
+                if (ImGui::SliderFloat("Guard band", &guardBand, 1.0f, 32.0f))
+                {
+                    m_SoftwareRendererPtr->SetGuardBand(guardBand);
+                }
+
+                if (m_UseSoftwareRenderer)
+                {
+                    const SoftwareFrameStats& stats = m_SoftwareRendererPtr->GetFrameStats();
+                    ImGui::Text("Triangles  : %u / %u in %u instance(s), %u clipped", stats.trianglesRasterized, stats.trianglesSubmitted, stats.instancesSubmitted,
+                                stats.trianglesClipped);
+                    ImGui::Text("Fragments  : %llu passed, %llu shaded, %llu pixels", static_cast<unsigned long long>(stats.fragmentsPassed),
+                                static_cast<unsigned long long>(stats.fragmentsShaded), static_cast<unsigned long long>(stats.pixelsVisible));
+                    ImGui::Text("Map samples: %llu", static_cast<unsigned long long>(stats.mapSamples));
+                    ImGui::Text("Timings    : %.2f ms geometry, %.2f ms raster, %.2f ms shading", stats.geometryMs, stats.rasterMs, stats.shadingMs);
+                    ImGui::Text("Transparent: %u triangles, %llu fragments, %llu evicted, %.2f ms (%.2f ms sort)", stats.trianglesTransparent,
+                                static_cast<unsigned long long>(stats.transparentFragments), static_cast<unsigned long long>(stats.kBufferEvictions),
+                                stats.transparencyMs, stats.sortMs);
+
+                    if (m_UseVirtualDiffuseMap and m_VirtualTextureCachePtr)
+                    {
+                        const VirtualTextureStats& pageStats = m_VirtualTextureCachePtr->GetStats();
+                        ImGui::Text("Pages      : %d / %d resident, %.1f%% of %d hit, %d loaded, %d pending", pageStats.residentPages, pageStats.slotCount,
+                                    pageStats.hitRate * 100.0f, pageStats.requestedPages, pageStats.pagesLoaded, pageStats.pendingPages);
+                        ImGui::Text("Page loads : %.2f ms average latency, %.2f ms max, %d evicted, %d dropped", pageStats.averageLatencyMs, pageStats.maxLatencyMs,
+                                    pageStats.pagesEvicted, pageStats.pagesDropped);
+                    }
+                }
+
+                if (ImGui::Button("Raster mode benchmark"))
+                {
+                    Benchmark::RasterModes(*m_SoftwareRendererPtr, ColorRGB{m_BackgroundColor[0], m_BackgroundColor[1], m_BackgroundColor[2]});
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Clipper benchmark"))
+                {
+                    Benchmark::ClipperFlyThrough(*m_SoftwareRendererPtr, m_VehicleSoftwareMeshIdx, m_Camera.GetProjectionMatrix(),
+                                                 ColorRGB{m_BackgroundColor[0], m_BackgroundColor[1], m_BackgroundColor[2]});
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Transparency benchmark"))
+                {
+                    Benchmark::TransparencyModes(*m_SoftwareRendererPtr, ColorRGB{m_BackgroundColor[0], m_BackgroundColor[1], m_BackgroundColor[2]});
+                }
+                if (ImGui::Button("Frame pipelining benchmark"))
+                {
+                    Benchmark::FramePipelining(*m_SoftwareRendererPtr, m_VehicleSoftwareMeshIdx, m_Camera.GetInverseViewMatrix() * m_Camera.GetProjectionMatrix(),
+                                               ColorRGB{m_BackgroundColor[0], m_BackgroundColor[1], m_BackgroundColor[2]});
+                }
+                if (m_PackedVehicleSoftwareMeshIdx >= 0)
+                {
+                    ImGui::SameLine();
+                    if (ImGui::Button("Channel packing benchmark"))
+                    {
+                        Benchmark::ChannelPacking(*m_SoftwareRendererPtr, m_VehicleSoftwareMeshIdx, m_PackedVehicleSoftwareMeshIdx,
+                                                  m_Camera.GetInverseViewMatrix() * m_Camera.GetProjectionMatrix(),
+                                                  ColorRGB{m_BackgroundColor[0], m_BackgroundColor[1], m_BackgroundColor[2]});
+                    }
+                }
+                if (ImGui::Button("Instancing benchmark (software)"))
+                {
+                    Benchmark::SoftwareInstancing(*m_SoftwareRendererPtr, m_VehicleSoftwareMeshIdx, m_SoftwareVehicleInstances,
+                                                  m_Camera.GetInverseViewMatrix() * m_Camera.GetProjectionMatrix(),
+                                                  ColorRGB{m_BackgroundColor[0], m_BackgroundColor[1], m_BackgroundColor[2]});
+                }
+                if (m_VirtualVehicleSoftwareMeshIdx >= 0 and ImGui::Button("Virtual texturing benchmark"))
+                {
+                    Benchmark::VirtualTexturing(*m_SoftwareRendererPtr, *m_VirtualTextureCachePtr, m_VehicleSoftwareMeshIdx, m_VirtualVehicleSoftwareMeshIdx,
+                                                m_Camera.GetInverseViewMatrix() * m_Camera.GetProjectionMatrix(),
+                                                ColorRGB{m_BackgroundColor[0], m_BackgroundColor[1], m_BackgroundColor[2]});
+                }
+            }
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
             if (ImGui::Button("Take screenshot"))
             {
                 TakeScreenshot();
@@ -734,6 +1081,125 @@ namespace dae
                 m_TimerPtr->StartBenchmark();
             }
 
+            if (ImGui::Button("Sampler benchmark"))
+            {
+                Benchmark::SamplerThroughput(m_DiffuseTexturePtr);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Texel layout benchmark"))
+            {
+                Benchmark::TexelLayouts(m_DiffuseTexturePtr);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Mip generation benchmark"))
+            {
+                Benchmark::MipGeneration({m_DiffuseTexturePtr, m_NormalTexturePtr, m_SpecularTexturePtr, m_GlossinessTexturePtr});
+            }
+
+            if (ImGui::Button("Texture sampling benchmark"))
+            {
+                Benchmark::TextureSampling(m_DiffuseTexturePtr);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Block compression benchmark"))
+            {
+                Benchmark::BlockCompression({{m_DiffuseTexturePtr,    BlockFormat::BC1},
+                                             {m_DiffuseTexturePtr,    BlockFormat::BC7},
+                                             {m_NormalTexturePtr,     BlockFormat::BC5},
+                                             {m_SpecularTexturePtr,   BlockFormat::BC1},
+                                             {m_GlossinessTexturePtr, BlockFormat::BC4}});
+            }
+
+            if (ImGui::Button("Bake textures"))
+            {
+                BakeTextures();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Texture loading benchmark"))
+            {
+                Benchmark::TextureLoading(m_DevicePtr, {m_DiffuseTextureAsset, m_GlossinessTextureAsset, m_NormalTextureAsset, m_SpecularTextureAsset,
+                                                        m_SpecularGlossinessTextureAsset, m_FireFXTextureAsset});
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("PNG decoding benchmark"))
+            {
+                Benchmark::PngDecoding(m_ResourcesPath);
+            }
+
+            if (ImGui::Button("Texture streaming benchmark"))
+            {
+                Benchmark::TextureStreaming(m_DevicePtr, {m_DiffuseTextureAsset, m_GlossinessTextureAsset, m_NormalTextureAsset, m_SpecularTextureAsset,
+                                                          m_SpecularGlossinessTextureAsset, m_FireFXTextureAsset});
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Atlas packing benchmark"))
+            {
+                Benchmark::AtlasPacking();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Render queue benchmark"))
+            {
+                Benchmark::RenderQueueSorting();
+            }
+            if (ImGui::Button("Instancing benchmark"))
+            {
+                Benchmark::HardwareInstancing(m_DeviceContextPtr, *m_MeshPtr, *m_StateTrackerPtr, m_VehicleInstances, m_Camera.GetInverseViewMatrix(),
+                                              m_Camera.GetProjectionMatrix());
+            }
+            ImGui::Text("FireFX diffuse map: %s", m_FireFXAtlasPagePath.empty() ? "own texture" : m_FireFXAtlasPagePath.c_str());
+
+            const EffectCacheStats effectCacheStats = Effect::GetCacheStats();
+            ImGui::Text("Effect cache: %llu hit(s), %llu compiled, %llu invalidated", static_cast<unsigned long long>(effectCacheStats.hits),
+                        static_cast<unsigned long long>(effectCacheStats.misses), static_cast<unsigned long long>(effectCacheStats.invalidations));
+
+            const EffectRegistryStats effectRegistryStats = Effect::GetRegistryStats();
+            ImGui::Text("Effects: %d shared by %d mesh(es), %llu of %llu lookup(s) reflected", effectRegistryStats.effectCount, effectRegistryStats.referenceCount,
+                        static_cast<unsigned long long>(effectRegistryStats.reflectionLookups),
+                        static_cast<unsigned long long>(effectRegistryStats.reflectionLookups + effectRegistryStats.cachedLookups));
+
+            const ParameterUploadStats parameterStats = Effect::GetParameterStats();
+            ImGui::Text("Parameter blocks: %llu upload(s) in %llu apply(s), %llu field(s), %llu byte(s)", static_cast<unsigned long long>(parameterStats.uploads),
+                        static_cast<unsigned long long>(parameterStats.applies), static_cast<unsigned long long>(parameterStats.uploadedFields),
+                        static_cast<unsigned long long>(parameterStats.uploadedBytes));
+
+            if (m_ShaderPermutationsPtr)
+            {
+                const PermutationStats& permutationStats = m_ShaderPermutationsPtr->GetStats();
+                ImGui::Text("Shader variants: %d alive, %llu acquired, %llu evicted, %llu not in the manifest", permutationStats.variantCount,
+                            static_cast<unsigned long long>(permutationStats.compiles), static_cast<unsigned long long>(permutationStats.evictions),
+                            static_cast<unsigned long long>(permutationStats.unlisted));
+            }
+
+            const RenderQueueStats& renderQueueStats = m_RenderQueuePtr->GetStats();
+            ImGui::Text("Render queue: %llu packet(s), %llu geometry, %llu material and %llu pass bind(s), %llu skipped",
+                        static_cast<unsigned long long>(renderQueueStats.packets), static_cast<unsigned long long>(renderQueueStats.geometryBinds),
+                        static_cast<unsigned long long>(renderQueueStats.materialBinds), static_cast<unsigned long long>(renderQueueStats.passBinds),
+                        static_cast<unsigned long long>(renderQueueStats.skippedBinds));
+
+            const PipelineStateStats& pipelineStats = m_StateTrackerPtr->GetStats();
+            const PipelineSlotStats   pipelineTotal = pipelineStats.GetTotal();
+            ImGui::Text("Pipeline state: %llu of %llu bind(s) filtered, %llu of them pass apply(s), %llu draw(s) of %llu instance(s)",
+                        static_cast<unsigned long long>(pipelineTotal.filtered), static_cast<unsigned long long>(pipelineTotal.issued + pipelineTotal.filtered),
+                        static_cast<unsigned long long>(pipelineStats[PipelineSlot::EffectPass].filtered), static_cast<unsigned long long>(pipelineStats.draws),
+                        static_cast<unsigned long long>(pipelineStats.instances));
+
+            const StateCacheStats& stateCacheStats = m_StateObjectsPtr->GetStats();
+            ImGui::Text("State objects: %d rasterizer, %d blend, %d depth-stencil, %d sampler, %llu of %llu lookup(s) hit, %llu created late",
+                        stateCacheStats.objectCounts[static_cast<size_t>(StateObjectType::Rasterizer)],
+                        stateCacheStats.objectCounts[static_cast<size_t>(StateObjectType::Blend)],
+                        stateCacheStats.objectCounts[static_cast<size_t>(StateObjectType::DepthStencil)],
+                        stateCacheStats.objectCounts[static_cast<size_t>(StateObjectType::Sampler)],
+                        static_cast<unsigned long long>(stateCacheStats.hits), static_cast<unsigned long long>(stateCacheStats.lookups),
+                        static_cast<unsigned long long>(stateCacheStats.lateCreations));
+
+            if (m_EffectHotReloadPtr)
+            {
+                const EffectReloadStats reloadStats = m_EffectHotReloadPtr->GetStats();
+                ImGui::Text("Hot reload: %d effect(s) watched, %llu compiled, %llu reloaded, %llu failed", reloadStats.watchedCount,
+                            static_cast<unsigned long long>(reloadStats.compiles), static_cast<unsigned long long>(reloadStats.reloads),
+                            static_cast<unsigned long long>(reloadStats.failures));
+            }
+
             if (m_UseFPSCounter)
             {
                 ImGui::Spacing();
@@ -831,6 +1297,146 @@ namespace dae
         }
         std::cout << GREEN_TEXT("**(HARDWARE) FillMode = ") << MAGENTA_TEXT("" + m_FillModeString + "") << '\n';
     }
+
+    void Renderer::UpdateSoftwareRenderer()
+    {
+        if (not m_SoftwareRendererPtr) return;
+
+        ShadingParameters parameters{};
+        parameters.cameraPosition = m_Camera.GetPosition();
+        parameters.lightDirection = Vector3{m_LightDirection[0], m_LightDirection[1], m_LightDirection[2]};
+        parameters.ambient        = ColorRGB{m_Ambient[0], m_Ambient[1], m_Ambient[2]};
+        parameters.lightIntensity = m_LightIntensity;
+        parameters.kd             = m_KD;
+        parameters.shininess      = m_Shininess;
+        parameters.shadingMode    = m_ShadingMode;
+        parameters.useNormalMap   = m_UseNormalMap;
+
+        m_SoftwareRendererPtr->SetShadingParameters(parameters);
+        m_SoftwareRendererPtr->SetSamplerState(m_SamplerState);
+        m_SoftwareRendererPtr->SetCullMode(m_CullMode, m_UseFrontCounterClockwise);
+
+        // The last frame is done sampling, so its feedback can become page requests and finished pages can enter the page table
+        if (m_VirtualTextureCachePtr) m_VirtualTextureCachePtr->Update();
+
+        // Same world matrix as the hardware meshes
+        const Matrix& worldMatrix = m_WorldMatrix;
+
+        // Transparent meshes go last, like the draw order in Render_W3_TODO_0()
+        m_SoftwareRendererPtr->BeginFrame(m_Camera.GetInverseViewMatrix() * m_Camera.GetProjectionMatrix());
+        int vehicleMeshIdx = m_UsePackedMaps and m_PackedVehicleSoftwareMeshIdx >= 0 ? m_PackedVehicleSoftwareMeshIdx : m_VehicleSoftwareMeshIdx;
+        if (m_UseVirtualDiffuseMap and m_VirtualVehicleSoftwareMeshIdx >= 0) vehicleMeshIdx = m_VirtualVehicleSoftwareMeshIdx;
+        if (m_UseVehicleCrowd) m_SoftwareRendererPtr->SubmitInstanced(vehicleMeshIdx, m_SoftwareVehicleInstances, worldMatrix);
+        else                   m_SoftwareRendererPtr->Submit(vehicleMeshIdx, worldMatrix);
+        if (m_UseFireFX          and m_FireFXSoftwareMeshIdx     >= 0) m_SoftwareRendererPtr->Submit(m_FireFXSoftwareMeshIdx,     worldMatrix);
+        if (m_UseFireStressScene and m_FireStressSoftwareMeshIdx >= 0) m_SoftwareRendererPtr->Submit(m_FireStressSoftwareMeshIdx, worldMatrix);
+    }
+
+    void Renderer::UpdateTextureResidency()
+    {
+        if (not m_TextureResidencyPtr) return;
+
+        // Only what the hardware path draws this frame is requested, everything else ages towards eviction
+        if (not m_UseSoftwareRenderer)
+        {
+            std::vector<const Texture*> vehicleTexturePtrs{m_DiffuseTexturePtr};
+            if (m_UseNormalMap) vehicleTexturePtrs.push_back(m_NormalTexturePtr);
+            if (m_UsePackedMaps and m_SpecularGlossinessTexturePtr)
+            {
+                vehicleTexturePtrs.push_back(m_SpecularGlossinessTexturePtr);
+            }
+            else
+            {
+                vehicleTexturePtrs.push_back(m_SpecularTexturePtr);
+                vehicleTexturePtrs.push_back(m_GlossinessTexturePtr);
+            }
+
+            for (const Texture* texturePtr : vehicleTexturePtrs)
+            {
+                m_TextureResidencyPtr->RequestLevel(texturePtr, EstimateMipLevel(texturePtr, m_VehicleRadius));
+            }
+            if (m_UseFireFX) m_TextureResidencyPtr->RequestLevel(m_FireFXTexturePtr, EstimateMipLevel(m_FireFXTexturePtr, m_FireFXRadius));
+        }
+
+        // The effect variables still point at the views that were replaced
+        if (m_TextureResidencyPtr->Update())
+        {
+            m_MeshPtr->SetDiffuseMap(m_DiffuseTexturePtr);
+            m_MeshPtr->SetNormalMap(m_NormalTexturePtr);
+            m_MeshPtr->SetSpecularMap(m_SpecularTexturePtr);
+            m_MeshPtr->SetGlossinessMap(m_GlossinessTexturePtr);
+            m_MeshPtr->SetSpecularGlossinessMap(m_SpecularGlossinessTexturePtr);
+            m_FireFXMeshPtr->SetDiffuseMap(m_FireFXTexturePtr);
+        }
+    }
+
+    void Renderer::SelectVehiclePermutation()
+    {
+        if (not m_ShaderPermutationsPtr or not m_MeshPtr) return;
+
+        const ShaderPermutation permutation{static_cast<int>(m_ShadingMode), m_UseNormalMap, static_cast<int>(m_SamplerState)};
+        if (permutation.GetKey() == m_VehiclePermutationKey) return;
+
+        // A variant that does not compile leaves the vehicle on the one it has, and is not tried again until the settings change
+        m_VehiclePermutationKey = permutation.GetKey();
+        if (m_MeshPtr->SetEffect(m_ShaderPermutationsPtr->Select(permutation)))
+        {
+            std::cout << GREEN_TEXT("**(HARDWARE) Shader Variant = ") << MAGENTA_TEXT("" + permutation.ToString() + "") << '\n';
+        }
+    }
+
+    float Renderer::EstimateMipLevel(const Texture* texturePtr, float radius) const
+    {
+        if (not texturePtr or texturePtr->GetMipChain().IsEmpty()) return 0.0f;
+
+        // Inside the sphere every level can show up
+        const float distance = m_Camera.GetPosition().Magnitude();
+        if (distance <= radius) return 0.0f;
+
+        // The texture is assumed to cover the diameter once. UV islands are stretched over less than that and anisotropic
+        // filtering reads finer levels at grazing angles, so one level finer is asked for
+        const float diameterPixels = radius / (distance * m_Camera.GetFOV()) * static_cast<float>(m_Height);
+        const float texels         = static_cast<float>(std::max(texturePtr->GetMipChain().levels[0].width, texturePtr->GetMipChain().levels[0].height));
+        return std::log2(texels / std::max(diameterPixels, 1.0f)) - 1.0f;
+    }
+
+    void Renderer::BakeTextures() const
+    {
+        for (const TextureAsset* assetPtr : {&m_DiffuseTextureAsset, &m_GlossinessTextureAsset, &m_NormalTextureAsset, &m_SpecularTextureAsset,
+                                             &m_SpecularGlossinessTextureAsset, &m_FireFXTextureAsset})
+        {
+            TextureContainer::Convert(*assetPtr);
+        }
+
+        // The small textures share pages, the fire draws from its page after the next start
+        TextureAtlas atlas{};
+        if (atlas.Build({m_FireFXTextureAsset, m_UVGrid2TextureAsset})) atlas.Write(m_AtlasTablePath);
+    }
+
+    Texture* Renderer::LoadTexture(const TextureAsset& asset) const
+    {
+        // A container older than one of its images is stale, decoding the images is slower but never wrong
+        const std::string containerPath = TextureContainer::GetContainerPath(asset);
+
+        std::error_code error{};
+        bool isBaked = std::filesystem::exists(containerPath, error)
+                   and std::filesystem::last_write_time(containerPath, error) >= std::filesystem::last_write_time(asset.path, error) and not error;
+        if (isBaked and not asset.alphaPath.empty())
+        {
+            isBaked = std::filesystem::last_write_time(containerPath, error) >= std::filesystem::last_write_time(asset.alphaPath, error) and not error;
+        }
+
+        if (isBaked)
+        {
+            if (m_TextureResidencyPtr)
+            {
+                if (Texture* texturePtr = m_TextureResidencyPtr->Load(containerPath)) return texturePtr;
+            }
+            if (Texture* texturePtr = Texture::LoadFromFile(containerPath, m_DevicePtr)) return texturePtr;
+        }
+        if (not asset.alphaPath.empty()) return Texture::LoadPacked(asset.path, asset.alphaPath, m_DevicePtr, asset.mipSettings, asset.compressionSettings);
+        return Texture::LoadFromFile(asset.path, m_DevicePtr, asset.mipSettings, asset.compressionSettings);
+    }
 #pragma endregion
 
 #pragma region Debug
@@ -887,8 +1493,46 @@ namespace dae
 #pragma region Week 3
     void Renderer::Render_W3_TODO_0() const
     {
-        m_MeshPtr->Render();
-        if (m_UseFireFX) m_FireFXMeshPtr->Render();
+        // Geometry and material ids, each mesh has its own of both
+        enum RenderId : uint16_t
+        {
+            VehicleId,
+            FireFXId
+        };
+
+        // Both meshes sit at the origin. Without alpha blending the fire writes depth like the vehicle does
+        const float depth = m_Camera.GetPosition().Magnitude();
+
+        m_RenderQueuePtr->Clear();
+        m_RenderQueuePtr->Add({m_MeshPtr, VehicleId, VehicleId, static_cast<uint8_t>(m_MeshPtr->GetPassIdx()), RenderLayer::Opaque, depth});
+        if (m_UseFireFX)
+        {
+            m_RenderQueuePtr->Add({m_FireFXMeshPtr, FireFXId, FireFXId, static_cast<uint8_t>(m_FireFXMeshPtr->GetPassIdx()),
+                                   m_UseAlphaBlending ? RenderLayer::Transparent : RenderLayer::Opaque, depth});
+        }
+        m_RenderQueuePtr->Sort();
+
+        MeshRenderBackend backend{};
+        m_RenderQueuePtr->Submit(backend);
+    }
+#pragma endregion
+
+#pragma region Software
+    void Renderer::Render_Software(const float* clearColor) const
+    {
+        // Pipelined frames show the previous submission while the geometry of the current one is processed
+        if (m_UseFramePipelining)
+        {
+            m_SoftwareRendererPtr->RenderPipelined(ColorRGB{clearColor[0], clearColor[1], clearColor[2]});
+        }
+        else
+        {
+            m_SoftwareRendererPtr->Render(ColorRGB{clearColor[0], clearColor[1], clearColor[2]});
+        }
+
+        // Copy the CPU image into the back buffer, the UI is drawn on top of it afterwards
+        const std::vector<uint32_t>& colorBuffer = m_SoftwareRendererPtr->GetColorBuffer();
+        m_DeviceContextPtr->UpdateSubresource(m_RenderTargetBufferPtr, 0, nullptr, colorBuffer.data(), m_Width * sizeof(uint32_t), 0);
     }
 #pragma endregion
 }
@@ -2,7 +2,9 @@
 
 // Project includes
 #include "Camera.h"
+#include "SamplerState.h"
 #include "SceneSelector.h"
+#include "TextureContainer.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -11,19 +13,20 @@ namespace dae
 {
     // Forward declarations
     struct Vertex;
+    class  D3DStateObjects;
+    class  EffectHotReload;
     class  Texture;
     class  Mesh;
+    class  ParameterBlock;
+    class  PipelineStateTracker;
+    class  RenderQueue;
+    class  ShaderPermutationCache;
+    class  SoftwareRenderer;
+    class  TextureResidency;
+    class  VirtualTexture;
+    class  VirtualTextureCache;
 
 #pragma region Enums
-    enum class SamplerState
-    {
-        Point,
-        Linear,
-        Anisotropic,
-
-        COUNT
-    };
-    
     enum class ShadingMode
     {
         ObservedArea, // Lambert Cosine Law
@@ -93,12 +96,24 @@ namespace dae
         void InitializeMesh();
         void InitializeTextures();
         void InitializeObjects();
+        void InitializeSoftwareRenderer();
 
         // Helper functions
         void UpdateSamplerStateString();
         void UpdateShadingModeString();
         void UpdateCullModeString();
         void UpdateFillModeString();
+        void UpdateSoftwareRenderer();
+        void UpdateTextureResidency();
+        // Switches the vehicle to the shader variant of the current shading mode, normal map and sampler
+        void SelectVehiclePermutation();
+        void BakeTextures() const;
+
+        // Finest level the hardware sampler picks for a texture stretched over a bounding sphere around the origin, from its size on screen
+        float EstimateMipLevel(const Texture* texturePtr, float radius) const;
+
+        // Loads the baked container next to the image when it is at least as new as the image, streamed when there is a residency manager
+        Texture* LoadTexture(const TextureAsset& asset) const;
 
         // UI
         void CreateUI();
@@ -118,6 +133,9 @@ namespace dae
         
         // --- Week 3 ---
         void Render_W3_TODO_0() const;
+
+        // --- Software ---
+        void Render_Software(const float* clearColor) const;
        
         // DIRECTX
         HRESULT InitializeDirectX();
@@ -145,6 +163,39 @@ namespace dae
         Camera m_Camera {};
         Mesh*  m_MeshPtr       = nullptr;
         Mesh*  m_FireFXMeshPtr = nullptr;
+
+        // Draws of the frame, sorted by state and depth before they are submitted
+        RenderQueue*          m_RenderQueuePtr   = nullptr;
+        // What the meshes bound last, invalidated every frame because the UI binds past it
+        PipelineStateTracker* m_StateTrackerPtr  = nullptr;
+        // Every rasterizer state the fill and cull modes cycle through, created once up front
+        D3DStateObjects*      m_StateObjectsPtr  = nullptr;
+
+        // Camera, time and lights, every mesh uploads it to the cbFrame of its effect when it changed
+        ParameterBlock* m_FrameParametersPtr = nullptr;
+
+        // Variants of the vehicle effect, one per shading mode, normal map and sampler
+        ShaderPermutationCache* m_ShaderPermutationsPtr = nullptr;
+        uint32_t                m_VehiclePermutationKey = UINT32_MAX; // ShaderPermutation::GetKey() of the variant the vehicle draws with
+
+        // Recompiles edited .fx files in the background, swapped in at the start of Update()
+        EffectHotReload* m_EffectHotReloadPtr = nullptr;
+
+        // CPU rasterizer, its image replaces the hardware one when enabled
+        SoftwareRenderer* m_SoftwareRendererPtr           = nullptr;
+        int               m_VehicleSoftwareMeshIdx        = -1;
+        int               m_PackedVehicleSoftwareMeshIdx  = -1; // Same geometry, specular and glossiness from one packed map
+        int               m_VirtualVehicleSoftwareMeshIdx = -1; // Same geometry, diffuse map paged through m_VirtualTextureCachePtr
+        int               m_FireFXSoftwareMeshIdx         = -1;
+        int               m_FireStressSoftwareMeshIdx     = -1; // Thousands of overlapping fire quads to stress the transparency modes
+        const int         m_NumFireStressQuads            = 4096;
+
+        // Copies of the vehicle on a grid, one DrawIndexedInstanced on the GPU and one SubmitInstanced() on the CPU. The software renderer
+        // shades every vertex of every instance into its frame, so it gets a smaller grid: ten thousand vehicles would take gigabytes
+        std::vector<Matrix> m_VehicleInstances            {};
+        std::vector<Matrix> m_SoftwareVehicleInstances    {};
+        const int           m_NumVehicleInstances         = 10000;
+        const int           m_NumSoftwareVehicleInstances = 64;
         
         // Path
 #if CUSTOM_PATH
@@ -158,6 +209,19 @@ namespace dae
         const std::string m_SpecularTexturePath   = m_ResourcesPath + "vehicle_specular.png";
         const std::string m_UVGrid2TexturePath    = m_ResourcesPath + "uv_grid_2.png";
         const std::string m_FireFXTexturePath     = m_ResourcesPath + "fireFX_diffuse.png";
+        const std::string m_VirtualDiffusePath    = m_ResourcesPath + "vehicle_diffuse.vtex";
+        const std::string m_AtlasTablePath        = m_ResourcesPath + "small_textures.atlas";
+        const std::string m_PermutationsPath      = m_ResourcesPath + "PosCol3D_W3_TODO_0.permutations";
+
+        // Normals and glossiness are data, averaging them in linear light would skew them. The specular map is colored, so BC1 rather than BC4.
+        // The packed map carries glossiness in alpha, which the MipGenerator always filters linearly, and needs BC7 because BC1 has no alpha
+        const TextureAsset m_DiffuseTextureAsset            {m_DiffuseTexturePath,    MipSettings{},                         CompressionSettings{BlockFormat::BC7}};
+        const TextureAsset m_GlossinessTextureAsset         {m_GlossinessTexturePath, MipSettings{MipFilter::Kaiser, false}, CompressionSettings{BlockFormat::BC4}};
+        const TextureAsset m_NormalTextureAsset             {m_NormalTexturePath,     MipSettings{MipFilter::Kaiser, false}, CompressionSettings{BlockFormat::BC5}};
+        const TextureAsset m_SpecularTextureAsset           {m_SpecularTexturePath,   MipSettings{},                         CompressionSettings{BlockFormat::BC1}};
+        const TextureAsset m_SpecularGlossinessTextureAsset {m_SpecularTexturePath,   MipSettings{},                         CompressionSettings{BlockFormat::BC7}, m_GlossinessTexturePath};
+        const TextureAsset m_FireFXTextureAsset             {m_FireFXTexturePath};
+        const TextureAsset m_UVGrid2TextureAsset            {m_UVGrid2TexturePath};
         
         const std::string m_VehiclePath           = m_ResourcesPath + "vehicle.obj";
         const std::string m_FireFXPath            = m_ResourcesPath + "fireFX.obj";
@@ -166,13 +230,29 @@ namespace dae
         Texture* m_TexturePtr = nullptr;
 
         // Vehicle
-        Texture* m_DiffuseTexturePtr    = nullptr;
-        Texture* m_GlossinessTexturePtr = nullptr;
-        Texture* m_NormalTexturePtr     = nullptr;
-        Texture* m_SpecularTexturePtr   = nullptr;
+        Texture* m_DiffuseTexturePtr            = nullptr;
+        Texture* m_GlossinessTexturePtr         = nullptr;
+        Texture* m_NormalTexturePtr             = nullptr;
+        Texture* m_SpecularTexturePtr           = nullptr;
+        Texture* m_SpecularGlossinessTexturePtr = nullptr; // Specular RGB with glossiness in alpha
 
         // FireFX
-        Texture* m_FireFXTexturePtr = nullptr;
+        Texture*    m_FireFXTexturePtr    = nullptr;
+        std::string m_FireFXAtlasPagePath {}; // Empty while the fire draws with a texture of its own
+
+        // Baked textures stream their finer GPU levels in on demand, images that still need decoding stay fully resident
+        TextureResidency* m_TextureResidencyPtr = nullptr;
+        int               m_TextureBudgetMiB    = 16;
+
+        // Pages of the diffuse map the software rasterizer sampled in the last frames, read from the .vtex file by worker threads.
+        // Fewer slots than the 84 pages of the 1024x1024 map, so a close-up has to evict
+        VirtualTextureCache*  m_VirtualTextureCachePtr   = nullptr;
+        const VirtualTexture* m_VirtualDiffuseTexturePtr = nullptr;
+        const int             m_NumVirtualTextureSlots   = 64;
+
+        // Bounding spheres around the origin, for the mip levels the residency manager is asked for
+        float m_VehicleRadius = 0.0f;
+        float m_FireFXRadius  = 0.0f;
 
         // Enums
         SamplerState m_SamplerState = SamplerState::Point;
@@ -185,7 +265,8 @@ namespace dae
         std::string m_CullModeString     = "NONE";
         std::string m_FillModeString     = "SOLID";
 
-        float m_AccTime = 0.0f;
+        float  m_AccTime     = 0.0f;
+        Matrix m_WorldMatrix {}; // The spin of every mesh at m_AccTime, built once per frame and shared by both backends
         
         // Debug
         bool m_Rotate                   = true;
@@ -195,13 +276,20 @@ namespace dae
         bool m_UseClearColor            = false;
         bool m_UseFPSCounter            = false;
         bool m_UseFrontCounterClockwise = false;
+        bool m_UseSoftwareRenderer      = false;
+        bool m_UseFireStressScene       = false;
+        bool m_UseFramePipelining       = false;
+        bool m_UsePackedMaps            = false;
+        bool m_UseTiledTexels           = false;
+        bool m_UseVirtualDiffuseMap     = false;
+        bool m_UseVehicleCrowd          = false;
 
         // UI
         bool m_ShowUI = true;
 
-        // Passes
-        UINT m_WithAlphaBlendingPassIdx    = 3;
-        UINT m_WithoutAlphaBlendingPassIdx = 4;
+        // Passes, the vehicle draws with P0 of every variant
+        UINT m_WithAlphaBlendingPassIdx    = 1;
+        UINT m_WithoutAlphaBlendingPassIdx = 2;
 
         // Lighting
         float m_Ambient[3]        = {0.03f, 0.03f, 0.03f};
@@ -1,27 +1,53 @@
 //-----------------------------------------------------------------------------
 // Global Variables
 //-----------------------------------------------------------------------------
-float4x4  gWorldViewProj  : WorldViewProjection;
+// One buffer per update frequency, Mesh uploads each in one go when it changed. Same order as the parameter blocks
+cbuffer cbFrame
+{
+    float3    gCameraPos      : CameraPos;
+    float3    gAmbientColor   : AmbientColor;
+    float3    gLightDir       : LightDir;
+    float     gLightIntensity : LightIntensity;
+};
+
+// Both built on the CPU once per object, the vertex shaders no longer rebuild the rotation from the time for every vertex
+cbuffer cbObject
+{
+    row_major float4x4 gWorldViewProj : WorldViewProjection;
+    row_major float4x4 gWorld         : World;
+};
+
+cbuffer cbMaterial
+{
+    float     gKD             : KD;
+    float     gShininess      : Shininess;
+};
 
 Texture2D gDiffuseMap     : DiffuseMap;
 Texture2D gNormalMap      : NormalMap;
 Texture2D gSpecularMap    : SpecularMap;
 Texture2D gGlossMap       : GlossMap;
 
-float     gTime           : Time;
-float3    gCameraPos      : CameraPos;
-bool      gUseNormalMap   : UseNormalMap;
-int       gShadingMode    : ShadingMode;
+// Specular RGB with glossiness in alpha, replaces gSpecularMap and gGlossMap in PackedTechnique
+Texture2D gSpecularGlossMap : SpecularGlossMap;
+
+//-----------------------------------------------------------------------------
+// Permutation defines: every variant is compiled on its own, the renderer selects one instead of setting uniforms.
+// Without defines this is the combined, normal mapped, point sampled variant
+//-----------------------------------------------------------------------------
+#ifndef SHADING_MODE
+#define SHADING_MODE 3   // 0 = observed area, 1 = diffuse, 2 = specular, 3 = combined
+#endif
 
-float3    gAmbientColor   : AmbientColor;
-float3    gLightDir       : LightDir;
-float     gLightIntensity : LightIntensity;
-float     gKD             : KD;
-float     gShininess      : Shininess;
+#ifndef USE_NORMAL_MAP
+#define USE_NORMAL_MAP 1
+#endif
+
+#ifndef SAMPLER_KIND
+#define SAMPLER_KIND 0   // 0 = point, 1 = linear, 2 = anisotropic
+#endif
 
 #define PI 3.1415926535897932384626433832795
-#define DEG_TO_RAD 0.01745329251994329576923690768489
-#define ROTATION_ANGLE -45.0f 
 
 //---------------------------------------------------------------------------
 // Sampler States: https://learn.microsoft.com/en-us/windows/win32/api/d3d11/ns-d3d11-d3d11_sampler_desc
@@ -47,6 +73,15 @@ SamplerState samAnisotropic
     AddressV = WRAP;
 };
 
+// The vehicle samples every map with the sampler of its variant
+#if SAMPLER_KIND == 0
+#define samVehicle samPoint
+#elif SAMPLER_KIND == 1
+#define samVehicle samLinear
+#else
+#define samVehicle samAnisotropic
+#endif
+
 //---------------------------------------------------------------------------
 // Blending States: https://learn.microsoft.com/en-us/windows/win32/api/d3d11/ns-d3d11-d3d11_render_target_blend_desc
 //---------------------------------------------------------------------------
@@ -106,24 +141,9 @@ DepthStencilState gNoDepthStencilState
 //---------------------------------------------------------------------------
 // Helper Functions
 //---------------------------------------------------------------------------
-float4x4 CreateRotationMatrix(float yaw)
-{
-    float4x4 rotation = (float4x4)0;
-    
-    rotation[0][0] = cos(yaw);
-    rotation[0][2] = sin(yaw);
-    rotation[1][1] = 1.0f;
-    rotation[2][0] = -sin(yaw);
-    rotation[2][2] = cos(yaw);
-    rotation[3][3] = 1.0f;
-    
-    return rotation;
-}
-
 float4 ShadePixel(float3 normal, float3 tangent, float3 viewDir, float3 diffuseColor, float3 normalColor, float3 specularColor, float gloss)
 {
-    float3 color = (float3)0;
-    
+#if USE_NORMAL_MAP
     // Binormal
     float3 binormal = cross(normal, tangent);
     
@@ -133,18 +153,22 @@ float4 ShadePixel(float3 normal, float3 tangent, float3 viewDir, float3 diffuseC
     // Remap normal from [0, 1] to [-1, 1]
     normalColor = normalColor * 2.0f - 1.0f;
     
+    // BC5 only stores X and Y, Z of a unit tangent-space normal always points out of the surface
+    normalColor.z = sqrt(saturate(1.0f - dot(normalColor.xy, normalColor.xy)));
+    
     // Transform normal from tangent-space to world-space
-    normal = gUseNormalMap ? mul(normalColor, tangentSpace) : normal;
+    normal = mul(normalColor, tangentSpace);
+#endif
     
     // Light direction
     float3 lightDir = normalize(gLightDir);
     
-    // Radiance (directional light)
-    float3 radiance = float3(1.0f, 1.0f, 1.0f) * gLightIntensity;
-    
     // Observed area
     float3 observedArea = saturate(dot(normal, -lightDir));
     
+#if SHADING_MODE == 0
+    float3 color = observedArea;
+#else
     // Diffuse lighting
     float3 diffuse = diffuseColor * gKD / PI;
     
@@ -153,22 +177,17 @@ float4 ShadePixel(float3 normal, float3 tangent, float3 viewDir, float3 diffuseC
     float cosAlpha        = saturate(dot(reflectedLight, -viewDir));
     float3 phong          = specularColor * pow(cosAlpha, gloss * gShininess);
     
-    if (gShadingMode == 0)
-    {
-        color = observedArea;
-    } 
-    else if (gShadingMode == 1)
-    {
-        color = diffuse * observedArea;
-    }
-    else if (gShadingMode == 2)
-    {
-        color = phong * observedArea;
-    }
-    else
-    {
-        color = radiance * (diffuse + phong + gAmbientColor) * observedArea;
-    }
+#if SHADING_MODE == 1
+    float3 color = diffuse * observedArea;
+#elif SHADING_MODE == 2
+    float3 color = phong * observedArea;
+#else
+    // Radiance (directional light)
+    float3 radiance = float3(1.0f, 1.0f, 1.0f) * gLightIntensity;
+    
+    float3 color = radiance * (diffuse + phong + gAmbientColor) * observedArea;
+#endif
+#endif
     return float4(color, 1.0f);
 }
 
@@ -184,6 +203,20 @@ struct VS_INPUT
     float3 Tangent  : TANGENT;
 };
 
+// InstancedTechnique: the vertex in slot 0, the instance in slot 1. The rows of its world matrix without the constant last column, 48 bytes instead of 64
+struct VS_INSTANCE_INPUT
+{
+    float3 Position    : POSITION;
+    float3 Color       : COLOR;
+    float2 Uv          : TEXCOORD;
+    float3 Normal      : NORMAL;
+    float3 Tangent     : TANGENT;
+    float3 AxisX       : WORLD0;
+    float3 AxisY       : WORLD1;
+    float3 AxisZ       : WORLD2;
+    float3 Translation : WORLD3;
+};
+
 struct VS_OUTPUT
 {
     float4 Position : SV_POSITION; // SV_POSITION is equivalent to SV_POSITION0
@@ -200,72 +233,77 @@ VS_OUTPUT VS(VS_INPUT input)
 {
     VS_OUTPUT output = (VS_OUTPUT)0;
     
-    //-----------------------------------------------------------------------
-    float4x4 rotationMatrix = CreateRotationMatrix(ROTATION_ANGLE * DEG_TO_RAD * gTime);
-    float4x4 resultMatrix   = mul(rotationMatrix, gWorldViewProj);
-    //-----------------------------------------------------------------------
-    
-    output.Position = mul(float4(input.Position, 1.0f), resultMatrix);
-    output.Normal   = mul(input.Normal, (float3x3) rotationMatrix);
-    output.Tangent  = mul(input.Tangent, (float3x3) rotationMatrix);
+    output.Position = mul(float4(input.Position, 1.0f), gWorldViewProj);
+    output.Normal   = mul(input.Normal, (float3x3) gWorld);
+    output.Tangent  = mul(input.Tangent, (float3x3) gWorld);
     output.Color    = input.Color;
     output.Uv       = input.Uv;
 
     return output;
 }
 
-VS_OUTPUT VS_FireFX(VS_INPUT input)
+// gWorldViewProj only holds the view projection here, every instance brings its own world matrix. Rigid or uniformly scaled
+VS_OUTPUT VS_Instanced(VS_INSTANCE_INPUT input)
 {
     VS_OUTPUT output = (VS_OUTPUT)0;
     
     //-----------------------------------------------------------------------
-    float4x4 rotationMatrix = CreateRotationMatrix(ROTATION_ANGLE * DEG_TO_RAD * gTime);
-    float4x4 resultMatrix   = mul(rotationMatrix, gWorldViewProj);
+    // Every instance spins around its own origin with the rotation of gWorld, then its world matrix places it
+    float3x3 worldAxes     = mul((float3x3) gWorld, float3x3(input.AxisX, input.AxisY, input.AxisZ));
+    float3   worldPosition = mul(input.Position, worldAxes) + input.Translation;
     //-----------------------------------------------------------------------
     
-    output.Position = mul(float4(input.Position, 1.0f), resultMatrix);
+    output.Position = mul(float4(worldPosition, 1.0f), gWorldViewProj);
+    output.Normal   = mul(input.Normal, worldAxes);
+    output.Tangent  = mul(input.Tangent, worldAxes);
+    output.Color    = input.Color;
     output.Uv       = input.Uv;
 
     return output;
 }
 
-//---------------------------------------------------------------------------
-// Pixel Shader: https://learn.microsoft.com/en-us/windows/win32/direct3d11/pixel-shader-stage#the-pixel-shader
-//---------------------------------------------------------------------------
-float4 PS_Point(VS_OUTPUT input) : SV_TARGET
+VS_OUTPUT VS_FireFX(VS_INPUT input)
 {
-    float3 viewDir = normalize(gCameraPos - input.Position.xyz);
-    
-    float3 diffuseColor  = gDiffuseMap.Sample(samPoint,  input.Uv).rgb;
-    float3 normalColor   = gNormalMap.Sample(samPoint,   input.Uv).rgb;
-    float3 specularColor = gSpecularMap.Sample(samPoint, input.Uv).rgb;
-    float  gloss         = gGlossMap.Sample(samPoint,    input.Uv).r;
+    VS_OUTPUT output = (VS_OUTPUT)0;
     
-    return ShadePixel(input.Normal, input.Tangent, viewDir, diffuseColor, normalColor, specularColor, gloss);
+    output.Position = mul(float4(input.Position, 1.0f), gWorldViewProj);
+    output.Uv       = input.Uv;
+
+    return output;
 }
 
-float4 PS_Linear(VS_OUTPUT input) : SV_TARGET
+//---------------------------------------------------------------------------
+// Pixel Shader: https://learn.microsoft.com/en-us/windows/win32/direct3d11/pixel-shader-stage#the-pixel-shader
+//---------------------------------------------------------------------------
+float4 PS_Vehicle(VS_OUTPUT input) : SV_TARGET
 {
     float3 viewDir = normalize(gCameraPos - input.Position.xyz);
     
-    float3 diffuseColor  = gDiffuseMap.Sample(samLinear,  input.Uv).rgb;
-    float3 normalColor   = gNormalMap.Sample(samLinear,   input.Uv).rgb;
-    float3 specularColor = gSpecularMap.Sample(samLinear, input.Uv).rgb;
-    float  gloss         = gGlossMap.Sample(samLinear,    input.Uv).r;
+    float3 diffuseColor  = gDiffuseMap.Sample(samVehicle,  input.Uv).rgb;
+#if USE_NORMAL_MAP
+    float3 normalColor   = gNormalMap.Sample(samVehicle,   input.Uv).rgb;
+#else
+    float3 normalColor   = (float3)0;
+#endif
+    float3 specularColor = gSpecularMap.Sample(samVehicle, input.Uv).rgb;
+    float  gloss         = gGlossMap.Sample(samVehicle,    input.Uv).r;
     
     return ShadePixel(input.Normal, input.Tangent, viewDir, diffuseColor, normalColor, specularColor, gloss);
 }
 
-float4 PS_Anisotropic(VS_OUTPUT input) : SV_TARGET
+float4 PS_Vehicle_Packed(VS_OUTPUT input) : SV_TARGET
 {
     float3 viewDir = normalize(gCameraPos - input.Position.xyz);
     
-    float3 diffuseColor  = gDiffuseMap.Sample(samAnisotropic,  input.Uv).rgb;
-    float3 normalColor   = gNormalMap.Sample(samAnisotropic,   input.Uv).rgb;
-    float3 specularColor = gSpecularMap.Sample(samAnisotropic, input.Uv).rgb;
-    float  gloss         = gGlossMap.Sample(samAnisotropic,    input.Uv).r;
+    float3 diffuseColor  = gDiffuseMap.Sample(samVehicle,       input.Uv).rgb;
+#if USE_NORMAL_MAP
+    float3 normalColor   = gNormalMap.Sample(samVehicle,        input.Uv).rgb;
+#else
+    float3 normalColor   = (float3)0;
+#endif
+    float4 specularGloss = gSpecularGlossMap.Sample(samVehicle, input.Uv);
     
-    return ShadePixel(input.Normal, input.Tangent, viewDir, diffuseColor, normalColor, specularColor, gloss);
+    return ShadePixel(input.Normal, input.Tangent, viewDir, diffuseColor, normalColor, specularGloss.rgb, specularGloss.a);
 }
 
 float4 PS_FireFX(VS_OUTPUT input) : SV_TARGET
@@ -280,42 +318,22 @@ float4 PS_FireFX(VS_OUTPUT input) : SV_TARGET
 technique11 DefaultTechnique
 {
     //-----------------------------------------------------------------------
-    // Passes for the vehicle
+    // Pass for the vehicle, the sampler comes from the variant
     //-----------------------------------------------------------------------
-    pass P0 // Point sampling
-    {
-        SetDepthStencilState( gNoDepthStencilState, 0 );
-        SetBlendState( gNoBlendState, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
-        
-        SetVertexShader( CompileShader( vs_5_0, VS() ) );
-        SetGeometryShader( NULL );
-        SetPixelShader( CompileShader( ps_5_0, PS_Point() ) );
-    }
-    
-    pass P1 // Linear sampling
-    {
-        SetDepthStencilState( gNoDepthStencilState, 0 );
-        SetBlendState( gNoBlendState, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
-        
-        SetVertexShader( CompileShader( vs_5_0, VS() ) );
-        SetGeometryShader( NULL );
-        SetPixelShader( CompileShader( ps_5_0, PS_Linear() ) );
-    }
-    
-    pass P2 // Anisotropic sampling
+    pass P0
     {
         SetDepthStencilState( gNoDepthStencilState, 0 );
         SetBlendState( gNoBlendState, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
         
         SetVertexShader( CompileShader( vs_5_0, VS() ) );
         SetGeometryShader( NULL );
-        SetPixelShader( CompileShader( ps_5_0, PS_Anisotropic() ) );
+        SetPixelShader( CompileShader( ps_5_0, PS_Vehicle() ) );
     }
     
     //-----------------------------------------------------------------------
     // Passes for the fire
     //-----------------------------------------------------------------------
-    pass P3 // With alpha blending
+    pass P1 // With alpha blending
     {
         // SetRasterizerState( gRasterizerState ); // Rasterizer State is controlled by Mesh::SetRasterizerState()
         SetDepthStencilState( gDepthStencilState, 0 );
@@ -326,7 +344,7 @@ technique11 DefaultTechnique
         SetPixelShader( CompileShader( ps_5_0, PS_FireFX() ) );
     }
     
-    pass P4 // Without alpha blending
+    pass P2 // Without alpha blending
     {
         // SetRasterizerState( gRasterizerState ); // Rasterizer State is controlled by Mesh::SetRasterizerState()
         SetDepthStencilState( gDepthStencilState, 0 );
@@ -336,4 +354,49 @@ technique11 DefaultTechnique
         SetGeometryShader( NULL );
         SetPixelShader( CompileShader( ps_5_0, PS_FireFX() ) );
     }
-}
\ No newline at end of file
+}
+
+//---------------------------------------------------------------------------
+// Same vehicle pass as DefaultTechnique, three samples per pixel instead of four
+//---------------------------------------------------------------------------
+technique11 PackedTechnique
+{
+    pass P0
+    {
+        SetDepthStencilState( gNoDepthStencilState, 0 );
+        SetBlendState( gNoBlendState, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
+        
+        SetVertexShader( CompileShader( vs_5_0, VS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( CompileShader( ps_5_0, PS_Vehicle_Packed() ) );
+    }
+}
+
+//---------------------------------------------------------------------------
+// The vehicle pass once per instance in slot 1, DrawIndexedInstanced draws every vehicle in one call
+//---------------------------------------------------------------------------
+technique11 InstancedTechnique
+{
+    pass P0
+    {
+        SetDepthStencilState( gNoDepthStencilState, 0 );
+        SetBlendState( gNoBlendState, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
+        
+        SetVertexShader( CompileShader( vs_5_0, VS_Instanced() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( CompileShader( ps_5_0, PS_Vehicle() ) );
+    }
+}
+
+technique11 PackedInstancedTechnique
+{
+    pass P0
+    {
+        SetDepthStencilState( gNoDepthStencilState, 0 );
+        SetBlendState( gNoBlendState, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
+        
+        SetVertexShader( CompileShader( vs_5_0, VS_Instanced() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( CompileShader( ps_5_0, PS_Vehicle_Packed() ) );
+    }
+}
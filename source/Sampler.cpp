@@ -0,0 +1,535 @@
+#include "pch.h"
+#include "Sampler.h"
+
+// Project includes
+#include "MipChain.h"
+#include "VirtualTexture.h"
+
+// Standard includes
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr int   LANES   = Sampler::BATCH_SIZE;
+        constexpr float TO_UNIT = 1.0f / 255.0f;
+
+        // Per-lane description of the mip level every lane reads from
+        struct LevelLanes
+        {
+            alignas(32) int   offset[LANES]  {};
+            alignas(32) int   width[LANES]   {};
+            alignas(32) int   height[LANES]  {};
+            alignas(32) int   rowPitch[LANES]{};
+            alignas(32) float fWidth[LANES]  {};
+            alignas(32) float fHeight[LANES] {};
+        };
+
+        void SelectLevels(const MipChain& mipChain, const int (&levels)[LANES], LevelLanes& lanes)
+        {
+            for (int i = 0; i < LANES; ++i)
+            {
+                const MipLevel& level = mipChain.levels[levels[i]];
+                lanes.offset[i]   = static_cast<int>(level.offset);
+                lanes.width[i]    = level.width;
+                lanes.height[i]   = level.height;
+                lanes.rowPitch[i] = MipChain::GetRowPitch(level.width, mipChain.layout);
+                lanes.fWidth[i]   = static_cast<float>(level.width);
+                lanes.fHeight[i]  = static_cast<float>(level.height);
+            }
+        }
+
+        // lanes.offset holds the level itself, every texel goes through the page table
+        void SelectLevels(const VirtualTexture& texture, const int (&levels)[LANES], LevelLanes& lanes)
+        {
+            for (int i = 0; i < LANES; ++i)
+            {
+                const MipLevel& level = texture.GetLevel(levels[i]);
+                lanes.offset[i]   = levels[i];
+                lanes.width[i]    = level.width;
+                lanes.height[i]   = level.height;
+                lanes.rowPitch[i] = level.width;
+                lanes.fWidth[i]   = static_cast<float>(level.width);
+                lanes.fHeight[i]  = static_cast<float>(level.height);
+            }
+        }
+
+        const MipLevel& GetBaseLevel(const MipChain& mipChain)      { return mipChain.levels[0]; }
+        const MipLevel& GetBaseLevel(const VirtualTexture& texture) { return texture.GetLevel(0); }
+
+        // Squared lengths of the screen-space footprint along x and y, in texels of the base level
+        template<typename TextureT>
+        void FootprintLengths(const TextureT& texture, const SampleBatch& batch, float (&lengthX)[LANES], float (&lengthY)[LANES])
+        {
+            const float baseWidth  = static_cast<float>(GetBaseLevel(texture).width);
+            const float baseHeight = static_cast<float>(GetBaseLevel(texture).height);
+
+            for (int i = 0; i < LANES; ++i)
+            {
+                const float dxu = batch.dudx[i] * baseWidth;
+                const float dxv = batch.dvdx[i] * baseHeight;
+                const float dyu = batch.dudy[i] * baseWidth;
+                const float dyv = batch.dvdy[i] * baseHeight;
+
+                lengthX[i] = dxu * dxu + dxv * dxv;
+                lengthY[i] = dyu * dyu + dyv * dyv;
+            }
+        }
+
+#if defined(__AVX2__)
+        inline __m256 Wrap(__m256 coord, __m256 size)
+        {
+            return _mm256_sub_ps(coord, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(coord, size)), size));
+        }
+
+        inline __m256i ToTexelIndex(__m256 coord, __m256i size)
+        {
+            const __m256i index = _mm256_cvttps_epi32(coord);
+            return _mm256_min_epi32(_mm256_max_epi32(index, _mm256_setzero_si256()), _mm256_sub_epi32(size, _mm256_set1_epi32(1)));
+        }
+
+        inline void Accumulate(__m256i texels, __m256 weight, ColorBatch& accum)
+        {
+            const __m256i byteMask = _mm256_set1_epi32(0xFF);
+            const __m256  scale    = _mm256_mul_ps(weight, _mm256_set1_ps(TO_UNIT));
+
+            const __m256 r = _mm256_cvtepi32_ps(_mm256_and_si256(texels, byteMask));
+            const __m256 g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8), byteMask));
+            const __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 16), byteMask));
+            const __m256 a = _mm256_cvtepi32_ps(_mm256_srli_epi32(texels, 24));
+
+            _mm256_store_ps(accum.r, _mm256_fmadd_ps(r, scale, _mm256_load_ps(accum.r)));
+            _mm256_store_ps(accum.g, _mm256_fmadd_ps(g, scale, _mm256_load_ps(accum.g)));
+            _mm256_store_ps(accum.b, _mm256_fmadd_ps(b, scale, _mm256_load_ps(accum.b)));
+            _mm256_store_ps(accum.a, _mm256_fmadd_ps(a, scale, _mm256_load_ps(accum.a)));
+        }
+
+        // Same addressing as MipChain::GetTexelIndex, the layout is the same for every lane
+        inline __m256i Gather(const MipChain& mipChain, __m256i offset, __m256i rowPitch, __m256i x, __m256i y)
+        {
+            __m256i index;
+            if (mipChain.layout == TexelLayout::Tiled)
+            {
+                const __m256i mask = _mm256_set1_epi32(MipChain::TILE_SIZE - 1);
+                const __m256i tile = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, MipChain::TILE_SHIFT), rowPitch),
+                                                      _mm256_slli_epi32(_mm256_srli_epi32(x, MipChain::TILE_SHIFT), 2 * MipChain::TILE_SHIFT));
+                const __m256i texel = _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(y, mask), MipChain::TILE_SHIFT), _mm256_and_si256(x, mask));
+                index = _mm256_add_epi32(offset, _mm256_add_epi32(tile, texel));
+            }
+            else
+            {
+                index = _mm256_add_epi32(offset, _mm256_add_epi32(_mm256_mullo_epi32(y, rowPitch), x));
+            }
+            return _mm256_i32gather_epi32(reinterpret_cast<const int*>(mipChain.texels.data()), index, 4);
+        }
+#endif
+
+        // Nearest texel of the given level per lane, weighted into accum
+        void FetchPoint(const MipChain& mipChain, const LevelLanes& lanes, const float* u, const float* v, const float* weight, ColorBatch& accum)
+        {
+#if defined(__AVX2__)
+            const __m256  fWidth  = _mm256_load_ps(lanes.fWidth);
+            const __m256  fHeight = _mm256_load_ps(lanes.fHeight);
+            const __m256i width   = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.width));
+            const __m256i height  = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.height));
+            const __m256i offset  = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.offset));
+            const __m256i pitch   = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.rowPitch));
+
+            const __m256i x = ToTexelIndex(Wrap(_mm256_mul_ps(_mm256_loadu_ps(u), fWidth),  fWidth),  width);
+            const __m256i y = ToTexelIndex(Wrap(_mm256_mul_ps(_mm256_loadu_ps(v), fHeight), fHeight), height);
+
+            Accumulate(Gather(mipChain, offset, pitch, x, y), _mm256_loadu_ps(weight), accum);
+#else
+            for (int i = 0; i < LANES; ++i)
+            {
+                const float fx = u[i] * lanes.fWidth[i];
+                const float fy = v[i] * lanes.fHeight[i];
+                const int   x  = Clamp(static_cast<int>(fx - std::floor(fx / lanes.fWidth[i])  * lanes.fWidth[i]),  0, lanes.width[i]  - 1);
+                const int   y  = Clamp(static_cast<int>(fy - std::floor(fy / lanes.fHeight[i]) * lanes.fHeight[i]), 0, lanes.height[i] - 1);
+
+                const uint32_t texel = mipChain.texels[lanes.offset[i] + MipChain::GetTexelIndex(x, y, lanes.rowPitch[i], mipChain.layout)];
+                const float    scale = weight[i] * TO_UNIT;
+
+                accum.r[i] += static_cast<float>(texel         & 0xFF) * scale;
+                accum.g[i] += static_cast<float>((texel >> 8)  & 0xFF) * scale;
+                accum.b[i] += static_cast<float>((texel >> 16) & 0xFF) * scale;
+                accum.a[i] += static_cast<float>(texel >> 24)          * scale;
+            }
+#endif
+        }
+
+        // 2x2 bilinear footprint of the given level per lane, weighted into accum
+        void FetchBilinear(const MipChain& mipChain, const LevelLanes& lanes, const float* u, const float* v, const float* weight, ColorBatch& accum)
+        {
+#if defined(__AVX2__)
+            const __m256  fWidth  = _mm256_load_ps(lanes.fWidth);
+            const __m256  fHeight = _mm256_load_ps(lanes.fHeight);
+            const __m256i width   = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.width));
+            const __m256i height  = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.height));
+            const __m256i offset  = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.offset));
+            const __m256i pitch   = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.rowPitch));
+            const __m256i one     = _mm256_set1_epi32(1);
+            const __m256  half    = _mm256_set1_ps(0.5f);
+
+            // Texel centers sit at half-integer coordinates
+            const __m256 fx  = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(u), fWidth),  half);
+            const __m256 fy  = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(v), fHeight), half);
+            const __m256 x0f = _mm256_floor_ps(fx);
+            const __m256 y0f = _mm256_floor_ps(fy);
+            const __m256 tx  = _mm256_sub_ps(fx, x0f);
+            const __m256 ty  = _mm256_sub_ps(fy, y0f);
+
+            const __m256i x0 = ToTexelIndex(Wrap(x0f, fWidth),  width);
+            const __m256i y0 = ToTexelIndex(Wrap(y0f, fHeight), height);
+            __m256i       x1 = _mm256_add_epi32(x0, one);
+            __m256i       y1 = _mm256_add_epi32(y0, one);
+            x1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(x1, width),  x1); // Wrap the right neighbour back to column 0
+            y1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(y1, height), y1); // Wrap the bottom neighbour back to row 0
+
+            const __m256 w   = _mm256_loadu_ps(weight);
+            const __m256 itx = _mm256_sub_ps(_mm256_set1_ps(1.0f), tx);
+            const __m256 ity = _mm256_sub_ps(_mm256_set1_ps(1.0f), ty);
+
+            Accumulate(Gather(mipChain, offset, pitch, x0, y0), _mm256_mul_ps(w, _mm256_mul_ps(itx, ity)), accum);
+            Accumulate(Gather(mipChain, offset, pitch, x1, y0), _mm256_mul_ps(w, _mm256_mul_ps(tx,  ity)), accum);
+            Accumulate(Gather(mipChain, offset, pitch, x0, y1), _mm256_mul_ps(w, _mm256_mul_ps(itx, ty)),  accum);
+            Accumulate(Gather(mipChain, offset, pitch, x1, y1), _mm256_mul_ps(w, _mm256_mul_ps(tx,  ty)),  accum);
+#else
+            for (int i = 0; i < LANES; ++i)
+            {
+                const float fx  = u[i] * lanes.fWidth[i]  - 0.5f;
+                const float fy  = v[i] * lanes.fHeight[i] - 0.5f;
+                const float x0f = std::floor(fx);
+                const float y0f = std::floor(fy);
+                const float tx  = fx - x0f;
+                const float ty  = fy - y0f;
+
+                const int x0 = Clamp(static_cast<int>(x0f - std::floor(x0f / lanes.fWidth[i])  * lanes.fWidth[i]),  0, lanes.width[i]  - 1);
+                const int y0 = Clamp(static_cast<int>(y0f - std::floor(y0f / lanes.fHeight[i]) * lanes.fHeight[i]), 0, lanes.height[i] - 1);
+                const int x1 = x0 + 1 == lanes.width[i]  ? 0 : x0 + 1;
+                const int y1 = y0 + 1 == lanes.height[i] ? 0 : y0 + 1;
+
+                const uint32_t*   levelPtr = mipChain.texels.data() + lanes.offset[i];
+                const int         rowPitch = lanes.rowPitch[i];
+                const TexelLayout layout   = mipChain.layout;
+
+                const uint32_t texels[4]  {levelPtr[MipChain::GetTexelIndex(x0, y0, rowPitch, layout)], levelPtr[MipChain::GetTexelIndex(x1, y0, rowPitch, layout)],
+                                           levelPtr[MipChain::GetTexelIndex(x0, y1, rowPitch, layout)], levelPtr[MipChain::GetTexelIndex(x1, y1, rowPitch, layout)]};
+                const float    weights[4] {(1.0f - tx) * (1.0f - ty), tx * (1.0f - ty), (1.0f - tx) * ty, tx * ty};
+
+                for (int t = 0; t < 4; ++t)
+                {
+                    const float scale = weight[i] * weights[t] * TO_UNIT;
+                    accum.r[i] += static_cast<float>(texels[t]         & 0xFF) * scale;
+                    accum.g[i] += static_cast<float>((texels[t] >> 8)  & 0xFF) * scale;
+                    accum.b[i] += static_cast<float>((texels[t] >> 16) & 0xFF) * scale;
+                    accum.a[i] += static_cast<float>(texels[t] >> 24)          * scale;
+                }
+            }
+#endif
+        }
+
+        inline void AccumulateLane(uint32_t texel, float scale, int lane, ColorBatch& accum)
+        {
+            accum.r[lane] += static_cast<float>(texel         & 0xFF) * scale;
+            accum.g[lane] += static_cast<float>((texel >> 8)  & 0xFF) * scale;
+            accum.b[lane] += static_cast<float>((texel >> 16) & 0xFF) * scale;
+            accum.a[lane] += static_cast<float>(texel >> 24)          * scale;
+        }
+
+        // Scalar, the page table rules out a gather. Lanes without weight are skipped so they never request a page
+        void FetchPoint(const VirtualTexture& texture, const LevelLanes& lanes, const float* u, const float* v, const float* weight, ColorBatch& accum)
+        {
+            for (int i = 0; i < LANES; ++i)
+            {
+                if (weight[i] == 0.0f) continue;
+
+                const float fx = u[i] * lanes.fWidth[i];
+                const float fy = v[i] * lanes.fHeight[i];
+                const int   x  = Clamp(static_cast<int>(fx - std::floor(fx / lanes.fWidth[i])  * lanes.fWidth[i]),  0, lanes.width[i]  - 1);
+                const int   y  = Clamp(static_cast<int>(fy - std::floor(fy / lanes.fHeight[i]) * lanes.fHeight[i]), 0, lanes.height[i] - 1);
+
+                texture.RequestPage(lanes.offset[i], x, y);
+                AccumulateLane(texture.GetTexel(lanes.offset[i], x, y), weight[i] * TO_UNIT, i, accum);
+            }
+        }
+
+        void FetchBilinear(const VirtualTexture& texture, const LevelLanes& lanes, const float* u, const float* v, const float* weight, ColorBatch& accum)
+        {
+            for (int i = 0; i < LANES; ++i)
+            {
+                if (weight[i] == 0.0f) continue;
+
+                const float fx  = u[i] * lanes.fWidth[i]  - 0.5f;
+                const float fy  = v[i] * lanes.fHeight[i] - 0.5f;
+                const float x0f = std::floor(fx);
+                const float y0f = std::floor(fy);
+                const float tx  = fx - x0f;
+                const float ty  = fy - y0f;
+
+                const int x0 = Clamp(static_cast<int>(x0f - std::floor(x0f / lanes.fWidth[i])  * lanes.fWidth[i]),  0, lanes.width[i]  - 1);
+                const int y0 = Clamp(static_cast<int>(y0f - std::floor(y0f / lanes.fHeight[i]) * lanes.fHeight[i]), 0, lanes.height[i] - 1);
+                const int x1 = x0 + 1 == lanes.width[i]  ? 0 : x0 + 1;
+                const int y1 = y0 + 1 == lanes.height[i] ? 0 : y0 + 1;
+
+                // Most footprints sit inside one page, the neighbours only ask for theirs when they cross into another
+                const int  level    = lanes.offset[i];
+                const bool crossesX = (x0 >> VirtualTexture::PAGE_SHIFT) != (x1 >> VirtualTexture::PAGE_SHIFT);
+                const bool crossesY = (y0 >> VirtualTexture::PAGE_SHIFT) != (y1 >> VirtualTexture::PAGE_SHIFT);
+                texture.RequestPage(level, x0, y0);
+                if (crossesX)              texture.RequestPage(level, x1, y0);
+                if (crossesY)              texture.RequestPage(level, x0, y1);
+                if (crossesX and crossesY) texture.RequestPage(level, x1, y1);
+
+                const uint32_t texels[4]  {texture.GetTexel(level, x0, y0), texture.GetTexel(level, x1, y0), texture.GetTexel(level, x0, y1), texture.GetTexel(level, x1, y1)};
+                const float    weights[4] {(1.0f - tx) * (1.0f - ty), tx * (1.0f - ty), (1.0f - tx) * ty, tx * ty};
+
+                for (int t = 0; t < 4; ++t)
+                {
+                    AccumulateLane(texels[t], weight[i] * weights[t] * TO_UNIT, i, accum);
+                }
+            }
+        }
+
+        // Bilinear on the two levels around lod, blended by the fractional lod (MIN_MAG_MIP_LINEAR)
+        template<typename TextureT>
+        void FetchTrilinear(const TextureT& texture, const float* u, const float* v, const float (&lod)[LANES], const float* weight, ColorBatch& accum)
+        {
+            const int maxLevel = texture.GetLevelCount() - 1;
+
+            int   levels0[LANES];
+            int   levels1[LANES];
+            alignas(32) float weights0[LANES];
+            alignas(32) float weights1[LANES];
+
+            bool needsSecondLevel = false;
+            for (int i = 0; i < LANES; ++i)
+            {
+                const float clampedLod = Clamp(lod[i], 0.0f, static_cast<float>(maxLevel));
+                const int   level      = static_cast<int>(clampedLod);
+                const float fraction   = clampedLod - static_cast<float>(level);
+
+                levels0[i]  = level;
+                levels1[i]  = std::min(level + 1, maxLevel);
+                weights0[i] = weight[i] * (1.0f - fraction);
+                weights1[i] = weight[i] * fraction;
+
+                needsSecondLevel = needsSecondLevel or fraction > 0.0f;
+            }
+
+            LevelLanes lanes;
+            SelectLevels(texture, levels0, lanes);
+            FetchBilinear(texture, lanes, u, v, weights0, accum);
+
+            if (needsSecondLevel)
+            {
+                SelectLevels(texture, levels1, lanes);
+                FetchBilinear(texture, lanes, u, v, weights1, accum);
+            }
+        }
+    }
+#pragma endregion
+
+#pragma region Initialization
+    Sampler::Sampler(SamplerState state, int maxAnisotropy)
+        : m_State{state}
+    {
+        SetMaxAnisotropy(maxAnisotropy);
+    }
+
+    void Sampler::SetMaxAnisotropy(int maxAnisotropy)
+    {
+        m_MaxAnisotropy = Clamp(maxAnisotropy, 1, MAX_ANISOTROPY);
+    }
+#pragma endregion
+
+#pragma region Sampling
+    void Sampler::Sample(const MipChain& mipChain, const SampleBatch& batch, ColorBatch& colors) const
+    {
+        colors = ColorBatch{};
+        if (mipChain.IsEmpty()) return;
+
+        SampleTexture(mipChain, batch, colors);
+    }
+
+    void Sampler::Sample(const VirtualTexture& texture, const SampleBatch& batch, ColorBatch& colors) const
+    {
+        colors = ColorBatch{};
+        if (texture.GetLevelCount() == 0) return;
+
+        SampleTexture(texture, batch, colors);
+    }
+
+    ColorRGB Sampler::Sample(const MipChain& mipChain, const Vector2& uv, const Vector2& ddx, const Vector2& ddy) const
+    {
+        SampleBatch batch{};
+        for (int i = 0; i < BATCH_SIZE; ++i)
+        {
+            batch.u[i]    = uv.x;
+            batch.v[i]    = uv.y;
+            batch.dudx[i] = ddx.x;
+            batch.dvdx[i] = ddx.y;
+            batch.dudy[i] = ddy.x;
+            batch.dvdy[i] = ddy.y;
+        }
+
+        ColorBatch colors{};
+        Sample(mipChain, batch, colors);
+        return ColorRGB{colors.r[0], colors.g[0], colors.b[0]};
+    }
+
+    /**
+     * \brief Samples a 2x2 pixel quad, deriving the footprint from the quad itself like the GPU does
+     * \param uvs Quad uvs in the order top-left, top-right, bottom-left, bottom-right
+     * \param colors Filtered colors in the same order
+     */
+    void Sampler::SampleQuad(const MipChain& mipChain, const Vector2 (&uvs)[4], ColorRGB (&colors)[4]) const
+    {
+        const Vector2 ddx = uvs[1] - uvs[0];
+        const Vector2 ddy = uvs[2] - uvs[0];
+
+        SampleBatch batch{};
+        for (int i = 0; i < 4; ++i)
+        {
+            batch.u[i]    = uvs[i].x;
+            batch.v[i]    = uvs[i].y;
+            batch.dudx[i] = ddx.x;
+            batch.dvdx[i] = ddx.y;
+            batch.dudy[i] = ddy.x;
+            batch.dvdy[i] = ddy.y;
+        }
+
+        ColorBatch result{};
+        Sample(mipChain, batch, result);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            colors[i] = ColorRGB{result.r[i], result.g[i], result.b[i]};
+        }
+    }
+
+    template<typename TextureT>
+    void Sampler::SampleTexture(const TextureT& texture, const SampleBatch& batch, ColorBatch& colors) const
+    {
+        switch (m_State)
+        {
+        case SamplerState::Point:
+            SamplePoint(texture, batch, colors);
+            break;
+        case SamplerState::Linear:
+            SampleLinear(texture, batch, colors);
+            break;
+        case SamplerState::Anisotropic:
+            SampleAnisotropic(texture, batch, colors);
+            break;
+        default:
+            SamplePoint(texture, batch, colors);
+            break;
+        }
+    }
+
+    // MIN_MAG_MIP_POINT: nearest texel of the nearest mip level
+    template<typename TextureT>
+    void Sampler::SamplePoint(const TextureT& texture, const SampleBatch& batch, ColorBatch& colors) const
+    {
+        const int maxLevel = texture.GetLevelCount() - 1;
+
+        float lengthX[LANES];
+        float lengthY[LANES];
+        FootprintLengths(texture, batch, lengthX, lengthY);
+
+        int levels[LANES];
+        for (int i = 0; i < LANES; ++i)
+        {
+            // 0.5 * log2 of a squared length is log2 of the length
+            const float lod = 0.5f * std::log2(std::max(std::max(lengthX[i], lengthY[i]), FLT_MIN));
+            levels[i] = Clamp(static_cast<int>(std::floor(lod + 0.5f)), 0, maxLevel);
+        }
+
+        alignas(32) float weights[LANES];
+        std::fill_n(weights, LANES, 1.0f);
+
+        LevelLanes lanes;
+        SelectLevels(texture, levels, lanes);
+        FetchPoint(texture, lanes, batch.u, batch.v, weights, colors);
+    }
+
+    // MIN_MAG_MIP_LINEAR: trilinear filtering, lod from the longest footprint axis
+    template<typename TextureT>
+    void Sampler::SampleLinear(const TextureT& texture, const SampleBatch& batch, ColorBatch& colors) const
+    {
+        float lengthX[LANES];
+        float lengthY[LANES];
+        FootprintLengths(texture, batch, lengthX, lengthY);
+
+        float lod[LANES];
+        for (int i = 0; i < LANES; ++i)
+        {
+            lod[i] = 0.5f * std::log2(std::max(std::max(lengthX[i], lengthY[i]), FLT_MIN));
+        }
+
+        alignas(32) float weights[LANES];
+        std::fill_n(weights, LANES, 1.0f);
+
+        FetchTrilinear(texture, batch.u, batch.v, lod, weights, colors);
+    }
+
+    // ANISOTROPIC: up to m_MaxAnisotropy trilinear taps spread along the major axis of the footprint
+    template<typename TextureT>
+    void Sampler::SampleAnisotropic(const TextureT& texture, const SampleBatch& batch, ColorBatch& colors) const
+    {
+        float lengthX[LANES];
+        float lengthY[LANES];
+        FootprintLengths(texture, batch, lengthX, lengthY);
+
+        float lod[LANES];
+        float axisU[LANES];
+        float axisV[LANES];
+        int   numTaps[LANES];
+        int   maxTaps = 1;
+
+        for (int i = 0; i < LANES; ++i)
+        {
+            const bool  isMajorX = lengthX[i] >= lengthY[i];
+            const float major    = std::sqrt(isMajorX ? lengthX[i] : lengthY[i]);
+            const float minor    = std::sqrt(isMajorX ? lengthY[i] : lengthX[i]);
+
+            const float ratio = std::min(major / std::max(minor, FLT_MIN), static_cast<float>(m_MaxAnisotropy));
+            numTaps[i] = Clamp(static_cast<int>(std::ceil(ratio)), 1, m_MaxAnisotropy);
+            maxTaps    = std::max(maxTaps, numTaps[i]);
+
+            // Each tap only has to cover the footprint divided by the number of taps
+            lod[i]   = std::log2(std::max(major / static_cast<float>(numTaps[i]), FLT_MIN));
+            axisU[i] = isMajorX ? batch.dudx[i] : batch.dudy[i];
+            axisV[i] = isMajorX ? batch.dvdx[i] : batch.dvdy[i];
+        }
+
+        alignas(32) float u[LANES];
+        alignas(32) float v[LANES];
+        alignas(32) float weights[LANES];
+
+        for (int tap = 0; tap < maxTaps; ++tap)
+        {
+            for (int i = 0; i < LANES; ++i)
+            {
+                const bool  isActive = tap < numTaps[i];
+                const float offset   = (static_cast<float>(tap) + 0.5f) / static_cast<float>(numTaps[i]) - 0.5f;
+
+                u[i]       = batch.u[i] + axisU[i] * offset;
+                v[i]       = batch.v[i] + axisV[i] * offset;
+                weights[i] = isActive ? 1.0f / static_cast<float>(numTaps[i]) : 0.0f;
+            }
+
+            FetchTrilinear(texture, u, v, lod, weights, colors);
+        }
+    }
+#pragma endregion
+}
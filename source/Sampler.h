@@ -0,0 +1,72 @@
+#pragma once
+#include "ColorRGB.h"
+#include "SamplerState.h"
+#include "Vector2.h"
+
+namespace dae
+{
+    // Forward declarations
+    struct MipChain;
+    class VirtualTexture;
+
+    // Eight sample requests in SoA layout, derivatives are in uv units per pixel
+    struct SampleBatch
+    {
+        alignas(32) float u[8]    {};
+        alignas(32) float v[8]    {};
+        alignas(32) float dudx[8] {};
+        alignas(32) float dvdx[8] {};
+        alignas(32) float dudy[8] {};
+        alignas(32) float dvdy[8] {};
+    };
+
+    struct ColorBatch
+    {
+        alignas(32) float r[8] {};
+        alignas(32) float g[8] {};
+        alignas(32) float b[8] {};
+        alignas(32) float a[8] {};
+    };
+
+    /**
+     * \brief CPU counterpart of samPoint, samLinear and samAnisotropic in the .fx files (WRAP addressing on U and V).
+     * Works on batches of 8 samples so every texel fetch is a single 8-wide gather on AVX2 hardware.
+     */
+    class Sampler final
+    {
+    public:
+        static constexpr int BATCH_SIZE     = 8;
+        static constexpr int MAX_ANISOTROPY = 16;
+
+        explicit Sampler(SamplerState state = SamplerState::Point, int maxAnisotropy = MAX_ANISOTROPY);
+        ~Sampler() = default;
+
+        Sampler(const Sampler& other)                = default;
+        Sampler(Sampler&& other) noexcept            = default;
+        Sampler& operator=(const Sampler& other)     = default;
+        Sampler& operator=(Sampler&& other) noexcept = default;
+
+        void     Sample(const MipChain& mipChain, const SampleBatch& batch, ColorBatch& colors)                      const;
+        ColorRGB Sample(const MipChain& mipChain, const Vector2& uv, const Vector2& ddx, const Vector2& ddy)          const;
+        void     SampleQuad(const MipChain& mipChain, const Vector2 (&uvs)[4], ColorRGB (&colors)[4])                 const;
+
+        // Same filtering through the page table, a texel whose page is not resident comes from the nearest coarser level that is
+        void     Sample(const VirtualTexture& texture, const SampleBatch& batch, ColorBatch& colors)                  const;
+
+        void         SetState(SamplerState state) { m_State = state; }
+        SamplerState GetState() const             { return m_State; }
+        void         SetMaxAnisotropy(int maxAnisotropy);
+        int          GetMaxAnisotropy() const     { return m_MaxAnisotropy; }
+
+    private:
+        // TextureT is a MipChain or a VirtualTexture, only instantiated in Sampler.cpp
+        template<typename TextureT> void SampleTexture(const TextureT& texture, const SampleBatch& batch, ColorBatch& colors)     const;
+        template<typename TextureT> void SamplePoint(const TextureT& texture, const SampleBatch& batch, ColorBatch& colors)       const;
+        template<typename TextureT> void SampleLinear(const TextureT& texture, const SampleBatch& batch, ColorBatch& colors)      const;
+        template<typename TextureT> void SampleAnisotropic(const TextureT& texture, const SampleBatch& batch, ColorBatch& colors) const;
+
+    private:
+        SamplerState m_State         = SamplerState::Point;
+        int          m_MaxAnisotropy = MAX_ANISOTROPY;
+    };
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace dae
+{
+    // The sampler both backends filter with, samPoint, samLinear and samAnisotropic in the .fx files
+    enum class SamplerState
+    {
+        Point,
+        Linear,
+        Anisotropic,
+
+        COUNT
+    };
+}
@@ -0,0 +1,223 @@
+#include "pch.h"
+#include "ShaderPermutation.h"
+
+// Project includes
+#include "Effect.h"
+
+// Standard includes
+#include <algorithm>
+#include <fstream>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr const char* MANIFEST_MAGIC   = "DPERM";
+        constexpr int         MANIFEST_VERSION = 1;
+
+        // Same names as the renderer prints
+        constexpr const char* SHADING_MODE_NAMES[] = {"OBSERVED AREA", "DIFFUSE", "SPECULAR", "COMBINED"};
+        constexpr const char* SAMPLER_KIND_NAMES[] = {"POINT", "LINEAR", "ANISOTROPIC"};
+    }
+#pragma endregion
+
+#pragma region ShaderPermutation
+    bool ShaderPermutation::IsValid() const
+    {
+        return shadingMode >= 0 and shadingMode < SHADING_MODE_COUNT and samplerKind >= 0 and samplerKind < SAMPLER_KIND_COUNT;
+    }
+
+    uint32_t ShaderPermutation::GetKey() const
+    {
+        return static_cast<uint32_t>(shadingMode) | static_cast<uint32_t>(useNormalMap) << 4 | static_cast<uint32_t>(samplerKind) << 8;
+    }
+
+    std::vector<EffectDefine> ShaderPermutation::GetDefines() const
+    {
+        return {
+            {"SHADING_MODE",   std::to_string(shadingMode)},
+            {"USE_NORMAL_MAP", useNormalMap ? "1" : "0"},
+            {"SAMPLER_KIND",   std::to_string(samplerKind)}
+        };
+    }
+
+    std::string ShaderPermutation::ToString() const
+    {
+        if (not IsValid()) return "INVALID";
+
+        return std::string{SHADING_MODE_NAMES[shadingMode]} + (useNormalMap ? ", NORMAL MAP, " : ", NO NORMAL MAP, ") + SAMPLER_KIND_NAMES[samplerKind];
+    }
+#pragma endregion
+
+#pragma region PermutationManifest
+    bool PermutationManifest::Read(const std::string& path)
+    {
+        m_Variants.clear();
+
+        std::ifstream file{path};
+        if (not file) return false;
+
+        std::string magic{};
+        int         version = 0;
+        if (not (file >> magic >> version) or magic != MANIFEST_MAGIC or version != MANIFEST_VERSION)
+        {
+            std::cout << RED_TEXT("PermutationManifest::Read() rejected ") << path << ": not a version " << MANIFEST_VERSION << " manifest\n";
+            return false;
+        }
+
+        std::string keyword{};
+        while (file >> keyword)
+        {
+            bool isValid = false;
+            if (keyword == "max")
+            {
+                isValid = static_cast<bool>(file >> m_MaxVariants) and m_MaxVariants > 0;
+            }
+            else if (keyword == "variant")
+            {
+                ShaderPermutation permutation{};
+                int               useNormalMap = 0;
+                isValid = static_cast<bool>(file >> permutation.shadingMode >> useNormalMap >> permutation.samplerKind)
+                      and (useNormalMap == 0 or useNormalMap == 1);
+
+                permutation.useNormalMap = useNormalMap != 0;
+                isValid = isValid and permutation.IsValid();
+                if (isValid) Add(permutation);
+            }
+
+            if (not isValid)
+            {
+                std::cout << RED_TEXT("PermutationManifest::Read() rejected ") << path << ": invalid " << keyword << " entry\n";
+                m_Variants.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool PermutationManifest::Write(const std::string& path) const
+    {
+        std::ofstream file{path};
+        if (not file)
+        {
+            std::cout << RED_TEXT("PermutationManifest::Write() failed to open ") << path << '\n';
+            return false;
+        }
+
+        file << MANIFEST_MAGIC << ' ' << MANIFEST_VERSION << '\n';
+        file << "max " << m_MaxVariants << '\n';
+        for (const ShaderPermutation& permutation : m_Variants)
+        {
+            file << "variant " << permutation.shadingMode << ' ' << (permutation.useNormalMap ? 1 : 0) << ' ' << permutation.samplerKind << '\n';
+        }
+        return file.good();
+    }
+
+    bool PermutationManifest::Add(const ShaderPermutation& permutation)
+    {
+        if (Contains(permutation)) return false;
+
+        m_Variants.push_back(permutation);
+        return true;
+    }
+
+    bool PermutationManifest::Contains(const ShaderPermutation& permutation) const
+    {
+        return std::find(m_Variants.begin(), m_Variants.end(), permutation) != m_Variants.end();
+    }
+
+    PermutationManifest PermutationManifest::CreateComplete()
+    {
+        PermutationManifest manifest{};
+        for (int shadingMode = 0; shadingMode < ShaderPermutation::SHADING_MODE_COUNT; ++shadingMode)
+        {
+            for (int samplerKind = 0; samplerKind < ShaderPermutation::SAMPLER_KIND_COUNT; ++samplerKind)
+            {
+                manifest.Add({shadingMode, true,  samplerKind});
+                manifest.Add({shadingMode, false, samplerKind});
+            }
+        }
+        manifest.SetMaxVariants(static_cast<int>(manifest.GetVariants().size()));
+        return manifest;
+    }
+#pragma endregion
+
+#pragma region ShaderPermutationCache
+    ShaderPermutationCache::ShaderPermutationCache(ID3D11Device* devicePtr, std::wstring assetFile, PermutationManifest manifest)
+        : m_DevicePtr{devicePtr},
+          m_AssetFile{std::move(assetFile)},
+          m_Manifest{std::move(manifest)}
+    {
+    }
+
+    ShaderPermutationCache::~ShaderPermutationCache()
+    {
+        for (const Variant& variant : m_Variants)
+        {
+            variant.effectPtr->Release();
+        }
+    }
+
+    int ShaderPermutationCache::Prewarm()
+    {
+        const std::vector<ShaderPermutation>& permutations = m_Manifest.GetVariants();
+        const size_t                          count        = std::min(permutations.size(), static_cast<size_t>(m_Manifest.GetMaxVariants()));
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (not m_VariantIts.contains(permutations[i].GetKey())) Acquire(permutations[i]);
+        }
+
+        std::cout << GREEN_TEXT("**(HARDWARE) Prewarmed ") << MAGENTA_TEXT("" + std::to_string(m_Variants.size()) + "") << " of "
+                  << permutations.size() << " listed shader variant(s), at most " << m_Manifest.GetMaxVariants() << " alive\n";
+        return static_cast<int>(m_Variants.size());
+    }
+
+    Effect* ShaderPermutationCache::Select(const ShaderPermutation& permutation)
+    {
+        ++m_Stats.selections;
+        if (not permutation.IsValid()) return nullptr;
+
+        const auto it = m_VariantIts.find(permutation.GetKey());
+        if (it != m_VariantIts.end())
+        {
+            ++m_Stats.hits;
+            m_Variants.splice(m_Variants.begin(), m_Variants, it->second);
+            return it->second->effectPtr;
+        }
+
+        // Compiled all the same, but the manifest should list it so the next run does that up front
+        if (not m_Manifest.Contains(permutation))
+        {
+            ++m_Stats.unlisted;
+            std::cout << YELLOW_TEXT("**(HARDWARE) Shader variant missing from the permutation manifest: ") << MAGENTA_TEXT("" + permutation.ToString() + "") << '\n';
+        }
+        return Acquire(permutation);
+    }
+#pragma endregion
+
+#pragma region Private
+    Effect* ShaderPermutationCache::Acquire(const ShaderPermutation& permutation)
+    {
+        Effect* effectPtr = Effect::Acquire(m_DevicePtr, m_AssetFile, permutation.GetDefines());
+        if (not effectPtr) return nullptr;
+
+        ++m_Stats.compiles;
+
+        // The least recently selected make room, a mesh that still draws with one keeps it alive
+        while (static_cast<int>(m_Variants.size()) >= std::max(m_Manifest.GetMaxVariants(), 1))
+        {
+            const Variant& oldest = m_Variants.back();
+            m_VariantIts.erase(oldest.permutation.GetKey());
+            oldest.effectPtr->Release();
+            m_Variants.pop_back();
+            ++m_Stats.evictions;
+        }
+
+        m_Variants.push_front({permutation, effectPtr});
+        m_VariantIts[permutation.GetKey()] = m_Variants.begin();
+        m_Stats.variantCount = static_cast<int>(m_Variants.size());
+        return effectPtr;
+    }
+#pragma endregion
+}
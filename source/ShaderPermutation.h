@@ -0,0 +1,117 @@
+#pragma once
+#include "EffectCache.h"
+
+// Standard includes
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dae
+{
+    // Forward declarations
+    class Effect;
+
+    // One specialized variant of the vehicle shading. Every member becomes a define, so the pixel shader branches on none of them
+    struct ShaderPermutation
+    {
+        static constexpr int SHADING_MODE_COUNT = 4; // ShadingMode of the renderer
+        static constexpr int SAMPLER_KIND_COUNT = 3; // SamplerState of the renderer
+
+        int  shadingMode  = 3; // Combined
+        bool useNormalMap = true;
+        int  samplerKind  = 0; // Point
+
+        bool operator==(const ShaderPermutation& other) const = default;
+
+        bool                      IsValid()    const;
+        uint32_t                  GetKey()     const;
+        // SHADING_MODE, USE_NORMAL_MAP and SAMPLER_KIND
+        std::vector<EffectDefine> GetDefines() const;
+        std::string               ToString()   const;
+    };
+
+    /**
+     * \brief Which variants of an effect are compiled up front and how many may be alive at once. A text file next to the effect:
+     * a "DPERM 1" line, then "max <count>" and one "variant <shadingMode> <useNormalMap> <samplerKind>" line per variant to prewarm.
+     */
+    class PermutationManifest final
+    {
+    public:
+        static constexpr const char* EXTENSION = ".permutations";
+
+        bool Read(const std::string& path);
+        bool Write(const std::string& path) const;
+
+        // False when the variant was listed already
+        bool Add(const ShaderPermutation& permutation);
+        bool Contains(const ShaderPermutation& permutation) const;
+
+        void SetMaxVariants(int maxVariants) { m_MaxVariants = maxVariants; }
+        int  GetMaxVariants()          const { return m_MaxVariants; }
+
+        const std::vector<ShaderPermutation>& GetVariants() const { return m_Variants; }
+
+        // Every variant there is, prewarmed and allowed to stay
+        static PermutationManifest CreateComplete();
+
+    private:
+        int                            m_MaxVariants = 8;
+        std::vector<ShaderPermutation> m_Variants    {};
+    };
+
+    struct PermutationStats
+    {
+        int      variantCount = 0; // Held by the cache
+        uint64_t selections   = 0;
+        uint64_t hits         = 0;
+        uint64_t compiles     = 0; // Variants the cache had to acquire, from the effect cache on disk or the compiler
+        uint64_t evictions    = 0;
+        uint64_t unlisted     = 0; // Selected variants the manifest does not prewarm
+    };
+
+    /**
+     * \brief Keeps the variants of one effect file alive between selections, at most the maximum of its manifest. The least recently
+     * selected variant is released when another one would not fit; meshes hold their own reference, so the one they draw with stays alive.
+     */
+    class ShaderPermutationCache final
+    {
+    public:
+        ShaderPermutationCache(ID3D11Device* devicePtr, std::wstring assetFile, PermutationManifest manifest);
+        ~ShaderPermutationCache();
+
+        ShaderPermutationCache(const ShaderPermutationCache&)                = delete;
+        ShaderPermutationCache(ShaderPermutationCache&&) noexcept            = delete;
+        ShaderPermutationCache& operator=(const ShaderPermutationCache&)     = delete;
+        ShaderPermutationCache& operator=(ShaderPermutationCache&&) noexcept = delete;
+
+        // Acquires every variant of the manifest, as many as fit. Returns how many are alive
+        int Prewarm();
+
+        // The variant, nullptr when it does not compile. Borrowed, Mesh::SetEffect() takes its own reference
+        Effect* Select(const ShaderPermutation& permutation);
+
+        const std::wstring&        GetAssetFile() const { return m_AssetFile; }
+        const PermutationManifest& GetManifest()  const { return m_Manifest; }
+        const PermutationStats&    GetStats()     const { return m_Stats; }
+
+    private:
+        struct Variant
+        {
+            ShaderPermutation permutation {};
+            Effect*           effectPtr   = nullptr;
+        };
+
+        Effect* Acquire(const ShaderPermutation& permutation);
+
+        ID3D11Device*       m_DevicePtr = nullptr;
+        std::wstring        m_AssetFile {};
+        PermutationManifest m_Manifest  {};
+
+        // Most recently selected first
+        std::list<Variant>                                         m_Variants   {};
+        std::unordered_map<uint32_t, std::list<Variant>::iterator> m_VariantIts {};
+        PermutationStats                                           m_Stats      {};
+    };
+}
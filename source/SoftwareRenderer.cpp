@@ -0,0 +1,979 @@
+#include "pch.h"
+#include "SoftwareRenderer.h"
+
+// Project includes
+#include "Clipper.h"
+#include "Mesh.h"
+#include "MipChain.h"
+#include "VirtualTexture.h"
+
+// Standard includes
+#include <cassert>
+#include <chrono>
+#include <execution>
+#include <future>
+#include <numeric>
+#include <utility>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        float MillisecondsSince(Clock::time_point start)
+        {
+            return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+        }
+
+        // DXGI_FORMAT_R8G8B8A8_UNORM, R in the lowest byte
+        uint32_t PackColor(const ColorRGB& color)
+        {
+            const uint32_t r = static_cast<uint32_t>(Saturate(color.r) * 255.0f + 0.5f);
+            const uint32_t g = static_cast<uint32_t>(Saturate(color.g) * 255.0f + 0.5f);
+            const uint32_t b = static_cast<uint32_t>(Saturate(color.b) * 255.0f + 0.5f);
+            return r | g << 8 | b << 16 | 0xFF000000;
+        }
+
+        ColorRGB UnpackColor(uint32_t color)
+        {
+            constexpr float scale = 1.0f / 255.0f;
+            return ColorRGB{static_cast<float>(color       & 0xFF) * scale,
+                            static_cast<float>(color >> 8  & 0xFF) * scale,
+                            static_cast<float>(color >> 16 & 0xFF) * scale};
+        }
+
+        // Unbound maps fall back to values that leave the lighting untouched
+        void SampleMap(const Sampler& sampler, const MipChain* mipChainPtr, const SampleBatch& batch, ColorBatch& colors, float fallbackR, float fallbackG, float fallbackB)
+        {
+            if (mipChainPtr and not mipChainPtr->IsEmpty())
+            {
+                sampler.Sample(*mipChainPtr, batch, colors);
+                return;
+            }
+
+            std::fill(std::begin(colors.r), std::end(colors.r), fallbackR);
+            std::fill(std::begin(colors.g), std::end(colors.g), fallbackG);
+            std::fill(std::begin(colors.b), std::end(colors.b), fallbackB);
+            std::fill(std::begin(colors.a), std::end(colors.a), 1.0f);
+        }
+
+        void SampleDiffuseMap(const Sampler& sampler, const SoftwareMaterial& material, const SampleBatch& batch, ColorBatch& colors)
+        {
+            if (material.virtualDiffusePtr) sampler.Sample(*material.virtualDiffusePtr, batch, colors);
+            else                            SampleMap(sampler, material.diffusePtr, batch, colors, 1.0f, 1.0f, 1.0f);
+        }
+
+        // What ShadeFragments() and ShadeTransparentFragments() sample per fragment, unbound maps fall back without a lookup
+        int CountSampledMaps(const SoftwareMaterial& material)
+        {
+            const auto isBound     = [](const MipChain* mipChainPtr) { return mipChainPtr and not mipChainPtr->IsEmpty() ? 1 : 0; };
+            const int  diffuseMaps = material.virtualDiffusePtr ? 1 : isBound(material.diffusePtr);
+            if (material.isTransparent) return diffuseMaps;
+
+            const int specularGlossinessMaps = material.specularGlossinessPtr ? isBound(material.specularGlossinessPtr)
+                                                                              : isBound(material.specularPtr) + isBound(material.glossinessPtr);
+            return diffuseMaps + isBound(material.normalPtr) + specularGlossinessMaps;
+        }
+
+        // C++ port of ShadePixel() in PosCol3D_W3_TODO_0.fx, lightDir is expected to be normalized
+        ColorRGB ShadePixel(const ShadingParameters& parameters, const Vector3& lightDir, const Vector3& normal, const Vector3& tangent, const Vector3& viewDir,
+                            const ColorRGB& diffuseColor, const ColorRGB& normalColor, const ColorRGB& specularColor, float gloss)
+        {
+            // Tangent-space normal remapped from [0, 1] to [-1, 1]
+            const Vector3 binormal     = Vector3::Cross(normal, tangent);
+            const Vector3 sampledNormal{normalColor.r * 2.0f - 1.0f, normalColor.g * 2.0f - 1.0f, normalColor.b * 2.0f - 1.0f};
+
+            const Vector3 shadingNormal = parameters.useNormalMap
+                ? tangent * sampledNormal.x + binormal * sampledNormal.y + normal * sampledNormal.z
+                : normal;
+
+            const float observedArea = Saturate(Vector3::Dot(shadingNormal, -lightDir));
+            if (parameters.shadingMode == ShadingMode::ObservedArea) return ColorRGB{observedArea};
+
+            const ColorRGB diffuse = diffuseColor * ColorRGB{parameters.kd / PI};
+            if (parameters.shadingMode == ShadingMode::Diffuse) return diffuse * ColorRGB{observedArea};
+
+            // Phong specular lighting
+            const Vector3  reflectedLight = Vector3::Reflect(-lightDir, shadingNormal);
+            const float    cosAlpha       = Saturate(Vector3::Dot(reflectedLight, -viewDir));
+            const ColorRGB phong          = specularColor * ColorRGB{std::pow(cosAlpha, gloss * parameters.shininess)};
+            if (parameters.shadingMode == ShadingMode::Specular) return phong * ColorRGB{observedArea};
+
+            return ColorRGB{parameters.lightIntensity} * (diffuse + phong + parameters.ambient) * ColorRGB{observedArea};
+        }
+    }
+#pragma endregion
+
+#pragma region Initialization
+    SoftwareRenderer::SoftwareRenderer(int width, int height)
+        : m_Width{width},
+          m_Height{height},
+          m_TilesX{(width  + TILE_SIZE - 1) / TILE_SIZE},
+          m_TilesY{(height + TILE_SIZE - 1) / TILE_SIZE}
+    {
+        const int numPixels = m_Width * m_Height;
+        const int numTiles  = m_TilesX * m_TilesY;
+
+        m_DepthBuffer.resize(numPixels, 1.0f);
+        m_VisibilityBuffer.resize(numPixels);
+        m_ColorBuffer.resize(numPixels, 0);
+
+        m_TileIndices.resize(numTiles);
+        std::iota(m_TileIndices.begin(), m_TileIndices.end(), 0);
+        m_TileStats.resize(numTiles);
+
+        for (FrameData& frame : m_Frames)
+        {
+            frame.tileBins.resize(numTiles);
+            frame.transparentTileBins.resize(numTiles);
+        }
+    }
+
+    int SoftwareRenderer::AddMesh(const std::vector<Vertex>* verticesPtr, const std::vector<uint32_t>* indicesPtr, const SoftwareMaterial& material)
+    {
+        assert(verticesPtr and indicesPtr and "SoftwareRenderer::AddMesh needs vertex and index data");
+
+        m_Meshes.push_back(MeshData{verticesPtr, indicesPtr, material});
+        return static_cast<int>(m_Meshes.size()) - 1;
+    }
+
+    void SoftwareRenderer::SetCullMode(CullMode cullMode, bool frontCounterClockwise)
+    {
+        m_Settings.cullMode              = cullMode;
+        m_Settings.frontCounterClockwise = frontCounterClockwise;
+    }
+#pragma endregion
+
+#pragma region Frame
+    void SoftwareRenderer::BeginFrame(const Matrix& viewProjectionMatrix)
+    {
+        FrameData& frame = m_Frames[m_SubmitFrameIdx];
+        frame.viewProjectionMatrix = viewProjectionMatrix;
+        frame.instances.clear();
+    }
+
+    void SoftwareRenderer::Submit(int meshIdx, const Matrix& worldMatrix)
+    {
+        assert(meshIdx >= 0 and meshIdx < static_cast<int>(m_Meshes.size()) and "SoftwareRenderer::Submit got an unknown mesh");
+
+        std::vector<Instance>& instances = m_Frames[m_SubmitFrameIdx].instances;
+
+        Instance instance{};
+        instance.meshIdx     = meshIdx;
+        instance.worldMatrix = worldMatrix;
+
+        if (not instances.empty())
+        {
+            const Instance& previous     = instances.back();
+            const MeshData& previousMesh = m_Meshes[previous.meshIdx];
+            instance.firstVertex   = previous.firstVertex   + static_cast<uint32_t>(previousMesh.verticesPtr->size());
+            instance.firstTriangle = previous.firstTriangle + static_cast<uint32_t>(previousMesh.indicesPtr->size() / 3);
+        }
+
+        instances.push_back(instance);
+    }
+
+    void SoftwareRenderer::SubmitInstanced(int meshIdx, const std::vector<Matrix>& worldMatrices, const Matrix& meshMatrix)
+    {
+        m_Frames[m_SubmitFrameIdx].instances.reserve(m_Frames[m_SubmitFrameIdx].instances.size() + worldMatrices.size());
+        for (const Matrix& worldMatrix : worldMatrices)
+        {
+            Submit(meshIdx, meshMatrix * worldMatrix);
+        }
+    }
+
+    void SoftwareRenderer::Render(const ColorRGB& clearColor)
+    {
+        FrameData& frame = m_Frames[m_SubmitFrameIdx];
+        frame.settings = m_Settings;
+
+        ProcessGeometry(frame);
+        RasterizeFrame(frame, clearColor);
+
+        // A frame that was still in flight is older than this one, drop it
+        m_IsFrameInFlight = false;
+    }
+
+    void SoftwareRenderer::RenderPipelined(const ColorRGB& clearColor)
+    {
+        FrameData& nextFrame = m_Frames[m_SubmitFrameIdx];
+        nextFrame.settings = m_Settings;
+
+        if (m_IsFrameInFlight)
+        {
+            // Only one frame is in flight, so the two stages never touch the same FrameData
+            std::future<void> geometry = std::async(std::launch::async, [this, &nextFrame]
+            {
+                ProcessGeometry(nextFrame);
+            });
+
+            RasterizeFrame(m_Frames[1 - m_SubmitFrameIdx], clearColor);
+            geometry.wait();
+        }
+        else
+        {
+            // Nothing to overlap with yet, this call only fills the pipeline
+            ProcessGeometry(nextFrame);
+        }
+
+        m_SubmitFrameIdx  = 1 - m_SubmitFrameIdx;
+        m_IsFrameInFlight = true;
+    }
+
+    // 1. Vertex shading, triangle setup and binning
+    void SoftwareRenderer::ProcessGeometry(FrameData& frame)
+    {
+        frame.stats = SoftwareFrameStats{};
+        frame.stats.instancesSubmitted = static_cast<uint32_t>(frame.instances.size());
+
+        const Clock::time_point start = Clock::now();
+
+        ShadeVertices(frame);
+        SetupTriangles(frame);
+        BinTriangles(frame);
+
+        frame.stats.geometryMs = MillisecondsSince(start);
+    }
+
+    void SoftwareRenderer::RasterizeFrame(const FrameData& frame, const ColorRGB& clearColor)
+    {
+        m_FrameStats = frame.stats;
+
+        // 2. Rasterization, also shades in forward mode
+        //=======================================================================================================
+        Clock::time_point start = Clock::now();
+
+        const uint32_t packedClearColor = PackColor(clearColor);
+        std::for_each(std::execution::par, m_TileIndices.begin(), m_TileIndices.end(), [this, &frame, packedClearColor](int tileIdx)
+        {
+            RasterizeTile(frame, tileIdx, packedClearColor);
+        });
+
+        m_FrameStats.rasterMs = MillisecondsSince(start);
+
+        // 3. Resolve the visibility buffer, every visible pixel is shaded exactly once
+        //=======================================================================================================
+        if (frame.settings.rasterMode == RasterMode::VisibilityBuffer)
+        {
+            start = Clock::now();
+
+            std::for_each(std::execution::par, m_TileIndices.begin(), m_TileIndices.end(), [this, &frame](int tileIdx)
+            {
+                ShadeTile(frame, tileIdx);
+            });
+
+            m_FrameStats.shadingMs = MillisecondsSince(start);
+        }
+
+        // 4. Transparent meshes over the opaque image, tested against the opaque depth without writing it
+        //=======================================================================================================
+        if (m_FrameStats.trianglesTransparent > 0)
+        {
+            start = Clock::now();
+
+            std::for_each(std::execution::par, m_TileIndices.begin(), m_TileIndices.end(), [this, &frame](int tileIdx)
+            {
+                CompositeTransparentTile(frame, tileIdx);
+            });
+
+            m_FrameStats.transparencyMs = MillisecondsSince(start);
+        }
+
+        for (const TileStats& tileStats : m_TileStats)
+        {
+            m_FrameStats.fragmentsCovered     += tileStats.fragmentsCovered;
+            m_FrameStats.fragmentsPassed      += tileStats.fragmentsPassed;
+            m_FrameStats.fragmentsShaded      += tileStats.fragmentsShaded;
+            m_FrameStats.pixelsVisible        += tileStats.pixelsVisible;
+            m_FrameStats.transparentFragments += tileStats.transparentFragments;
+            m_FrameStats.kBufferEvictions     += tileStats.kBufferEvictions;
+            m_FrameStats.mapSamples           += tileStats.mapSamples;
+        }
+    }
+#pragma endregion
+
+#pragma region Geometry
+    void SoftwareRenderer::ShadeVertices(FrameData& frame)
+    {
+        if (frame.instances.empty())
+        {
+            frame.vertices.clear();
+            return;
+        }
+
+        const Instance& last = frame.instances.back();
+        frame.vertices.resize(last.firstVertex + m_Meshes[last.meshIdx].verticesPtr->size());
+
+        m_VertexJobs.clear();
+        for (uint32_t instanceIdx = 0; instanceIdx < frame.instances.size(); ++instanceIdx)
+        {
+            const uint32_t numVertices = static_cast<uint32_t>(m_Meshes[frame.instances[instanceIdx].meshIdx].verticesPtr->size());
+            for (uint32_t first = 0; first < numVertices; first += VERTEX_JOB_SIZE)
+            {
+                m_VertexJobs.push_back({instanceIdx, first, std::min(VERTEX_JOB_SIZE, numVertices - first)});
+            }
+        }
+
+        std::for_each(std::execution::par, m_VertexJobs.begin(), m_VertexJobs.end(), [this, &frame](const GeometryJob& job)
+        {
+            const Instance&            instance = frame.instances[job.instanceIdx];
+            const std::vector<Vertex>& vertices = *m_Meshes[instance.meshIdx].verticesPtr;
+
+            const Matrix& worldMatrix               = instance.worldMatrix;
+            const Matrix  worldViewProjectionMatrix = worldMatrix * frame.viewProjectionMatrix;
+
+            ShadedVertex* outputPtr = frame.vertices.data() + instance.firstVertex + job.first;
+            for (uint32_t i = job.first; i < job.first + job.count; ++i)
+            {
+                const Vertex& vertex = vertices[i];
+
+                ShadedVertex& output = *outputPtr++;
+                output.position      = worldViewProjectionMatrix.TransformPoint(Vector4{vertex.position, 1.0f});
+                output.worldPosition = worldMatrix.TransformPoint(vertex.position);
+                output.normal        = worldMatrix.TransformVector(vertex.normal);
+                output.tangent       = worldMatrix.TransformVector(vertex.tangent);
+                output.uv            = vertex.uv;
+            }
+        });
+    }
+
+    void SoftwareRenderer::SetupTriangles(FrameData& frame)
+    {
+        uint32_t numTriangles = 0;
+        if (not frame.instances.empty())
+        {
+            const Instance& last = frame.instances.back();
+            numTriangles = last.firstTriangle + static_cast<uint32_t>(m_Meshes[last.meshIdx].indicesPtr->size() / 3);
+        }
+
+        frame.triangles.resize(numTriangles);
+        frame.clipResults.resize(numTriangles);
+        frame.stats.trianglesSubmitted = numTriangles;
+
+        m_TriangleJobs.clear();
+        for (uint32_t instanceIdx = 0; instanceIdx < frame.instances.size(); ++instanceIdx)
+        {
+            const uint32_t meshNumTriangles = static_cast<uint32_t>(m_Meshes[frame.instances[instanceIdx].meshIdx].indicesPtr->size() / 3);
+            const uint32_t numBatches       = (meshNumTriangles + Clipper::BATCH_SIZE - 1) / Clipper::BATCH_SIZE;
+
+            for (uint32_t batchIdx = 0; batchIdx < numBatches; ++batchIdx)
+            {
+                m_TriangleJobs.push_back({instanceIdx, batchIdx});
+            }
+        }
+
+        std::for_each(std::execution::par, m_TriangleJobs.begin(), m_TriangleJobs.end(), [this, &frame](const GeometryJob& job)
+        {
+            SetupTriangleBatch(frame, job.instanceIdx, job.first);
+        });
+
+        // The guard band keeps clipping rare, so it runs serially and appends its output behind the submitted triangles
+        ClipTriangles(frame, numTriangles);
+    }
+
+    void SoftwareRenderer::SetupTriangleBatch(FrameData& frame, uint32_t instanceIdx, uint32_t batchIdx)
+    {
+        const Instance&              instance = frame.instances[instanceIdx];
+        const std::vector<uint32_t>& indices  = *m_Meshes[instance.meshIdx].indicesPtr;
+
+        const uint32_t firstTriangle = batchIdx * Clipper::BATCH_SIZE;
+        const int      count         = std::min(Clipper::BATCH_SIZE, static_cast<int>(indices.size() / 3 - firstTriangle));
+
+        ClipTriangleBatch batch{};
+        uint32_t          vertices[Clipper::BATCH_SIZE][3];
+        for (int lane = 0; lane < count; ++lane)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                vertices[lane][i] = instance.firstVertex + indices[(firstTriangle + lane) * 3 + i];
+
+                const Vector4& position = frame.vertices[vertices[lane][i]].position;
+                batch.x[i][lane] = position.x;
+                batch.y[i][lane] = position.y;
+                batch.z[i][lane] = position.z;
+                batch.w[i][lane] = position.w;
+            }
+        }
+
+        ClipResult results[Clipper::BATCH_SIZE];
+        frame.settings.clipper.Classify(batch, count, results);
+
+        for (int lane = 0; lane < count; ++lane)
+        {
+            const uint32_t triangleIdx = instance.firstTriangle + firstTriangle + lane;
+            frame.clipResults[triangleIdx] = results[lane];
+
+            TriangleSetup& setup = frame.triangles[triangleIdx];
+            if (results[lane] == ClipResult::Inside)
+            {
+                SetupTriangle(frame, setup, instanceIdx, vertices[lane]);
+            }
+            else
+            {
+                // Keep the vertices around for the clipper
+                setup             = TriangleSetup{};
+                setup.instanceIdx = instanceIdx;
+                std::copy(std::begin(vertices[lane]), std::end(vertices[lane]), std::begin(setup.vertices));
+            }
+        }
+    }
+
+    void SoftwareRenderer::ClipTriangles(FrameData& frame, uint32_t numTriangles)
+    {
+        ClippedVertex polygon[Clipper::MAX_POLYGON_VERTICES];
+
+        for (uint32_t triangleIdx = 0; triangleIdx < numTriangles; ++triangleIdx)
+        {
+            if (frame.clipResults[triangleIdx] != ClipResult::Clip) continue;
+
+            ++frame.stats.trianglesClipped;
+
+            // Copies, the vectors below grow while this triangle is processed
+            const uint32_t instanceIdx = frame.triangles[triangleIdx].instanceIdx;
+            const ShadedVertex vertices[3]
+            {
+                frame.vertices[frame.triangles[triangleIdx].vertices[0]],
+                frame.vertices[frame.triangles[triangleIdx].vertices[1]],
+                frame.vertices[frame.triangles[triangleIdx].vertices[2]]
+            };
+
+            const Vector4 positions[3]{vertices[0].position, vertices[1].position, vertices[2].position};
+            const int numVertices = frame.settings.clipper.ClipTriangle(positions, polygon);
+            if (numVertices < 3) continue;
+
+            // Clip-space interpolation is perspective-correct for every attribute
+            const uint32_t firstVertex = static_cast<uint32_t>(frame.vertices.size());
+            for (int i = 0; i < numVertices; ++i)
+            {
+                const float (&weights)[3] = polygon[i].weights;
+
+                ShadedVertex vertex{};
+                vertex.position      = polygon[i].position;
+                vertex.worldPosition = vertices[0].worldPosition * weights[0] + vertices[1].worldPosition * weights[1] + vertices[2].worldPosition * weights[2];
+                vertex.normal        = vertices[0].normal        * weights[0] + vertices[1].normal        * weights[1] + vertices[2].normal        * weights[2];
+                vertex.tangent       = vertices[0].tangent       * weights[0] + vertices[1].tangent       * weights[1] + vertices[2].tangent       * weights[2];
+                vertex.uv            = vertices[0].uv            * weights[0] + vertices[1].uv            * weights[1] + vertices[2].uv            * weights[2];
+                frame.vertices.push_back(vertex);
+            }
+
+            // Sutherland-Hodgman keeps the winding, so a fan keeps the facing of the original triangle
+            for (int i = 1; i < numVertices - 1; ++i)
+            {
+                const uint32_t fan[3]{firstVertex, firstVertex + i, firstVertex + i + 1};
+                frame.triangles.emplace_back();
+                SetupTriangle(frame, frame.triangles.back(), instanceIdx, fan);
+            }
+        }
+    }
+
+    void SoftwareRenderer::SetupTriangle(const FrameData& frame, TriangleSetup& setup, uint32_t instanceIdx, const uint32_t (&vertices)[3]) const
+    {
+        setup             = TriangleSetup{};
+        setup.instanceIdx = instanceIdx;
+
+        // The clipper guarantees 0 <= z and a sane w for everything that gets here
+        float screenX[3];
+        float screenY[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            setup.vertices[i] = vertices[i];
+
+            const Vector4& position = frame.vertices[setup.vertices[i]].position;
+            setup.invW[i]  = 1.0f / position.w;
+            setup.depth[i] = position.z * setup.invW[i];
+            screenX[i]     = (position.x * setup.invW[i] + 1.0f) * 0.5f * static_cast<float>(m_Width);
+            screenY[i]     = (1.0f - position.y * setup.invW[i]) * 0.5f * static_cast<float>(m_Height);
+        }
+
+        // Edge i is opposite to vertex i
+        for (int i = 0; i < 3; ++i)
+        {
+            const int a = (i + 1) % 3;
+            const int b = (i + 2) % 3;
+            setup.edgeA[i] = screenY[a] - screenY[b];
+            setup.edgeB[i] = screenX[b] - screenX[a];
+            setup.edgeC[i] = screenX[a] * screenY[b] - screenX[b] * screenY[a];
+        }
+
+        // Positive area means clockwise on screen
+        float area = setup.edgeA[0] * screenX[0] + setup.edgeB[0] * screenY[0] + setup.edgeC[0];
+        if (area == 0.0f) return;
+
+        const bool isFrontFace = (area > 0.0f) != frame.settings.frontCounterClockwise;
+        if (frame.settings.cullMode == CullMode::Back  and not isFrontFace) return;
+        if (frame.settings.cullMode == CullMode::Front and isFrontFace)     return;
+
+        // Flip the edges of counterclockwise triangles so the inside test is always >= 0, the barycentrics stay the same
+        if (area < 0.0f)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                setup.edgeA[i] = -setup.edgeA[i];
+                setup.edgeB[i] = -setup.edgeB[i];
+                setup.edgeC[i] = -setup.edgeC[i];
+            }
+            area = -area;
+        }
+        setup.invArea = 1.0f / area;
+
+        // Top-left fill rule, pixels exactly on a shared edge belong to one triangle only
+        for (int i = 0; i < 3; ++i)
+        {
+            setup.isTopLeft[i] = setup.edgeA[i] > 0.0f or (setup.edgeA[i] == 0.0f and setup.edgeB[i] > 0.0f);
+        }
+
+        setup.minX = std::max(0,            static_cast<int>(std::floor(std::min({screenX[0], screenX[1], screenX[2]}))));
+        setup.minY = std::max(0,            static_cast<int>(std::floor(std::min({screenY[0], screenY[1], screenY[2]}))));
+        setup.maxX = std::min(m_Width  - 1, static_cast<int>(std::ceil(std::max({screenX[0], screenX[1], screenX[2]}))));
+        setup.maxY = std::min(m_Height - 1, static_cast<int>(std::ceil(std::max({screenY[0], screenY[1], screenY[2]}))));
+
+        setup.isVisible = setup.minX <= setup.maxX and setup.minY <= setup.maxY;
+    }
+
+    void SoftwareRenderer::BinTriangles(FrameData& frame)
+    {
+        for (std::vector<uint32_t>& bin : frame.tileBins)
+        {
+            bin.clear();
+        }
+        for (std::vector<uint32_t>& bin : frame.transparentTileBins)
+        {
+            bin.clear();
+        }
+        frame.transparentTriangles.clear();
+
+        // Serial so every bin keeps submission order
+        for (uint32_t triangleIdx = 0; triangleIdx < frame.triangles.size(); ++triangleIdx)
+        {
+            const TriangleSetup& setup = frame.triangles[triangleIdx];
+            if (not setup.isVisible) continue;
+
+            ++frame.stats.trianglesRasterized;
+
+            if (GetMaterial(frame, setup).isTransparent)
+            {
+                const float viewDepth = frame.vertices[setup.vertices[0]].position.w + frame.vertices[setup.vertices[1]].position.w + frame.vertices[setup.vertices[2]].position.w;
+                frame.transparentTriangles.emplace_back(viewDepth / 3.0f, triangleIdx);
+                continue;
+            }
+
+            for (int tileY = setup.minY / TILE_SIZE; tileY <= setup.maxY / TILE_SIZE; ++tileY)
+            {
+                for (int tileX = setup.minX / TILE_SIZE; tileX <= setup.maxX / TILE_SIZE; ++tileX)
+                {
+                    frame.tileBins[tileY * m_TilesX + tileX].push_back(triangleIdx);
+                }
+            }
+        }
+
+        frame.stats.trianglesTransparent = static_cast<uint32_t>(frame.transparentTriangles.size());
+
+        // Per-triangle painter's algorithm, intersecting triangles can still blend in the wrong order
+        if (frame.settings.transparencyMode == TransparencyMode::Sorted)
+        {
+            const Clock::time_point start = Clock::now();
+
+            std::stable_sort(std::execution::par, frame.transparentTriangles.begin(), frame.transparentTriangles.end(),
+                [](const std::pair<float, uint32_t>& lhs, const std::pair<float, uint32_t>& rhs)
+            {
+                return lhs.first > rhs.first;
+            });
+
+            frame.stats.sortMs = MillisecondsSince(start);
+        }
+
+        for (const std::pair<float, uint32_t>& transparentTriangle : frame.transparentTriangles)
+        {
+            const TriangleSetup& setup = frame.triangles[transparentTriangle.second];
+            for (int tileY = setup.minY / TILE_SIZE; tileY <= setup.maxY / TILE_SIZE; ++tileY)
+            {
+                for (int tileX = setup.minX / TILE_SIZE; tileX <= setup.maxX / TILE_SIZE; ++tileX)
+                {
+                    frame.transparentTileBins[tileY * m_TilesX + tileX].push_back(transparentTriangle.second);
+                }
+            }
+        }
+    }
+#pragma endregion
+
+#pragma region Rasterization
+    template <typename FragmentFunction>
+    void SoftwareRenderer::RasterizeTriangle(const TriangleSetup& setup, int minX, int minY, int maxX, int maxY, FragmentFunction&& fragmentFunction) const
+    {
+        for (int y = minY; y <= maxY; ++y)
+        {
+            const float pixelY = static_cast<float>(y) + 0.5f;
+            const float pixelX = static_cast<float>(minX) + 0.5f;
+
+            float edges[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                edges[i] = setup.edgeA[i] * pixelX + setup.edgeB[i] * pixelY + setup.edgeC[i];
+            }
+
+            for (int x = minX; x <= maxX; ++x)
+            {
+                bool isInside = true;
+                for (int i = 0; i < 3; ++i)
+                {
+                    isInside = isInside and (edges[i] > 0.0f or (edges[i] == 0.0f and setup.isTopLeft[i]));
+                }
+
+                if (isInside)
+                {
+                    const float depth = (edges[0] * setup.depth[0] + edges[1] * setup.depth[1] + edges[2] * setup.depth[2]) * setup.invArea;
+                    fragmentFunction(x, y, depth);
+                }
+
+                for (int i = 0; i < 3; ++i)
+                {
+                    edges[i] += setup.edgeA[i];
+                }
+            }
+        }
+    }
+
+    void SoftwareRenderer::RasterizeTile(const FrameData& frame, int tileIdx, uint32_t clearColor)
+    {
+        const int tileMinX = (tileIdx % m_TilesX) * TILE_SIZE;
+        const int tileMinY = (tileIdx / m_TilesX) * TILE_SIZE;
+        const int tileMaxX = std::min(tileMinX + TILE_SIZE, m_Width)  - 1;
+        const int tileMaxY = std::min(tileMinY + TILE_SIZE, m_Height) - 1;
+
+        TileStats& stats = m_TileStats[tileIdx];
+        stats = TileStats{};
+
+        // Clear
+        for (int y = tileMinY; y <= tileMaxY; ++y)
+        {
+            const int rowStart = y * m_Width;
+            std::fill(m_DepthBuffer.begin()      + rowStart + tileMinX, m_DepthBuffer.begin()      + rowStart + tileMaxX + 1, 1.0f);
+            std::fill(m_VisibilityBuffer.begin() + rowStart + tileMinX, m_VisibilityBuffer.begin() + rowStart + tileMaxX + 1, VisibilitySample{});
+            std::fill(m_ColorBuffer.begin()      + rowStart + tileMinX, m_ColorBuffer.begin()      + rowStart + tileMaxX + 1, clearColor);
+        }
+
+        const bool isForward = frame.settings.rasterMode == RasterMode::Forward;
+
+        Fragment fragments[Sampler::BATCH_SIZE];
+        int      numFragments = 0;
+
+        for (const uint32_t triangleIdx : frame.tileBins[tileIdx])
+        {
+            const TriangleSetup& setup = frame.triangles[triangleIdx];
+
+            const int minX = std::max(setup.minX, tileMinX);
+            const int minY = std::max(setup.minY, tileMinY);
+            const int maxX = std::min(setup.maxX, tileMaxX);
+            const int maxY = std::min(setup.maxY, tileMaxY);
+
+            const SoftwareMaterial& material = GetMaterial(frame, setup);
+
+            RasterizeTriangle(setup, minX, minY, maxX, maxY, [&](int x, int y, float depth)
+            {
+                ++stats.fragmentsCovered;
+
+                const int pixelIdx = y * m_Width + x;
+                if (depth >= m_DepthBuffer[pixelIdx]) return;
+
+                ++stats.fragmentsPassed;
+                m_DepthBuffer[pixelIdx] = depth;
+
+                if (isForward)
+                {
+                    fragments[numFragments++] = Fragment{x, y, triangleIdx};
+                    if (numFragments == Sampler::BATCH_SIZE)
+                    {
+                        ShadeFragments(frame, fragments, numFragments, material);
+                        stats.fragmentsShaded += numFragments;
+                        stats.mapSamples      += numFragments * CountSampledMaps(material);
+                        numFragments = 0;
+                    }
+                }
+                else
+                {
+                    const Instance& instance = frame.instances[setup.instanceIdx];
+                    m_VisibilityBuffer[pixelIdx] = VisibilitySample{setup.instanceIdx, triangleIdx - instance.firstTriangle};
+                }
+            });
+
+            // Flush before the next triangle can overwrite the same pixels
+            if (numFragments > 0)
+            {
+                ShadeFragments(frame, fragments, numFragments, material);
+                stats.fragmentsShaded += numFragments;
+                stats.mapSamples      += numFragments * CountSampledMaps(material);
+                numFragments = 0;
+            }
+        }
+
+        if (isForward)
+        {
+            for (int y = tileMinY; y <= tileMaxY; ++y)
+            {
+                for (int x = tileMinX; x <= tileMaxX; ++x)
+                {
+                    stats.pixelsVisible += m_DepthBuffer[y * m_Width + x] < 1.0f;
+                }
+            }
+        }
+    }
+
+    void SoftwareRenderer::ShadeTile(const FrameData& frame, int tileIdx)
+    {
+        const int tileMinX = (tileIdx % m_TilesX) * TILE_SIZE;
+        const int tileMinY = (tileIdx / m_TilesX) * TILE_SIZE;
+        const int tileMaxX = std::min(tileMinX + TILE_SIZE, m_Width)  - 1;
+        const int tileMaxY = std::min(tileMinY + TILE_SIZE, m_Height) - 1;
+
+        TileStats& stats = m_TileStats[tileIdx];
+
+        Fragment                fragments[Sampler::BATCH_SIZE];
+        int                     numFragments = 0;
+        const SoftwareMaterial* materialPtr  = nullptr;
+
+        for (int y = tileMinY; y <= tileMaxY; ++y)
+        {
+            for (int x = tileMinX; x <= tileMaxX; ++x)
+            {
+                const VisibilitySample& sample = m_VisibilityBuffer[y * m_Width + x];
+                if (sample.instanceIdx == INVALID_ID) continue;
+
+                ++stats.pixelsVisible;
+
+                const uint32_t          triangleIdx = frame.instances[sample.instanceIdx].firstTriangle + sample.triangleIdx;
+                const SoftwareMaterial& material    = GetMaterial(frame, frame.triangles[triangleIdx]);
+
+                // A batch samples a single set of maps
+                if (numFragments == Sampler::BATCH_SIZE or (numFragments > 0 and materialPtr != &material))
+                {
+                    ShadeFragments(frame, fragments, numFragments, *materialPtr);
+                    stats.fragmentsShaded += numFragments;
+                    stats.mapSamples      += numFragments * CountSampledMaps(*materialPtr);
+                    numFragments = 0;
+                }
+
+                materialPtr = &material;
+                fragments[numFragments++] = Fragment{x, y, triangleIdx};
+            }
+        }
+
+        if (numFragments > 0)
+        {
+            ShadeFragments(frame, fragments, numFragments, *materialPtr);
+            stats.fragmentsShaded += numFragments;
+            stats.mapSamples      += numFragments * CountSampledMaps(*materialPtr);
+        }
+    }
+
+    void SoftwareRenderer::CompositeTransparentTile(const FrameData& frame, int tileIdx)
+    {
+        const std::vector<uint32_t>& bin = frame.transparentTileBins[tileIdx];
+        if (bin.empty()) return;
+
+        const int tileMinX = (tileIdx % m_TilesX) * TILE_SIZE;
+        const int tileMinY = (tileIdx / m_TilesX) * TILE_SIZE;
+        const int tileMaxX = std::min(tileMinX + TILE_SIZE, m_Width)  - 1;
+        const int tileMaxY = std::min(tileMinY + TILE_SIZE, m_Height) - 1;
+
+        TileStats& stats = m_TileStats[tileIdx];
+
+        // One buffer per worker thread, sized for a single tile so the layers stay in cache
+        thread_local TransparencyBuffer buffer{};
+        buffer.Begin(frame.settings.transparencyMode, TILE_SIZE * TILE_SIZE);
+
+        for (int y = tileMinY; y <= tileMaxY; ++y)
+        {
+            for (int x = tileMinX; x <= tileMaxX; ++x)
+            {
+                buffer.SetBackground((y - tileMinY) * TILE_SIZE + (x - tileMinX), UnpackColor(m_ColorBuffer[y * m_Width + x]));
+            }
+        }
+
+        Fragment fragments[Sampler::BATCH_SIZE];
+        int      numFragments = 0;
+
+        for (const uint32_t triangleIdx : bin)
+        {
+            const TriangleSetup& setup = frame.triangles[triangleIdx];
+
+            const int minX = std::max(setup.minX, tileMinX);
+            const int minY = std::max(setup.minY, tileMinY);
+            const int maxX = std::min(setup.maxX, tileMaxX);
+            const int maxY = std::min(setup.maxY, tileMaxY);
+
+            const SoftwareMaterial& material = GetMaterial(frame, setup);
+
+            RasterizeTriangle(setup, minX, minY, maxX, maxY, [&](int x, int y, float depth)
+            {
+                if (depth >= m_DepthBuffer[y * m_Width + x]) return;
+
+                fragments[numFragments++] = Fragment{x, y, triangleIdx};
+                if (numFragments == Sampler::BATCH_SIZE)
+                {
+                    ShadeTransparentFragments(frame, fragments, numFragments, material, buffer, tileMinX, tileMinY);
+                    stats.transparentFragments += numFragments;
+                    stats.mapSamples           += numFragments * CountSampledMaps(material);
+                    numFragments = 0;
+                }
+            });
+
+            // Flush so the ordered modes blend this triangle before the next one
+            if (numFragments > 0)
+            {
+                ShadeTransparentFragments(frame, fragments, numFragments, material, buffer, tileMinX, tileMinY);
+                stats.transparentFragments += numFragments;
+                stats.mapSamples           += numFragments * CountSampledMaps(material);
+                numFragments = 0;
+            }
+        }
+
+        for (int y = tileMinY; y <= tileMaxY; ++y)
+        {
+            for (int x = tileMinX; x <= tileMaxX; ++x)
+            {
+                m_ColorBuffer[y * m_Width + x] = PackColor(buffer.Resolve((y - tileMinY) * TILE_SIZE + (x - tileMinX)));
+            }
+        }
+
+        stats.kBufferEvictions = buffer.GetEvictions();
+    }
+#pragma endregion
+
+#pragma region Shading
+    /**
+     * \brief Reconstructs the perspective-correct attributes of up to 8 fragments, idle lanes repeat the first fragment.
+     * Texture derivatives are analytic, d(uv)/dx = (d(sum(b * uv / w))/dx - uv * d(sum(b / w))/dx) / sum(b / w).
+     */
+    void SoftwareRenderer::InterpolateFragments(const FrameData& frame, const Fragment* fragments, int count, SampleBatch& batch, Interpolants (&interpolants)[Sampler::BATCH_SIZE]) const
+    {
+        for (int lane = 0; lane < Sampler::BATCH_SIZE; ++lane)
+        {
+            // Idle lanes repeat the first fragment so they never pick an odd mip level
+            const Fragment&      fragment = fragments[lane < count ? lane : 0];
+            const TriangleSetup& setup    = frame.triangles[fragment.triangleIdx];
+
+            const float pixelX = static_cast<float>(fragment.x) + 0.5f;
+            const float pixelY = static_cast<float>(fragment.y) + 0.5f;
+
+            float weights[3];
+            float sumWeights  = 0.0f;
+            float sumWeightsX = 0.0f;
+            float sumWeightsY = 0.0f;
+            for (int i = 0; i < 3; ++i)
+            {
+                const float barycentric = (setup.edgeA[i] * pixelX + setup.edgeB[i] * pixelY + setup.edgeC[i]) * setup.invArea;
+                weights[i]   = barycentric * setup.invW[i];
+                sumWeights  += weights[i];
+                sumWeightsX += setup.edgeA[i] * setup.invArea * setup.invW[i];
+                sumWeightsY += setup.edgeB[i] * setup.invArea * setup.invW[i];
+            }
+
+            const float invSumWeights = 1.0f / sumWeights;
+
+            Interpolants& output = interpolants[lane];
+            output.worldPosition = Vector3::Zero;
+            output.normal        = Vector3::Zero;
+            output.tangent       = Vector3::Zero;
+            output.viewDepth     = invSumWeights;
+
+            Vector2 uv{};
+            Vector2 uvWeightedX{};
+            Vector2 uvWeightedY{};
+            for (int i = 0; i < 3; ++i)
+            {
+                const ShadedVertex& vertex = frame.vertices[setup.vertices[i]];
+                const float         weight = weights[i] * invSumWeights;
+
+                uv                   += vertex.uv * weight;
+                uvWeightedX          += vertex.uv * (setup.edgeA[i] * setup.invArea * setup.invW[i]);
+                uvWeightedY          += vertex.uv * (setup.edgeB[i] * setup.invArea * setup.invW[i]);
+                output.worldPosition += vertex.worldPosition * weight;
+                output.normal        += vertex.normal * weight;
+                output.tangent       += vertex.tangent * weight;
+            }
+
+            const Vector2 ddx = (uvWeightedX - uv * sumWeightsX) * invSumWeights;
+            const Vector2 ddy = (uvWeightedY - uv * sumWeightsY) * invSumWeights;
+
+            batch.u[lane]    = uv.x;
+            batch.v[lane]    = uv.y;
+            batch.dudx[lane] = ddx.x;
+            batch.dvdx[lane] = ddx.y;
+            batch.dudy[lane] = ddy.x;
+            batch.dvdy[lane] = ddy.y;
+        }
+    }
+
+    // Runs the vehicle pixel shader on up to 8 fragments
+    void SoftwareRenderer::ShadeFragments(const FrameData& frame, const Fragment* fragments, int count, const SoftwareMaterial& material)
+    {
+        SampleBatch  batch{};
+        Interpolants interpolants[Sampler::BATCH_SIZE];
+        InterpolateFragments(frame, fragments, count, batch, interpolants);
+
+        ColorBatch diffuseColors{};
+        ColorBatch normalColors{};
+        ColorBatch specularColors{};
+        ColorBatch glossColors{};
+        SampleDiffuseMap(frame.settings.sampler, material, batch, diffuseColors);
+        SampleMap(frame.settings.sampler, material.normalPtr, batch, normalColors, 0.5f, 0.5f, 1.0f);
+
+        // Like PS_*_Packed, glossiness comes out of the alpha of the specular lookup
+        const float* glossPtr = glossColors.r;
+        if (material.specularGlossinessPtr)
+        {
+            SampleMap(frame.settings.sampler, material.specularGlossinessPtr, batch, specularColors, 0.0f, 0.0f, 0.0f);
+            glossPtr = specularColors.a;
+        }
+        else
+        {
+            SampleMap(frame.settings.sampler, material.specularPtr,   batch, specularColors, 0.0f, 0.0f, 0.0f);
+            SampleMap(frame.settings.sampler, material.glossinessPtr, batch, glossColors,    0.0f, 0.0f, 0.0f);
+        }
+
+        const Vector3 lightDir = frame.settings.shadingParameters.lightDirection.Normalized();
+
+        for (int lane = 0; lane < count; ++lane)
+        {
+            const Vector3 viewDir = (frame.settings.shadingParameters.cameraPosition - interpolants[lane].worldPosition).Normalized();
+
+            const ColorRGB color = ShadePixel(frame.settings.shadingParameters, lightDir, interpolants[lane].normal, interpolants[lane].tangent, viewDir,
+                                              ColorRGB{diffuseColors.r[lane],  diffuseColors.g[lane],  diffuseColors.b[lane]},
+                                              ColorRGB{normalColors.r[lane],   normalColors.g[lane],   normalColors.b[lane]},
+                                              ColorRGB{specularColors.r[lane], specularColors.g[lane], specularColors.b[lane]},
+                                              glossPtr[lane]);
+
+            m_ColorBuffer[fragments[lane].y * m_Width + fragments[lane].x] = PackColor(color);
+        }
+    }
+
+    // C++ port of PS_FireFX, the sampled RGBA goes into the transparency buffer of the tile
+    void SoftwareRenderer::ShadeTransparentFragments(const FrameData& frame, const Fragment* fragments, int count, const SoftwareMaterial& material, TransparencyBuffer& buffer,
+                                                     int tileMinX, int tileMinY) const
+    {
+        SampleBatch  batch{};
+        Interpolants interpolants[Sampler::BATCH_SIZE];
+        InterpolateFragments(frame, fragments, count, batch, interpolants);
+
+        ColorBatch diffuseColors{};
+        SampleDiffuseMap(m_TransparentSampler, material, batch, diffuseColors);
+
+        for (int lane = 0; lane < count; ++lane)
+        {
+            TransparentFragment fragment{};
+            fragment.color     = ColorRGB{diffuseColors.r[lane], diffuseColors.g[lane], diffuseColors.b[lane]};
+            fragment.alpha     = diffuseColors.a[lane];
+            fragment.viewDepth = interpolants[lane].viewDepth;
+
+            buffer.Add((fragments[lane].y - tileMinY) * TILE_SIZE + (fragments[lane].x - tileMinX), fragment);
+        }
+    }
+
+    const SoftwareMaterial& SoftwareRenderer::GetMaterial(const FrameData& frame, const TriangleSetup& setup) const
+    {
+        return m_Meshes[frame.instances[setup.instanceIdx].meshIdx].material;
+    }
+#pragma endregion
+}
@@ -0,0 +1,292 @@
+#pragma once
+#include "Renderer.h"
+#include "Clipper.h"
+#include "Sampler.h"
+#include "TransparencyBuffer.h"
+
+namespace dae
+{
+    // Forward declarations
+    struct MipChain;
+    struct Vertex;
+    class VirtualTexture;
+
+    enum class RasterMode
+    {
+        Forward,          // Shade every fragment that passes the depth test
+        VisibilityBuffer, // Rasterize triangle and instance IDs only, shade every visible pixel once afterwards
+
+        COUNT
+    };
+
+    struct SoftwareMaterial
+    {
+        const MipChain* diffusePtr            = nullptr;
+        const MipChain* normalPtr             = nullptr;
+        const MipChain* specularPtr           = nullptr;
+        const MipChain* glossinessPtr         = nullptr;
+        const MipChain* specularGlossinessPtr = nullptr; // Specular RGB with glossiness in alpha, replaces both maps above when set
+        bool            isTransparent         = false;   // Unlit diffuse RGBA blended over the opaque image like PS_FireFX, no depth write
+
+        const VirtualTexture* virtualDiffusePtr = nullptr; // Paged through a VirtualTextureCache, replaces diffusePtr when set
+    };
+
+    // CPU copy of the scalar variables in PosCol3D_W3_TODO_0.fx
+    struct ShadingParameters
+    {
+        Vector3     cameraPosition {};
+        Vector3     lightDirection {0.577f, -0.577f, 0.577f};
+        ColorRGB    ambient        {0.03f, 0.03f, 0.03f};
+        float       lightIntensity = 1.0f;
+        float       kd             = 7.0f;
+        float       shininess      = 25.0f;
+        ShadingMode shadingMode    = ShadingMode::Combined;
+        bool        useNormalMap   = true;
+    };
+
+    struct SoftwareFrameStats
+    {
+        uint32_t instancesSubmitted   = 0;
+        uint32_t trianglesSubmitted   = 0;
+        uint32_t trianglesClipped     = 0; // Crossed the near plane or left the guard band
+        uint32_t trianglesRasterized  = 0; // Survived culling and rejection, includes the output of the clipper
+        uint32_t trianglesTransparent = 0; // Part of trianglesRasterized
+        uint64_t fragmentsCovered     = 0; // Every covered pixel of every triangle
+        uint64_t fragmentsPassed      = 0; // Covered pixels that passed the depth test
+        uint64_t fragmentsShaded      = 0; // Runs of the pixel shader
+        uint64_t pixelsVisible        = 0; // Pixels that ended up with geometry
+        uint64_t transparentFragments = 0; // Transparent fragments in front of the opaque depth
+        uint64_t kBufferEvictions     = 0; // Transparent fragments that did not fit in the k-buffer
+        uint64_t mapSamples           = 0; // Filtered lookups, one per bound map per shaded fragment
+        float    geometryMs           = 0.0f;
+        float    sortMs               = 0.0f; // Part of geometryMs, only in TransparencyMode::Sorted
+        float    rasterMs             = 0.0f;
+        float    shadingMs            = 0.0f; // Forward shading happens inside the raster pass
+        float    transparencyMs       = 0.0f;
+    };
+
+    /**
+     * \brief Tiled CPU rasterizer for the vehicle technique, outputs RGBA8 texels that can be copied straight into the back buffer.
+     * In VisibilityBuffer mode the raster pass only stores depth plus a triangle/instance ID per pixel and a second pass
+     * reconstructs the attributes, so the normal-map and Phong work no longer scales with depth complexity.
+     * Transparent meshes are rasterized last, per tile, into a TransparencyBuffer and composited over the shaded opaque image.
+     */
+    class SoftwareRenderer final
+    {
+    public:
+        static constexpr int TILE_SIZE = 64;
+
+        SoftwareRenderer(int width, int height);
+        ~SoftwareRenderer() = default;
+
+        SoftwareRenderer(const SoftwareRenderer&)                = delete;
+        SoftwareRenderer(SoftwareRenderer&&) noexcept            = delete;
+        SoftwareRenderer& operator=(const SoftwareRenderer&)     = delete;
+        SoftwareRenderer& operator=(SoftwareRenderer&&) noexcept = delete;
+
+        // Vertex and index data is referenced, not copied, and must outlive the renderer
+        int  AddMesh(const std::vector<Vertex>* verticesPtr, const std::vector<uint32_t>* indicesPtr, const SoftwareMaterial& material);
+
+        void BeginFrame(const Matrix& viewProjectionMatrix);
+        void Submit(int meshIdx, const Matrix& worldMatrix);
+        // The CPU side of InstancedTechnique: one instance per world matrix, each drawn with meshMatrix * worldMatrix
+        void SubmitInstanced(int meshIdx, const std::vector<Matrix>& worldMatrices, const Matrix& meshMatrix = {});
+        void Render(const ColorRGB& clearColor);
+
+        /**
+         * \brief Starts the geometry of the frame that was just submitted on a worker and rasterizes the previous frame meanwhile.
+         * The color buffer lags one frame behind the submissions and at most one frame is in flight, the first call only fills the pipeline.
+         * Settings are captured per frame, so every image is identical to the one Render() would have produced for the same submission.
+         */
+        void RenderPipelined(const ColorRGB& clearColor);
+
+        // Settings, they apply from the next Render() or RenderPipelined() on
+        void SetRasterMode(RasterMode rasterMode)                        { m_Settings.rasterMode = rasterMode; }
+        void SetSamplerState(SamplerState samplerState)                  { m_Settings.sampler.SetState(samplerState); }
+        void SetShadingParameters(const ShadingParameters& parameters)   { m_Settings.shadingParameters = parameters; }
+        void SetCullMode(CullMode cullMode, bool frontCounterClockwise);
+        void SetGuardBand(float guardBand)                               { m_Settings.clipper.SetGuardBand(guardBand); }
+        void SetTransparencyMode(TransparencyMode transparencyMode)      { m_Settings.transparencyMode = transparencyMode; }
+
+        RasterMode                   GetRasterMode()       const { return m_Settings.rasterMode; }
+        TransparencyMode             GetTransparencyMode() const { return m_Settings.transparencyMode; }
+        float                        GetGuardBand()        const { return m_Settings.clipper.GetGuardBand(); }
+        const SoftwareFrameStats&    GetFrameStats()       const { return m_FrameStats; }
+        const std::vector<uint32_t>& GetColorBuffer()      const { return m_ColorBuffer; }
+        int                          GetWidth()            const { return m_Width; }
+        int                          GetHeight()           const { return m_Height; }
+
+    private:
+        static constexpr uint32_t INVALID_ID = 0xFFFFFFFF;
+
+        struct MeshData
+        {
+            const std::vector<Vertex>*   verticesPtr = nullptr;
+            const std::vector<uint32_t>* indicesPtr  = nullptr;
+            SoftwareMaterial             material    {};
+        };
+
+        // Vertex shading and triangle setup are spread over the workers in jobs across every instance, not one dispatch per instance
+        static constexpr uint32_t VERTEX_JOB_SIZE = 1024;
+
+        struct GeometryJob
+        {
+            uint32_t instanceIdx = 0;
+            uint32_t first       = 0; // First vertex of the mesh, or the triangle batch
+            uint32_t count       = 0; // Vertices, unused for triangle batches
+        };
+
+        struct Instance
+        {
+            int      meshIdx       = 0;
+            Matrix   worldMatrix   {};
+            uint32_t firstVertex   = 0; // Into m_Vertices
+            uint32_t firstTriangle = 0; // Into m_Triangles
+        };
+
+        // Vertex shader output
+        struct ShadedVertex
+        {
+            Vector4 position      {}; // Clip space
+            Vector3 worldPosition {};
+            Vector3 normal        {};
+            Vector3 tangent       {};
+            Vector2 uv            {};
+        };
+
+        // Screen-space edge equations, the barycentric of vertex i is (edgeA[i] * x + edgeB[i] * y + edgeC[i]) * invArea
+        struct TriangleSetup
+        {
+            uint32_t vertices[3]  {};
+            float    edgeA[3]     {};
+            float    edgeB[3]     {};
+            float    edgeC[3]     {};
+            float    depth[3]     {};
+            float    invW[3]      {};
+            bool     isTopLeft[3] {};
+            float    invArea      = 0.0f;
+            int      minX = 0, minY = 0, maxX = 0, maxY = 0;
+            uint32_t instanceIdx  = 0;
+            bool     isVisible    = false;
+        };
+
+        struct VisibilitySample
+        {
+            uint32_t instanceIdx = INVALID_ID;
+            uint32_t triangleIdx = INVALID_ID; // Relative to Instance::firstTriangle, IDs past the mesh refer to clipper output
+        };
+
+        struct Fragment
+        {
+            int      x           = 0;
+            int      y           = 0;
+            uint32_t triangleIdx = 0; // Into m_Triangles
+        };
+
+        // Perspective-correct attributes of a fragment, the uvs and their derivatives go into a SampleBatch
+        struct Interpolants
+        {
+            Vector3 worldPosition {};
+            Vector3 normal        {};
+            Vector3 tangent       {};
+            float   viewDepth     = 0.0f;
+        };
+
+        struct TileStats
+        {
+            uint64_t fragmentsCovered     = 0;
+            uint64_t fragmentsPassed      = 0;
+            uint64_t fragmentsShaded      = 0;
+            uint64_t pixelsVisible        = 0;
+            uint64_t transparentFragments = 0;
+            uint64_t kBufferEvictions     = 0;
+            uint64_t mapSamples           = 0;
+        };
+
+        struct FrameSettings
+        {
+            RasterMode        rasterMode            = RasterMode::Forward;
+            TransparencyMode  transparencyMode      = TransparencyMode::Sorted;
+            CullMode          cullMode              = CullMode::None;
+            bool              frontCounterClockwise = false;
+            Sampler           sampler               {};
+            Clipper           clipper               {};
+            ShadingParameters shadingParameters     {};
+        };
+
+        // Everything between BeginFrame() and the end of rasterization, double-buffered so the next frame can be set up meanwhile
+        struct FrameData
+        {
+            FrameSettings settings             {}; // Captured when the geometry of the frame starts
+            Matrix        viewProjectionMatrix {};
+
+            std::vector<Instance>      instances   {};
+            std::vector<ShadedVertex>  vertices    {}; // Submitted vertices first, clipper output behind them
+            std::vector<TriangleSetup> triangles   {}; // Same layout as vertices
+            std::vector<ClipResult>    clipResults {};
+
+            std::vector<std::pair<float, uint32_t>> transparentTriangles {}; // View depth of the centroid and index into triangles
+
+            std::vector<std::vector<uint32_t>> tileBins            {};
+            std::vector<std::vector<uint32_t>> transparentTileBins {}; // Back to front in TransparencyMode::Sorted
+
+            SoftwareFrameStats stats {}; // Triangle counters and geometry timings
+        };
+
+        // Frame stages
+        void ProcessGeometry(FrameData& frame);
+        void RasterizeFrame(const FrameData& frame, const ColorRGB& clearColor);
+
+        // Passes
+        void ShadeVertices(FrameData& frame);
+        void SetupTriangles(FrameData& frame);
+        void SetupTriangleBatch(FrameData& frame, uint32_t instanceIdx, uint32_t batchIdx);
+        void ClipTriangles(FrameData& frame, uint32_t numTriangles);
+        void BinTriangles(FrameData& frame);
+        void RasterizeTile(const FrameData& frame, int tileIdx, uint32_t clearColor);
+        void ShadeTile(const FrameData& frame, int tileIdx);
+        void CompositeTransparentTile(const FrameData& frame, int tileIdx);
+
+        // Calls fragmentFunction(x, y, depth) for every covered pixel of the triangle inside the rectangle
+        template <typename FragmentFunction>
+        void RasterizeTriangle(const TriangleSetup& setup, int minX, int minY, int maxX, int maxY, FragmentFunction&& fragmentFunction) const;
+
+        void InterpolateFragments(const FrameData& frame, const Fragment* fragments, int count, SampleBatch& batch, Interpolants (&interpolants)[Sampler::BATCH_SIZE]) const;
+        void ShadeFragments(const FrameData& frame, const Fragment* fragments, int count, const SoftwareMaterial& material);
+        void ShadeTransparentFragments(const FrameData& frame, const Fragment* fragments, int count, const SoftwareMaterial& material, TransparencyBuffer& buffer,
+                                       int tileMinX, int tileMinY) const;
+        void SetupTriangle(const FrameData& frame, TriangleSetup& setup, uint32_t instanceIdx, const uint32_t (&vertices)[3]) const;
+
+        const SoftwareMaterial& GetMaterial(const FrameData& frame, const TriangleSetup& setup) const;
+
+    private:
+        int m_Width  = 0;
+        int m_Height = 0;
+        int m_TilesX = 0;
+        int m_TilesY = 0;
+
+        FrameSettings m_Settings           {};
+        Sampler       m_TransparentSampler {SamplerState::Point}; // PS_FireFX always uses samPoint
+
+        std::vector<MeshData> m_Meshes {};
+
+        // BeginFrame() and Submit() write m_Frames[m_SubmitFrameIdx], the other one can be in flight
+        FrameData m_Frames[2]       {};
+        int       m_SubmitFrameIdx  = 0;
+        bool      m_IsFrameInFlight = false;
+
+        // Tiles are rasterized in parallel, every tile owns its bin and counters
+        std::vector<int>       m_TileIndices {};
+        std::vector<TileStats> m_TileStats   {};
+
+        // Only touched by the geometry stage
+        std::vector<GeometryJob> m_VertexJobs   {};
+        std::vector<GeometryJob> m_TriangleJobs {};
+
+        std::vector<float>            m_DepthBuffer      {};
+        std::vector<VisibilitySample> m_VisibilityBuffer {};
+        std::vector<uint32_t>         m_ColorBuffer      {};
+
+        SoftwareFrameStats m_FrameStats {};
+    };
+}
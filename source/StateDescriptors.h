@@ -0,0 +1,106 @@
+#pragma once
+
+// Standard includes
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+
+namespace dae
+{
+    /**
+     * \brief Copies of state descriptors fit to be a StateObjectCache key: every member the device reads is copied into a zeroed descriptor,
+     * so padding and members the device ignores never make equal states look different. Templates over the member names of the D3D11
+     * descriptors, D3DStateObjects instantiates them with those and the tests with look-alikes of the same layout.
+     */
+    namespace StateDescriptors
+    {
+        template <typename Desc>
+        Desc CreateZeroed()
+        {
+            Desc zeroed;
+            std::memset(&zeroed, 0, sizeof(zeroed));
+            return zeroed;
+        }
+
+        // The render target descriptors end in an 8-bit write mask followed by padding. Without independent blending only the first target counts
+        template <typename BlendDesc>
+        BlendDesc NormalizeBlendDesc(const BlendDesc& desc)
+        {
+            BlendDesc normalized = CreateZeroed<BlendDesc>();
+
+            normalized.AlphaToCoverageEnable  = desc.AlphaToCoverageEnable;
+            normalized.IndependentBlendEnable = desc.IndependentBlendEnable;
+
+            const size_t targetCount = desc.IndependentBlendEnable ? std::size(desc.RenderTarget) : 1;
+            for (size_t i = 0; i < targetCount; ++i)
+            {
+                const auto& target       = desc.RenderTarget[i];
+                auto&       normalTarget = normalized.RenderTarget[i];
+
+                normalTarget.BlendEnable           = target.BlendEnable;
+                normalTarget.SrcBlend              = target.SrcBlend;
+                normalTarget.DestBlend             = target.DestBlend;
+                normalTarget.BlendOp               = target.BlendOp;
+                normalTarget.SrcBlendAlpha         = target.SrcBlendAlpha;
+                normalTarget.DestBlendAlpha        = target.DestBlendAlpha;
+                normalTarget.BlendOpAlpha          = target.BlendOpAlpha;
+                normalTarget.RenderTargetWriteMask = target.RenderTargetWriteMask;
+            }
+            return normalized;
+        }
+
+        // Padding follows the two 8-bit stencil masks
+        template <typename DepthStencilDesc>
+        DepthStencilDesc NormalizeDepthStencilDesc(const DepthStencilDesc& desc)
+        {
+            DepthStencilDesc normalized = CreateZeroed<DepthStencilDesc>();
+
+            normalized.DepthEnable      = desc.DepthEnable;
+            normalized.DepthWriteMask   = desc.DepthWriteMask;
+            normalized.DepthFunc        = desc.DepthFunc;
+            normalized.StencilEnable    = desc.StencilEnable;
+            normalized.StencilReadMask  = desc.StencilReadMask;
+            normalized.StencilWriteMask = desc.StencilWriteMask;
+            normalized.FrontFace        = desc.FrontFace;
+            normalized.BackFace         = desc.BackFace;
+            return normalized;
+        }
+
+        // Only members of the same type, copied through a zeroed one all the same in case a header packs them otherwise
+        template <typename RasterizerDesc>
+        RasterizerDesc NormalizeRasterizerDesc(const RasterizerDesc& desc)
+        {
+            RasterizerDesc normalized = CreateZeroed<RasterizerDesc>();
+
+            normalized.FillMode              = desc.FillMode;
+            normalized.CullMode              = desc.CullMode;
+            normalized.FrontCounterClockwise = desc.FrontCounterClockwise;
+            normalized.DepthBias             = desc.DepthBias;
+            normalized.DepthBiasClamp        = desc.DepthBiasClamp;
+            normalized.SlopeScaledDepthBias  = desc.SlopeScaledDepthBias;
+            normalized.DepthClipEnable       = desc.DepthClipEnable;
+            normalized.ScissorEnable         = desc.ScissorEnable;
+            normalized.MultisampleEnable     = desc.MultisampleEnable;
+            normalized.AntialiasedLineEnable = desc.AntialiasedLineEnable;
+            return normalized;
+        }
+
+        template <typename SamplerDesc>
+        SamplerDesc NormalizeSamplerDesc(const SamplerDesc& desc)
+        {
+            SamplerDesc normalized = CreateZeroed<SamplerDesc>();
+
+            normalized.Filter         = desc.Filter;
+            normalized.AddressU       = desc.AddressU;
+            normalized.AddressV       = desc.AddressV;
+            normalized.AddressW       = desc.AddressW;
+            normalized.MipLODBias     = desc.MipLODBias;
+            normalized.MaxAnisotropy  = desc.MaxAnisotropy;
+            normalized.ComparisonFunc = desc.ComparisonFunc;
+            normalized.MinLOD         = desc.MinLOD;
+            normalized.MaxLOD         = desc.MaxLOD;
+            std::memcpy(normalized.BorderColor, desc.BorderColor, sizeof(normalized.BorderColor));
+            return normalized;
+        }
+    }
+}
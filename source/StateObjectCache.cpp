@@ -0,0 +1,89 @@
+// Built without the precompiled header, the cache knows nothing about D3D and its tests run on any platform
+#include "StateObjectCache.h"
+
+// Standard includes
+#include <cstring>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+        constexpr uint64_t FNV_PRIME  = 0x00000100000001B3ull;
+
+        uint64_t HashBytes(uint64_t hash, const void* dataPtr, size_t size)
+        {
+            const uint8_t* bytePtr = static_cast<const uint8_t*>(dataPtr);
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash = (hash ^ bytePtr[i]) * FNV_PRIME;
+            }
+            return hash;
+        }
+    }
+#pragma endregion
+
+#pragma region Initialization & Cleanup
+    StateObjectCache::StateObjectCache(IStateObjectFactory& factory)
+        : m_Factory{factory}
+    {
+    }
+
+    StateObjectCache::~StateObjectCache()
+    {
+        for (auto& [hash, entry] : m_Entries)
+        {
+            m_Factory.Destroy(entry.type, entry.objectPtr);
+        }
+    }
+#pragma endregion
+
+#pragma region Public
+    void* StateObjectCache::Acquire(StateObjectType type, const void* descPtr, size_t descSize)
+    {
+        ++m_Stats.lookups;
+
+        const uint64_t hash = HashDescriptor(type, descPtr, descSize);
+        const auto [first, last] = m_Entries.equal_range(hash);
+        for (auto it = first; it != last; ++it)
+        {
+            const Entry& entry = it->second;
+            if (entry.type == type and entry.desc.size() == descSize and std::memcmp(entry.desc.data(), descPtr, descSize) == 0)
+            {
+                ++m_Stats.hits;
+                return entry.objectPtr;
+            }
+        }
+
+        void* objectPtr = m_Factory.Create(type, descPtr, descSize);
+
+        ++m_Stats.creations;
+        if (m_IsSealed) ++m_Stats.lateCreations;
+
+        // Not cached, the next request for the descriptor asks the factory again
+        if (not objectPtr)
+        {
+            ++m_Stats.failures;
+            return nullptr;
+        }
+
+        Entry entry{};
+        entry.type      = type;
+        entry.desc.assign(static_cast<const uint8_t*>(descPtr), static_cast<const uint8_t*>(descPtr) + descSize);
+        entry.objectPtr = objectPtr;
+        m_Entries.emplace(hash, std::move(entry));
+
+        ++m_Stats.objectCounts[static_cast<size_t>(type)];
+        return objectPtr;
+    }
+#pragma endregion
+
+#pragma region Static Functions
+    uint64_t StateObjectCache::HashDescriptor(StateObjectType type, const void* descPtr, size_t descSize)
+    {
+        const uint64_t hash = HashBytes(FNV_OFFSET, &type, sizeof(type));
+        return HashBytes(hash, descPtr, descSize);
+    }
+#pragma endregion
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Standard includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace dae
+{
+    enum class StateObjectType : uint8_t
+    {
+        Rasterizer,
+        Blend,
+        DepthStencil,
+        Sampler,
+
+        COUNT
+    };
+
+    // Creates the objects the cache hands out, e.g. through an ID3D11Device. Behind an interface so the cache runs without D3D
+    class IStateObjectFactory
+    {
+    public:
+        virtual ~IStateObjectFactory() = default;
+
+        // descPtr points at the descriptor of type, nullptr when the device refuses it
+        virtual void* Create(StateObjectType type, const void* descPtr, size_t descSize) = 0;
+        virtual void  Destroy(StateObjectType type, void* objectPtr)                     = 0;
+    };
+
+    struct StateCacheStats
+    {
+        std::array<int, static_cast<size_t>(StateObjectType::COUNT)> objectCounts {}; // Alive, by StateObjectType
+
+        uint64_t lookups       = 0;
+        uint64_t hits          = 0;
+        uint64_t creations     = 0; // Calls to the factory, failed ones included
+        uint64_t failures      = 0; // Creations the factory refused, not cached so a later request tries again
+        uint64_t lateCreations = 0; // Creations after Seal(), runtime state changes that missed the prewarm
+    };
+
+    /**
+     * \brief One state object per unique descriptor, shared by everyone who asks for it and destroyed with the cache. Descriptors are hashed
+     * and compared byte for byte, so they have to be zeroed before they are filled when their type has padding; two descriptors that only
+     * differ in padding would otherwise be created twice. Meant to be prewarmed with every state the application switches between and then
+     * sealed, after which a creation is counted as late: changing state at runtime should never have to allocate a driver object.
+     */
+    class StateObjectCache final
+    {
+    public:
+        explicit StateObjectCache(IStateObjectFactory& factory);
+        ~StateObjectCache();
+
+        StateObjectCache(const StateObjectCache&)                = delete;
+        StateObjectCache(StateObjectCache&&) noexcept            = delete;
+        StateObjectCache& operator=(const StateObjectCache&)     = delete;
+        StateObjectCache& operator=(StateObjectCache&&) noexcept = delete;
+
+        // Borrowed, the cache keeps ownership. nullptr when the factory refused the descriptor
+        void* Acquire(StateObjectType type, const void* descPtr, size_t descSize);
+        template <typename Desc>
+        void* Acquire(StateObjectType type, const Desc& desc) { return Acquire(type, &desc, sizeof(Desc)); }
+
+        // The prewarm is done, creations from now on are counted as late
+        void Seal()           { m_IsSealed = true; }
+        bool IsSealed() const { return m_IsSealed; }
+
+        static uint64_t HashDescriptor(StateObjectType type, const void* descPtr, size_t descSize);
+
+        const StateCacheStats& GetStats() const { return m_Stats; }
+
+    private:
+        struct Entry
+        {
+            StateObjectType      type      = StateObjectType::Rasterizer;
+            std::vector<uint8_t> desc      {};
+            void*                objectPtr = nullptr;
+        };
+
+        IStateObjectFactory& m_Factory;
+
+        // By descriptor hash, a collision only costs a comparison
+        std::unordered_multimap<uint64_t, Entry> m_Entries  {};
+        bool                                     m_IsSealed = false;
+        StateCacheStats                          m_Stats    {};
+    };
+}
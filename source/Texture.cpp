@@ -2,6 +2,8 @@
 #include "Texture.h"
 
 // Project includes
+#include "PngDecoder.h"
+#include "TextureContainer.h"
 #include "Vector2.h"
 
 // SDL includes
@@ -9,27 +11,224 @@
 
 // Standard includes
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace dae
 {
-    Texture::Texture(SDL_Surface* pSurface) :
-        m_SurfacePtr{pSurface},
-        m_SurfacePixelsPtr{(uint32_t*)pSurface->pixels}
+    namespace
     {
-        
+        constexpr int LANES = 8;
+
+        // The built-in decoder covers our 8-bit RGB and RGBA PNGs, anything else still goes through SDL_image
+        std::vector<SDL_Surface*> LoadImages(const std::vector<std::string>& paths)
+        {
+            std::vector<SDL_Surface*> surfacePtrs = PngDecoder::LoadFiles(paths);
+            for (size_t i = 0; i < paths.size(); ++i)
+            {
+                if (not surfacePtrs[i]) surfacePtrs[i] = IMG_Load(paths[i].c_str());
+            }
+            return surfacePtrs;
+        }
+
+        SDL_Surface* LoadImage(const std::string& path)
+        {
+            if (SDL_Surface* surfacePtr = PngDecoder::Load(path)) return surfacePtr;
+            return IMG_Load(path.c_str());
+        }
+
+        // Indexed by the stored byte, replaces SDL_GetRGB and the three divisions per lookup
+        const std::array<float, 256>& GetDecodeTable(bool toLinear)
+        {
+            static const std::array<float, 256> unormTable = []
+            {
+                std::array<float, 256> result{};
+                for (int i = 0; i < 256; ++i) result[i] = static_cast<float>(i) / 255.0f;
+                return result;
+            }();
+
+            static const std::array<float, 256> srgbTable = []
+            {
+                std::array<float, 256> result{};
+                for (int i = 0; i < 256; ++i)
+                {
+                    const float value = static_cast<float>(i) / 255.0f;
+                    result[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+                }
+                return result;
+            }();
+
+            return toLinear ? srgbTable : unormTable;
+        }
+
+        ColorRGB Decode(uint32_t texel, const std::array<float, 256>& table)
+        {
+            return ColorRGB{table[texel & 0xFF], table[texel >> 8 & 0xFF], table[texel >> 16 & 0xFF]};
+        }
+
+        // Texel coordinate in [0, size) for wrap and mirror, clamping happens when it becomes an index.
+        // The scalar and AVX2 versions do the same float math, so single and batched lookups always agree
+        float AddressTexel(float coordinate, float size, AddressMode addressMode)
+        {
+            switch (addressMode)
+            {
+            case AddressMode::Wrap:
+                return coordinate - std::floor(coordinate / size) * size;
+            case AddressMode::Mirror:
+            {
+                const float period  = 2.0f * size;
+                const float wrapped = coordinate - std::floor(coordinate / period) * period;
+                return wrapped < size ? wrapped : period - wrapped;
+            }
+            default:
+                return coordinate;
+            }
+        }
+
+        // NaN and coordinates far outside the texture end up on the edges
+        int ToTexelIndex(float coordinate, int size)
+        {
+            if (not (coordinate > 0.0f)) return 0;
+            return coordinate < static_cast<float>(size) ? static_cast<int>(coordinate) : size - 1;
+        }
+
+#if defined(__AVX2__)
+        __m256 AddressTexel(__m256 coordinate, __m256 size, AddressMode addressMode)
+        {
+            switch (addressMode)
+            {
+            case AddressMode::Wrap:
+                return _mm256_sub_ps(coordinate, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(coordinate, size)), size));
+            case AddressMode::Mirror:
+            {
+                const __m256 period  = _mm256_add_ps(size, size);
+                const __m256 wrapped = _mm256_sub_ps(coordinate, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(coordinate, period)), period));
+                return _mm256_blendv_ps(wrapped, _mm256_sub_ps(period, wrapped), _mm256_cmp_ps(wrapped, size, _CMP_GE_OQ));
+            }
+            default:
+                return coordinate;
+            }
+        }
+
+        // Clamped in float first, the conversion of NaN and huge values is undefined
+        __m256i ToTexelIndex(__m256 coordinate, __m256i maxIndex)
+        {
+            const __m256 clamped = _mm256_min_ps(_mm256_max_ps(coordinate, _mm256_setzero_ps()), _mm256_cvtepi32_ps(_mm256_add_epi32(maxIndex, _mm256_set1_epi32(1))));
+            return _mm256_min_epi32(_mm256_cvttps_epi32(clamped), maxIndex);
+        }
+
+        // MipChain::GetTexelIndex for 8 texels of the same level
+        __m256i ToTexelOffset(__m256i x, __m256i y, __m256i rowPitch, TexelLayout layout)
+        {
+            if (layout == TexelLayout::Linear) return _mm256_add_epi32(_mm256_mullo_epi32(y, rowPitch), x);
+
+            const __m256i mask = _mm256_set1_epi32(MipChain::TILE_SIZE - 1);
+            const __m256i tile = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, MipChain::TILE_SHIFT), rowPitch),
+                                                  _mm256_slli_epi32(_mm256_srli_epi32(x, MipChain::TILE_SHIFT), 2 * MipChain::TILE_SHIFT));
+            return _mm256_add_epi32(tile, _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(y, mask), MipChain::TILE_SHIFT), _mm256_and_si256(x, mask)));
+        }
+#endif
+
+        DXGI_FORMAT ToDXGIFormat(BlockFormat format)
+        {
+            switch (format)
+            {
+            case BlockFormat::BC1: return DXGI_FORMAT_BC1_UNORM;
+            case BlockFormat::BC4: return DXGI_FORMAT_BC4_UNORM;
+            case BlockFormat::BC5: return DXGI_FORMAT_BC5_UNORM;
+            case BlockFormat::BC7: return DXGI_FORMAT_BC7_UNORM;
+            default:               return DXGI_FORMAT_R8G8B8A8_UNORM;
+            }
+        }
+    }
+
+    Texture::Texture(SDL_Surface* pSurface, SDL_Surface* alphaSurfacePtr, const MipSettings& mipSettings) :
+        m_SurfacePtr{pSurface}
+    {
+        InitializeMipChain(mipSettings, alphaSurfacePtr);
     }
 
-    Texture::Texture(SDL_Surface* pSurface, ID3D11Device* devicePtr) :
-        m_SurfacePtr{pSurface},
-        m_SurfacePixelsPtr{(uint32_t*)pSurface->pixels}
+    Texture::Texture(SDL_Surface* pSurface, SDL_Surface* alphaSurfacePtr, ID3D11Device* devicePtr, const MipSettings& mipSettings,
+                     const CompressionSettings& compressionSettings) :
+        m_SurfacePtr{pSurface}
     {
-        DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        InitializeMipChain(mipSettings, alphaSurfacePtr);
+
+        // Only lives until the upload, the software sampler keeps reading the RGBA8 chain
+        CompressedChain compressedChain{};
+        if (compressionSettings.format != BlockFormat::None and not m_MipChain.IsEmpty())
+        {
+            if (m_SurfacePtr->w % 4 == 0 and m_SurfacePtr->h % 4 == 0)
+            {
+                BlockCompressor{compressionSettings}.Compress(m_MipChain, compressedChain);
+                m_Format = compressionSettings.format;
+            }
+            else
+            {
+                std::cout << RED_TEXT("Texture::Texture() block compression needs sides that are multiples of 4, uploading RGBA8") << '\n';
+            }
+        }
+
+        // One subresource per mip level, the chain is already RGBA8 with R in the lowest byte
+        std::vector<D3D11_SUBRESOURCE_DATA> initData(std::max(m_MipChain.GetLevelCount(), 1));
+        if (not compressedChain.IsEmpty())
+        {
+            const int blockBytes = BlockCompressor::GetBlockBytes(m_Format);
+            for (int level = 0; level < compressedChain.GetLevelCount(); ++level)
+            {
+                const CompressedLevel& compressedLevel = compressedChain.levels[level];
+                initData[level].pSysMem          = compressedChain.GetLevelBlocks(level);
+                initData[level].SysMemPitch      = static_cast<UINT>(compressedLevel.blocksX * blockBytes);
+                initData[level].SysMemSlicePitch = static_cast<UINT>(compressedLevel.blocksX * compressedLevel.blocksY * blockBytes);
+            }
+        }
+        else if (m_MipChain.IsEmpty())
+        {
+            initData[0].pSysMem          = m_SurfacePtr->pixels;
+            initData[0].SysMemPitch      = static_cast<UINT>(m_SurfacePtr->pitch);
+            initData[0].SysMemSlicePitch = static_cast<UINT>(m_SurfacePtr->pitch * m_SurfacePtr->h);
+        }
+        else
+        {
+            for (int level = 0; level < m_MipChain.GetLevelCount(); ++level)
+            {
+                const MipLevel& mipLevel = m_MipChain.levels[level];
+                initData[level].pSysMem          = m_MipChain.GetLevelTexels(level);
+                initData[level].SysMemPitch      = static_cast<UINT>(mipLevel.width * sizeof(uint32_t));
+                initData[level].SysMemSlicePitch = static_cast<UINT>(mipLevel.width * mipLevel.height * sizeof(uint32_t));
+            }
+        }
         
+        if (not InitializeResource(devicePtr, m_SurfacePtr->w, m_SurfacePtr->h, initData)) return;
+
+        // Clean up
+        //=======================================================================================================
+        FreeSurface();
+    }
+
+    Texture::Texture(const TextureContainer& container, ID3D11Device* devicePtr, int firstLevel) :
+        m_Format{container.GetFormat()}
+    {
+        container.CopyMipChain(m_MipChain);
+        SetResidentLevels(container, devicePtr, firstLevel);
+    }
+
+    bool Texture::InitializeResource(ID3D11Device* devicePtr, int width, int height, const std::vector<D3D11_SUBRESOURCE_DATA>& initData)
+    {
+        const DXGI_FORMAT format = ToDXGIFormat(m_Format);
+
         D3D11_TEXTURE2D_DESC desc{};
-        desc.Width              = m_SurfacePtr->w;
-        desc.Height             = m_SurfacePtr->h;
-        desc.MipLevels          = 1;
+        desc.Width              = static_cast<UINT>(width);
+        desc.Height             = static_cast<UINT>(height);
+        desc.MipLevels          = static_cast<UINT>(initData.size());
         desc.ArraySize          = 1;
         desc.Format             = format;
         desc.SampleDesc.Count   = 1;
@@ -39,16 +238,11 @@ namespace dae
         desc.CPUAccessFlags     = 0;
         desc.MiscFlags          = 0;
 
-        D3D11_SUBRESOURCE_DATA initData;
-        initData.pSysMem          = m_SurfacePtr->pixels;
-        initData.SysMemPitch      = static_cast<UINT>(m_SurfacePtr->pitch);
-        initData.SysMemSlicePitch = static_cast<UINT>(m_SurfacePtr->pitch * m_SurfacePtr->h);
-
-        HRESULT hr = devicePtr->CreateTexture2D(&desc, &initData, &m_ResourcePtr);
+        HRESULT hr = devicePtr->CreateTexture2D(&desc, initData.data(), &m_ResourcePtr);
         if (FAILED(hr))
         {
-            std::cout << RED_TEXT("Texture::Texture() failed: ") << hr << '\n';
-            return;
+            std::cout << RED_TEXT("Texture::InitializeResource() failed: ") << hr << '\n';
+            return false;
         }
 
         D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc{};
@@ -59,13 +253,72 @@ namespace dae
         hr = devicePtr->CreateShaderResourceView(m_ResourcePtr, &SRVDesc, &m_SRVPtr);
         if (FAILED(hr))
         {
-            std::cout << RED_TEXT("Texture::Texture() failed: ") << hr << '\n';
+            std::cout << RED_TEXT("Texture::InitializeResource() failed: ") << hr << '\n';
+            return false;
+        }
+        return true;
+    }
+
+    void Texture::InitializeMipChain(const MipSettings& mipSettings, SDL_Surface* alphaSurfacePtr)
+    {
+        // Convert once to RGBA8 so the sampler never has to go through SDL_GetRGB
+        SDL_Surface* convertedPtr = SDL_ConvertSurfaceFormat(m_SurfacePtr, SDL_PIXELFORMAT_RGBA32, 0);
+        if (not convertedPtr)
+        {
+            std::cout << RED_TEXT("Texture::InitializeMipChain() failed: ") << SDL_GetError() << '\n';
             return;
         }
 
-        // Clean up
-        //=======================================================================================================
-        FreeSurface();
+        const int width  = convertedPtr->w;
+        const int height = convertedPtr->h;
+
+        m_MipChain.levels.push_back({width, height, 0});
+        m_MipChain.texels.resize(static_cast<size_t>(width) * height);
+
+        const uint8_t* sourcePtr = static_cast<const uint8_t*>(convertedPtr->pixels);
+        for (int y = 0; y < height; ++y)
+        {
+            std::memcpy(m_MipChain.GetLevelTexels(0) + static_cast<size_t>(y) * width, sourcePtr + static_cast<size_t>(y) * convertedPtr->pitch, width * sizeof(uint32_t));
+        }
+
+        SDL_FreeSurface(convertedPtr);
+
+        // Alpha is always filtered linearly, so packing before the mips keeps the packed channel identical to a separate map
+        if (alphaSurfacePtr) PackAlpha(alphaSurfacePtr);
+
+        MipGenerator{mipSettings}.Generate(m_MipChain);
+    }
+
+    void Texture::PackAlpha(SDL_Surface* alphaSurfacePtr)
+    {
+        const MipLevel& baseLevel = m_MipChain.levels[0];
+        if (alphaSurfacePtr->w != baseLevel.width or alphaSurfacePtr->h != baseLevel.height)
+        {
+            std::cout << RED_TEXT("Texture::PackAlpha() failed: the alpha source is ") << alphaSurfacePtr->w << 'x' << alphaSurfacePtr->h
+                      << RED_TEXT(" but the texture is ") << baseLevel.width << 'x' << baseLevel.height << '\n';
+            return;
+        }
+
+        SDL_Surface* convertedPtr = SDL_ConvertSurfaceFormat(alphaSurfacePtr, SDL_PIXELFORMAT_RGBA32, 0);
+        if (not convertedPtr)
+        {
+            std::cout << RED_TEXT("Texture::PackAlpha() failed: ") << SDL_GetError() << '\n';
+            return;
+        }
+
+        // R is the lowest byte of an RGBA32 texel, alpha the highest
+        uint32_t* texelsPtr = m_MipChain.GetLevelTexels(0);
+        for (int y = 0; y < baseLevel.height; ++y)
+        {
+            const uint8_t* sourcePtr = static_cast<const uint8_t*>(convertedPtr->pixels) + static_cast<size_t>(y) * convertedPtr->pitch;
+            uint32_t*      rowPtr    = texelsPtr + static_cast<size_t>(y) * baseLevel.width;
+            for (int x = 0; x < baseLevel.width; ++x)
+            {
+                rowPtr[x] = (rowPtr[x] & 0x00FFFFFF) | static_cast<uint32_t>(sourcePtr[x * 4]) << 24;
+            }
+        }
+
+        SDL_FreeSurface(convertedPtr);
     }
 
     void Texture::FreeSurface()
@@ -85,50 +338,205 @@ namespace dae
         SAFE_RELEASE(m_SRVPtr)
     }
 
-    Texture* Texture::LoadFromFile(const std::string& path)
+    Texture* Texture::LoadFromFile(const std::string& path, const MipSettings& mipSettings)
     {
-        SDL_Surface* pSurface = IMG_Load(path.c_str());
+        SDL_Surface* pSurface = LoadImage(path);
         if (!pSurface)
         {
             std::cout << RED_TEXT("Texture::LoadFromFile() failed: ") << SDL_GetError() << '\n';
             return nullptr;
         }
-        return new Texture(pSurface);
+        return new Texture(pSurface, nullptr, mipSettings);
     }
 
-    Texture* Texture::LoadFromFile(const std::string& path, ID3D11Device* devicePtr)
+    Texture* Texture::LoadFromFile(const std::string& path, ID3D11Device* devicePtr, const MipSettings& mipSettings, const CompressionSettings& compressionSettings)
     {
-        SDL_Surface* pSurface = IMG_Load(path.c_str());
+        if (TextureContainer::IsContainerPath(path))
+        {
+            // Only mapped while the resource is created, D3D11 copies the subresources
+            TextureContainer container{};
+            if (not container.Open(path)) return nullptr;
+
+            return new Texture(container, devicePtr, 0);
+        }
+
+        SDL_Surface* pSurface = LoadImage(path);
         if (!pSurface)
         {
             std::cout << RED_TEXT("Texture::LoadFromFile() failed: ") << SDL_GetError() << '\n';
             return nullptr;
         }
-        return new Texture(pSurface, devicePtr);
+        return new Texture(pSurface, nullptr, devicePtr, mipSettings, compressionSettings);
+    }
+
+    Texture* Texture::LoadPacked(const std::string& path, const std::string& alphaPath, const MipSettings& mipSettings)
+    {
+        // Both images are decoded at the same time
+        const std::vector<SDL_Surface*> surfacePtrs = LoadImages({path, alphaPath});
+
+        SDL_Surface* pSurface      = surfacePtrs[0];
+        SDL_Surface* pAlphaSurface = surfacePtrs[1];
+        if (!pSurface or !pAlphaSurface)
+        {
+            std::cout << RED_TEXT("Texture::LoadPacked() failed: ") << SDL_GetError() << '\n';
+            SDL_FreeSurface(pSurface);
+            SDL_FreeSurface(pAlphaSurface);
+            return nullptr;
+        }
+
+        Texture* texturePtr = new Texture(pSurface, pAlphaSurface, mipSettings);
+        SDL_FreeSurface(pAlphaSurface);
+        return texturePtr;
+    }
+
+    Texture* Texture::LoadPacked(const std::string& path, const std::string& alphaPath, ID3D11Device* devicePtr, const MipSettings& mipSettings,
+                                 const CompressionSettings& compressionSettings)
+    {
+        // Both images are decoded at the same time
+        const std::vector<SDL_Surface*> surfacePtrs = LoadImages({path, alphaPath});
+
+        SDL_Surface* pSurface      = surfacePtrs[0];
+        SDL_Surface* pAlphaSurface = surfacePtrs[1];
+        if (!pSurface or !pAlphaSurface)
+        {
+            std::cout << RED_TEXT("Texture::LoadPacked() failed: ") << SDL_GetError() << '\n';
+            SDL_FreeSurface(pSurface);
+            SDL_FreeSurface(pAlphaSurface);
+            return nullptr;
+        }
+
+        Texture* texturePtr = new Texture(pSurface, pAlphaSurface, devicePtr, mipSettings, compressionSettings);
+        SDL_FreeSurface(pAlphaSurface);
+        return texturePtr;
+    }
+
+    void Texture::SetTexelLayout(TexelLayout layout)
+    {
+        m_MipChain.ConvertLayout(layout);
+    }
+
+    Texture* Texture::LoadFromContainer(const TextureContainer& container, ID3D11Device* devicePtr, int firstLevel)
+    {
+        Texture* texturePtr = new Texture(container, devicePtr, firstLevel);
+        if (not texturePtr->m_SRVPtr)
+        {
+            delete texturePtr;
+            return nullptr;
+        }
+        return texturePtr;
+    }
+
+    bool Texture::SetResidentLevels(const TextureContainer& container, ID3D11Device* devicePtr, int firstLevel)
+    {
+        firstLevel = std::clamp(firstLevel, 0, container.GetLevelCount() - 1);
+
+        // Straight out of the mapping, the payload already is in its final format
+        std::vector<D3D11_SUBRESOURCE_DATA> initData(container.GetLevelCount() - firstLevel);
+        for (int level = firstLevel; level < container.GetLevelCount(); ++level)
+        {
+            initData[level - firstLevel].pSysMem          = container.GetLevelData(level);
+            initData[level - firstLevel].SysMemPitch      = container.GetRowPitch(level);
+            initData[level - firstLevel].SysMemSlicePitch = container.GetSlicePitch(level);
+        }
+
+        ID3D11Texture2D*          oldResourcePtr = m_ResourcePtr;
+        ID3D11ShaderResourceView* oldSRVPtr      = m_SRVPtr;
+        m_ResourcePtr = nullptr;
+        m_SRVPtr      = nullptr;
+
+        if (not InitializeResource(devicePtr, std::max(container.GetWidth() >> firstLevel, 1), std::max(container.GetHeight() >> firstLevel, 1), initData))
+        {
+            SAFE_RELEASE(m_ResourcePtr)
+            SAFE_RELEASE(m_SRVPtr)
+            m_ResourcePtr = oldResourcePtr;
+            m_SRVPtr      = oldSRVPtr;
+            return false;
+        }
+
+        SAFE_RELEASE(oldResourcePtr)
+        SAFE_RELEASE(oldSRVPtr)
+        m_FirstResidentLevel = firstLevel;
+        return true;
     }
 
     /**
-     * \brief Sample the correct texel for the given uv
+     * \brief Sample the nearest texel of level 0 for the given uv
      * \param uv 
-     * \return 
+     * \param addressMode What happens outside [0, 1]
+     * \param toLinear Decode sRGB texels to linear light
+     * \return Black when the texture has no CPU texels
      */
-    ColorRGB Texture::Sample(const Vector2& uv) const
+    ColorRGB Texture::Sample(const Vector2& uv, AddressMode addressMode, bool toLinear) const
     {
-        // Clamp uv to [0, 1]
-        float x {std::clamp(uv.x, 0.f, 1.f)};
-        float y {std::clamp(uv.y, 0.f, 1.f)};
+        if (m_MipChain.IsEmpty()) return ColorRGB{};
 
-        // Calculate the index of the pixel
-        x = x * static_cast<float>(m_SurfacePtr->w);
-        y = y * static_cast<float>(m_SurfacePtr->h);
-        const int index{static_cast<int>(y) * m_SurfacePtr->w + static_cast<int>(x)};
+        const MipLevel& level = m_MipChain.levels[0];
+        const int x = ToTexelIndex(AddressTexel(uv.x * static_cast<float>(level.width),  static_cast<float>(level.width),  addressMode), level.width);
+        const int y = ToTexelIndex(AddressTexel(uv.y * static_cast<float>(level.height), static_cast<float>(level.height), addressMode), level.height);
 
-        // Get the pixel at the index
-        const uint32_t pixel{m_SurfacePixelsPtr[index]};
+        return Decode(m_MipChain.GetTexel(0, x, y), GetDecodeTable(toLinear));
+    }
 
-        // Convert the pixel to a ColorRGB, range [0, 1]
-        uint8_t r, g, b;
-        SDL_GetRGB(pixel, m_SurfacePtr->format, &r, &g, &b);
-        return ColorRGB{static_cast<float>(r) / 255.0f, static_cast<float>(g) / 255.0f, static_cast<float>(b) / 255.0f};
+    void Texture::Sample(std::span<const Vector2> uvs, std::span<ColorRGB> colors, AddressMode addressMode, bool toLinear) const
+    {
+        assert(colors.size() >= uvs.size() and "Texture::Sample() needs a color for every uv!");
+
+        if (m_MipChain.IsEmpty())
+        {
+            std::fill_n(colors.begin(), uvs.size(), ColorRGB{});
+            return;
+        }
+
+        const MipLevel&               level    = m_MipChain.levels[0];
+        const std::array<float, 256>& table    = GetDecodeTable(toLinear);
+        const float                   width    = static_cast<float>(level.width);
+        const float                   height   = static_cast<float>(level.height);
+        const TexelLayout             layout   = m_MipChain.layout;
+        const int                     rowPitch = MipChain::GetRowPitch(level.width, layout);
+
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256  fWidth  = _mm256_set1_ps(width);
+        const __m256  fHeight = _mm256_set1_ps(height);
+        const __m256i maxX    = _mm256_set1_epi32(level.width  - 1);
+        const __m256i maxY    = _mm256_set1_epi32(level.height - 1);
+        const __m256i pitch   = _mm256_set1_epi32(rowPitch);
+        const __m256i byte    = _mm256_set1_epi32(0xFF);
+        const int*    texels  = reinterpret_cast<const int*>(m_MipChain.texels.data());
+
+        alignas(32) float r[LANES];
+        alignas(32) float g[LANES];
+        alignas(32) float b[LANES];
+
+        for (; i + LANES <= uvs.size(); i += LANES)
+        {
+            // x0 y0 ... x7 y7 into x0..x7 and y0..y7
+            const __m256 first  = _mm256_loadu_ps(&uvs[i].x);
+            const __m256 second = _mm256_loadu_ps(&uvs[i + 4].x);
+            const __m256 u = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+            const __m256 v = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+
+            const __m256i x = ToTexelIndex(AddressTexel(_mm256_mul_ps(u, fWidth),  fWidth,  addressMode), maxX);
+            const __m256i y = ToTexelIndex(AddressTexel(_mm256_mul_ps(v, fHeight), fHeight, addressMode), maxY);
+
+            const __m256i texel = _mm256_i32gather_epi32(texels, ToTexelOffset(x, y, pitch, layout), 4);
+
+            _mm256_store_ps(r, _mm256_i32gather_ps(table.data(), _mm256_and_si256(texel, byte),                         4));
+            _mm256_store_ps(g, _mm256_i32gather_ps(table.data(), _mm256_and_si256(_mm256_srli_epi32(texel, 8),  byte), 4));
+            _mm256_store_ps(b, _mm256_i32gather_ps(table.data(), _mm256_and_si256(_mm256_srli_epi32(texel, 16), byte), 4));
+
+            for (int lane = 0; lane < LANES; ++lane)
+            {
+                colors[i + lane] = ColorRGB{r[lane], g[lane], b[lane]};
+            }
+        }
+#endif
+        for (; i < uvs.size(); ++i)
+        {
+            const int x = ToTexelIndex(AddressTexel(uvs[i].x * width,  width,  addressMode), level.width);
+            const int y = ToTexelIndex(AddressTexel(uvs[i].y * height, height, addressMode), level.height);
+
+            colors[i] = Decode(m_MipChain.texels[MipChain::GetTexelIndex(x, y, rowPitch, layout)], table);
+        }
     }
 }
@@ -1,12 +1,28 @@
 #pragma once
 #include <SDL_surface.h>
+#include <span>
 #include <string>
+#include <vector>
+#include "BlockCompressor.h"
 #include "ColorRGB.h"
+#include "MipChain.h"
+#include "MipGenerator.h"
 
 namespace dae
 {
+    class TextureContainer;
     struct Vector2;
 
+    // D3D11_TEXTURE_ADDRESS_* for the lookups of Texture::Sample, the Sampler always wraps like the samplers in the .fx files
+    enum class AddressMode
+    {
+        Wrap,
+        Clamp,
+        Mirror,
+
+        COUNT
+    };
+
     class Texture final
     {
     public:
@@ -18,19 +34,58 @@ namespace dae
         Texture& operator=(const Texture& other)     = delete;
         Texture& operator=(Texture&& other) noexcept = delete;
 
-        static Texture* LoadFromFile(const std::string& path);
-        static Texture* LoadFromFile(const std::string& path, ID3D11Device* devicePtr);
-        ColorRGB Sample(const Vector2& uv) const;
-        inline ID3D11ShaderResourceView* GetSRV() const { return m_SRVPtr; }
+        static Texture* LoadFromFile(const std::string& path, const MipSettings& mipSettings = MipSettings{});
+        // A .dtex path is memory-mapped and uploaded as baked, the settings only apply to images that still need decoding
+        static Texture* LoadFromFile(const std::string& path, ID3D11Device* devicePtr, const MipSettings& mipSettings = MipSettings{},
+                                     const CompressionSettings& compressionSettings = CompressionSettings{});
+
+        // The red channel of alphaPath replaces the alpha of path before the mips are built, e.g. glossiness next to specular RGB
+        static Texture* LoadPacked(const std::string& path, const std::string& alphaPath, const MipSettings& mipSettings = MipSettings{});
+        static Texture* LoadPacked(const std::string& path, const std::string& alphaPath, ID3D11Device* devicePtr, const MipSettings& mipSettings = MipSettings{},
+                                   const CompressionSettings& compressionSettings = CompressionSettings{});
+
+        // Nearest texel of level 0, decoded through a 256-entry table. toLinear converts sRGB texels to linear light, otherwise the stored value / 255 is returned
+        ColorRGB Sample(const Vector2& uv, AddressMode addressMode = AddressMode::Clamp, bool toLinear = false) const;
+        // Same lookup for every uv, 8 at a time with AVX2. colors needs at least as many elements as uvs
+        void     Sample(std::span<const Vector2> uvs, std::span<ColorRGB> colors, AddressMode addressMode = AddressMode::Clamp, bool toLinear = false) const;
+
+        // Uploads only the levels from firstLevel down, the residency manager streams the finer ones in from the same container later.
+        // The CPU copy always holds the full chain
+        static Texture* LoadFromContainer(const TextureContainer& container, ID3D11Device* devicePtr, int firstLevel = 0);
+
+        // Reorders the CPU copy for the software sampler, the GPU copy was uploaded row-major when the texture was created
+        void SetTexelLayout(TexelLayout layout);
+
+        // Recreates the GPU copy from levels [firstLevel, last] of the container it was loaded from. The SRV changes, so it has to be bound again.
+        // The old copy is kept when the new one cannot be created
+        bool SetResidentLevels(const TextureContainer& container, ID3D11Device* devicePtr, int firstLevel);
+
+        inline ID3D11ShaderResourceView* GetSRV()                const { return m_SRVPtr;             }
+        inline const MipChain&           GetMipChain()           const { return m_MipChain;           }
+        inline BlockFormat               GetFormat()             const { return m_Format;             }
+        inline int                       GetFirstResidentLevel() const { return m_FirstResidentLevel; }
 
     private:
-        Texture(SDL_Surface* pSurface);
-        Texture(SDL_Surface* pSurface, ID3D11Device* devicePtr);
+        // alphaSurfacePtr is optional and stays owned by the caller
+        Texture(SDL_Surface* pSurface, SDL_Surface* alphaSurfacePtr, const MipSettings& mipSettings);
+        Texture(SDL_Surface* pSurface, SDL_Surface* alphaSurfacePtr, ID3D11Device* devicePtr, const MipSettings& mipSettings, const CompressionSettings& compressionSettings);
+        Texture(const TextureContainer& container, ID3D11Device* devicePtr, int firstLevel);
 
         void FreeSurface();
+        void InitializeMipChain(const MipSettings& mipSettings, SDL_Surface* alphaSurfacePtr);
+        void PackAlpha(SDL_Surface* alphaSurfacePtr);
+        bool InitializeResource(ID3D11Device* devicePtr, int width, int height, const std::vector<D3D11_SUBRESOURCE_DATA>& initData);
+
+        SDL_Surface* m_SurfacePtr = nullptr;
+
+        // Full mip chain in RGBA8 whatever the source format was, uploaded to the GPU and read by every CPU lookup, outlives the surface
+        MipChain m_MipChain {};
+
+        // What the GPU copy is stored as, the CPU copy always stays RGBA8
+        BlockFormat m_Format = BlockFormat::None;
 
-        SDL_Surface* m_SurfacePtr       = nullptr;
-        uint32_t*    m_SurfacePixelsPtr = nullptr;
+        // Level of the CPU chain that is level 0 of the GPU copy, only containers upload less than the full chain
+        int m_FirstResidentLevel = 0;
 
         // DirectX
         ID3D11ShaderResourceView* m_SRVPtr      = nullptr;
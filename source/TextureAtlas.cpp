@@ -0,0 +1,348 @@
+#include "pch.h"
+#include "TextureAtlas.h"
+
+// Project includes
+#include "Mesh.h"
+#include "Texture.h"
+#include "TextureContainer.h"
+
+// imgui_draw.cpp compiles its copy of imstb_rectpack with internal linkage, so this one is private as well
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+// Standard includes
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr const char* TABLE_MAGIC   = "DATLAS";
+        constexpr int         TABLE_VERSION = 1;
+
+        int Wrap(int coordinate, int size)
+        {
+            const int wrapped = coordinate % size;
+            return wrapped < 0 ? wrapped + size : wrapped;
+        }
+
+        // Every level of the source into the same level of the page, the gutter repeats the texture like D3D11_TEXTURE_ADDRESS_WRAP.
+        // A coarse level can have a gutter wider than itself, then it repeats more than once
+        void BlitWrapped(const MipChain& source, MipChain& page, const AtlasRect& rect)
+        {
+            std::vector<uint32_t> row(rect.width);
+            for (int level = 0; level < page.GetLevelCount(); ++level)
+            {
+                const int width     = rect.width  >> level;
+                const int height    = rect.height >> level;
+                const int gutter    = rect.gutter >> level;
+                const int pageWidth = page.levels[level].width;
+
+                uint32_t* originPtr = page.GetLevelTexels(level) + static_cast<size_t>(rect.y >> level) * pageWidth + (rect.x >> level);
+                for (int y = -gutter; y < height + gutter; ++y)
+                {
+                    source.ReadRow(level, Wrap(y, height), row.data());
+
+                    uint32_t* rowPtr = originPtr + static_cast<ptrdiff_t>(y) * pageWidth;
+                    for (int x = -gutter; x < width + gutter; ++x) rowPtr[x] = row[Wrap(x, width)];
+                }
+            }
+        }
+    }
+#pragma endregion
+
+#pragma region Public
+    bool TextureAtlas::Build(const std::vector<TextureAsset>& assets, const AtlasSettings& settings)
+    {
+        std::vector<std::string>     names{};
+        std::vector<const Texture*>  texturePtrs{};
+        std::vector<const MipChain*> mipChainPtrs{};
+        for (const TextureAsset& asset : assets)
+        {
+            const Texture* texturePtr = asset.alphaPath.empty() ? Texture::LoadFromFile(asset.path, asset.mipSettings)
+                                                                : Texture::LoadPacked(asset.path, asset.alphaPath, asset.mipSettings);
+            if (not texturePtr) continue;
+
+            names.push_back(asset.path);
+            texturePtrs.push_back(texturePtr);
+            mipChainPtrs.push_back(&texturePtr->GetMipChain());
+        }
+
+        const bool isBuilt = Build(names, mipChainPtrs, settings);
+        for (const Texture* texturePtr : texturePtrs) delete texturePtr;
+
+        return isBuilt;
+    }
+
+    bool TextureAtlas::Build(const std::vector<std::string>& names, const std::vector<const MipChain*>& mipChainPtrs, const AtlasSettings& settings)
+    {
+        m_PageSizes.clear();
+        m_Pages.clear();
+        m_Names.clear();
+        m_Rects.clear();
+        m_RectIdxs.clear();
+
+        m_Settings            = settings;
+        m_Settings.levelCount = std::clamp(settings.levelCount, 1, 16);
+
+        // The packer works in units of the alignment, which keeps every rectangle on whole texels down to the last level of the page
+        const int alignment = 1 << (m_Settings.levelCount - 1);
+        const int gutter    = (std::max(settings.gutter, alignment) + alignment - 1) / alignment * alignment;
+        const int maxUnits  = settings.maxPageSize / alignment;
+        m_Settings.gutter   = gutter;
+
+        std::vector<stbrp_rect> pendingRects{};
+        for (size_t i = 0; i < mipChainPtrs.size(); ++i)
+        {
+            const MipChain& mipChain = *mipChainPtrs[i];
+            if (mipChain.IsEmpty()) continue;
+
+            const int width  = mipChain.levels[0].width;
+            const int height = mipChain.levels[0].height;
+            if (width % alignment != 0 or height % alignment != 0 or mipChain.GetLevelCount() < m_Settings.levelCount)
+            {
+                std::cout << RED_TEXT("TextureAtlas::Build() skipped ") << names[i] << ": " << width << 'x' << height
+                          << " is not a multiple of " << alignment << " texels\n";
+                continue;
+            }
+
+            stbrp_rect rect{};
+            rect.id = static_cast<int>(i);
+            rect.w  = (width  + 2 * gutter) / alignment;
+            rect.h  = (height + 2 * gutter) / alignment;
+            pendingRects.push_back(rect);
+        }
+
+        std::vector<stbrp_node> nodes(std::max(maxUnits, 1));
+        while (not pendingRects.empty())
+        {
+            stbrp_context context{};
+            stbrp_init_target(&context, maxUnits, maxUnits, nodes.data(), static_cast<int>(nodes.size()));
+            stbrp_pack_rects(&context, pendingRects.data(), static_cast<int>(pendingRects.size()));
+
+            std::vector<stbrp_rect> packedRects{};
+            std::vector<stbrp_rect> spilledRects{};
+            int                     usedUnitsX = 0;
+            int                     usedUnitsY = 0;
+            for (const stbrp_rect& rect : pendingRects)
+            {
+                if (not rect.was_packed)
+                {
+                    spilledRects.push_back(rect);
+                    continue;
+                }
+                packedRects.push_back(rect);
+                usedUnitsX = std::max(usedUnitsX, rect.x + rect.w);
+                usedUnitsY = std::max(usedUnitsY, rect.y + rect.h);
+            }
+
+            // Nothing fits an empty page, so none of the rest ever will
+            if (packedRects.empty())
+            {
+                for (const stbrp_rect& rect : spilledRects)
+                {
+                    std::cout << RED_TEXT("TextureAtlas::Build() skipped ") << names[rect.id] << ": larger than a "
+                              << settings.maxPageSize << 'x' << settings.maxPageSize << " page with its gutter\n";
+                }
+                break;
+            }
+
+            const int page = GetPageCount();
+            m_PageSizes.emplace_back(usedUnitsX * alignment, usedUnitsY * alignment);
+
+            MipChain& pageChain = m_Pages.emplace_back();
+            for (int level = 0; level < m_Settings.levelCount; ++level)
+            {
+                pageChain.AddLevel(m_PageSizes.back().first >> level, m_PageSizes.back().second >> level);
+            }
+
+            for (const stbrp_rect& packedRect : packedRects)
+            {
+                const MipChain& source = *mipChainPtrs[packedRect.id];
+
+                AtlasRect rect{};
+                rect.page   = page;
+                rect.x      = packedRect.x * alignment + gutter;
+                rect.y      = packedRect.y * alignment + gutter;
+                rect.width  = source.levels[0].width;
+                rect.height = source.levels[0].height;
+                rect.gutter = gutter;
+
+                BlitWrapped(source, pageChain, rect);
+                AddRect(names[packedRect.id], rect);
+            }
+
+            pendingRects = std::move(spilledRects);
+        }
+
+        return not m_Rects.empty();
+    }
+
+    bool TextureAtlas::Write(const std::string& tablePath) const
+    {
+        if (m_Pages.empty() or m_Pages.size() != m_PageSizes.size())
+        {
+            std::cout << RED_TEXT("TextureAtlas::Write() has no pages to write: ") << tablePath << '\n';
+            return false;
+        }
+
+        // The pages first, a table is only ever newer than the pages it points into
+        for (int page = 0; page < GetPageCount(); ++page)
+        {
+            CompressedChain compressedChain{};
+            if (m_Settings.compressionSettings.format != BlockFormat::None)
+            {
+                BlockCompressor{m_Settings.compressionSettings}.Compress(m_Pages[page], compressedChain);
+            }
+
+            if (not TextureContainer::Write(GetPagePath(tablePath, page), m_Pages[page], compressedChain)) return false;
+        }
+
+        std::ofstream file{tablePath};
+        if (not file)
+        {
+            std::cout << RED_TEXT("TextureAtlas::Write() failed to open ") << tablePath << '\n';
+            return false;
+        }
+
+        file << TABLE_MAGIC << ' ' << TABLE_VERSION << '\n';
+        for (const auto& [width, height] : m_PageSizes)
+        {
+            file << "page " << width << ' ' << height << '\n';
+        }
+        for (size_t i = 0; i < m_Rects.size(); ++i)
+        {
+            const AtlasRect& rect = m_Rects[i];
+            file << "rect " << std::quoted(m_Names[i]) << ' ' << rect.page << ' ' << rect.x << ' ' << rect.y << ' '
+                 << rect.width << ' ' << rect.height << ' ' << rect.gutter << '\n';
+        }
+
+        if (not file.good()) return false;
+
+        std::cout << GREEN_TEXT("**(CONVERTER) Baked ") << MAGENTA_TEXT("" + tablePath + "") << " = " << m_Rects.size() << " texture(s) in "
+                  << m_PageSizes.size() << " page(s), " << std::fixed << std::setprecision(2) << GetOccupancy() * 100.0f << "% occupied"
+                  << std::defaultfloat << '\n';
+        return true;
+    }
+
+    bool TextureAtlas::Read(const std::string& tablePath)
+    {
+        m_PageSizes.clear();
+        m_Pages.clear();
+        m_Names.clear();
+        m_Rects.clear();
+        m_RectIdxs.clear();
+
+        std::ifstream file{tablePath};
+        if (not file) return false;
+
+        std::string magic{};
+        int         version = 0;
+        if (not (file >> magic >> version) or magic != TABLE_MAGIC or version != TABLE_VERSION)
+        {
+            std::cout << RED_TEXT("TextureAtlas::Read() rejected ") << tablePath << ": not a version " << TABLE_VERSION << " table\n";
+            return false;
+        }
+
+        // Every page is declared before the rectangles that point into it
+        std::string keyword{};
+        while (file >> keyword)
+        {
+            bool isValid = false;
+            if (keyword == "page")
+            {
+                int width  = 0;
+                int height = 0;
+                isValid = static_cast<bool>(file >> width >> height) and width > 0 and height > 0;
+                if (isValid) m_PageSizes.emplace_back(width, height);
+            }
+            else if (keyword == "rect")
+            {
+                std::string name{};
+                AtlasRect   rect{};
+                isValid = static_cast<bool>(file >> std::quoted(name) >> rect.page >> rect.x >> rect.y >> rect.width >> rect.height >> rect.gutter)
+                      and rect.page >= 0 and rect.page < GetPageCount() and rect.width > 0 and rect.height > 0 and rect.gutter >= 0
+                      and rect.x - rect.gutter >= 0 and rect.x + rect.width  + rect.gutter <= m_PageSizes[rect.page].first
+                      and rect.y - rect.gutter >= 0 and rect.y + rect.height + rect.gutter <= m_PageSizes[rect.page].second;
+                if (isValid) AddRect(name, rect);
+            }
+
+            if (not isValid)
+            {
+                std::cout << RED_TEXT("TextureAtlas::Read() rejected ") << tablePath << ": invalid " << keyword << " entry\n";
+                m_PageSizes.clear();
+                m_Names.clear();
+                m_Rects.clear();
+                m_RectIdxs.clear();
+                return false;
+            }
+        }
+        return not m_Rects.empty();
+    }
+
+    const AtlasRect* TextureAtlas::Find(const std::string& name) const
+    {
+        const auto it = m_RectIdxs.find(name);
+        return it == m_RectIdxs.end() ? nullptr : &m_Rects[it->second];
+    }
+
+    float TextureAtlas::GetOccupancy() const
+    {
+        double pageTexels = 0.0;
+        double rectTexels = 0.0;
+        for (const auto& [width, height] : m_PageSizes) pageTexels += static_cast<double>(width) * height;
+        for (const AtlasRect& rect : m_Rects)           rectTexels += static_cast<double>(rect.width) * rect.height;
+
+        return pageTexels > 0.0 ? static_cast<float>(rectTexels / pageTexels) : 0.0f;
+    }
+
+    std::string TextureAtlas::GetPagePath(const std::string& tablePath, int page)
+    {
+        const size_t extensionStart = tablePath.find_last_of('.');
+        const size_t fileStart      = tablePath.find_last_of("/\\");
+        const bool   hasExtension   = extensionStart != std::string::npos and (fileStart == std::string::npos or extensionStart > fileStart);
+
+        return (hasExtension ? tablePath.substr(0, extensionStart) : tablePath) + '_' + std::to_string(page) + TextureContainer::EXTENSION;
+    }
+
+    int TextureAtlas::RemapUVs(std::vector<Vertex>& vertices, const AtlasRect& rect)
+    {
+        const float marginU = static_cast<float>(rect.gutter) / static_cast<float>(rect.width);
+        const float marginV = static_cast<float>(rect.gutter) / static_cast<float>(rect.height);
+
+        int numOutside = 0;
+        for (Vertex& vertex : vertices)
+        {
+            Vector2& uv = vertex.uv;
+            if (uv.x < -marginU or uv.x > 1.0f + marginU or uv.y < -marginV or uv.y > 1.0f + marginV) ++numOutside;
+
+            uv.x = rect.uvOffset.x + uv.x * rect.uvScale.x;
+            uv.y = rect.uvOffset.y + uv.y * rect.uvScale.y;
+        }
+        return numOutside;
+    }
+#pragma endregion
+
+#pragma region Private
+    void TextureAtlas::AddRect(const std::string& name, AtlasRect rect)
+    {
+        const float pageWidth  = static_cast<float>(m_PageSizes[rect.page].first);
+        const float pageHeight = static_cast<float>(m_PageSizes[rect.page].second);
+
+        rect.uvOffset = Vector2{static_cast<float>(rect.x)     / pageWidth, static_cast<float>(rect.y)      / pageHeight};
+        rect.uvScale  = Vector2{static_cast<float>(rect.width) / pageWidth, static_cast<float>(rect.height) / pageHeight};
+
+        // A name that comes twice keeps its first rectangle
+        if (m_RectIdxs.emplace(name, m_Rects.size()).second)
+        {
+            m_Names.push_back(name);
+            m_Rects.push_back(rect);
+        }
+    }
+#pragma endregion
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "BlockCompressor.h"
+#include "MipChain.h"
+#include "Vector2.h"
+
+// Standard includes
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dae
+{
+    // Forward declarations
+    struct TextureAsset;
+    struct Vertex;
+
+    struct AtlasSettings
+    {
+        int                 maxPageSize         = 4096; // Pages are trimmed to what was packed into them
+        int                 levelCount          = 6;    // Of every page. Rectangles start on multiples of 2^(levelCount - 1) texels, so each level stays exact
+        int                 gutter              = 32;   // Wrapped border around every texture, rounded up to the alignment
+        CompressionSettings compressionSettings {};
+    };
+
+    // Where one texture ended up, in level 0 texels of its page without the gutter
+    struct AtlasRect
+    {
+        int     page     = 0;
+        int     x        = 0;
+        int     y        = 0;
+        int     width    = 0;
+        int     height   = 0;
+        int     gutter   = 0;
+        Vector2 uvOffset {};       // Page uv = uv * uvScale + uvOffset
+        Vector2 uvScale  {1.0f, 1.0f};
+    };
+
+    /**
+     * \brief Packs many small textures into a few large pages with imstb_rectpack, so the meshes that use them can share one binding.
+     * Every texture is surrounded by a gutter that repeats it the way the WRAP samplers would, level by level from its own mip chain,
+     * so a bilinear or trilinear lookup never reaches a neighbour as long as the UVs stay within the gutter.
+     * The pages are written as .dtex containers next to a text table that maps every source to its rectangle; the UVs of the meshes are remapped when they are loaded.
+     */
+    class TextureAtlas final
+    {
+    public:
+        static constexpr const char* EXTENSION = ".atlas";
+
+        TextureAtlas() = default;
+        ~TextureAtlas() = default;
+
+        TextureAtlas(const TextureAtlas&)                = delete;
+        TextureAtlas(TextureAtlas&&) noexcept            = delete;
+        TextureAtlas& operator=(const TextureAtlas&)     = delete;
+        TextureAtlas& operator=(TextureAtlas&&) noexcept = delete;
+
+        // Decodes every asset for the CPU only. Sources whose sides are not multiples of the alignment, or that do not fit in a page, are skipped
+        bool Build(const std::vector<TextureAsset>& assets, const AtlasSettings& settings = AtlasSettings{});
+        // Any layout, names are what Find() looks the rectangles up by
+        bool Build(const std::vector<std::string>& names, const std::vector<const MipChain*>& mipChainPtrs, const AtlasSettings& settings = AtlasSettings{});
+
+        // The table at tablePath, every page next to it as GetPagePath()
+        bool Write(const std::string& tablePath) const;
+        // Only the table, the pages are loaded as textures
+        bool Read(const std::string& tablePath);
+
+        // nullptr when name was not packed
+        const AtlasRect* Find(const std::string& name) const;
+
+        int             GetPageCount()       const { return static_cast<int>(m_PageSizes.size()); }
+        int             GetRectCount()       const { return static_cast<int>(m_Rects.size()); }
+        const MipChain& GetPage(int page)    const { return m_Pages[page]; } // After Build() only
+        // Share of the page texels that belong to a texture, gutters not included
+        float           GetOccupancy()       const;
+
+        static std::string GetPagePath(const std::string& tablePath, int page);
+
+        // Moves the UVs into the rectangle. Returns how many vertices lie beyond the gutter, their triangles bleed into whatever is next to it
+        static int RemapUVs(std::vector<Vertex>& vertices, const AtlasRect& rect);
+
+    private:
+        void AddRect(const std::string& name, AtlasRect rect);
+
+        std::vector<std::pair<int, int>>        m_PageSizes {};
+        std::vector<MipChain>                   m_Pages     {};
+        std::vector<std::string>                m_Names     {};
+        std::vector<AtlasRect>                  m_Rects     {};
+        std::unordered_map<std::string, size_t> m_RectIdxs  {};
+        AtlasSettings                           m_Settings  {};
+    };
+}
@@ -0,0 +1,345 @@
+#include "pch.h"
+#include "TextureContainer.h"
+
+// Project includes
+#include "MipChain.h"
+#include "Texture.h"
+
+// Standard includes
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr uint32_t MAGIC      = 0x58455444; // "DTEX"
+        constexpr uint32_t VERSION    = 1;
+        constexpr uint64_t ALIGNMENT  = 16;         // Enough for the SIMD loads of the sampler and the MipGenerator
+        constexpr int      MAX_LEVELS = 16;
+
+        // On-disk layout, little endian. The level table follows the header, every payload starts on an ALIGNMENT boundary
+        struct ContainerHeader
+        {
+            uint32_t magic      = MAGIC;
+            uint32_t version    = VERSION;
+            uint32_t width      = 0;
+            uint32_t height     = 0;
+            uint32_t levelCount = 0;
+            uint32_t format     = 0; // BlockFormat of the GPU levels
+            uint64_t fileSize   = 0;
+        };
+
+        struct ContainerLevel
+        {
+            uint32_t width      = 0;
+            uint32_t height     = 0;
+            uint32_t rowPitch   = 0; // Of the GPU payload, in bytes
+            uint32_t slicePitch = 0;
+            uint64_t gpuOffset  = 0; // From the start of the file
+            uint64_t cpuOffset  = 0; // RGBA8 copy, the same as gpuOffset when the GPU level is RGBA8
+        };
+
+        static_assert(sizeof(ContainerHeader) == 32 and sizeof(ContainerLevel) == 32, "The container layout must not depend on the compiler");
+
+        uint64_t AlignUp(uint64_t value)
+        {
+            return (value + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+
+        const ContainerHeader& GetHeader(const uint8_t* dataPtr)
+        {
+            return *reinterpret_cast<const ContainerHeader*>(dataPtr);
+        }
+
+        const ContainerLevel& GetLevel(const uint8_t* dataPtr, int level)
+        {
+            return reinterpret_cast<const ContainerLevel*>(dataPtr + sizeof(ContainerHeader))[level];
+        }
+
+        bool IsInside(uint64_t offset, uint64_t size, uint64_t fileSize)
+        {
+            return offset <= fileSize and size <= fileSize - offset;
+        }
+    }
+#pragma endregion
+
+#pragma region Public
+    TextureContainer::~TextureContainer()
+    {
+        Close();
+    }
+
+    bool TextureContainer::Open(const std::string& path)
+    {
+        Close();
+
+        m_FileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_FileHandle == INVALID_HANDLE_VALUE)
+        {
+            std::cout << RED_TEXT("TextureContainer::Open() could not open ") << path << '\n';
+            return false;
+        }
+
+        LARGE_INTEGER fileSize{};
+        if (not GetFileSizeEx(m_FileHandle, &fileSize) or fileSize.QuadPart < static_cast<LONGLONG>(sizeof(ContainerHeader)))
+        {
+            std::cout << RED_TEXT("TextureContainer::Open() file too small: ") << path << '\n';
+            Close();
+            return false;
+        }
+
+        m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_MappingHandle)
+        {
+            m_DataPtr = static_cast<const uint8_t*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+        }
+
+        if (not m_DataPtr)
+        {
+            std::cout << RED_TEXT("TextureContainer::Open() could not map ") << path << '\n';
+            Close();
+            return false;
+        }
+        m_Size = static_cast<size_t>(fileSize.QuadPart);
+
+        // Nothing below trusts the file: every offset is checked once here so the getters do not have to
+        const ContainerHeader& header = GetHeader(m_DataPtr);
+
+        bool isValid = header.magic == MAGIC and header.version == VERSION and header.fileSize == m_Size
+                   and header.levelCount > 0 and header.levelCount <= MAX_LEVELS and header.format < static_cast<uint32_t>(BlockFormat::COUNT)
+                   and IsInside(sizeof(ContainerHeader), sizeof(ContainerLevel) * header.levelCount, m_Size);
+
+        for (int level = 0; isValid and level < static_cast<int>(header.levelCount); ++level)
+        {
+            const ContainerLevel& containerLevel = GetLevel(m_DataPtr, level);
+            const uint64_t        texelBytes     = static_cast<uint64_t>(containerLevel.width) * containerLevel.height * sizeof(uint32_t);
+
+            isValid = containerLevel.width > 0 and containerLevel.height > 0
+                  and containerLevel.gpuOffset % ALIGNMENT == 0 and containerLevel.cpuOffset % ALIGNMENT == 0
+                  and IsInside(containerLevel.gpuOffset, containerLevel.slicePitch, m_Size)
+                  and IsInside(containerLevel.cpuOffset, texelBytes, m_Size);
+        }
+
+        if (not isValid)
+        {
+            std::cout << RED_TEXT("TextureContainer::Open() invalid or outdated container: ") << path << '\n';
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void TextureContainer::Close()
+    {
+        if (m_DataPtr)
+        {
+            UnmapViewOfFile(m_DataPtr);
+            m_DataPtr = nullptr;
+        }
+
+        if (m_MappingHandle)
+        {
+            CloseHandle(m_MappingHandle);
+            m_MappingHandle = nullptr;
+        }
+
+        if (m_FileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_FileHandle);
+            m_FileHandle = INVALID_HANDLE_VALUE;
+        }
+
+        m_Size = 0;
+    }
+
+    int TextureContainer::GetWidth() const
+    {
+        return static_cast<int>(GetHeader(m_DataPtr).width);
+    }
+
+    int TextureContainer::GetHeight() const
+    {
+        return static_cast<int>(GetHeader(m_DataPtr).height);
+    }
+
+    int TextureContainer::GetLevelCount() const
+    {
+        return static_cast<int>(GetHeader(m_DataPtr).levelCount);
+    }
+
+    BlockFormat TextureContainer::GetFormat() const
+    {
+        return static_cast<BlockFormat>(GetHeader(m_DataPtr).format);
+    }
+
+    const void* TextureContainer::GetLevelData(int level) const
+    {
+        return m_DataPtr + GetLevel(m_DataPtr, level).gpuOffset;
+    }
+
+    uint32_t TextureContainer::GetRowPitch(int level) const
+    {
+        return GetLevel(m_DataPtr, level).rowPitch;
+    }
+
+    uint32_t TextureContainer::GetSlicePitch(int level) const
+    {
+        return GetLevel(m_DataPtr, level).slicePitch;
+    }
+
+    const uint32_t* TextureContainer::GetLevelTexels(int level) const
+    {
+        return reinterpret_cast<const uint32_t*>(m_DataPtr + GetLevel(m_DataPtr, level).cpuOffset);
+    }
+
+    void TextureContainer::CopyMipChain(MipChain& mipChain) const
+    {
+        mipChain.levels.clear();
+        mipChain.layout = TexelLayout::Linear;
+
+        uint32_t numTexels = 0;
+        for (int level = 0; level < GetLevelCount(); ++level)
+        {
+            const ContainerLevel& containerLevel = GetLevel(m_DataPtr, level);
+            mipChain.levels.push_back({static_cast<int>(containerLevel.width), static_cast<int>(containerLevel.height), numTexels});
+            numTexels += containerLevel.width * containerLevel.height;
+        }
+
+        mipChain.texels.resize(numTexels);
+        for (int level = 0; level < GetLevelCount(); ++level)
+        {
+            const MipLevel& mipLevel = mipChain.levels[level];
+            std::memcpy(mipChain.GetLevelTexels(level), GetLevelTexels(level), static_cast<size_t>(mipLevel.width) * mipLevel.height * sizeof(uint32_t));
+        }
+    }
+
+    bool TextureContainer::Write(const std::string& path, const MipChain& mipChain, const CompressedChain& compressedChain)
+    {
+        const bool isCompressed = not compressedChain.IsEmpty();
+        const int  numLevels    = mipChain.GetLevelCount();
+        if (numLevels == 0 or numLevels > MAX_LEVELS or (isCompressed and compressedChain.GetLevelCount() != numLevels))
+        {
+            std::cout << RED_TEXT("TextureContainer::Write() needs a mip chain of 1 to 16 levels: ") << path << '\n';
+            return false;
+        }
+
+        ContainerHeader header{};
+        header.width      = static_cast<uint32_t>(mipChain.levels[0].width);
+        header.height     = static_cast<uint32_t>(mipChain.levels[0].height);
+        header.levelCount = static_cast<uint32_t>(numLevels);
+        header.format     = static_cast<uint32_t>(isCompressed ? compressedChain.format : BlockFormat::None);
+
+        // GPU levels first so they are contiguous, the RGBA8 copies behind them are only read by the software sampler
+        std::vector<ContainerLevel> levels(numLevels);
+        uint64_t offset = AlignUp(sizeof(ContainerHeader) + sizeof(ContainerLevel) * numLevels);
+        for (int level = 0; level < numLevels; ++level)
+        {
+            const MipLevel& mipLevel       = mipChain.levels[level];
+            ContainerLevel& containerLevel = levels[level];
+
+            containerLevel.width  = static_cast<uint32_t>(mipLevel.width);
+            containerLevel.height = static_cast<uint32_t>(mipLevel.height);
+            if (isCompressed)
+            {
+                const CompressedLevel& compressedLevel = compressedChain.levels[level];
+                containerLevel.rowPitch   = static_cast<uint32_t>(compressedLevel.blocksX * BlockCompressor::GetBlockBytes(compressedChain.format));
+                containerLevel.slicePitch = containerLevel.rowPitch * static_cast<uint32_t>(compressedLevel.blocksY);
+            }
+            else
+            {
+                containerLevel.rowPitch   = containerLevel.width * sizeof(uint32_t);
+                containerLevel.slicePitch = containerLevel.rowPitch * containerLevel.height;
+            }
+
+            containerLevel.gpuOffset = offset;
+            containerLevel.cpuOffset = offset;
+            offset = AlignUp(offset + containerLevel.slicePitch);
+        }
+
+        if (isCompressed)
+        {
+            for (ContainerLevel& containerLevel : levels)
+            {
+                containerLevel.cpuOffset = offset;
+                offset = AlignUp(offset + static_cast<uint64_t>(containerLevel.width) * containerLevel.height * sizeof(uint32_t));
+            }
+        }
+        header.fileSize = offset;
+
+        std::vector<uint8_t> file(offset, 0);
+        std::memcpy(file.data(), &header, sizeof(header));
+        std::memcpy(file.data() + sizeof(header), levels.data(), sizeof(ContainerLevel) * numLevels);
+        for (int level = 0; level < numLevels; ++level)
+        {
+            const ContainerLevel& containerLevel = levels[level];
+            // Always row-major on disk, whatever layout the chain is in
+            uint32_t* rowPtr = reinterpret_cast<uint32_t*>(file.data() + containerLevel.cpuOffset);
+            for (uint32_t y = 0; y < containerLevel.height; ++y, rowPtr += containerLevel.width)
+            {
+                mipChain.ReadRow(level, static_cast<int>(y), rowPtr);
+            }
+            if (isCompressed)
+            {
+                std::memcpy(file.data() + containerLevel.gpuOffset, compressedChain.GetLevelBlocks(level), containerLevel.slicePitch);
+            }
+        }
+
+        std::ofstream stream{path, std::ios::binary | std::ios::trunc};
+        stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        if (not stream)
+        {
+            std::cout << RED_TEXT("TextureContainer::Write() could not write ") << path << '\n';
+            return false;
+        }
+        return true;
+    }
+
+    bool TextureContainer::Convert(const TextureAsset& asset)
+    {
+        const Texture* texturePtr = asset.alphaPath.empty() ? Texture::LoadFromFile(asset.path, asset.mipSettings)
+                                                            : Texture::LoadPacked(asset.path, asset.alphaPath, asset.mipSettings);
+        if (not texturePtr) return false;
+
+        const MipChain& mipChain = texturePtr->GetMipChain();
+
+        CompressedChain compressedChain{};
+        if (asset.compressionSettings.format != BlockFormat::None and not mipChain.IsEmpty()
+            and mipChain.levels[0].width % 4 == 0 and mipChain.levels[0].height % 4 == 0)
+        {
+            BlockCompressor{asset.compressionSettings}.Compress(mipChain, compressedChain);
+        }
+
+        const std::string containerPath = GetContainerPath(asset);
+        const bool        isWritten     = Write(containerPath, mipChain, compressedChain);
+        delete texturePtr;
+
+        if (isWritten)
+        {
+            std::cout << GREEN_TEXT("**(CONVERTER) Baked ") << MAGENTA_TEXT("" + containerPath + "") << '\n';
+        }
+        return isWritten;
+    }
+
+    bool TextureContainer::IsContainerPath(const std::string& path)
+    {
+        const std::string extension = EXTENSION;
+        return path.size() >= extension.size() and path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    }
+
+    std::string TextureContainer::GetContainerPath(const TextureAsset& asset)
+    {
+        const std::string& sourcePath = asset.path;
+        const std::string  suffix     = asset.alphaPath.empty() ? EXTENSION : std::string{"_packed"} + EXTENSION;
+
+        const size_t extensionStart = sourcePath.find_last_of('.');
+        const size_t fileStart      = sourcePath.find_last_of("/\\");
+        if (extensionStart == std::string::npos or (fileStart != std::string::npos and extensionStart < fileStart)) return sourcePath + suffix;
+
+        return sourcePath.substr(0, extensionStart) + suffix;
+    }
+#pragma endregion
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "BlockCompressor.h"
+#include "MipGenerator.h"
+
+// Standard includes
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+    // Forward declarations
+    struct MipChain;
+
+    // A source image and how it has to be baked, shared by the converter and the loading benchmark
+    struct TextureAsset
+    {
+        std::string         path                {}; // PNG, the container lives next to it
+        MipSettings         mipSettings         {};
+        CompressionSettings compressionSettings {};
+        std::string         alphaPath           {}; // Optional, its red channel is packed into the alpha of path
+    };
+
+    /**
+     * \brief Read-only view of a .dtex file: a header, a level table and the final GPU payload of every mip level,
+     * plus an RGBA8 copy for the software sampler when the GPU levels are block-compressed.
+     * The file is memory-mapped, so the level pointers can go straight into D3D11_SUBRESOURCE_DATA without a copy.
+     */
+    class TextureContainer final
+    {
+    public:
+        static constexpr const char* EXTENSION = ".dtex";
+
+        TextureContainer() = default;
+        ~TextureContainer();
+
+        TextureContainer(const TextureContainer&)                = delete;
+        TextureContainer(TextureContainer&&) noexcept            = delete;
+        TextureContainer& operator=(const TextureContainer&)     = delete;
+        TextureContainer& operator=(TextureContainer&&) noexcept = delete;
+
+        // Maps the file and validates the header and every level against the file size
+        bool Open(const std::string& path);
+        void Close();
+
+        int         GetWidth()      const;
+        int         GetHeight()     const;
+        int         GetLevelCount() const;
+        BlockFormat GetFormat()     const;
+
+        // Point into the mapping, valid until Close()
+        const void*     GetLevelData(int level)   const;
+        uint32_t        GetRowPitch(int level)    const;
+        uint32_t        GetSlicePitch(int level)  const;
+        const uint32_t* GetLevelTexels(int level) const;
+
+        // The RGBA8 levels, back to back like MipGenerator lays them out
+        void CopyMipChain(MipChain& mipChain) const;
+
+        // An empty compressedChain stores the GPU levels as RGBA8
+        static bool Write(const std::string& path, const MipChain& mipChain, const CompressedChain& compressedChain);
+
+        // Loads the source through SDL_image, builds the mips and compresses them exactly like a runtime load would
+        static bool Convert(const TextureAsset& asset);
+
+        static bool        IsContainerPath(const std::string& path);
+        // Packed assets get a suffix, their container holds more than the image at path
+        static std::string GetContainerPath(const TextureAsset& asset);
+
+    private:
+        HANDLE         m_FileHandle    = INVALID_HANDLE_VALUE;
+        HANDLE         m_MappingHandle = nullptr;
+        const uint8_t* m_DataPtr       = nullptr;
+        size_t         m_Size          = 0;
+    };
+}
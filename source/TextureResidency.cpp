@@ -0,0 +1,260 @@
+#include "pch.h"
+#include "TextureResidency.h"
+
+// Project includes
+#include "Texture.h"
+#include "TextureContainer.h"
+
+// Standard includes
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace dae
+{
+    TextureResidency::TextureResidency(ID3D11Device* devicePtr, size_t budgetBytes, size_t uploadBytesPerUpdate) :
+        m_DevicePtr{devicePtr},
+        m_BudgetBytes{budgetBytes},
+        m_UploadBytesPerUpdate{uploadBytesPerUpdate}
+    {
+        m_Stats.budgetBytes = budgetBytes;
+    }
+
+    TextureResidency::~TextureResidency()
+    {
+        for (const Entry& entry : m_Entries)
+        {
+            delete entry.containerPtr;
+        }
+    }
+
+    Texture* TextureResidency::Load(const std::string& containerPath)
+    {
+        TextureContainer* containerPtr = new TextureContainer{};
+        if (not containerPtr->Open(containerPath))
+        {
+            delete containerPtr;
+            return nullptr;
+        }
+
+        Entry entry{};
+        entry.containerPtr = containerPtr;
+        entry.levelBytes.resize(containerPtr->GetLevelCount());
+        entry.lastRequested.resize(containerPtr->GetLevelCount(), 0);
+
+        entry.tailLevel = containerPtr->GetLevelCount() - 1;
+        for (int level = 0; level < containerPtr->GetLevelCount(); ++level)
+        {
+            entry.levelBytes[level] = containerPtr->GetSlicePitch(level);
+
+            const int width  = std::max(containerPtr->GetWidth()  >> level, 1);
+            const int height = std::max(containerPtr->GetHeight() >> level, 1);
+            if (width <= TAIL_SIZE and height <= TAIL_SIZE and level < entry.tailLevel) entry.tailLevel = level;
+        }
+        entry.requestedLevel = entry.tailLevel;
+
+        entry.texturePtr = Texture::LoadFromContainer(*containerPtr, m_DevicePtr, entry.tailLevel);
+        if (not entry.texturePtr)
+        {
+            std::cout << RED_TEXT("TextureResidency::Load() failed: ") << containerPath << '\n';
+            delete containerPtr;
+            return nullptr;
+        }
+
+        m_Stats.bytesUploaded += GetResidentBytes(entry, entry.tailLevel);
+
+        m_EntryIdxs[entry.texturePtr] = m_Entries.size();
+        m_Entries.push_back(std::move(entry));
+        UpdateStats();
+
+        return m_Entries.back().texturePtr;
+    }
+
+    void TextureResidency::Unregister(const Texture* texturePtr)
+    {
+        const auto it = m_EntryIdxs.find(texturePtr);
+        if (it == m_EntryIdxs.end()) return;
+
+        const size_t entryIdx = it->second;
+        m_EntryIdxs.erase(it);
+        delete m_Entries[entryIdx].containerPtr;
+
+        // The last entry takes the free slot
+        if (entryIdx + 1 != m_Entries.size())
+        {
+            m_Entries[entryIdx] = std::move(m_Entries.back());
+            m_EntryIdxs[m_Entries[entryIdx].texturePtr] = entryIdx;
+        }
+        m_Entries.pop_back();
+        UpdateStats();
+    }
+
+    void TextureResidency::RequestLevel(const Texture* texturePtr, float level)
+    {
+        const auto it = m_EntryIdxs.find(texturePtr);
+        if (it == m_EntryIdxs.end()) return;
+
+        // Clamped in float first, NaN asks for the tail only
+        Entry&    entry          = m_Entries[it->second];
+        const int requestedLevel = level > 0.0f ? static_cast<int>(std::floor(std::min(level, static_cast<float>(entry.tailLevel)))) : (level <= 0.0f ? 0 : entry.tailLevel);
+
+        // The coarser levels are needed as well, a resident range never has holes
+        entry.requestedLevel = std::min(entry.requestedLevel, requestedLevel);
+        for (int i = requestedLevel; i < static_cast<int>(entry.lastRequested.size()); ++i)
+        {
+            entry.lastRequested[i] = m_UpdateIdx;
+        }
+    }
+
+    bool TextureResidency::Update()
+    {
+        std::vector<int> firstLevels(m_Entries.size());
+        size_t           residentBytes = 0;
+        for (size_t i = 0; i < m_Entries.size(); ++i)
+        {
+            firstLevels[i]  = m_Entries[i].texturePtr->GetFirstResidentLevel();
+            residentBytes  += GetResidentBytes(m_Entries[i], firstLevels[i]);
+        }
+
+        // 1. Over budget, e.g. after SetBudget(), so even levels that are still requested have to go, oldest first
+        while (residentBytes > m_BudgetBytes)
+        {
+            const int victimIdx = FindEvictionVictim(firstLevels, m_UpdateIdx + 1);
+            if (victimIdx < 0) break;
+            residentBytes -= m_Entries[victimIdx].levelBytes[firstLevels[victimIdx]++];
+        }
+
+        // 2. One level per texture per pass, the coarsest missing level first so every texture sharpens at the same pace
+        std::vector<int> pendingIdxs{};
+        for (size_t i = 0; i < m_Entries.size(); ++i)
+        {
+            if (m_Entries[i].requestedLevel < firstLevels[i]) pendingIdxs.push_back(static_cast<int>(i));
+        }
+
+        // Every texture whose range changes is recreated once at the end, with everything it then holds
+        std::vector<size_t> plannedUploads(m_Entries.size(), 0);
+        size_t              uploadBytes = 0;
+
+        bool isStreaming = not pendingIdxs.empty();
+        while (isStreaming)
+        {
+            isStreaming = false;
+            std::stable_sort(pendingIdxs.begin(), pendingIdxs.end(), [&firstLevels](int a, int b) { return firstLevels[a] > firstLevels[b]; });
+
+            for (const int entryIdx : pendingIdxs)
+            {
+                const Entry& entry = m_Entries[entryIdx];
+                if (entry.requestedLevel >= firstLevels[entryIdx]) continue;
+
+                const int    level      = firstLevels[entryIdx] - 1;
+                const size_t levelBytes = entry.levelBytes[level];
+                const size_t uploadCost = GetResidentBytes(entry, level) - plannedUploads[entryIdx];
+                if (uploadBytes > 0 and uploadBytes + uploadCost > m_UploadBytesPerUpdate) continue;
+
+                // Only levels nobody asked for in this update make room, and only when enough of them can go
+                std::vector<int> plannedLevels = firstLevels;
+                size_t           plannedBytes  = residentBytes;
+                while (plannedBytes + levelBytes > m_BudgetBytes)
+                {
+                    const int victimIdx = FindEvictionVictim(plannedLevels, m_UpdateIdx);
+                    if (victimIdx < 0) break;
+                    plannedBytes -= m_Entries[victimIdx].levelBytes[plannedLevels[victimIdx]++];
+                }
+                if (plannedBytes + levelBytes > m_BudgetBytes) continue;
+
+                firstLevels               = std::move(plannedLevels);
+                firstLevels[entryIdx]     = level;
+                residentBytes             = plannedBytes + levelBytes;
+                uploadBytes              += uploadCost;
+                plannedUploads[entryIdx] += uploadCost;
+                isStreaming = true;
+            }
+        }
+
+        // 3. Apply, a texture that failed keeps its old range and is retried in the next update
+        bool isChanged = false;
+        for (size_t i = 0; i < m_Entries.size(); ++i)
+        {
+            Entry&    entry    = m_Entries[i];
+            const int oldLevel = entry.texturePtr->GetFirstResidentLevel();
+            if (firstLevels[i] == oldLevel) continue;
+
+            if (entry.texturePtr->SetResidentLevels(*entry.containerPtr, m_DevicePtr, firstLevels[i]))
+            {
+                if (firstLevels[i] < oldLevel) m_Stats.levelsStreamedIn += oldLevel - firstLevels[i];
+                else                           m_Stats.levelsEvicted    += firstLevels[i] - oldLevel;
+                m_Stats.bytesUploaded += GetResidentBytes(entry, firstLevels[i]);
+                isChanged = true;
+            }
+        }
+
+        m_Stats.requestedBytes  = 0;
+        m_Stats.pendingTextures = 0;
+        for (Entry& entry : m_Entries)
+        {
+            m_Stats.requestedBytes += GetResidentBytes(entry, entry.requestedLevel);
+            if (entry.requestedLevel < entry.texturePtr->GetFirstResidentLevel()) ++m_Stats.pendingTextures;
+
+            entry.requestedLevel = entry.tailLevel;
+        }
+        UpdateStats();
+
+        ++m_UpdateIdx;
+        return isChanged;
+    }
+
+    void TextureResidency::SetBudget(size_t budgetBytes)
+    {
+        m_BudgetBytes       = budgetBytes;
+        m_Stats.budgetBytes = budgetBytes;
+    }
+
+    int TextureResidency::FindEvictionVictim(const std::vector<int>& firstLevels, uint64_t maxUpdateIdx) const
+    {
+        int      victimIdx     = -1;
+        uint64_t oldestRequest = maxUpdateIdx;
+        size_t   victimBytes   = 0;
+        for (size_t i = 0; i < m_Entries.size(); ++i)
+        {
+            const Entry& entry = m_Entries[i];
+            const int    level = firstLevels[i];
+            if (level >= entry.tailLevel) continue;
+
+            // Between levels that were last needed at the same time the largest one frees the most
+            const uint64_t lastRequested = entry.lastRequested[level];
+            if (lastRequested < oldestRequest or (lastRequested == oldestRequest and victimIdx >= 0 and entry.levelBytes[level] > victimBytes))
+            {
+                victimIdx     = static_cast<int>(i);
+                oldestRequest = lastRequested;
+                victimBytes   = entry.levelBytes[level];
+            }
+        }
+        return victimIdx;
+    }
+
+    size_t TextureResidency::GetResidentBytes(const Entry& entry, int firstLevel) const
+    {
+        size_t bytes = 0;
+        for (int level = firstLevel; level < static_cast<int>(entry.levelBytes.size()); ++level)
+        {
+            bytes += entry.levelBytes[level];
+        }
+        return bytes;
+    }
+
+    void TextureResidency::UpdateStats()
+    {
+        m_Stats.textureCount   = static_cast<int>(m_Entries.size());
+        m_Stats.residentBytes  = 0;
+        m_Stats.residentLevels = 0;
+        m_Stats.totalLevels    = 0;
+        for (const Entry& entry : m_Entries)
+        {
+            const int firstLevel = entry.texturePtr->GetFirstResidentLevel();
+            m_Stats.residentBytes  += GetResidentBytes(entry, firstLevel);
+            m_Stats.residentLevels += static_cast<int>(entry.levelBytes.size()) - firstLevel;
+            m_Stats.totalLevels    += static_cast<int>(entry.levelBytes.size());
+        }
+        m_Stats.peakBytes = std::max(m_Stats.peakBytes, m_Stats.residentBytes);
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+// Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dae
+{
+    // Forward declarations
+    class Texture;
+    class TextureContainer;
+
+    struct ResidencyStats
+    {
+        size_t   budgetBytes      = 0;
+        size_t   residentBytes    = 0; // GPU levels of every registered texture, tails included
+        size_t   requestedBytes   = 0; // What the requests of the last update would have needed
+        size_t   peakBytes        = 0;
+        int      textureCount     = 0;
+        int      residentLevels   = 0;
+        int      totalLevels      = 0;
+        int      pendingTextures  = 0; // Still coarser than requested after the last update
+        uint64_t levelsStreamedIn = 0;
+        uint64_t levelsEvicted    = 0;
+        uint64_t bytesUploaded    = 0; // A resident range is recreated as a whole, so the coarser levels are uploaded again
+    };
+
+    /**
+     * \brief Keeps the GPU copies of baked textures within a memory budget. Every texture starts with only its tail resident,
+     * finer levels are streamed in from the memory-mapped container when the renderer requests them. An update runs passes of one level per texture,
+     * coarse to fine, until the upload allowance of the update is used up.
+     * When a level does not fit, the level that was requested the longest ago is dropped first; levels requested in the current update are only
+     * evicted when the budget was lowered below what is already resident. The CPU chains for the software sampler are not managed.
+     */
+    class TextureResidency final
+    {
+    public:
+        // Levels with both sides at or below this never leave the GPU
+        static constexpr int TAIL_SIZE = 64;
+
+        TextureResidency(ID3D11Device* devicePtr, size_t budgetBytes, size_t uploadBytesPerUpdate = size_t{8} << 20);
+        ~TextureResidency();
+
+        TextureResidency(const TextureResidency&)                = delete;
+        TextureResidency(TextureResidency&&) noexcept            = delete;
+        TextureResidency& operator=(const TextureResidency&)     = delete;
+        TextureResidency& operator=(TextureResidency&&) noexcept = delete;
+
+        // Maps the container and uploads only its tail. The texture belongs to the caller, it is deleted after Unregister() or after the manager
+        Texture* Load(const std::string& containerPath);
+        void     Unregister(const Texture* texturePtr);
+
+        // Feedback for the current update: the finest level the texture will be sampled at, fractions round down to the finer level
+        void RequestLevel(const Texture* texturePtr, float level);
+
+        // Evicts down to the budget, then streams the requested levels in. True when any SRV changed, so it has to be bound again
+        bool Update();
+
+        void SetBudget(size_t budgetBytes);
+
+        size_t                GetBudget() const { return m_BudgetBytes; }
+        const ResidencyStats& GetStats()  const { return m_Stats;       }
+
+    private:
+        struct Entry
+        {
+            Texture*              texturePtr     = nullptr;
+            TextureContainer*     containerPtr   = nullptr; // Stays mapped, the finer levels stream in from it
+            int                   tailLevel      = 0;       // Finest level of the tail
+            int                   requestedLevel = 0;       // Finest level requested in the current update, tailLevel when none was
+            std::vector<size_t>   levelBytes     {};
+            std::vector<uint64_t> lastRequested  {};        // Update index of the last request that needed each level
+        };
+
+        // Entry whose finest planned level was requested the longest ago, -1 when no level above a tail was requested before maxUpdateIdx
+        int FindEvictionVictim(const std::vector<int>& firstLevels, uint64_t maxUpdateIdx) const;
+
+        size_t GetResidentBytes(const Entry& entry, int firstLevel) const;
+        void   UpdateStats();
+
+        ID3D11Device* m_DevicePtr = nullptr;
+
+        std::vector<Entry>                         m_Entries   {};
+        std::unordered_map<const Texture*, size_t> m_EntryIdxs {};
+
+        size_t   m_BudgetBytes          = 0;
+        size_t   m_UploadBytesPerUpdate = 0;
+        uint64_t m_UpdateIdx            = 1;
+
+        ResidencyStats m_Stats {};
+    };
+}
@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "TransparencyBuffer.h"
+
+// Standard includes
+#include <algorithm>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        // Equation 10 of "Weighted Blended Order-Independent Transparency" (McGuire and Bavoil 2013), viewDepth in world units
+        float Weight(float alpha, float viewDepth)
+        {
+            const float depth5   = viewDepth / 5.0f;
+            const float depth200 = viewDepth / 200.0f;
+            const float weight   = 10.0f / (1e-5f + depth5 * depth5 + depth200 * depth200 * depth200 * depth200 * depth200 * depth200);
+            return alpha * std::clamp(weight, 1e-2f, 3e3f);
+        }
+
+        // SRC_ALPHA / INV_SRC_ALPHA
+        ColorRGB Blend(const ColorRGB& source, float alpha, const ColorRGB& destination)
+        {
+            return source * ColorRGB{alpha} + destination * ColorRGB{1.0f - alpha};
+        }
+    }
+#pragma endregion
+
+#pragma region Public
+    void TransparencyBuffer::Begin(TransparencyMode mode, int numPixels)
+    {
+        m_Mode      = mode;
+        m_Evictions = 0;
+
+        m_Colors.resize(numPixels);
+
+        if (mode == TransparencyMode::WeightedBlended or mode == TransparencyMode::KBuffer)
+        {
+            m_Accumulation.assign(numPixels, ColorRGB{0.0f});
+            m_AccumulatedAlpha.assign(numPixels, 0.0f);
+            m_Revealage.assign(numPixels, 1.0f);
+        }
+
+        if (mode == TransparencyMode::KBuffer)
+        {
+            m_Layers.resize(static_cast<size_t>(numPixels) * K_BUFFER_SIZE);
+            m_LayerCounts.assign(numPixels, 0);
+        }
+    }
+
+    void TransparencyBuffer::Add(int pixelIdx, const TransparentFragment& fragment)
+    {
+        if (fragment.alpha <= 0.0f) return;
+
+        switch (m_Mode)
+        {
+        case TransparencyMode::WeightedBlended:
+            Accumulate(pixelIdx, fragment.color, fragment.alpha, fragment.viewDepth);
+            return;
+
+        case TransparencyMode::KBuffer:
+        {
+            Layer*   layers = &m_Layers[static_cast<size_t>(pixelIdx) * K_BUFFER_SIZE];
+            uint8_t& count  = m_LayerCounts[pixelIdx];
+
+            const Layer layer{fragment.viewDepth, fragment.alpha, fragment.color};
+            if (count < K_BUFFER_SIZE)
+            {
+                layers[count++] = layer;
+                return;
+            }
+
+            // Full, whatever ends up furthest away moves to the weighted tail behind the K layers
+            ++m_Evictions;
+
+            Layer* furthest = std::max_element(layers, layers + K_BUFFER_SIZE, [](const Layer& lhs, const Layer& rhs)
+            {
+                return lhs.viewDepth < rhs.viewDepth;
+            });
+
+            if (furthest->viewDepth > layer.viewDepth)
+            {
+                Accumulate(pixelIdx, furthest->color, furthest->alpha, furthest->viewDepth);
+                *furthest = layer;
+            }
+            else
+            {
+                Accumulate(pixelIdx, layer.color, layer.alpha, layer.viewDepth);
+            }
+            return;
+        }
+
+        default:
+            m_Colors[pixelIdx] = Blend(fragment.color, fragment.alpha, m_Colors[pixelIdx]);
+            return;
+        }
+    }
+
+    ColorRGB TransparencyBuffer::Resolve(int pixelIdx)
+    {
+        if (m_Mode == TransparencyMode::Unsorted or m_Mode == TransparencyMode::Sorted) return m_Colors[pixelIdx];
+
+        // Weighted average of the accumulated layers over the background
+        ColorRGB color = m_Colors[pixelIdx];
+        if (m_Revealage[pixelIdx] < 1.0f)
+        {
+            const ColorRGB average = m_Accumulation[pixelIdx] / ColorRGB{std::max(m_AccumulatedAlpha[pixelIdx], 1e-5f)};
+            color = ColorRGB::Lerp(average, color, m_Revealage[pixelIdx]);
+        }
+
+        if (m_Mode == TransparencyMode::KBuffer)
+        {
+            Layer*        layers = &m_Layers[static_cast<size_t>(pixelIdx) * K_BUFFER_SIZE];
+            const uint8_t count  = m_LayerCounts[pixelIdx];
+
+            // Back to front
+            std::sort(layers, layers + count, [](const Layer& lhs, const Layer& rhs)
+            {
+                return lhs.viewDepth > rhs.viewDepth;
+            });
+
+            for (int i = 0; i < count; ++i)
+            {
+                color = Blend(layers[i].color, layers[i].alpha, color);
+            }
+        }
+
+        return color;
+    }
+#pragma endregion
+
+#pragma region Private
+    void TransparencyBuffer::Accumulate(int pixelIdx, const ColorRGB& color, float alpha, float viewDepth)
+    {
+        const float weight = Weight(alpha, viewDepth);
+
+        m_Accumulation[pixelIdx]     += color * ColorRGB{alpha * weight};
+        m_AccumulatedAlpha[pixelIdx] += alpha * weight;
+        m_Revealage[pixelIdx]        *= 1.0f - alpha;
+    }
+#pragma endregion
+}
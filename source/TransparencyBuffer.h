@@ -0,0 +1,76 @@
+#pragma once
+#include "ColorRGB.h"
+
+// Standard includes
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+    enum class TransparencyMode
+    {
+        Unsorted,        // Blend in submission order like pass P3, wrong wherever layers overlap out of order
+        Sorted,          // Sort the transparent triangles back to front every frame, then blend (reference)
+        WeightedBlended, // Order independent, depth-weighted average of all layers (McGuire and Bavoil 2013)
+        KBuffer,         // Keep the K nearest layers per pixel and sort them, layers behind those are weighted-blended
+
+        COUNT
+    };
+
+    struct TransparentFragment
+    {
+        ColorRGB color     {};
+        float    alpha     = 0.0f;
+        float    viewDepth = 0.0f; // Clip-space w, larger is further away
+    };
+
+    /**
+     * \brief Per-pixel transparency storage for one tile of the software rasterizer, blends SRC_ALPHA/INV_SRC_ALPHA like gAlphaBlendState.
+     * A tile is small enough to keep K layers per pixel in cache, so the k-buffer never needs a per-pixel linked list of unbounded size.
+     */
+    class TransparencyBuffer final
+    {
+    public:
+        static constexpr int K_BUFFER_SIZE = 8;
+
+        TransparencyBuffer() = default;
+        ~TransparencyBuffer() = default;
+
+        TransparencyBuffer(const TransparencyBuffer& other)                = default;
+        TransparencyBuffer(TransparencyBuffer&& other) noexcept            = default;
+        TransparencyBuffer& operator=(const TransparencyBuffer& other)     = default;
+        TransparencyBuffer& operator=(TransparencyBuffer&& other) noexcept = default;
+
+        // Resets every pixel, the background of each pixel has to be set before fragments are added to it
+        void Begin(TransparencyMode mode, int numPixels);
+
+        void     SetBackground(int pixelIdx, const ColorRGB& color) { m_Colors[pixelIdx] = color; }
+        void     Add(int pixelIdx, const TransparentFragment& fragment);
+        ColorRGB Resolve(int pixelIdx);
+
+        // Layers that did not fit in the k-buffer since Begin()
+        uint64_t GetEvictions() const { return m_Evictions; }
+
+    private:
+        struct Layer
+        {
+            float    viewDepth = 0.0f;
+            float    alpha     = 0.0f;
+            ColorRGB color     {};
+        };
+
+        void Accumulate(int pixelIdx, const ColorRGB& color, float alpha, float viewDepth);
+
+    private:
+        TransparencyMode m_Mode = TransparencyMode::Unsorted;
+
+        std::vector<ColorRGB> m_Colors           {}; // Background, blended directly in the ordered modes
+        std::vector<ColorRGB> m_Accumulation     {}; // Sum of premultiplied color * weight
+        std::vector<float>    m_AccumulatedAlpha {}; // Sum of alpha * weight
+        std::vector<float>    m_Revealage        {}; // Product of (1 - alpha)
+        std::vector<Layer>    m_Layers           {}; // K_BUFFER_SIZE per pixel
+        std::vector<uint8_t>  m_LayerCounts      {};
+
+        uint64_t m_Evictions = 0;
+    };
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <fstream>
+#include <random>
 #include "Math.h"
 #include "Mesh.h"
 
@@ -159,6 +160,66 @@ namespace dae
 
 			return true;
 		}
+
+		//Transparency stress geometry: numQuads quads with a random position, size and yaw inside a box around the origin
+		static void CreateQuadCloud(int numQuads, const Vector3& extent, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t seed = 42)
+		{
+			std::mt19937                          generator{seed};
+			std::uniform_real_distribution<float> xDistribution{-extent.x, extent.x};
+			std::uniform_real_distribution<float> yDistribution{-extent.y, extent.y};
+			std::uniform_real_distribution<float> zDistribution{-extent.z, extent.z};
+			std::uniform_real_distribution<float> sizeDistribution{2.0f, 8.0f};
+			std::uniform_real_distribution<float> angleDistribution{0.0f, PI_2};
+
+			vertices.clear();
+			indices.clear();
+			vertices.reserve(static_cast<size_t>(numQuads) * 4);
+			indices.reserve(static_cast<size_t>(numQuads) * 6);
+
+			for (int quad = 0; quad < numQuads; ++quad)
+			{
+				const Vector3 center{xDistribution(generator), yDistribution(generator), zDistribution(generator)};
+				const float   halfSize = sizeDistribution(generator) * 0.5f;
+				const float   angle    = angleDistribution(generator);
+
+				const Vector3 right  {std::cos(angle) * halfSize, 0.0f, std::sin(angle) * halfSize};
+				const Vector3 up     {0.0f, halfSize, 0.0f};
+				const Vector3 normal {-std::sin(angle), 0.0f, std::cos(angle)};
+				const Vector3 tangent{std::cos(angle), 0.0f, std::sin(angle)};
+
+				const uint32_t first = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(Vertex{center - right + up, colors::White, {0.0f, 0.0f}, normal, tangent});
+				vertices.push_back(Vertex{center + right + up, colors::White, {1.0f, 0.0f}, normal, tangent});
+				vertices.push_back(Vertex{center - right - up, colors::White, {0.0f, 1.0f}, normal, tangent});
+				vertices.push_back(Vertex{center + right - up, colors::White, {1.0f, 1.0f}, normal, tangent});
+
+				for (const uint32_t index : {0u, 1u, 2u, 2u, 1u, 3u})
+				{
+					indices.push_back(first + index);
+				}
+			}
+		}
+
+		//Instancing stress scene: the world matrices of numInstances copies on a square grid around the origin, each with a random yaw
+		static void CreateInstanceGrid(int numInstances, float spacing, std::vector<Matrix>& worldMatrices, uint32_t seed = 42)
+		{
+			std::mt19937                          generator{seed};
+			std::uniform_real_distribution<float> angleDistribution{0.0f, PI_2};
+
+			const int   numColumns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(numInstances))));
+			const float offset     = static_cast<float>(numColumns - 1) * spacing * 0.5f;
+
+			worldMatrices.clear();
+			worldMatrices.reserve(numInstances);
+
+			for (int instance = 0; instance < numInstances; ++instance)
+			{
+				const float x = static_cast<float>(instance % numColumns) * spacing - offset;
+				const float z = static_cast<float>(instance / numColumns) * spacing - offset;
+
+				worldMatrices.push_back(Matrix::CreateRotationY(angleDistribution(generator)) * Matrix::CreateTranslation(x, 0.0f, z));
+			}
+		}
 #pragma warning(pop)
 	}
 }
@@ -0,0 +1,487 @@
+#include "pch.h"
+#include "VirtualTexture.h"
+
+// Standard includes
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace dae
+{
+#pragma region Helpers
+    namespace
+    {
+        constexpr uint32_t MAGIC      = 0x58545644; // "DVTX"
+        constexpr uint32_t VERSION    = 1;
+        constexpr int      MAX_LEVELS = 16;
+
+        // On-disk layout, little endian: the header, the level table, the page table, the tail levels row-major and back to back, then the pages
+        struct VirtualHeader
+        {
+            uint32_t magic      = MAGIC;
+            uint32_t version    = VERSION;
+            uint32_t width      = 0;
+            uint32_t height     = 0;
+            uint32_t levelCount = 0;
+            uint32_t tailLevel  = 0; // First level that fits in one page
+            uint32_t pageSize   = VirtualTexture::PAGE_SIZE;
+            uint32_t pageCount  = 0; // Of the levels above the tail
+        };
+
+        struct VirtualLevel
+        {
+            uint32_t width     = 0;
+            uint32_t height    = 0;
+            uint32_t pagesX    = 0;
+            uint32_t firstPage = 0;
+        };
+
+        static_assert(sizeof(VirtualHeader) == 32 and sizeof(VirtualLevel) == 16, "The .vtex layout must not depend on the compiler");
+
+        int GetPagesAlong(int size)
+        {
+            return (size + VirtualTexture::PAGE_SIZE - 1) >> VirtualTexture::PAGE_SHIFT;
+        }
+    }
+#pragma endregion
+
+#pragma region VirtualTexture
+    bool VirtualTexture::Write(const std::string& path, const MipChain& mipChain)
+    {
+        const int numLevels = mipChain.GetLevelCount();
+        int       tailLevel = numLevels;
+        for (int level = numLevels - 1; level >= 0 and mipChain.levels[level].width <= PAGE_SIZE and mipChain.levels[level].height <= PAGE_SIZE; --level)
+        {
+            tailLevel = level;
+        }
+        if (numLevels == 0 or numLevels > MAX_LEVELS or tailLevel == numLevels)
+        {
+            std::cout << RED_TEXT("VirtualTexture::Write() needs a mip chain of 1 to 16 levels down to one page: ") << path << '\n';
+            return false;
+        }
+
+        VirtualHeader header{};
+        header.width      = static_cast<uint32_t>(mipChain.levels[0].width);
+        header.height     = static_cast<uint32_t>(mipChain.levels[0].height);
+        header.levelCount = static_cast<uint32_t>(numLevels);
+        header.tailLevel  = static_cast<uint32_t>(tailLevel);
+
+        std::vector<VirtualLevel> levels(numLevels);
+        size_t                    tailTexels = 0;
+        for (int level = 0; level < numLevels; ++level)
+        {
+            const MipLevel& mipLevel = mipChain.levels[level];
+            levels[level].width     = static_cast<uint32_t>(mipLevel.width);
+            levels[level].height    = static_cast<uint32_t>(mipLevel.height);
+            levels[level].pagesX    = level < tailLevel ? static_cast<uint32_t>(GetPagesAlong(mipLevel.width)) : 1;
+            levels[level].firstPage = header.pageCount;
+
+            if (level < tailLevel) header.pageCount += levels[level].pagesX * static_cast<uint32_t>(GetPagesAlong(mipLevel.height));
+            else                   tailTexels       += static_cast<size_t>(mipLevel.width) * mipLevel.height;
+        }
+
+        const size_t tableBytes = sizeof(VirtualHeader) + sizeof(VirtualLevel) * numLevels + sizeof(uint64_t) * header.pageCount;
+        const size_t pagesStart = tableBytes + tailTexels * sizeof(uint32_t);
+
+        std::vector<uint8_t> file(pagesStart + static_cast<size_t>(header.pageCount) * PAGE_TEXELS * sizeof(uint32_t), 0);
+        std::memcpy(file.data(), &header, sizeof(header));
+        std::memcpy(file.data() + sizeof(header), levels.data(), sizeof(VirtualLevel) * numLevels);
+
+        uint64_t* pageOffsetPtr = reinterpret_cast<uint64_t*>(file.data() + sizeof(header) + sizeof(VirtualLevel) * numLevels);
+        uint32_t* tailPtr       = reinterpret_cast<uint32_t*>(file.data() + tableBytes);
+        uint32_t* pagesPtr      = reinterpret_cast<uint32_t*>(file.data() + pagesStart);
+
+        std::vector<uint32_t> row{};
+        for (int level = 0; level < numLevels; ++level)
+        {
+            const VirtualLevel& virtualLevel = levels[level];
+            row.resize(virtualLevel.width);
+
+            for (uint32_t y = 0; y < virtualLevel.height; ++y)
+            {
+                mipChain.ReadRow(level, static_cast<int>(y), row.data());
+                if (level >= tailLevel)
+                {
+                    std::memcpy(tailPtr, row.data(), virtualLevel.width * sizeof(uint32_t));
+                    tailPtr += virtualLevel.width;
+                    continue;
+                }
+
+                // The padding of partial pages stays zero, no lookup reaches it
+                for (uint32_t pageX = 0; pageX < virtualLevel.pagesX; ++pageX)
+                {
+                    const uint32_t page   = virtualLevel.firstPage + (y >> PAGE_SHIFT) * virtualLevel.pagesX + pageX;
+                    const uint32_t startX = pageX << PAGE_SHIFT;
+                    uint32_t*      dstPtr = pagesPtr + static_cast<size_t>(page) * PAGE_TEXELS + ((y & (PAGE_SIZE - 1)) << PAGE_SHIFT);
+                    std::memcpy(dstPtr, row.data() + startX, std::min<uint32_t>(PAGE_SIZE, virtualLevel.width - startX) * sizeof(uint32_t));
+                }
+            }
+        }
+
+        for (uint32_t page = 0; page < header.pageCount; ++page)
+        {
+            pageOffsetPtr[page] = pagesStart + static_cast<uint64_t>(page) * PAGE_TEXELS * sizeof(uint32_t);
+        }
+
+        std::ofstream stream{path, std::ios::binary | std::ios::trunc};
+        stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        if (not stream)
+        {
+            std::cout << RED_TEXT("VirtualTexture::Write() could not write ") << path << '\n';
+            return false;
+        }
+        return true;
+    }
+
+    bool VirtualTexture::Open(const std::string& path, const uint32_t* slotTexelsPtr)
+    {
+        std::ifstream stream{path, std::ios::binary | std::ios::ate};
+        if (not stream)
+        {
+            std::cout << RED_TEXT("VirtualTexture::Open() could not open ") << path << '\n';
+            return false;
+        }
+        const uint64_t fileSize = static_cast<uint64_t>(stream.tellg());
+        stream.seekg(0);
+
+        VirtualHeader header{};
+        stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (not stream or header.magic != MAGIC or header.version != VERSION or header.pageSize != PAGE_SIZE or header.levelCount == 0
+            or header.levelCount > MAX_LEVELS or header.tailLevel >= header.levelCount or header.pageCount > fileSize / (PAGE_TEXELS * sizeof(uint32_t)))
+        {
+            std::cout << RED_TEXT("VirtualTexture::Open() found no valid header in ") << path << '\n';
+            return false;
+        }
+
+        std::vector<VirtualLevel> levels(header.levelCount);
+        stream.read(reinterpret_cast<char*>(levels.data()), static_cast<std::streamsize>(sizeof(VirtualLevel) * levels.size()));
+
+        std::vector<uint64_t> pageOffsets(header.pageCount);
+        stream.read(reinterpret_cast<char*>(pageOffsets.data()), static_cast<std::streamsize>(sizeof(uint64_t) * pageOffsets.size()));
+
+        // Every level has to be half of the one before, so a coarser lookup always lands inside it
+        bool     isValid   = static_cast<bool>(stream) and levels[0].width == header.width and levels[0].height == header.height;
+        uint32_t pageCount = 0;
+        for (uint32_t level = 0; isValid and level < header.levelCount; ++level)
+        {
+            const VirtualLevel& virtualLevel = levels[level];
+            const bool          isTail       = level >= header.tailLevel;
+
+            isValid = virtualLevel.width > 0 and virtualLevel.height > 0 and virtualLevel.firstPage == pageCount
+                      and (level == 0 or (virtualLevel.width == std::max(levels[level - 1].width >> 1, 1u) and virtualLevel.height == std::max(levels[level - 1].height >> 1, 1u)))
+                      and (isTail ? virtualLevel.width <= PAGE_SIZE and virtualLevel.height <= PAGE_SIZE
+                                  : virtualLevel.pagesX == static_cast<uint32_t>(GetPagesAlong(static_cast<int>(virtualLevel.width))));
+            if (not isTail) pageCount += virtualLevel.pagesX * static_cast<uint32_t>(GetPagesAlong(static_cast<int>(virtualLevel.height)));
+        }
+        for (uint32_t page = 0; isValid and page < header.pageCount; ++page)
+        {
+            isValid = pageOffsets[page] <= fileSize and PAGE_TEXELS * sizeof(uint32_t) <= fileSize - pageOffsets[page];
+        }
+        if (not isValid or pageCount != header.pageCount)
+        {
+            std::cout << RED_TEXT("VirtualTexture::Open() found an invalid level or page table in ") << path << '\n';
+            return false;
+        }
+
+        m_Path          = path;
+        m_TailLevel     = static_cast<int>(header.tailLevel);
+        m_PageOffsets   = std::move(pageOffsets);
+        m_SlotTexelsPtr = slotTexelsPtr;
+        m_Levels.clear();
+        m_PagesX.clear();
+        m_Tail = MipChain{};
+
+        for (uint32_t level = 0; level < header.levelCount; ++level)
+        {
+            const VirtualLevel& virtualLevel = levels[level];
+            m_Levels.push_back({static_cast<int>(virtualLevel.width), static_cast<int>(virtualLevel.height), virtualLevel.firstPage});
+            m_PagesX.push_back(static_cast<int>(virtualLevel.pagesX));
+
+            if (static_cast<int>(level) >= m_TailLevel)
+            {
+                m_Tail.AddLevel(static_cast<int>(virtualLevel.width), static_cast<int>(virtualLevel.height));
+            }
+        }
+
+        stream.read(reinterpret_cast<char*>(m_Tail.texels.data()), static_cast<std::streamsize>(m_Tail.texels.size() * sizeof(uint32_t)));
+        if (not stream)
+        {
+            std::cout << RED_TEXT("VirtualTexture::Open() could not read the tail of ") << path << '\n';
+            return false;
+        }
+
+        m_PageSlots.assign(header.pageCount, -1);
+        m_IsPending.assign(header.pageCount, 0);
+        m_Feedback = std::vector<std::atomic<uint32_t>>(header.pageCount);
+        return true;
+    }
+#pragma endregion
+
+#pragma region VirtualTextureCache
+    VirtualTextureCache::VirtualTextureCache(int slotCount, int workerCount)
+    {
+        slotCount   = std::max(slotCount, 1);
+        workerCount = std::max(workerCount, 1);
+
+        m_SlotTexels.resize(static_cast<size_t>(slotCount) * VirtualTexture::PAGE_TEXELS);
+        m_SlotOwners.resize(slotCount, nullptr);
+        m_SlotPages.resize(slotCount, -1);
+        m_SlotLastUsed.resize(slotCount, 0);
+        m_LruIts.resize(slotCount, m_LruSlots.end());
+
+        // Handed out from the back, slot 0 first
+        for (int slot = slotCount - 1; slot >= 0; --slot)
+        {
+            m_FreeSlots.push_back(slot);
+        }
+        m_Stats.slotCount = slotCount;
+
+        for (int i = 0; i < workerCount; ++i)
+        {
+            m_Workers.emplace_back(&VirtualTextureCache::RunWorker, this);
+        }
+    }
+
+    VirtualTextureCache::~VirtualTextureCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_Mutex};
+            m_IsStopping = true;
+        }
+        m_Condition.notify_all();
+
+        for (std::thread& worker : m_Workers)
+        {
+            worker.join();
+        }
+        for (const VirtualTexture* texturePtr : m_TexturePtrs)
+        {
+            delete texturePtr;
+        }
+    }
+
+    const VirtualTexture* VirtualTextureCache::Open(const std::string& path)
+    {
+        VirtualTexture* texturePtr = new VirtualTexture{};
+        if (not texturePtr->Open(path, m_SlotTexels.data()))
+        {
+            delete texturePtr;
+            return nullptr;
+        }
+
+        texturePtr->m_FrameIdx = m_FrameIdx.load(std::memory_order_relaxed);
+        m_TexturePtrs.push_back(texturePtr);
+        return texturePtr;
+    }
+
+    void VirtualTextureCache::Update()
+    {
+        const uint32_t          frameIdx = m_FrameIdx.load(std::memory_order_relaxed);
+        const Clock::time_point now      = Clock::now();
+
+        // 1. Feedback first, so the hit rate is what the frame saw and not what it is about to get
+        std::vector<PageRequest> requests{};
+        m_Stats.requestedPages = 0;
+        m_Stats.hitPages       = 0;
+        for (VirtualTexture* texturePtr : m_TexturePtrs)
+        {
+            VirtualTexture& texture = *texturePtr;
+            for (int level = 0; level < texture.m_TailLevel; ++level)
+            {
+                const int firstPage = static_cast<int>(texture.m_Levels[level].offset);
+                const int lastPage  = level + 1 < texture.m_TailLevel ? static_cast<int>(texture.m_Levels[level + 1].offset) : texture.GetPageCount();
+                for (int page = firstPage; page < lastPage; ++page)
+                {
+                    if (texture.m_Feedback[page].load(std::memory_order_relaxed) != frameIdx) continue;
+
+                    ++m_Stats.requestedPages;
+                    if (texture.m_PageSlots[page] >= 0)
+                    {
+                        ++m_Stats.hitPages;
+                        TouchSlot(texture.m_PageSlots[page], frameIdx);
+                        continue;
+                    }
+                    RequestPage(texture, page, level, now, requests);
+
+                    // The frame read the nearest resident ancestor instead, which has to stay until the page arrives.
+                    // Missing ancestors are loaded as well, so the detail builds up one level at a time
+                    int pageX = (page - firstPage) % texture.m_PagesX[level];
+                    int pageY = (page - firstPage) / texture.m_PagesX[level];
+                    for (int parentLevel = level + 1; parentLevel < texture.m_TailLevel; ++parentLevel)
+                    {
+                        pageX = std::min(pageX >> 1, texture.m_PagesX[parentLevel] - 1);
+                        pageY = std::min(pageY >> 1, GetPagesAlong(texture.m_Levels[parentLevel].height) - 1);
+
+                        const int parentPage = static_cast<int>(texture.m_Levels[parentLevel].offset) + pageY * texture.m_PagesX[parentLevel] + pageX;
+                        if (texture.m_PageSlots[parentPage] >= 0)
+                        {
+                            TouchSlot(texture.m_PageSlots[parentPage], frameIdx);
+                            break;
+                        }
+                        RequestPage(texture, parentPage, parentLevel, now, requests);
+                    }
+                }
+            }
+        }
+
+        // Coarse pages first, they cover more of the screen
+        std::stable_sort(requests.begin(), requests.end(), [](const PageRequest& a, const PageRequest& b) { return a.level > b.level; });
+
+        std::vector<LoadedPage> loadedPages{};
+        {
+            std::lock_guard<std::mutex> lock{m_Mutex};
+            m_Requests.insert(m_Requests.end(), requests.begin(), requests.end());
+            loadedPages.swap(m_LoadedPages);
+        }
+        if (not requests.empty()) m_Condition.notify_all();
+
+        // 2. Commit what the workers finished
+        m_Stats.pagesLoaded  = 0;
+        m_Stats.pagesEvicted = 0;
+        m_Stats.pagesDropped = 0;
+        float totalLatencyMs = 0.0f;
+        m_Stats.maxLatencyMs = 0.0f;
+
+        for (LoadedPage& loadedPage : loadedPages)
+        {
+            VirtualTexture& texture = *loadedPage.request.texturePtr;
+            const int       page    = loadedPage.request.page;
+            texture.m_IsPending[page] = 0;
+            if (loadedPage.texels.empty()) continue;
+
+            const int slot = AllocateSlot(frameIdx);
+            if (slot < 0)
+            {
+                ++m_Stats.pagesDropped;
+                continue;
+            }
+
+            std::memcpy(m_SlotTexels.data() + static_cast<size_t>(slot) * VirtualTexture::PAGE_TEXELS, loadedPage.texels.data(), VirtualTexture::PAGE_TEXELS * sizeof(uint32_t));
+            m_SlotOwners[slot]       = &texture;
+            m_SlotPages[slot]        = page;
+            texture.m_PageSlots[page] = slot;
+            TouchSlot(slot, frameIdx);
+
+            const float latencyMs = std::chrono::duration<float, std::milli>(now - loadedPage.request.requestTime).count();
+            totalLatencyMs       += latencyMs;
+            m_Stats.maxLatencyMs  = std::max(m_Stats.maxLatencyMs, latencyMs);
+            ++m_Stats.pagesLoaded;
+        }
+
+        // 3. Stats, then every texture stamps the next frame
+        m_Stats.hitRate            = m_Stats.requestedPages > 0 ? static_cast<float>(m_Stats.hitPages) / static_cast<float>(m_Stats.requestedPages) : 1.0f;
+        m_Stats.averageLatencyMs   = m_Stats.pagesLoaded > 0 ? totalLatencyMs / static_cast<float>(m_Stats.pagesLoaded) : 0.0f;
+        m_Stats.residentPages      = m_Stats.slotCount - static_cast<int>(m_FreeSlots.size());
+        m_Stats.totalPagesLoaded  += m_Stats.pagesLoaded;
+        m_Stats.totalPagesEvicted += m_Stats.pagesEvicted;
+        {
+            std::lock_guard<std::mutex> lock{m_Mutex};
+            m_Stats.pendingPages = static_cast<int>(m_Requests.size() + m_LoadedPages.size()) + m_ReadingCount;
+        }
+
+        m_FrameIdx.store(frameIdx + 1, std::memory_order_relaxed);
+        for (VirtualTexture* texturePtr : m_TexturePtrs)
+        {
+            texturePtr->m_FrameIdx = frameIdx + 1;
+        }
+    }
+
+    void VirtualTextureCache::Flush()
+    {
+        std::unique_lock<std::mutex> lock{m_Mutex};
+        m_Condition.wait(lock, [this] { return m_Requests.empty() and m_ReadingCount == 0; });
+    }
+
+    void VirtualTextureCache::Clear()
+    {
+        for (const int slot : m_LruSlots)
+        {
+            m_SlotOwners[slot]->m_PageSlots[m_SlotPages[slot]] = -1;
+            m_SlotOwners[slot] = nullptr;
+            m_SlotPages[slot]  = -1;
+            m_LruIts[slot]     = m_LruSlots.end();
+            m_FreeSlots.push_back(slot);
+        }
+        m_LruSlots.clear();
+        m_Stats.residentPages = 0;
+    }
+
+    void VirtualTextureCache::RunWorker()
+    {
+        // Every worker keeps its own handle per backing file, so reads never wait on each other
+        std::unordered_map<const VirtualTexture*, std::ifstream> streams{};
+
+        std::unique_lock<std::mutex> lock{m_Mutex};
+        while (true)
+        {
+            m_Condition.wait(lock, [this] { return m_IsStopping or not m_Requests.empty(); });
+            if (m_IsStopping) return;
+
+            LoadedPage loadedPage{};
+            loadedPage.request = m_Requests.front();
+            m_Requests.pop_front();
+            ++m_ReadingCount;
+            lock.unlock();
+
+            // A page nobody sampled for a while is not worth the read anymore, it is requested again if it comes back into view
+            const VirtualTexture& texture    = *loadedPage.request.texturePtr;
+            const uint32_t        lastWanted = texture.m_Feedback[loadedPage.request.page].load(std::memory_order_relaxed);
+            if (lastWanted + STALE_FRAMES >= m_FrameIdx.load(std::memory_order_relaxed))
+            {
+                std::ifstream& stream = streams[&texture];
+                if (not stream.is_open()) stream.open(texture.m_Path, std::ios::binary);
+
+                loadedPage.texels.resize(VirtualTexture::PAGE_TEXELS);
+                stream.clear();
+                stream.seekg(static_cast<std::streamoff>(texture.m_PageOffsets[loadedPage.request.page]));
+                stream.read(reinterpret_cast<char*>(loadedPage.texels.data()), VirtualTexture::PAGE_TEXELS * sizeof(uint32_t));
+                if (not stream)
+                {
+                    std::cout << RED_TEXT("VirtualTextureCache could not read a page of ") << texture.m_Path << '\n';
+                    loadedPage.texels.clear();
+                }
+            }
+
+            lock.lock();
+            m_LoadedPages.push_back(std::move(loadedPage));
+            --m_ReadingCount;
+            m_Condition.notify_all();
+        }
+    }
+
+    void VirtualTextureCache::RequestPage(VirtualTexture& texture, int page, int level, Clock::time_point now, std::vector<PageRequest>& requests)
+    {
+        if (texture.m_IsPending[page]) return;
+
+        // Ancestors were not sampled themselves, the stamp keeps the workers from skipping them as stale
+        texture.m_IsPending[page] = 1;
+        texture.m_Feedback[page].store(m_FrameIdx.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        requests.push_back({&texture, page, level, now});
+    }
+
+    int VirtualTextureCache::AllocateSlot(uint32_t frameIdx)
+    {
+        if (not m_FreeSlots.empty())
+        {
+            const int slot = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+            return slot;
+        }
+
+        const int slot = m_LruSlots.front();
+        if (m_SlotLastUsed[slot] >= frameIdx) return -1;
+
+        m_SlotOwners[slot]->m_PageSlots[m_SlotPages[slot]] = -1;
+        ++m_Stats.pagesEvicted;
+        return slot;
+    }
+
+    void VirtualTextureCache::TouchSlot(int slot, uint32_t frameIdx)
+    {
+        m_SlotLastUsed[slot] = frameIdx;
+        if (m_LruIts[slot] == m_LruSlots.end()) m_LruIts[slot] = m_LruSlots.insert(m_LruSlots.end(), slot);
+        else                                    m_LruSlots.splice(m_LruSlots.end(), m_LruSlots, m_LruIts[slot]);
+    }
+#pragma endregion
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include "MipChain.h"
+
+// Standard includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+    struct VirtualTextureStats
+    {
+        int      slotCount         = 0;
+        int      residentPages     = 0;
+        int      pendingPages      = 0;    // Queued or being read by a worker
+        int      requestedPages    = 0;    // Distinct pages the last frame sampled
+        int      hitPages          = 0;    // Of requestedPages, the ones that were resident while that frame was sampled
+        float    hitRate           = 1.0f;
+        int      pagesLoaded       = 0;    // Committed by the last Update()
+        int      pagesEvicted      = 0;
+        int      pagesDropped      = 0;    // Read, but every slot was still in use by the last frame
+        float    averageLatencyMs  = 0.0f; // From the request to the commit, over the pages of the last Update()
+        float    maxLatencyMs      = 0.0f;
+        uint64_t totalPagesLoaded  = 0;
+        uint64_t totalPagesEvicted = 0;
+    };
+
+    /**
+     * \brief RGBA8 mip chain split into PAGE_SIZE x PAGE_SIZE pages in a .vtex backing file. A page table maps every page to a slot
+     * of the VirtualTextureCache that opened the texture; the levels that fit in one page form the tail, which is read when the
+     * texture is opened and never leaves memory. A lookup into a page that is not resident falls back to the same spot one level
+     * coarser and records the page it wanted, which the cache turns into a load after the frame.
+     */
+    class VirtualTexture final
+    {
+    public:
+        static constexpr const char* EXTENSION   = ".vtex";
+        static constexpr int         PAGE_SHIFT  = 7;
+        static constexpr int         PAGE_SIZE   = 1 << PAGE_SHIFT;
+        static constexpr int         PAGE_TEXELS = PAGE_SIZE * PAGE_SIZE;
+
+        ~VirtualTexture() = default;
+
+        VirtualTexture(const VirtualTexture&)                = delete;
+        VirtualTexture(VirtualTexture&&) noexcept            = delete;
+        VirtualTexture& operator=(const VirtualTexture&)     = delete;
+        VirtualTexture& operator=(VirtualTexture&&) noexcept = delete;
+
+        // Any layout, pages are always row-major on disk
+        static bool Write(const std::string& path, const MipChain& mipChain);
+
+        int             GetLevelCount()       const { return static_cast<int>(m_Levels.size()); }
+        const MipLevel& GetLevel(int level)   const { return m_Levels[level]; } // offset is the first page of the level
+        int             GetTailLevel()        const { return m_TailLevel; }
+        int             GetPageCount()        const { return static_cast<int>(m_PageSlots.size()); }
+        bool            IsResident(int page)  const { return m_PageSlots[page] >= 0; }
+
+        // Called by the sampler from any thread while a frame is rendered, the page table only changes between frames
+        void RequestPage(int level, int x, int y) const
+        {
+            if (level >= m_TailLevel) return;
+
+            std::atomic<uint32_t>& stamp = m_Feedback[GetPageIndex(level, x, y)];
+            if (stamp.load(std::memory_order_relaxed) != m_FrameIdx) stamp.store(m_FrameIdx, std::memory_order_relaxed);
+        }
+
+        uint32_t GetTexel(int level, int x, int y) const
+        {
+            for (; level < m_TailLevel; ++level)
+            {
+                const int32_t slot = m_PageSlots[GetPageIndex(level, x, y)];
+                if (slot >= 0) return m_SlotTexelsPtr[(static_cast<size_t>(slot) << (2 * PAGE_SHIFT)) + ((y & (PAGE_SIZE - 1)) << PAGE_SHIFT) + (x & (PAGE_SIZE - 1))];
+
+                x = std::min(x >> 1, m_Levels[level + 1].width  - 1);
+                y = std::min(y >> 1, m_Levels[level + 1].height - 1);
+            }
+            return m_Tail.GetTexel(level - m_TailLevel, x, y);
+        }
+
+    private:
+        friend class VirtualTextureCache;
+
+        VirtualTexture() = default;
+
+        // Reads the header, the page table and the tail, the pages stay on disk
+        bool Open(const std::string& path, const uint32_t* slotTexelsPtr);
+
+        int GetPageIndex(int level, int x, int y) const
+        {
+            return static_cast<int>(m_Levels[level].offset) + (y >> PAGE_SHIFT) * m_PagesX[level] + (x >> PAGE_SHIFT);
+        }
+
+        std::string           m_Path          {};
+        std::vector<MipLevel> m_Levels        {};
+        std::vector<int>      m_PagesX        {};
+        int                   m_TailLevel     = 0;
+        MipChain              m_Tail          {}; // Level 0 is m_TailLevel
+        std::vector<uint64_t> m_PageOffsets   {}; // Where every page starts in the backing file
+        std::vector<int32_t>  m_PageSlots     {}; // Cache slot of every page, -1 when it is not resident
+        std::vector<uint8_t>  m_IsPending     {}; // Requested and not committed yet
+        const uint32_t*       m_SlotTexelsPtr = nullptr;
+        uint32_t              m_FrameIdx      = 1;
+
+        // Index of the last frame that wanted every page
+        mutable std::vector<std::atomic<uint32_t>> m_Feedback {};
+    };
+
+    /**
+     * \brief Physical tile cache shared by every VirtualTexture it opens. Pages are read from the backing files by worker threads,
+     * so a missing page never stalls a frame, and only enter the page tables in Update(), between frames. When every slot is taken,
+     * the page that was sampled the longest ago makes room; a page sampled by the last frame is never evicted.
+     */
+    class VirtualTextureCache final
+    {
+    public:
+        explicit VirtualTextureCache(int slotCount, int workerCount = 2);
+        ~VirtualTextureCache();
+
+        VirtualTextureCache(const VirtualTextureCache&)                = delete;
+        VirtualTextureCache(VirtualTextureCache&&) noexcept            = delete;
+        VirtualTextureCache& operator=(const VirtualTextureCache&)     = delete;
+        VirtualTextureCache& operator=(VirtualTextureCache&&) noexcept = delete;
+
+        // Belongs to the cache, nullptr when the backing file cannot be read
+        const VirtualTexture* Open(const std::string& path);
+
+        // Never while a frame is sampled: turns the feedback of the frame that was just rendered into requests, then commits the pages the workers finished
+        void Update();
+
+        // Blocks until every queued request is read, so the next Update() commits all of them
+        void Flush();
+
+        // Evicts every page, the tails stay
+        void Clear();
+
+        const VirtualTextureStats& GetStats() const { return m_Stats; }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct PageRequest
+        {
+            VirtualTexture*   texturePtr  = nullptr;
+            int               page        = 0;
+            int               level       = 0;
+            Clock::time_point requestTime {};
+        };
+
+        struct LoadedPage
+        {
+            PageRequest           request {};
+            std::vector<uint32_t> texels  {}; // Empty when the read failed or the page was no longer wanted
+        };
+
+        void RunWorker();
+        void RequestPage(VirtualTexture& texture, int page, int level, Clock::time_point now, std::vector<PageRequest>& requests);
+        // Free slot or the least recently used one, -1 when every slot was sampled by the frame in flight
+        int  AllocateSlot(uint32_t frameIdx);
+        void TouchSlot(int slot, uint32_t frameIdx);
+
+        std::vector<VirtualTexture*> m_TexturePtrs {};
+
+        // Slot texels are row-major pages back to back, allocated once so the texture pointers into it stay valid
+        std::vector<uint32_t>                 m_SlotTexels   {};
+        std::vector<VirtualTexture*>          m_SlotOwners   {};
+        std::vector<int>                      m_SlotPages    {};
+        std::vector<uint32_t>                 m_SlotLastUsed {};
+        std::vector<int>                      m_FreeSlots    {};
+        std::list<int>                        m_LruSlots     {}; // Resident slots, least recently used first
+        std::vector<std::list<int>::iterator> m_LruIts       {};
+
+        std::mutex               m_Mutex       {};
+        std::condition_variable  m_Condition   {}; // Signals new requests to the workers and finished reads to Flush()
+        std::deque<PageRequest>  m_Requests    {};
+        std::vector<LoadedPage>  m_LoadedPages {};
+        int                      m_ReadingCount = 0;
+        bool                     m_IsStopping   = false;
+        std::vector<std::thread> m_Workers      {};
+
+        // Frame being sampled, workers skip requests that went this many frames without being sampled again
+        static constexpr uint32_t STALE_FRAMES = 4;
+        std::atomic<uint32_t>     m_FrameIdx   {1};
+
+        VirtualTextureStats m_Stats {};
+    };
+}
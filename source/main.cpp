@@ -36,11 +36,29 @@ void StartImGuiFrame()
 #endif
 }
 
+// Offline converter: DirectX.exe --bake <image> [BC1|BC4|BC5|BC7] [--linear] [--alpha <image>] writes the .dtex next to the image
+int BakeTexture(int argc, char* args[])
+{
+    TextureAsset asset{args[2]};
+    for (int i = 3; i < argc; ++i)
+    {
+        const std::string argument = args[i];
+        if      (argument == "BC1")      asset.compressionSettings.format = BlockFormat::BC1;
+        else if (argument == "BC4")      asset.compressionSettings.format = BlockFormat::BC4;
+        else if (argument == "BC5")      asset.compressionSettings.format = BlockFormat::BC5;
+        else if (argument == "BC7")      asset.compressionSettings.format = BlockFormat::BC7;
+        else if (argument == "--linear") asset.mipSettings.isSRGB         = false;
+        else if (argument == "--alpha" and i + 1 < argc) asset.alphaPath = args[++i];
+        else std::cout << RED_TEXT("Unknown bake option: ") << argument << '\n';
+    }
+    return TextureContainer::Convert(asset) ? 0 : 1;
+}
+
 int main(int argc, char* args[])
 {
-    //Unreferenced parameters
-    (void)argc;
-    (void)args;
+    // No window needed to bake
+    if (argc >= 3 and std::string{args[1]} == "--bake")
+        return BakeTexture(argc, args);
 
     //Create window + surfaces
     SDL_Init(SDL_INIT_VIDEO);
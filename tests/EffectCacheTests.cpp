@@ -0,0 +1,298 @@
+#include "EffectCache.h"
+
+// Standard includes
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+// Test includes
+#include <gtest/gtest.h>
+
+namespace dae
+{
+    namespace
+    {
+        // Counts its compiles. The binary is the source with its defines and flags, so a stale entry is visible in what Load() returns
+        class StubEffectCompiler final : public IEffectCompiler
+        {
+        public:
+            bool Compile(const EffectSource& source, std::vector<uint8_t>& binary, std::string& errors) const override
+            {
+                ++m_NumCompiles;
+
+                std::ifstream file{source.path, std::ios::binary};
+                if (not file)
+                {
+                    errors = "missing " + source.path.string();
+                    return false;
+                }
+
+                std::string output{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+                for (const EffectDefine& define : source.defines)
+                {
+                    output += '|' + define.name + '=' + define.value;
+                }
+                output += '|' + std::to_string(source.shaderFlags) + '|' + std::to_string(source.effectFlags);
+
+                binary.assign(output.begin(), output.end());
+                return true;
+            }
+
+            std::string GetVersion() const override { return "stub 1"; }
+
+            int GetNumCompiles() const { return m_NumCompiles; }
+
+        private:
+            mutable std::atomic<int> m_NumCompiles{0};
+        };
+
+        class EffectCacheTest : public testing::Test
+        {
+        protected:
+            void SetUp() override
+            {
+                const testing::TestInfo* infoPtr = testing::UnitTest::GetInstance()->current_test_info();
+                m_Directory = std::filesystem::temp_directory_path() / "EffectCacheTests" / infoPtr->name();
+                std::filesystem::remove_all(m_Directory);
+                std::filesystem::create_directories(m_Directory);
+
+                WriteFile("Effect.fx",  "#include \"Common.fxh\"\nfloat4 PS() : SV_TARGET { return gColor; }\n");
+                WriteFile("Common.fxh", "float4 gColor;\n");
+
+                m_Source.path = m_Directory / "Effect.fx";
+            }
+
+            void TearDown() override
+            {
+                std::filesystem::remove_all(m_Directory);
+            }
+
+            void WriteFile(const std::string& name, const std::string& contents) const
+            {
+                std::ofstream file{m_Directory / name, std::ios::binary | std::ios::trunc};
+                file << contents;
+            }
+
+            std::vector<uint8_t> Load(EffectCache& cache, const EffectSource& source) const
+            {
+                std::vector<uint8_t> binary{};
+                std::string          errors{};
+                EXPECT_TRUE(cache.Load(source, binary, errors)) << errors;
+                return binary;
+            }
+
+            std::vector<uint8_t> Compile(const EffectSource& source) const
+            {
+                const StubEffectCompiler compiler{};
+                std::vector<uint8_t>     binary{};
+                std::string              errors{};
+                EXPECT_TRUE(compiler.Compile(source, binary, errors)) << errors;
+                return binary;
+            }
+
+            std::filesystem::path m_Directory {};
+            EffectSource          m_Source    {};
+            StubEffectCompiler    m_Compiler  {};
+        };
+    }
+
+    TEST_F(EffectCacheTest, MissCompilesAndStoresTheEntry)
+    {
+        EffectCache cache{m_Compiler, m_Directory / "Cache"};
+
+        EXPECT_EQ(Load(cache, m_Source), Compile(m_Source));
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 1);
+        EXPECT_TRUE(std::filesystem::exists(cache.GetEntryPath(m_Source)));
+
+        const EffectCacheStats stats = cache.GetStats();
+        EXPECT_EQ(stats.hits,   0u);
+        EXPECT_EQ(stats.misses, 1u);
+    }
+
+    TEST_F(EffectCacheTest, HitReadsTheStoredEntry)
+    {
+        EffectCache cache{m_Compiler, m_Directory / "Cache"};
+        const std::vector<uint8_t> compiled = Load(cache, m_Source);
+
+        // Another cache on the same directory, like the next run of the application
+        EffectCache nextCache{m_Compiler, m_Directory / "Cache"};
+        EXPECT_EQ(Load(nextCache, m_Source), compiled);
+        EXPECT_EQ(Load(nextCache, m_Source), compiled);
+
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 1);
+        EXPECT_EQ(nextCache.GetStats().hits,   2u);
+        EXPECT_EQ(nextCache.GetStats().misses, 0u);
+    }
+
+    TEST_F(EffectCacheTest, ChangedIncludeInvalidatesTheEntry)
+    {
+        EffectCache cache{m_Compiler, m_Directory / "Cache"};
+        Load(cache, m_Source);
+
+        WriteFile("Common.fxh", "float4 gColor;\nfloat gIntensity;\n");
+        Load(cache, m_Source);
+
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 2);
+        EXPECT_EQ(cache.GetStats().invalidations, 1u);
+
+        Load(cache, m_Source);
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 2);
+    }
+
+    TEST_F(EffectCacheTest, ChangedSourceInvalidatesTheEntry)
+    {
+        EffectCache cache{m_Compiler, m_Directory / "Cache"};
+        Load(cache, m_Source);
+
+        WriteFile("Effect.fx", "#include \"Common.fxh\"\nfloat4 PS() : SV_TARGET { return gColor * 0.5f; }\n");
+        EXPECT_EQ(Load(cache, m_Source), Compile(m_Source));
+
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 2);
+        EXPECT_EQ(cache.GetStats().invalidations, 1u);
+    }
+
+    TEST_F(EffectCacheTest, DefinesAndFlagsSelectTheirOwnEntry)
+    {
+        EffectCache cache{m_Compiler, m_Directory / "Cache"};
+        Load(cache, m_Source);
+
+        EffectSource defined = m_Source;
+        defined.defines      = {{"SHADING_MODE", "1"}};
+        EffectSource redefined = m_Source;
+        redefined.defines      = {{"SHADING_MODE", "2"}};
+        EffectSource shaderFlagged = m_Source;
+        shaderFlagged.shaderFlags  = 1u << 0;
+        EffectSource effectFlagged = m_Source;
+        effectFlagged.effectFlags  = 1u << 1;
+
+        for (const EffectSource* sourcePtr : {&defined, &redefined, &shaderFlagged, &effectFlagged})
+        {
+            EXPECT_NE(cache.GetEntryPath(*sourcePtr), cache.GetEntryPath(m_Source));
+            EXPECT_NE(cache.GetKey(*sourcePtr),       cache.GetKey(m_Source));
+            EXPECT_EQ(Load(cache, *sourcePtr), Compile(*sourcePtr));
+        }
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 5);
+
+        // None of them replaced another
+        for (const EffectSource* sourcePtr : {&m_Source, &defined, &redefined, &shaderFlagged, &effectFlagged})
+        {
+            EXPECT_EQ(Load(cache, *sourcePtr), Compile(*sourcePtr));
+        }
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 5);
+        EXPECT_EQ(cache.GetStats().hits, 5u);
+    }
+
+    TEST_F(EffectCacheTest, TruncatedEntryIsRejected)
+    {
+        EffectCache cache{m_Compiler, m_Directory / "Cache"};
+        const std::vector<uint8_t> compiled = Load(cache, m_Source);
+
+        const std::filesystem::path entryPath = cache.GetEntryPath(m_Source);
+        for (const uintmax_t size : {std::filesystem::file_size(entryPath) - 1, uintmax_t{40}, uintmax_t{16}, uintmax_t{0}})
+        {
+            std::filesystem::resize_file(entryPath, size);
+            EXPECT_EQ(Load(cache, m_Source), compiled);
+        }
+
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 5);
+        EXPECT_EQ(cache.GetStats().corruptEntries, 4u);
+    }
+
+    TEST_F(EffectCacheTest, CorruptEntryIsRejected)
+    {
+        EffectCache cache{m_Compiler, m_Directory / "Cache"};
+        const std::vector<uint8_t> compiled = Load(cache, m_Source);
+
+        // One flipped byte in the binary, the header still matches the key
+        const std::filesystem::path entryPath = cache.GetEntryPath(m_Source);
+        {
+            std::fstream file{entryPath, std::ios::binary | std::ios::in | std::ios::out};
+            file.seekg(-1, std::ios::end);
+            const char last = static_cast<char>(file.get());
+            file.seekp(-1, std::ios::end);
+            file.put(static_cast<char>(last ^ 0x5A));
+        }
+        EXPECT_EQ(Load(cache, m_Source), compiled);
+
+        // A foreign file in place of the entry
+        {
+            std::ofstream file{entryPath, std::ios::binary | std::ios::trunc};
+            file << "not an effect cache entry, long enough to hold a header";
+        }
+        EXPECT_EQ(Load(cache, m_Source), compiled);
+
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 3);
+        EXPECT_EQ(cache.GetStats().corruptEntries, 2u);
+
+        // The corrupt entry was replaced
+        Load(cache, m_Source);
+        EXPECT_EQ(m_Compiler.GetNumCompiles(), 3);
+    }
+
+    TEST_F(EffectCacheTest, WritersOfTheSameKeyNeverTearTheEntry)
+    {
+        constexpr int NUM_WRITERS = 8;
+        constexpr int NUM_ROUNDS  = 16;
+
+        const std::vector<uint8_t> expected = Compile(m_Source);
+
+        for (int round = 0; round < NUM_ROUNDS; ++round)
+        {
+            std::filesystem::remove_all(m_Directory / "Cache");
+
+            // Every writer has its own cache like separate processes would, all of them miss and store the same entry at once
+            std::atomic<int>         numReady{0};
+            std::vector<std::thread> writers{};
+            std::vector<std::vector<uint8_t>> binaries(NUM_WRITERS);
+            for (int writerIdx = 0; writerIdx < NUM_WRITERS; ++writerIdx)
+            {
+                writers.emplace_back([this, writerIdx, &numReady, &binaries]()
+                {
+                    EffectCache cache{m_Compiler, m_Directory / "Cache"};
+
+                    ++numReady;
+                    while (numReady < NUM_WRITERS) std::this_thread::yield();
+
+                    binaries[writerIdx] = Load(cache, m_Source);
+                });
+            }
+            for (std::thread& writer : writers)
+            {
+                writer.join();
+            }
+
+            for (const std::vector<uint8_t>& binary : binaries)
+            {
+                EXPECT_EQ(binary, expected);
+            }
+
+            // One intact entry and no temporary files left behind
+            int numFiles = 0;
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{m_Directory / "Cache"})
+            {
+                EXPECT_EQ(entry.path().extension(), EffectCache::EXTENSION);
+                ++numFiles;
+            }
+            EXPECT_EQ(numFiles, 1);
+
+            EffectCache cache{m_Compiler, m_Directory / "Cache"};
+            EXPECT_EQ(Load(cache, m_Source), expected);
+            EXPECT_EQ(cache.GetStats().hits, 1u);
+        }
+    }
+
+    TEST_F(EffectCacheTest, CompileFailureIsNotStored)
+    {
+        EffectCache cache{m_Compiler, m_Directory / "Cache"};
+
+        EffectSource missing = m_Source;
+        missing.path         = m_Directory / "Missing.fx";
+
+        std::vector<uint8_t> binary{};
+        std::string          errors{};
+        EXPECT_FALSE(cache.Load(missing, binary, errors));
+        EXPECT_FALSE(errors.empty());
+        EXPECT_FALSE(std::filesystem::exists(cache.GetEntryPath(missing)));
+        EXPECT_EQ(cache.GetStats().compileFailures, 1u);
+    }
+}
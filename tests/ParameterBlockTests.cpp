@@ -0,0 +1,282 @@
+#include "ParameterBlock.h"
+
+// Standard includes
+#include <cstring>
+
+// Test includes
+#include <gtest/gtest.h>
+
+namespace dae
+{
+    namespace
+    {
+        // Keeps every upload and a copy of the buffer it would have written to
+        class RecordingParameterSink final : public IParameterSink
+        {
+        public:
+            struct Record
+            {
+                uint64_t blockId   = 0;
+                uint64_t fieldMask = 0;
+            };
+
+            void Upload(const ParameterBlock& block, uint64_t fieldMask) override
+            {
+                m_Uploads.push_back({block.GetId(), fieldMask});
+
+                uint32_t offset{};
+                uint32_t size{};
+                block.GetRange(fieldMask, offset, size);
+                if (m_Buffer.size() < offset + size) m_Buffer.resize(offset + size, 0);
+                std::memcpy(m_Buffer.data() + offset, block.GetData() + offset, size);
+            }
+
+            const std::vector<Record>&  GetUploads() const { return m_Uploads; }
+            const std::vector<uint8_t>& GetBuffer()  const { return m_Buffer; }
+
+            uint64_t GetLastMask() const { return m_Uploads.empty() ? 0 : m_Uploads.back().fieldMask; }
+
+        private:
+            std::vector<Record>  m_Uploads {};
+            std::vector<uint8_t> m_Buffer  {};
+        };
+
+        struct Float3
+        {
+            float x, y, z;
+        };
+
+        struct Float4x4
+        {
+            float m[16];
+        };
+
+        uint64_t Bits(std::initializer_list<int> fieldIndices)
+        {
+            uint64_t mask = 0;
+            for (const int fieldIdx : fieldIndices)
+            {
+                mask |= uint64_t{1} << fieldIdx;
+            }
+            return mask;
+        }
+    }
+
+#pragma region Packing
+    TEST(ParameterBlockPacking, FieldsFollowHlslRegisterPacking)
+    {
+        // Same layout as cbFrame
+        ParameterBlock block{ParameterFrequency::Frame};
+        const int cameraPos      = block.AddField("gCameraPos",      sizeof(Float3));
+        const int time           = block.AddField("gTime",           sizeof(float));
+        const int ambientColor   = block.AddField("gAmbientColor",   sizeof(Float3));
+        const int lightDir       = block.AddField("gLightDir",       sizeof(Float3));
+        const int lightIntensity = block.AddField("gLightIntensity", sizeof(float));
+
+        const std::vector<ParameterField>& fields = block.GetFields();
+        EXPECT_EQ(fields[cameraPos].offset,      0u);
+        EXPECT_EQ(fields[time].offset,           12u); // Fills the register of the float3
+        EXPECT_EQ(fields[ambientColor].offset,   16u);
+        EXPECT_EQ(fields[lightDir].offset,       32u); // 28 + 12 would straddle into the third register
+        EXPECT_EQ(fields[lightIntensity].offset, 44u);
+        EXPECT_EQ(block.GetSize(),               48u);
+    }
+
+    TEST(ParameterBlockPacking, Float3AfterMatrixStartsItsOwnRegister)
+    {
+        ParameterBlock block{ParameterFrequency::Object};
+        const int worldViewProj = block.AddField("gWorldViewProj", sizeof(Float4x4));
+        const int position      = block.AddField("gPosition",      sizeof(Float3));
+        const int scale         = block.AddField("gScale",         sizeof(float));
+        const int world         = block.AddField("gWorld",         sizeof(Float4x4));
+
+        const std::vector<ParameterField>& fields = block.GetFields();
+        EXPECT_EQ(fields[worldViewProj].offset, 0u);
+        EXPECT_EQ(fields[position].offset,      64u);
+        EXPECT_EQ(fields[scale].offset,         76u);
+        EXPECT_EQ(fields[world].offset,         80u);
+        EXPECT_EQ(block.GetSize(),              144u);
+    }
+
+    TEST(ParameterBlockPacking, FieldsNeverStraddleARegister)
+    {
+        ParameterBlock block{ParameterFrequency::Material};
+        const int first  = block.AddField("gFirst",  sizeof(float) * 2);
+        const int second = block.AddField("gSecond", sizeof(Float3));  // 8 + 12 > 16
+        const int third  = block.AddField("gThird",  sizeof(float) * 2);
+        const int matrix = block.AddField("gMatrix", sizeof(Float4x4)); // Only the first register would fit after 40
+        const int last   = block.AddField("gLast",   sizeof(float));
+
+        const std::vector<ParameterField>& fields = block.GetFields();
+        EXPECT_EQ(fields[first].offset,  0u);
+        EXPECT_EQ(fields[second].offset, 16u);
+        EXPECT_EQ(fields[third].offset,  32u); // 28 + 8 would straddle
+        EXPECT_EQ(fields[matrix].offset, 48u);
+        EXPECT_EQ(fields[last].offset,   112u);
+    }
+
+    TEST(ParameterBlockPacking, RangeCoversExactlyTheMaskedFields)
+    {
+        ParameterBlock block{ParameterFrequency::Frame};
+        block.AddField("gA", sizeof(Float3));
+        block.AddField("gB", sizeof(float));
+        block.AddField("gC", sizeof(Float3));
+        block.AddField("gD", sizeof(Float3));
+
+        uint32_t offset{};
+        uint32_t size{};
+        block.GetRange(Bits({1, 2}), offset, size);
+        EXPECT_EQ(offset, 12u);
+        EXPECT_EQ(size,   16u);
+
+        block.GetRange(Bits({3}), offset, size);
+        EXPECT_EQ(offset, 32u);
+        EXPECT_EQ(size,   12u);
+
+        block.GetRange(0, offset, size);
+        EXPECT_EQ(size, 0u);
+    }
+#pragma endregion
+
+#pragma region Dirty tracking
+    TEST(ParameterBlockDirty, SetOfAnUnchangedValueIsNoChange)
+    {
+        ParameterBlock block{ParameterFrequency::Frame};
+        const int time = block.AddField("gTime", sizeof(float));
+
+        EXPECT_TRUE(block.Set(time, 1.0f));
+        const uint64_t version = block.GetVersion();
+
+        EXPECT_FALSE(block.Set(time, 1.0f));
+        EXPECT_EQ(block.GetVersion(),        version);
+        EXPECT_EQ(block.GetDirtyMask(version), 0u);
+
+        EXPECT_TRUE(block.Set(time, 2.0f));
+        EXPECT_EQ(block.GetDirtyMask(version), Bits({time}));
+    }
+
+    TEST(ParameterBlockDirty, ZeroIsAChangeForAFieldThatWasNeverSet)
+    {
+        ParameterBlock block{ParameterFrequency::Frame};
+        const int time = block.AddField("gTime", sizeof(float));
+
+        // The data starts out zeroed, but the buffer holds its own value until the field is set
+        EXPECT_EQ(block.GetDirtyMask(0), 0u);
+        EXPECT_TRUE(block.Set(time, 0.0f));
+        EXPECT_EQ(block.GetDirtyMask(0), Bits({time}));
+    }
+
+    TEST(ParameterBlockDirty, ApplyOnlyUploadsWhatChanged)
+    {
+        ParameterBlock block{ParameterFrequency::Frame};
+        const int cameraPos = block.AddField("gCameraPos", sizeof(Float3));
+        const int time      = block.AddField("gTime",      sizeof(float));
+        const int lightDir  = block.AddField("gLightDir",  sizeof(Float3));
+
+        RecordingParameterSink sink{};
+        ParameterBinding       binding{sink};
+
+        block.Set(cameraPos, Float3{1.0f, 2.0f, 3.0f});
+        block.Set(time,      0.5f);
+        EXPECT_TRUE(binding.Apply(block));
+        EXPECT_EQ(sink.GetLastMask(), Bits({cameraPos, time})); // lightDir was never set
+
+        EXPECT_FALSE(binding.Apply(block));
+        block.Set(time, 0.5f);
+        EXPECT_FALSE(binding.Apply(block));
+
+        block.Set(lightDir, Float3{0.0f, -1.0f, 0.0f});
+        EXPECT_TRUE(binding.Apply(block));
+        EXPECT_EQ(sink.GetLastMask(), Bits({lightDir}));
+
+        EXPECT_EQ(sink.GetUploads().size(), 2u);
+        EXPECT_EQ(binding.GetStats().applies,        4u);
+        EXPECT_EQ(binding.GetStats().uploads,        2u);
+        EXPECT_EQ(binding.GetStats().uploadedFields, 3u);
+        EXPECT_EQ(binding.GetStats().uploadedBytes,  16u + 12u);
+
+        // What the sink received matches the block
+        ASSERT_EQ(sink.GetBuffer().size(), block.GetSize());
+        EXPECT_EQ(std::memcmp(sink.GetBuffer().data(), block.GetData(), block.GetSize()), 0);
+    }
+
+    TEST(ParameterBlockDirty, BindingsOfOneBlockTrackTheirOwnVersion)
+    {
+        ParameterBlock block{ParameterFrequency::Frame};
+        const int time      = block.AddField("gTime",      sizeof(float));
+        const int intensity = block.AddField("gIntensity", sizeof(float));
+
+        RecordingParameterSink firstSink{};
+        RecordingParameterSink secondSink{};
+        ParameterBinding       first{firstSink};
+        ParameterBinding       second{secondSink};
+
+        block.Set(time,      1.0f);
+        block.Set(intensity, 2.0f);
+        EXPECT_TRUE(first.Apply(block));
+        EXPECT_EQ(firstSink.GetLastMask(), Bits({time, intensity}));
+
+        // The first binding having consumed the change does not clear it for the second
+        block.Set(time, 3.0f);
+        EXPECT_TRUE(first.Apply(block));
+        EXPECT_EQ(firstSink.GetLastMask(), Bits({time}));
+
+        EXPECT_TRUE(second.Apply(block));
+        EXPECT_EQ(secondSink.GetLastMask(), Bits({time, intensity}));
+
+        block.Set(intensity, 4.0f);
+        EXPECT_TRUE(second.Apply(block));
+        EXPECT_EQ(secondSink.GetLastMask(), Bits({intensity}));
+        EXPECT_TRUE(first.Apply(block));
+        EXPECT_EQ(firstSink.GetLastMask(), Bits({intensity}));
+
+        EXPECT_FALSE(first.Apply(block));
+        EXPECT_FALSE(second.Apply(block));
+    }
+
+    TEST(ParameterBlockDirty, RebindingAnotherBlockUploadsAllOfIt)
+    {
+        ParameterBlock first{ParameterFrequency::Object};
+        ParameterBlock second{ParameterFrequency::Object};
+        const int firstWorld  = first.AddField("gWorld",  sizeof(Float4x4));
+        const int secondWorld = second.AddField("gWorld", sizeof(Float4x4));
+        first.Set(firstWorld,   Float4x4{{1.0f}});
+        second.Set(secondWorld, Float4x4{{2.0f}});
+
+        RecordingParameterSink sink{};
+        ParameterBinding       binding{sink};
+
+        EXPECT_TRUE(binding.Apply(first));
+        EXPECT_FALSE(binding.Apply(first));
+
+        // Same layout, same versions, but the buffer holds the other block
+        EXPECT_TRUE(binding.Apply(second));
+        EXPECT_EQ(sink.GetUploads().back().blockId, second.GetId());
+        EXPECT_EQ(sink.GetLastMask(),                Bits({secondWorld}));
+
+        EXPECT_TRUE(binding.Apply(first));
+        EXPECT_EQ(sink.GetUploads().back().blockId, first.GetId());
+        EXPECT_EQ(std::memcmp(sink.GetBuffer().data(), first.GetData(), first.GetSize()), 0);
+    }
+
+    TEST(ParameterBlockDirty, ResetAndLayoutChangesUploadEverything)
+    {
+        ParameterBlock block{ParameterFrequency::Material};
+        const int kd = block.AddField("gKD", sizeof(float));
+        block.Set(kd, 7.0f);
+
+        RecordingParameterSink sink{};
+        ParameterBinding       binding{sink};
+        EXPECT_TRUE(binding.Apply(block));
+
+        binding.Reset();
+        EXPECT_TRUE(binding.Apply(block));
+        EXPECT_EQ(sink.GetLastMask(), Bits({kd}));
+
+        const int shininess = block.AddField("gShininess", sizeof(float));
+        block.Set(shininess, 25.0f);
+        EXPECT_TRUE(binding.Apply(block));
+        EXPECT_EQ(sink.GetLastMask(), Bits({kd, shininess}));
+    }
+#pragma endregion
+}
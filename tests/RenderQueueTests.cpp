@@ -0,0 +1,290 @@
+#include "RenderQueue.h"
+
+// Standard includes
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <set>
+#include <tuple>
+
+// Test includes
+#include <gtest/gtest.h>
+
+namespace dae
+{
+    namespace
+    {
+        // Tags a packet with the order it was added in, the queue never reads objectPtr
+        const void* Tag(size_t idx)
+        {
+            return reinterpret_cast<const void*>(idx + 1);
+        }
+
+        size_t GetTag(const DrawPacket& packet)
+        {
+            return reinterpret_cast<size_t>(packet.objectPtr) - 1;
+        }
+
+        DrawPacket MakePacket(uint16_t geometryId, uint16_t materialId, uint8_t passIdx, float depth, RenderLayer layer = RenderLayer::Opaque)
+        {
+            DrawPacket packet{};
+            packet.geometryId = geometryId;
+            packet.materialId = materialId;
+            packet.passIdx    = passIdx;
+            packet.depth      = depth;
+            packet.layer      = layer;
+            return packet;
+        }
+
+        std::vector<DrawPacket> MakeRandomPackets(size_t count, uint32_t seed)
+        {
+            std::mt19937                          generator{seed};
+            std::uniform_int_distribution<int>    idDistribution{0, 0xFFFF};
+            std::uniform_int_distribution<int>    passDistribution{0, 0x7F};
+            std::uniform_real_distribution<float> depthDistribution{-1.0f, 1000.0f};
+            std::bernoulli_distribution           transparentDistribution{0.25};
+
+            std::vector<DrawPacket> packets{};
+            for (size_t i = 0; i < count; ++i)
+            {
+                DrawPacket packet = MakePacket(static_cast<uint16_t>(idDistribution(generator)), static_cast<uint16_t>(idDistribution(generator)),
+                                               static_cast<uint8_t>(passDistribution(generator)), depthDistribution(generator),
+                                               transparentDistribution(generator) ? RenderLayer::Transparent : RenderLayer::Opaque);
+                packet.objectPtr = Tag(i);
+                packets.push_back(packet);
+            }
+            return packets;
+        }
+
+        // Sorted like Sort() promises: by key, ties in the order they were added in
+        std::vector<size_t> GetReferenceOrder(const std::vector<DrawPacket>& packets)
+        {
+            std::vector<size_t> order(packets.size());
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                order[i] = i;
+            }
+            std::ranges::stable_sort(order, [&packets](size_t lhs, size_t rhs)
+            {
+                return RenderQueue::EncodeSortKey(packets[lhs]) < RenderQueue::EncodeSortKey(packets[rhs]);
+            });
+            return order;
+        }
+
+        std::vector<size_t> GetOrder(const RenderQueue& queue)
+        {
+            std::vector<size_t> order{};
+            for (size_t i = 0; i < queue.GetPacketCount(); ++i)
+            {
+                order.push_back(GetTag(queue.GetPacket(i)));
+            }
+            return order;
+        }
+
+        size_t CountCommands(const RecordingBackend& backend, RenderCommandType type)
+        {
+            return static_cast<size_t>(std::ranges::count_if(backend.GetCommands(), [type](const RenderCommand& command) { return command.type == type; }));
+        }
+    }
+
+#pragma region Sort keys
+    TEST(RenderQueueKeys, OpaqueOrdersByPassMaterialGeometryThenDepth)
+    {
+        const uint64_t base = RenderQueue::EncodeSortKey(MakePacket(5, 5, 5, 10.0f));
+
+        EXPECT_LT(base, RenderQueue::EncodeSortKey(MakePacket(5, 5, 5, 20.0f)));
+        EXPECT_LT(base, RenderQueue::EncodeSortKey(MakePacket(6, 5, 5, 0.0f)));
+        EXPECT_LT(base, RenderQueue::EncodeSortKey(MakePacket(0, 6, 5, 0.0f)));
+        EXPECT_LT(base, RenderQueue::EncodeSortKey(MakePacket(0, 0, 6, 0.0f)));
+
+        // The state outranks the depth, the pass outranks everything
+        EXPECT_LT(RenderQueue::EncodeSortKey(MakePacket(1, 1, 1, 999.0f)), RenderQueue::EncodeSortKey(MakePacket(2, 1, 1, 1.0f)));
+        EXPECT_LT(RenderQueue::EncodeSortKey(MakePacket(0xFFFF, 0xFFFF, 1, 999.0f)), RenderQueue::EncodeSortKey(MakePacket(0, 0, 2, 0.0f)));
+    }
+
+    TEST(RenderQueueKeys, TransparentFollowsOpaqueBackToFront)
+    {
+        const uint64_t opaque = RenderQueue::EncodeSortKey(MakePacket(0xFFFF, 0xFFFF, 0x7F, 1e30f));
+        const uint64_t far    = RenderQueue::EncodeSortKey(MakePacket(9, 9, 9, 100.0f, RenderLayer::Transparent));
+        const uint64_t near   = RenderQueue::EncodeSortKey(MakePacket(0, 0, 0, 10.0f,  RenderLayer::Transparent));
+
+        EXPECT_LT(opaque, far);
+        EXPECT_LT(far,    near);
+
+        // Equal depths fall back to the state
+        EXPECT_LT(RenderQueue::EncodeSortKey(MakePacket(0, 1, 0, 10.0f, RenderLayer::Transparent)),
+                  RenderQueue::EncodeSortKey(MakePacket(0, 2, 0, 10.0f, RenderLayer::Transparent)));
+    }
+
+    TEST(RenderQueueKeys, NegativeAndNanDepthsCountAsZero)
+    {
+        const uint64_t zero = RenderQueue::EncodeSortKey(MakePacket(1, 1, 1, 0.0f));
+        EXPECT_EQ(RenderQueue::EncodeSortKey(MakePacket(1, 1, 1, -5.0f)),                                    zero);
+        EXPECT_EQ(RenderQueue::EncodeSortKey(MakePacket(1, 1, 1, std::numeric_limits<float>::quiet_NaN())), zero);
+    }
+#pragma endregion
+
+#pragma region Sort
+    TEST(RenderQueueSort, RadixSortMatchesAStableSortOfTheKeys)
+    {
+        RenderQueue queue{};
+        for (const size_t count : {size_t{0}, size_t{1}, size_t{2}, size_t{17}, size_t{1000}, size_t{10000}})
+        {
+            const std::vector<DrawPacket> packets = MakeRandomPackets(count, static_cast<uint32_t>(count));
+
+            queue.Clear();
+            for (const DrawPacket& packet : packets)
+            {
+                queue.Add(packet);
+            }
+            queue.Sort();
+
+            ASSERT_EQ(queue.GetPacketCount(), count);
+            EXPECT_EQ(GetOrder(queue), GetReferenceOrder(packets)) << count << " packets";
+            for (size_t i = 1; i < queue.GetPacketCount(); ++i)
+            {
+                EXPECT_LE(queue.GetSortKey(i - 1), queue.GetSortKey(i));
+            }
+        }
+    }
+
+    TEST(RenderQueueSort, EqualKeysKeepTheOrderTheyWereAddedIn)
+    {
+        // Few states and depths, so most keys have many duplicates
+        std::mt19937                       generator{7};
+        std::uniform_int_distribution<int> stateDistribution{0, 2};
+
+        std::vector<DrawPacket> packets{};
+        for (size_t i = 0; i < 3000; ++i)
+        {
+            DrawPacket packet = MakePacket(static_cast<uint16_t>(stateDistribution(generator)), static_cast<uint16_t>(stateDistribution(generator)),
+                                           static_cast<uint8_t>(stateDistribution(generator)), static_cast<float>(stateDistribution(generator)),
+                                           i % 5 == 0 ? RenderLayer::Transparent : RenderLayer::Opaque);
+            packet.objectPtr = Tag(i);
+            packets.push_back(packet);
+        }
+
+        RenderQueue queue{};
+        for (const DrawPacket& packet : packets)
+        {
+            queue.Add(packet);
+        }
+        queue.Sort();
+
+        const std::vector<size_t> order = GetOrder(queue);
+        EXPECT_EQ(order, GetReferenceOrder(packets));
+        for (size_t i = 1; i < order.size(); ++i)
+        {
+            if (queue.GetSortKey(i - 1) == queue.GetSortKey(i))
+            {
+                EXPECT_LT(order[i - 1], order[i]);
+            }
+        }
+    }
+
+    TEST(RenderQueueSort, BytesEveryKeySharesAreSkipped)
+    {
+        // Only the geometry differs, in its low byte
+        RenderQueue queue{};
+        for (uint16_t geometryId = 200; geometryId > 0; --geometryId)
+        {
+            queue.Add(MakePacket(geometryId, 3, 1, 5.0f));
+        }
+        queue.Sort();
+
+        EXPECT_EQ(queue.GetStats().sortPasses, 1u);
+        for (size_t i = 0; i < queue.GetPacketCount(); ++i)
+        {
+            EXPECT_EQ(queue.GetPacket(i).geometryId, i + 1);
+        }
+
+        // Already in one bucket everywhere, nothing to move
+        queue.Clear();
+        queue.Add(MakePacket(1, 1, 1, 1.0f));
+        queue.Add(MakePacket(1, 1, 1, 1.0f));
+        queue.Sort();
+        EXPECT_EQ(queue.GetStats().sortPasses, 0u);
+    }
+#pragma endregion
+
+#pragma region Submit
+    TEST(RenderQueueSubmit, RedundantBindsAreSkipped)
+    {
+        // Two passes, three materials and four geometries, interleaved the way a scene adds them
+        RenderQueue queue{};
+        for (int copy = 0; copy < 4; ++copy)
+        {
+            for (uint16_t geometryId = 0; geometryId < 4; ++geometryId)
+            {
+                for (uint16_t materialId = 0; materialId < 3; ++materialId)
+                {
+                    queue.Add(MakePacket(geometryId, materialId, static_cast<uint8_t>(materialId % 2), static_cast<float>(copy)));
+                }
+            }
+        }
+        const size_t numPackets = queue.GetPacketCount();
+
+        RecordingBackend unsortedBackend{};
+        const RenderQueueStats unsortedStats = queue.Submit(unsortedBackend);
+
+        queue.Sort();
+        RecordingBackend       backend{};
+        const RenderQueueStats stats = queue.Submit(backend);
+
+        // Every packet is drawn once, sorted or not
+        EXPECT_EQ(stats.packets,                                          numPackets);
+        EXPECT_EQ(CountCommands(backend, RenderCommandType::Draw),         numPackets);
+        EXPECT_EQ(CountCommands(unsortedBackend, RenderCommandType::Draw), numPackets);
+
+        // One bind per run of equal state: each material once, each geometry once per material
+        EXPECT_EQ(stats.materialBinds, 3u);
+        EXPECT_EQ(stats.passBinds,     3u);
+        EXPECT_EQ(stats.geometryBinds, 3u * 4u);
+        EXPECT_EQ(CountCommands(backend, RenderCommandType::BindMaterial), stats.materialBinds);
+        EXPECT_EQ(CountCommands(backend, RenderCommandType::BindPass),     stats.passBinds);
+        EXPECT_EQ(CountCommands(backend, RenderCommandType::BindGeometry), stats.geometryBinds);
+        EXPECT_EQ(backend.GetStateChangeCount(), stats.materialBinds + stats.passBinds + stats.geometryBinds);
+        EXPECT_EQ(stats.skippedBinds, 3 * numPackets - backend.GetStateChangeCount());
+
+        // The order they were added in changes material on every packet
+        EXPECT_EQ(unsortedStats.materialBinds, numPackets);
+        EXPECT_LT(backend.GetStateChangeCount(), unsortedBackend.GetStateChangeCount());
+    }
+
+    TEST(RenderQueueSubmit, EveryDrawFollowsTheBindsOfItsState)
+    {
+        RenderQueue queue{};
+        for (const DrawPacket& packet : MakeRandomPackets(500, 11))
+        {
+            DrawPacket narrowed = packet;
+            narrowed.geometryId %= 3;
+            narrowed.materialId %= 3;
+            narrowed.passIdx    %= 2;
+            queue.Add(narrowed);
+        }
+        queue.Sort();
+
+        RecordingBackend backend{};
+        queue.Submit(backend);
+
+        // Replays the commands, the state bound when a draw is made is always the state of that draw
+        int geometryId = -1;
+        int materialId = -1;
+        int passIdx    = -1;
+        for (const RenderCommand& command : backend.GetCommands())
+        {
+            switch (command.type)
+            {
+                case RenderCommandType::BindGeometry: geometryId = command.geometryId; break;
+                case RenderCommandType::BindMaterial: materialId = command.materialId; passIdx = -1; break;
+                case RenderCommandType::BindPass:     passIdx    = command.passIdx;    break;
+                case RenderCommandType::Draw:
+                    EXPECT_EQ(geometryId, command.geometryId);
+                    EXPECT_EQ(materialId, command.materialId);
+                    EXPECT_EQ(passIdx,    command.passIdx);
+                    break;
+            }
+        }
+    }
+#pragma endregion
+}
@@ -0,0 +1,327 @@
+#include "StateObjectCache.h"
+#include "StateDescriptors.h"
+
+// Standard includes
+#include <cstring>
+#include <memory>
+#include <set>
+
+// Test includes
+#include <gtest/gtest.h>
+
+namespace dae
+{
+    namespace
+    {
+        // Look-alikes of the D3D11 descriptors, same members and layout: BOOL and the enums are 32-bit
+        struct RenderTargetBlendDesc
+        {
+            int     BlendEnable;
+            int     SrcBlend;
+            int     DestBlend;
+            int     BlendOp;
+            int     SrcBlendAlpha;
+            int     DestBlendAlpha;
+            int     BlendOpAlpha;
+            uint8_t RenderTargetWriteMask;
+        };
+
+        struct BlendDesc
+        {
+            int                   AlphaToCoverageEnable;
+            int                   IndependentBlendEnable;
+            RenderTargetBlendDesc RenderTarget[8];
+        };
+
+        struct DepthStencilOpDesc
+        {
+            int StencilFailOp;
+            int StencilDepthFailOp;
+            int StencilPassOp;
+            int StencilFunc;
+        };
+
+        struct DepthStencilDesc
+        {
+            int                DepthEnable;
+            int                DepthWriteMask;
+            int                DepthFunc;
+            int                StencilEnable;
+            uint8_t            StencilReadMask;
+            uint8_t            StencilWriteMask;
+            DepthStencilOpDesc FrontFace;
+            DepthStencilOpDesc BackFace;
+        };
+
+        struct RasterizerDesc
+        {
+            int   FillMode;
+            int   CullMode;
+            int   FrontCounterClockwise;
+            int   DepthBias;
+            float DepthBiasClamp;
+            float SlopeScaledDepthBias;
+            int   DepthClipEnable;
+            int   ScissorEnable;
+            int   MultisampleEnable;
+            int   AntialiasedLineEnable;
+        };
+
+        struct SamplerDesc
+        {
+            int      Filter;
+            int      AddressU;
+            int      AddressV;
+            int      AddressW;
+            float    MipLODBias;
+            uint32_t MaxAnisotropy;
+            int      ComparisonFunc;
+            float    BorderColor[4];
+            float    MinLOD;
+            float    MaxLOD;
+        };
+
+        // Hands out distinct dummy objects and counts what the cache asks of it
+        class CountingStateObjectFactory final : public IStateObjectFactory
+        {
+        public:
+            void* Create(StateObjectType type, const void*, size_t) override
+            {
+                ++creates[static_cast<size_t>(type)];
+                if (isRefusing) return nullptr;
+
+                void* objectPtr = new int{};
+                aliveObjects.insert(objectPtr);
+                return objectPtr;
+            }
+
+            void Destroy(StateObjectType type, void* objectPtr) override
+            {
+                ++destroys[static_cast<size_t>(type)];
+                EXPECT_EQ(aliveObjects.erase(objectPtr), 1u) << "destroyed an object it never created, or twice";
+                delete static_cast<int*>(objectPtr);
+            }
+
+            int GetCreateCount() const
+            {
+                int count = 0;
+                for (const int typeCount : creates)
+                {
+                    count += typeCount;
+                }
+                return count;
+            }
+
+            std::array<int, static_cast<size_t>(StateObjectType::COUNT)> creates      {};
+            std::array<int, static_cast<size_t>(StateObjectType::COUNT)> destroys     {};
+            std::set<void*>                                              aliveObjects {};
+            bool                                                         isRefusing   = false;
+        };
+
+        // Every byte set, padding included, like a descriptor on the stack that was never zeroed
+        template <typename Desc>
+        Desc CreateDirty(uint8_t garbage)
+        {
+            Desc dirty;
+            std::memset(&dirty, garbage, sizeof(dirty));
+            return dirty;
+        }
+
+        RasterizerDesc MakeRasterizerDesc(int cullMode)
+        {
+            RasterizerDesc desc = StateDescriptors::CreateZeroed<RasterizerDesc>();
+            desc.FillMode        = 3;
+            desc.CullMode        = cullMode;
+            desc.DepthClipEnable = 1;
+            return desc;
+        }
+
+        void FillBlendTarget(RenderTargetBlendDesc& target)
+        {
+            target.BlendEnable           = 1;
+            target.SrcBlend              = 5;
+            target.DestBlend             = 6;
+            target.BlendOp               = 1;
+            target.SrcBlendAlpha         = 2;
+            target.DestBlendAlpha        = 1;
+            target.BlendOpAlpha          = 1;
+            target.RenderTargetWriteMask = 0x0F;
+        }
+    }
+
+#pragma region Deduplication
+    TEST(StateObjectCache, EqualDescriptorsShareOneObject)
+    {
+        CountingStateObjectFactory factory{};
+        StateObjectCache           cache{factory};
+
+        void* firstPtr  = cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(3));
+        void* secondPtr = cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(3));
+        void* otherPtr  = cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(1));
+
+        ASSERT_NE(firstPtr, nullptr);
+        EXPECT_EQ(firstPtr, secondPtr);
+        EXPECT_NE(firstPtr, otherPtr);
+        EXPECT_EQ(factory.GetCreateCount(), 2);
+
+        const StateCacheStats& stats = cache.GetStats();
+        EXPECT_EQ(stats.lookups,   3u);
+        EXPECT_EQ(stats.hits,      1u);
+        EXPECT_EQ(stats.creations, 2u);
+        EXPECT_EQ(stats.objectCounts[static_cast<size_t>(StateObjectType::Rasterizer)], 2);
+    }
+
+    TEST(StateObjectCache, EqualBytesOfAnotherTypeAreAnotherObject)
+    {
+        CountingStateObjectFactory factory{};
+        StateObjectCache           cache{factory};
+
+        const SamplerDesc desc = StateDescriptors::CreateZeroed<SamplerDesc>();
+        void* samplerPtr       = cache.Acquire(StateObjectType::Sampler,    desc);
+        void* rasterizerPtr    = cache.Acquire(StateObjectType::Rasterizer, &desc, sizeof(desc));
+
+        EXPECT_NE(samplerPtr, rasterizerPtr);
+        EXPECT_EQ(factory.creates[static_cast<size_t>(StateObjectType::Sampler)],    1);
+        EXPECT_EQ(factory.creates[static_cast<size_t>(StateObjectType::Rasterizer)], 1);
+    }
+
+    TEST(StateObjectCache, DestroysEveryObjectWithTheCache)
+    {
+        CountingStateObjectFactory factory{};
+        {
+            StateObjectCache cache{factory};
+            cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(1));
+            cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(2));
+            cache.Acquire(StateObjectType::Sampler,    StateDescriptors::CreateZeroed<SamplerDesc>());
+            EXPECT_EQ(factory.aliveObjects.size(), 3u);
+        }
+        EXPECT_TRUE(factory.aliveObjects.empty());
+        EXPECT_EQ(factory.destroys[static_cast<size_t>(StateObjectType::Rasterizer)], 2);
+        EXPECT_EQ(factory.destroys[static_cast<size_t>(StateObjectType::Sampler)],    1);
+    }
+#pragma endregion
+
+#pragma region Normalization
+    TEST(StateDescriptors, PaddingNeverReachesTheKey)
+    {
+        // Same members, different garbage in the padding after the 8-bit masks
+        DepthStencilDesc first  = CreateDirty<DepthStencilDesc>(0xAB);
+        DepthStencilDesc second = CreateDirty<DepthStencilDesc>(0xCD);
+        for (DepthStencilDesc* descPtr : {&first, &second})
+        {
+            descPtr->DepthEnable      = 1;
+            descPtr->DepthWriteMask   = 1;
+            descPtr->DepthFunc        = 2;
+            descPtr->StencilEnable    = 0;
+            descPtr->StencilReadMask  = 0xFF;
+            descPtr->StencilWriteMask = 0xFF;
+            descPtr->FrontFace        = DepthStencilOpDesc{1, 1, 1, 8};
+            descPtr->BackFace         = DepthStencilOpDesc{1, 1, 1, 8};
+        }
+        ASSERT_NE(std::memcmp(&first, &second, sizeof(first)), 0);
+
+        const DepthStencilDesc firstNormalized  = StateDescriptors::NormalizeDepthStencilDesc(first);
+        const DepthStencilDesc secondNormalized = StateDescriptors::NormalizeDepthStencilDesc(second);
+        EXPECT_EQ(std::memcmp(&firstNormalized, &secondNormalized, sizeof(firstNormalized)), 0);
+
+        CountingStateObjectFactory factory{};
+        StateObjectCache           cache{factory};
+        EXPECT_EQ(cache.Acquire(StateObjectType::DepthStencil, firstNormalized), cache.Acquire(StateObjectType::DepthStencil, secondNormalized));
+        EXPECT_EQ(factory.GetCreateCount(), 1);
+    }
+
+    TEST(StateDescriptors, UnusedRenderTargetsNeverReachTheKey)
+    {
+        BlendDesc first  = CreateDirty<BlendDesc>(0x11);
+        BlendDesc second = CreateDirty<BlendDesc>(0x22);
+        for (BlendDesc* descPtr : {&first, &second})
+        {
+            descPtr->AlphaToCoverageEnable  = 0;
+            descPtr->IndependentBlendEnable = 0;
+            FillBlendTarget(descPtr->RenderTarget[0]);
+        }
+
+        const BlendDesc firstNormalized  = StateDescriptors::NormalizeBlendDesc(first);
+        const BlendDesc secondNormalized = StateDescriptors::NormalizeBlendDesc(second);
+        EXPECT_EQ(StateObjectCache::HashDescriptor(StateObjectType::Blend, &firstNormalized,  sizeof(firstNormalized)),
+                  StateObjectCache::HashDescriptor(StateObjectType::Blend, &secondNormalized, sizeof(secondNormalized)));
+        EXPECT_EQ(std::memcmp(&firstNormalized, &secondNormalized, sizeof(firstNormalized)), 0);
+
+        // With independent blending every target counts
+        first.IndependentBlendEnable  = 1;
+        second.IndependentBlendEnable = 1;
+        const BlendDesc firstIndependent  = StateDescriptors::NormalizeBlendDesc(first);
+        const BlendDesc secondIndependent = StateDescriptors::NormalizeBlendDesc(second);
+        EXPECT_EQ(std::memcmp(&firstIndependent.RenderTarget[0], &secondIndependent.RenderTarget[0], sizeof(RenderTargetBlendDesc)), 0);
+        EXPECT_NE(std::memcmp(&firstIndependent, &secondIndependent, sizeof(firstIndependent)), 0);
+    }
+
+    TEST(StateDescriptors, EveryMemberTheDeviceReadsIsKept)
+    {
+        RasterizerDesc rasterizer = CreateDirty<RasterizerDesc>(0x5A);
+        rasterizer.DepthBiasClamp = 0.5f;
+        const RasterizerDesc normalizedRasterizer = StateDescriptors::NormalizeRasterizerDesc(rasterizer);
+        EXPECT_EQ(std::memcmp(&rasterizer, &normalizedRasterizer, sizeof(rasterizer)), 0) << "the rasterizer descriptor has no padding to drop";
+
+        SamplerDesc sampler = CreateDirty<SamplerDesc>(0x3C);
+        sampler.BorderColor[2] = 0.25f;
+        sampler.MaxLOD         = 1000.0f;
+        const SamplerDesc normalizedSampler = StateDescriptors::NormalizeSamplerDesc(sampler);
+        EXPECT_EQ(std::memcmp(&sampler, &normalizedSampler, sizeof(sampler)), 0) << "the sampler descriptor has no padding to drop";
+    }
+#pragma endregion
+
+#pragma region Failures
+    TEST(StateObjectCache, RefusedDescriptorsAreNotCached)
+    {
+        CountingStateObjectFactory factory{};
+        StateObjectCache           cache{factory};
+        const RasterizerDesc       desc = MakeRasterizerDesc(3);
+
+        factory.isRefusing = true;
+        EXPECT_EQ(cache.Acquire(StateObjectType::Rasterizer, desc), nullptr);
+        EXPECT_EQ(cache.Acquire(StateObjectType::Rasterizer, desc), nullptr);
+        EXPECT_EQ(factory.GetCreateCount(), 2) << "every request for a refused descriptor asks the factory again";
+        EXPECT_EQ(cache.GetStats().failures, 2u);
+        EXPECT_EQ(cache.GetStats().hits,     0u);
+        EXPECT_EQ(cache.GetStats().objectCounts[static_cast<size_t>(StateObjectType::Rasterizer)], 0);
+
+        // Once the factory accepts it, it is created and cached like any other
+        factory.isRefusing = false;
+        void* objectPtr = cache.Acquire(StateObjectType::Rasterizer, desc);
+        ASSERT_NE(objectPtr, nullptr);
+        EXPECT_EQ(cache.Acquire(StateObjectType::Rasterizer, desc), objectPtr);
+        EXPECT_EQ(factory.GetCreateCount(), 3);
+        EXPECT_EQ(cache.GetStats().creations, 3u);
+        EXPECT_EQ(cache.GetStats().failures,  2u);
+    }
+#pragma endregion
+
+#pragma region Seal
+    TEST(StateObjectCache, CreationsAfterSealAreLate)
+    {
+        CountingStateObjectFactory factory{};
+        StateObjectCache           cache{factory};
+
+        void* prewarmedPtr = cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(3));
+        EXPECT_FALSE(cache.IsSealed());
+        cache.Seal();
+        EXPECT_TRUE(cache.IsSealed());
+
+        // Prewarmed states are hits, not late
+        EXPECT_EQ(cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(3)), prewarmedPtr);
+        EXPECT_EQ(cache.GetStats().lateCreations, 0u);
+
+        cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(1));
+        cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(1));
+        EXPECT_EQ(cache.GetStats().lateCreations, 1u);
+        EXPECT_EQ(cache.GetStats().creations,     2u);
+
+        // A refused attempt after the seal still went to the factory
+        factory.isRefusing = true;
+        EXPECT_EQ(cache.Acquire(StateObjectType::Rasterizer, MakeRasterizerDesc(2)), nullptr);
+        EXPECT_EQ(cache.GetStats().lateCreations, 2u);
+        EXPECT_EQ(cache.GetStats().failures,      1u);
+    }
+#pragma endregion
+}